@@ -17,12 +17,17 @@
 #include "heightmap/FlatElevationProvider.hpp"
 #include "heightmap/GridElevationProvider.hpp"
 #include "heightmap/SrtmElevationProvider.hpp"
+#include "index/BoundingBoxVisitor.hpp"
+#include "index/ElementCopier.hpp"
 #include "index/GeoStore.hpp"
 #include "index/InMemoryElementStore.hpp"
+#include "index/PackedElementStore.hpp"
 #include "index/PersistentElementStore.hpp"
 #include "mapcss/MapCssParser.hpp"
 #include "mapcss/StyleSheet.hpp"
 #include "utils/CoreUtils.hpp"
+#include "utils/FileUtils.hpp"
+#include "utils/GeoUtils.hpp"
 
 #include "Callbacks.hpp"
 #include "ExportElementVisitor.hpp"
@@ -30,12 +35,14 @@
 #include <exception>
 #include <fstream>
 #include <memory>
+#include <thread>
 #include <vector>
 
 /// Exposes API for external usage.
 class Application {
  public:
   enum class ElevationDataType { Flat = 0, Srtm, Grid };
+  enum class PersistentStoreType { Files = 0, Packed };
 
   /// Composes object graph.
   explicit Application(const char *dataPath) :
@@ -43,10 +50,20 @@ class Application {
       stringTable_(dataPath),
       geoStore_(stringTable_),
       flatEleProvider_(), srtmEleProvider_(dataPath), gridEleProvider_(dataPath),
-      quadKeyBuilder_(geoStore_, stringTable_) {
+      quadKeyBuilder_(geoStore_, stringTable_),
+      importOptions_(createImportOptions()) {
     registerDefaultBuilders();
   }
 
+  /// Saves style rules matched during session, so next one does not match them again.
+  ~Application() {
+    for (const auto &pair : styleProviders_) {
+      std::ofstream file(getStyleMatchesPath(*pair.second), std::ios::out | std::ios::binary | std::ios::trunc);
+      if (file.good())
+        pair.second->writeMatches(file);
+    }
+  }
+
   /// Registers stylesheet.
   void registerStylesheet(const char *path, OnNewDirectory *directoryCallback) {
     auto &styleProvider = getStyleProvider(path);
@@ -59,11 +76,36 @@ class Application {
     geoStore_.registerStore(key, utymap::utils::make_unique<utymap::index::InMemoryElementStore>(stringTable_));
   }
 
-  /// Registers new persistent store.
-  void registerPersistentStore(const char *key, const char *dataPath, OnNewDirectory *directoryCallback) {
-    geoStore_
-        .registerStore(key, utymap::utils::make_unique<utymap::index::PersistentElementStore>(dataPath, stringTable_));
-    createDataDirs(dataPath_ + "data/", directoryCallback);
+  /// Registers new in-memory store which keeps at most given amount of bytes in memory
+  /// and moves least recently searched tiles to persistent store of given type. Spilled
+  /// tiles are kept in "spill" subdirectory of given path which is cleared on registration
+  /// as in-memory store starts empty.
+  void registerInMemoryStore(const char *key,
+                             std::size_t memoryBudget,
+                             const char *spillDataPath,
+                             const PersistentStoreType &spillStoreType,
+                             OnNewDirectory *directoryCallback) {
+    std::string spillPath = std::string(spillDataPath) + "spill/";
+    utymap::utils::FileUtils::removeDirectory(spillPath);
+    createDataDirs(spillPath + "data/", directoryCallback);
+    geoStore_.registerStore(key, utymap::utils::make_unique<utymap::index::InMemoryElementStore>(
+        stringTable_, memoryBudget, createPersistentStore(spillPath, spillStoreType)));
+  }
+
+  /// Registers new persistent store of given type.
+  void registerPersistentStore(const char *key,
+                               const char *dataPath,
+                               const PersistentStoreType &storeType,
+                               OnNewDirectory *directoryCallback) {
+    // NOTE store opens its files on creation, so directories are created first.
+    createDataDirs(std::string(dataPath) + "data/", directoryCallback);
+    // NOTE osm data is kept there to apply change files to stored elements, if enabled.
+    geoStore_.registerStore(key, createPersistentStore(dataPath, storeType), std::string(dataPath) + "data/osm");
+  }
+
+  /// Enables or disables keeping osm data of imported files, which is required to apply change files.
+  void enableSourceData(bool enabled) {
+    importOptions_.keepsSourceData = enabled;
   }
 
   /// Enables or disables mesh caching.
@@ -81,7 +123,7 @@ class Application {
                   const utymap::QuadKey &quadKey,
                   OnError *errorCallback) {
     safeExecute([&]() {
-      geoStore_.add(key, path, quadKey, getStyleProvider(styleFile));
+      geoStore_.add(key, path, quadKey, getStyleProvider(styleFile), importOptions_);
     }, errorCallback);
   }
 
@@ -93,7 +135,7 @@ class Application {
                   const utymap::LodRange &range,
                   OnError *errorCallback) {
     safeExecute([&]() {
-      geoStore_.add(key, path, bbox, range, getStyleProvider(styleFile));
+      geoStore_.add(key, path, bbox, range, getStyleProvider(styleFile), importOptions_);
     }, errorCallback);
   }
 
@@ -104,7 +146,7 @@ class Application {
                   const utymap::LodRange &range,
                   OnError *errorCallback) {
     safeExecute([&]() {
-      geoStore_.add(key, path, range, getStyleProvider(styleFile));
+      geoStore_.add(key, path, range, getStyleProvider(styleFile), importOptions_);
     }, errorCallback);
   }
 
@@ -119,10 +161,46 @@ class Application {
     }, errorCallback);
   }
 
+  /// Applies osm change file to store and invalidates cached meshes of affected quadkeys.
+  void applyChanges(const char *key,
+                    const char *styleFile,
+                    const char *path,
+                    const utymap::LodRange &range,
+                    OnError *errorCallback) {
+    safeExecute([&]() {
+      auto quadKeys = geoStore_.applyChanges(key, path, range, getStyleProvider(styleFile));
+      // NOTE cache is invalidated for every style, not only ones loaded by application.
+      for (const auto &meshCache : meshCaches_) {
+        for (const auto &quadKey : quadKeys)
+          meshCache.second->invalidate(quadKey);
+      }
+    }, errorCallback);
+  }
+
+  /// Removes element from store.
+  void removeFromStore(const char *key,
+                       const utymap::entities::Element &element,
+                       const utymap::LodRange &range,
+                       OnError *errorCallback) {
+    safeExecute([&]() {
+      geoStore_.erase(key, element, range);
+    }, errorCallback);
+  }
+
   bool hasData(const utymap::QuadKey &quadKey) const {
     return geoStore_.hasData(quadKey);
   }
 
+  /// Checks whether quadkeys of higher level of details inside given one have data.
+  bool hasDescendantData(const utymap::QuadKey &quadKey) const {
+    return geoStore_.hasDescendantData(quadKey);
+  }
+
+  /// Checks whether quadkeys of lower level of details containing given one have data.
+  bool hasAncestorData(const utymap::QuadKey &quadKey) const {
+    return geoStore_.hasAncestorData(quadKey);
+  }
+
   /// Loads given quadKey.
   void loadQuadKey(int tag,
                    const char *styleFile,
@@ -154,6 +232,91 @@ class Application {
     }, errorCallback);
   }
 
+  /// Builds given quadkey without reporting results, so its output only ends up in mesh caches.
+  void buildQuadKey(const char *styleFile,
+                    const utymap::QuadKey &quadKey,
+                    const ElevationDataType &eleDataType,
+                    OnError *errorCallback,
+                    const utymap::CancellationToken &cancellationToken) {
+    safeExecute([&]() {
+      quadKeyBuilder_.build(quadKey, getStyleProvider(styleFile), getElevationProvider(quadKey, eleDataType),
+                            [](const utymap::math::Mesh &) {}, [](const utymap::entities::Element &) {},
+                            cancellationToken);
+    }, errorCallback);
+  }
+
+  /// Searches elements within radius in meters around given coordinate using data of
+  /// given level of details. Elements are reported in distance order.
+  void searchElements(int tag,
+                      const char *styleFile,
+                      const utymap::GeoCoordinate &coordinate,
+                      double radius,
+                      int levelOfDetail,
+                      const ElevationDataType &eleDataType,
+                      OnElementLoaded *elementCallback,
+                      OnError *errorCallback,
+                      utymap::CancellationToken *cancellationToken) {
+    safeExecute([&]() {
+      auto quadKey = utymap::utils::GeoUtils::GeoCoordinateToQuadKey(coordinate, levelOfDetail);
+      auto &styleProvider = getStyleProvider(styleFile);
+      auto &eleProvider = getElevationProvider(quadKey, eleDataType);
+      ExportElementVisitor elementVisitor(tag, quadKey, stringTable_, styleProvider, eleProvider, elementCallback);
+      geoStore_.search(coordinate, radius, levelOfDetail, elementVisitor, *cancellationToken);
+    }, errorCallback);
+  }
+
+  /// Searches elements of given quadkey which tags match filter.
+  void searchElements(int tag,
+                      const char *styleFile,
+                      const utymap::QuadKey &quadKey,
+                      const utymap::index::TagFilter &filter,
+                      const ElevationDataType &eleDataType,
+                      OnElementLoaded *elementCallback,
+                      OnError *errorCallback,
+                      utymap::CancellationToken *cancellationToken) {
+    safeExecute([&]() {
+      auto &styleProvider = getStyleProvider(styleFile);
+      auto &eleProvider = getElevationProvider(quadKey, eleDataType);
+      ExportElementVisitor elementVisitor(tag, quadKey, stringTable_, styleProvider, eleProvider, elementCallback);
+      geoStore_.search(quadKey, filter, elementVisitor, *cancellationToken);
+    }, errorCallback);
+  }
+
+  /// Finds elements with given id stored at given level of details. Clipped element is
+  /// reported once per quadkey where it is stored.
+  void findElementById(int tag,
+                       const char *styleFile,
+                       std::uint64_t id,
+                       int levelOfDetail,
+                       const ElevationDataType &eleDataType,
+                       OnElementLoaded *elementCallback,
+                       OnError *errorCallback,
+                       utymap::CancellationToken *cancellationToken) {
+    safeExecute([&]() {
+      struct ElementCollector : utymap::entities::ElementVisitor {
+        void visitNode(const utymap::entities::Node &node) override { add(node); }
+        void visitWay(const utymap::entities::Way &way) override { add(way); }
+        void visitArea(const utymap::entities::Area &area) override { add(area); }
+        void visitRelation(const utymap::entities::Relation &relation) override { add(relation); }
+        void add(const utymap::entities::Element &element) {
+          elements.push_back(utymap::index::ElementCopier::copy(element));
+        }
+        std::vector<std::shared_ptr<utymap::entities::Element>> elements;
+      } collector;
+      geoStore_.findElementById(id, levelOfDetail, collector, *cancellationToken);
+
+      // NOTE elements are found in different quadkeys, so each one is exported using its own.
+      auto &styleProvider = getStyleProvider(styleFile);
+      for (const auto &element : collector.elements) {
+        auto center = utymap::index::BoundingBoxVisitor::create(*element).center();
+        auto quadKey = utymap::utils::GeoUtils::GeoCoordinateToQuadKey(center, levelOfDetail);
+        ExportElementVisitor elementVisitor(tag, quadKey, stringTable_, styleProvider,
+                                            getElevationProvider(quadKey, eleDataType), elementCallback);
+        element->accept(elementVisitor);
+      }
+    }, errorCallback);
+  }
+
   /// Gets id for the string.
   std::uint32_t getStringId(const char *str) const {
     return stringTable_.getId(str);
@@ -177,6 +340,19 @@ class Application {
     }
   }
 
+  /// Creates import options which use all available cores.
+  static utymap::index::ImportOptions createImportOptions() {
+    utymap::index::ImportOptions options;
+    unsigned int cores = std::thread::hardware_concurrency();
+    // NOTE parsing and writer threads take two cores, pbf decoders and import workers
+    // share the rest as they run at the same time.
+    std::size_t threads = cores > 2 ? cores - 2 : 0;
+    options.parserWorkerCount = threads/3;
+    options.workerCount = threads - options.parserWorkerCount;
+    options.storesNodeLocations = true;
+    return options;
+  }
+
   const utymap::heightmap::ElevationProvider &getElevationProvider(const utymap::QuadKey &quadKey,
                                                                    const ElevationDataType &eleDataType) const {
     switch (eleDataType) {
@@ -186,6 +362,16 @@ class Application {
     }
   }
 
+  std::unique_ptr<utymap::index::ElementStore> createPersistentStore(const std::string &dataPath,
+                                                                     const PersistentStoreType &storeType) const {
+    switch (storeType) {
+      case PersistentStoreType::Packed:
+        return utymap::utils::make_unique<utymap::index::PackedElementStore>(dataPath, stringTable_);
+      default:
+        return utymap::utils::make_unique<utymap::index::PersistentElementStore>(dataPath, stringTable_);
+    }
+  }
+
   const utymap::mapcss::StyleProvider &getStyleProvider(const std::string &stylePath) {
     auto pair = styleProviders_.find(stylePath);
     if (pair!=styleProviders_.end())
@@ -200,35 +386,34 @@ class Application {
     utymap::mapcss::MapCssParser parser(dir);
     utymap::mapcss::StyleSheet stylesheet = parser.parse(styleFile);
 
-    styleProviders_.emplace(
-        stylePath,
-        utymap::utils::make_unique<const utymap::mapcss::StyleProvider>(stylesheet, stringTable_));
+    auto styleProvider = utymap::utils::make_unique<const utymap::mapcss::StyleProvider>(stylesheet, stringTable_);
+    std::ifstream matchesFile(getStyleMatchesPath(*styleProvider), std::ios::in | std::ios::binary);
+    if (matchesFile.good())
+      styleProvider->readMatches(matchesFile);
+    styleProviders_.emplace(stylePath, std::move(styleProvider));
 
     return *styleProviders_[stylePath];
   }
 
+  /// Gets path to file with style rules matched by elements. It is kept in cache
+  /// directory of the stylesheet, so it is not reused when stylesheet is changed.
+  std::string getStyleMatchesPath(const utymap::mapcss::StyleProvider &styleProvider) const {
+    return dataPath_ + "cache/" + styleProvider.getTag() + "/styles.dat";
+  }
+
   void registerDefaultBuilders() {
-    registerBuilder<utymap::builders::TerraBuilder>("terrain", true);
+    registerBuilder<utymap::builders::TerraBuilder>("terrain");
     registerBuilder<utymap::builders::BuildingBuilder>("building");
     registerBuilder<utymap::builders::TreeBuilder>("tree");
     registerBuilder<utymap::builders::BarrierBuilder>("barrier");
     registerBuilder<utymap::builders::LampBuilder>("lamp");
   }
 
+  /// Registers builder which output is cached in its own mesh cache.
   template<typename Builder>
-  void registerBuilder(const std::string &name, bool useCache = false) {
-    if (useCache)
-      meshCaches_.emplace(name, utymap::utils::make_unique<utymap::builders::MeshCache>(dataPath_, name));
-
-    quadKeyBuilder_
-        .registerElementBuilder(name, useCache ? createCacheFactory<Builder>(name) : createFactory<Builder>());
-  }
-
-  template<typename Builder>
-  utymap::builders::QuadKeyBuilder::ElementBuilderFactory createFactory() const {
-    return [](const utymap::builders::BuilderContext &context) {
-      return utymap::utils::make_unique<Builder>(context);
-    };
+  void registerBuilder(const std::string &name) {
+    meshCaches_.emplace(name, utymap::utils::make_unique<utymap::builders::MeshCache>(dataPath_, name));
+    quadKeyBuilder_.registerElementBuilder(name, createCacheFactory<Builder>(name));
   }
 
   template<typename Builder>
@@ -257,6 +442,7 @@ class Application {
   utymap::heightmap::GridElevationProvider gridEleProvider_;
 
   utymap::builders::QuadKeyBuilder quadKeyBuilder_;
+  utymap::index::ImportOptions importOptions_;
   std::unordered_map<std::string, std::unique_ptr<utymap::builders::MeshCache>> meshCaches_;
   std::unordered_map<std::string, std::unique_ptr<const utymap::mapcss::StyleProvider>> styleProviders_;
 };
@@ -48,15 +48,13 @@ struct ExportElementVisitor : public utymap::entities::ElementVisitor {
 
   void visitElement(const utymap::entities::Element &element, const Coordinates &coordinates) {
     // convert tags
+    // NOTE string table keeps null terminated strings alive, so they are not copied.
     std::vector<const char *> ctags;
-    tagStrings_.reserve(element.tags.size()*2);
     ctags.reserve(element.tags.size()*2);
     for (std::size_t i = 0; i < element.tags.size(); ++i) {
       const utymap::entities::Tag &tag = element.tags[i];
-      tagStrings_.push_back(stringTable_.getString(tag.key));
-      tagStrings_.push_back(stringTable_.getString(tag.value));
-      ctags.push_back(tagStrings_[tagStrings_.size() - 2].c_str());
-      ctags.push_back(tagStrings_[tagStrings_.size() - 1].c_str());
+      ctags.push_back(stringTable_.getStringView(tag.key).data);
+      ctags.push_back(stringTable_.getStringView(tag.value).data);
     }
     // convert geometry
     vertices_.reserve(coordinates.size()*3);
@@ -70,13 +68,12 @@ struct ExportElementVisitor : public utymap::entities::ElementVisitor {
     utymap::mapcss::Style style = styleProvider_.forElement(element, quadKey_.levelOfDetail);
     std::vector<const char *> cstyles;
     auto declarations = style.declarations();
-    styleStrings_.reserve(declarations.size()*2);
-    cstyles.reserve(declarations.size());
+    styleStrings_.reserve(declarations.size());
+    cstyles.reserve(declarations.size()*2);
     for (const auto &declaration : declarations) {
-      styleStrings_.push_back(stringTable_.getString(declaration->key()));
       styleStrings_.push_back(declaration->value());
-      cstyles.push_back(styleStrings_[styleStrings_.size() - 2].c_str());
-      cstyles.push_back(styleStrings_[styleStrings_.size() - 1].c_str());
+      cstyles.push_back(stringTable_.getStringView(declaration->key()).data);
+      cstyles.push_back(styleStrings_.back().c_str());
     }
 
     elementCallback_(tag_, element.id,
@@ -86,7 +83,6 @@ struct ExportElementVisitor : public utymap::entities::ElementVisitor {
 
     // NOTE clear vectors after raw array data is consumed by external code
     vertices_.clear();
-    tagStrings_.clear();
     styleStrings_.clear();
   }
 
@@ -97,7 +93,6 @@ struct ExportElementVisitor : public utymap::entities::ElementVisitor {
   const utymap::heightmap::ElevationProvider &eleProvider_;
   OnElementLoaded *elementCallback_;
   std::vector<double> vertices_;
-  std::vector<std::string> tagStrings_;   // holds temporary tag strings
   std::vector<std::string> styleStrings_; // holds temporary style strings
 };
 
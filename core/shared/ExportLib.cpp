@@ -10,6 +10,52 @@
 
 static Application *applicationPtr = nullptr;
 
+namespace {
+/// Creates node, way or area from vertices and passes it to given function.
+template<typename Function>
+void withElement(std::uint64_t id, const double *vertices, int vertexLength,
+                 const char **tags, int tagLength, const Function &function) {
+  std::vector<utymap::entities::Tag> elementTags;
+  elementTags.reserve(static_cast<std::size_t>(tagLength/2));
+  for (std::size_t i = 0; i < tagLength; i += 2) {
+    auto keyId = applicationPtr->getStringId(tags[i]);
+    auto valueId = applicationPtr->getStringId(tags[i + 1]);
+    elementTags.push_back(utymap::entities::Tag(keyId, valueId));
+  }
+
+  // Node
+  if (vertexLength/2==1) {
+    utymap::entities::Node node;
+    node.id = id;
+    node.tags = elementTags;
+    node.coordinate = utymap::GeoCoordinate(vertices[0], vertices[1]);
+    function(node);
+    return;
+  }
+
+  std::vector<utymap::GeoCoordinate> coordinates;
+  coordinates.reserve(static_cast<std::size_t>(vertexLength/2));
+  for (int i = 0; i < vertexLength; i += 2) {
+    coordinates.push_back(utymap::GeoCoordinate(vertices[i], vertices[i + 1]));
+  }
+
+  // Way or Area
+  if (coordinates[0]==coordinates[coordinates.size() - 1]) {
+    utymap::entities::Area area;
+    area.id = id;
+    area.coordinates = coordinates;
+    area.tags = elementTags;
+    function(area);
+  } else {
+    utymap::entities::Way way;
+    way.id = id;
+    way.coordinates = coordinates;
+    way.tags = elementTags;
+    function(way);
+  }
+}
+}
+
 extern "C"
 {
 /// Performs cleanup.
@@ -41,8 +87,11 @@ void EXPORT_API registerInMemoryStore(const char *key) {
 /// Registers new persistent store.
 void EXPORT_API registerPersistentStore(const char *key,
                                         const char *dataPath,
+                                        int storeType,     // 0 - file per tile, 1 - packed file per lod
                                         OnNewDirectory *directoryCallback) {
-  applicationPtr->registerPersistentStore(key, dataPath, directoryCallback);
+  applicationPtr->registerPersistentStore(key, dataPath,
+                                          static_cast<Application::PersistentStoreType>(storeType),
+                                          directoryCallback);
 }
 
 /// Enables or disables mesh caching. By default, it is disabled.
@@ -50,6 +99,12 @@ void EXPORT_API enableMeshCache(int enabled) {
   applicationPtr->enableMeshCache(enabled > 0);
 }
 
+/// Enables or disables keeping osm data of imported files. By default, it is disabled.
+/// NOTE it should be enabled before import to apply change files to imported data.
+void EXPORT_API enableSourceData(int enabled) {
+  applicationPtr->enableSourceData(enabled > 0);
+}
+
 /// Adds data to store to specific level of details range.
 void EXPORT_API addToStoreInRange(const char *key,           // store key
                                   const char *styleFile,     // style file
@@ -87,6 +142,16 @@ void EXPORT_API addToStoreInQuadKey(const char *key,           // store key
   applicationPtr->addToStore(key, styleFile, path, utymap::QuadKey(levelOfDetail, tileX, tileY), errorCallback);
 }
 
+/// Applies osm change file to store in specific level of details range.
+void EXPORT_API applyChangesInRange(const char *key,           // store key
+                                    const char *styleFile,     // style file
+                                    const char *path,          // path to osm change file
+                                    int startLod,              // start zoom level
+                                    int endLod,                // end zoom level
+                                    OnError *errorCallback) {
+  applicationPtr->applyChanges(key, styleFile, path, utymap::LodRange(startLod, endLod), errorCallback);
+}
+
 /// Adds element to store. NOTE: relation is not yet supported.
 void EXPORT_API addToStoreElement(const char *key,           // store key
                                   const char *styleFile,     // style file
@@ -98,45 +163,22 @@ void EXPORT_API addToStoreElement(const char *key,           // store key
                                   int startLod,              // start zoom level
                                   int endLod,                // end zoom level
                                   OnError *errorCallback) {
-  utymap::LodRange lod(startLod, endLod);
-  std::vector<utymap::entities::Tag> elementTags;
-  elementTags.reserve(static_cast<std::size_t>(tagLength/2));
-  for (std::size_t i = 0; i < tagLength; i += 2) {
-    auto keyId = applicationPtr->getStringId(tags[i]);
-    auto valueId = applicationPtr->getStringId(tags[i + 1]);
-    elementTags.push_back(utymap::entities::Tag(keyId, valueId));
-  }
-
-  // Node
-  if (vertexLength/2==1) {
-    utymap::entities::Node node;
-    node.id = id;
-    node.tags = elementTags;
-    node.coordinate = utymap::GeoCoordinate(vertices[0], vertices[1]);
-    applicationPtr->addToStore(key, styleFile, node, lod, errorCallback);
-    return;
-  }
-
-  std::vector<utymap::GeoCoordinate> coordinates;
-  coordinates.reserve(static_cast<std::size_t>(vertexLength/2));
-  for (int i = 0; i < vertexLength; i += 2) {
-    coordinates.push_back(utymap::GeoCoordinate(vertices[i], vertices[i + 1]));
-  }
+  withElement(id, vertices, vertexLength, tags, tagLength, [&](const utymap::entities::Element &element) {
+    applicationPtr->addToStore(key, styleFile, element, utymap::LodRange(startLod, endLod), errorCallback);
+  });
+}
 
-  // Way or Area
-  if (coordinates[0]==coordinates[coordinates.size() - 1]) {
-    utymap::entities::Area area;
-    area.id = id;
-    area.coordinates = coordinates;
-    area.tags = elementTags;
-    applicationPtr->addToStore(key, styleFile, area, lod, errorCallback);
-  } else {
-    utymap::entities::Way way;
-    way.id = id;
-    way.coordinates = coordinates;
-    way.tags = elementTags;
-    applicationPtr->addToStore(key, styleFile, way, lod, errorCallback);
-  }
+/// Removes element from store. Geometry should be the one used to add element.
+void EXPORT_API removeFromStoreElement(const char *key,           // store key
+                                       std::uint64_t id,          // element id
+                                       const double *vertices,    // vertex array
+                                       int vertexLength,          // vertex array length,
+                                       int startLod,              // start zoom level
+                                       int endLod,                // end zoom level
+                                       OnError *errorCallback) {
+  withElement(id, vertices, vertexLength, nullptr, 0, [&](const utymap::entities::Element &element) {
+    applicationPtr->removeFromStore(key, element, utymap::LodRange(startLod, endLod), errorCallback);
+  });
 }
 
 /// Loads quadkey.
@@ -153,6 +195,59 @@ void EXPORT_API loadQuadKey(int tag,                                 // request
                               meshCallback, elementCallback, errorCallback, cancellationToken);
 }
 
+/// Searches elements within given radius around coordinate in distance order.
+void EXPORT_API searchElements(int tag,                                 // request tag
+                               const char *styleFile,                   // style file
+                               double latitude, double longitude,       // search center
+                               double radius,                           // radius in meters
+                               int levelOfDetail,                       // level of detail
+                               int eleDataType,                         // elevation data type
+                               OnElementLoaded *elementCallback,        // element callback
+                               OnError *errorCallback,                  // completion callback
+                               utymap::CancellationToken *cancellationToken) {
+  applicationPtr->searchElements(tag, styleFile, utymap::GeoCoordinate(latitude, longitude), radius, levelOfDetail,
+                                 static_cast<Application::ElevationDataType>(eleDataType),
+                                 elementCallback, errorCallback, cancellationToken);
+}
+
+/// Searches elements of quadkey which have all given tags. Tags are passed as key and
+/// value pairs, value "*" matches any value of the key.
+void EXPORT_API searchElementsByTags(int tag,                                 // request tag
+                                     const char *styleFile,                   // style file
+                                     int tileX, int tileY, int levelOfDetail, // quadkey info
+                                     const char **tags,                       // tag array
+                                     int tagLength,                           // tag array length
+                                     int eleDataType,                         // elevation data type
+                                     OnElementLoaded *elementCallback,        // element callback
+                                     OnError *errorCallback,                  // completion callback
+                                     utymap::CancellationToken *cancellationToken) {
+  utymap::index::TagFilter filter;
+  for (int i = 0; i + 1 < tagLength; i += 2) {
+    auto keyId = applicationPtr->getStringId(tags[i]);
+    if (std::string(tags[i + 1])=="*")
+      filter.hasKey(keyId);
+    else
+      filter.hasTag(keyId, applicationPtr->getStringId(tags[i + 1]));
+  }
+  applicationPtr->searchElements(tag, styleFile, utymap::QuadKey(levelOfDetail, tileX, tileY), filter,
+                                 static_cast<Application::ElevationDataType>(eleDataType),
+                                 elementCallback, errorCallback, cancellationToken);
+}
+
+/// Finds elements with given id stored at given level of detail.
+void EXPORT_API findElementById(int tag,                                 // request tag
+                                const char *styleFile,                   // style file
+                                std::uint64_t id,                        // element id
+                                int levelOfDetail,                       // level of detail
+                                int eleDataType,                         // elevation data type
+                                OnElementLoaded *elementCallback,        // element callback
+                                OnError *errorCallback,                  // completion callback
+                                utymap::CancellationToken *cancellationToken) {
+  applicationPtr->findElementById(tag, styleFile, id, levelOfDetail,
+                                  static_cast<Application::ElevationDataType>(eleDataType),
+                                  elementCallback, errorCallback, cancellationToken);
+}
+
 /// Checks whether there is data for given quadkey.
 bool EXPORT_API hasData(int tileX, int tileY, int levelOfDetail) {
   return applicationPtr->hasData(utymap::QuadKey(levelOfDetail, tileX, tileY));
@@ -51,7 +51,7 @@ class CacheBuilder final : public ElementBuilder {
     builder_->complete();
     if (cacheContext_) {
       meshCache_.unwrap(*cacheContext_);
-      cacheContext_.release();
+      cacheContext_.reset();
     }
   }
 
@@ -1,9 +1,11 @@
 #include "builders/MeshCache.hpp"
 #include "index/ElementStream.hpp"
 #include "index/MeshStream.hpp"
+#include "utils/FileUtils.hpp"
 
 #include <fstream>
 #include <mutex>
+#include <set>
 
 using namespace utymap;
 using namespace utymap::builders;
@@ -54,8 +56,9 @@ class MeshCache::MeshCacheImpl {
 
     if (entry==cachingQuads_.end()) return;
 
+    bool isStale = staleQuads_.erase(context.quadKey) > 0;
     if (entry->second->good()) {
-      if (context.cancelToken.isCancelled()) {
+      if (context.cancelToken.isCancelled() || isStale) {
         // NOTE no guarantee that all data was processed and saved.
         // So it is better to delete the whole file
         entry->second->close();
@@ -70,6 +73,20 @@ class MeshCache::MeshCacheImpl {
     cachingQuads_.erase(entry);
   }
 
+  void invalidate(const QuadKey &quadKey, const std::string &styleTag) {
+    std::lock_guard<std::mutex> lock(lock_);
+    if (cachingQuads_.find(quadKey)!=cachingQuads_.end())
+      staleQuads_.insert(quadKey);
+    else
+      std::remove(getFilePath(quadKey, styleTag).c_str());
+  }
+
+  void invalidate(const QuadKey &quadKey) {
+    // NOTE every subdirectory of cache is named by tag of style which data it keeps.
+    for (const auto &styleTag : FileUtils::getEntryNames(dataPath_ + "cache/"))
+      invalidate(quadKey, styleTag);
+  }
+
  private:
 
   /// Checks whether the data associated with given context is already cached on disk.
@@ -85,10 +102,14 @@ class MeshCache::MeshCacheImpl {
 
   /// Gets path to cache file on disk.
   std::string getFilePath(const BuilderContext &context) const {
+    return getFilePath(context.quadKey, context.styleProvider.getTag());
+  }
+
+  std::string getFilePath(const QuadKey &quadKey, const std::string &styleTag) const {
     std::stringstream ss;
-    ss << dataPath_ << "cache/" << context.styleProvider.getTag()
-       << "/" << context.quadKey.levelOfDetail << "/"
-       << GeoUtils::quadKeyToString(context.quadKey) << extension_;
+    ss << dataPath_ << "cache/" << styleTag
+       << "/" << quadKey.levelOfDetail << "/"
+       << GeoUtils::quadKeyToString(quadKey) << extension_;
     return ss.str();
   }
 
@@ -97,6 +118,7 @@ class MeshCache::MeshCacheImpl {
     file->open(filePath, std::ios::out | std::ios::binary | std::ios::trunc);
     // NOTE marker that processing in progress
     *file << static_cast<char>(0);
+    ElementStream::writeHeader(*file);
 
     cachingQuads_.insert({context.quadKey, file});
 
@@ -135,6 +157,8 @@ class MeshCache::MeshCacheImpl {
     file.seekg(0, std::ios::beg);
     
     if (!isGood(file)) return;
+    // NOTE caches without header keep elements in the first format version.
+    auto version = ElementStream::readHeader(file);
 
     while (!context.cancelToken.isCancelled()) {
       char type;
@@ -145,7 +169,7 @@ class MeshCache::MeshCacheImpl {
       else if (type==ElementType) {
         std::uint64_t id;
         file.read(reinterpret_cast<char *>(&id), sizeof(id));
-        context.elementCallback(*ElementStream::read(file, id));
+        context.elementCallback(*ElementStream::read(file, id, version));
       } else
         throw std::invalid_argument("Cannot read cache.");
     }
@@ -163,6 +187,8 @@ class MeshCache::MeshCacheImpl {
   const std::string extension_;
   std::mutex lock_;
   std::map<QuadKey, std::shared_ptr<std::fstream>, QuadKey::Comparator> cachingQuads_;
+  /// Quadkeys invalidated while their data is being cached.
+  std::set<QuadKey, QuadKey::Comparator> staleQuads_;
 };
 
 MeshCache::MeshCache(const std::string &directory, const std::string &extension) :
@@ -181,4 +207,12 @@ void MeshCache::unwrap(const BuilderContext &context) const {
   pimpl_->unwrap(context);
 }
 
+void MeshCache::invalidate(const QuadKey &quadKey, const std::string &styleTag) const {
+  pimpl_->invalidate(quadKey, styleTag);
+}
+
+void MeshCache::invalidate(const QuadKey &quadKey) const {
+  pimpl_->invalidate(quadKey);
+}
+
 MeshCache::~MeshCache() {}
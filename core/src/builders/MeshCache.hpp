@@ -36,6 +36,13 @@ class MeshCache final {
   /// Releases context.
   void unwrap(const BuilderContext &context) const;
 
+  /// Removes cached data of the quadkey built using style with given tag.
+  /// NOTE data which is being cached at the moment is discarded on unwrap.
+  void invalidate(const utymap::QuadKey &quadKey, const std::string &styleTag) const;
+
+  /// Removes cached data of the quadkey built using any style which has cache directory.
+  void invalidate(const utymap::QuadKey &quadKey) const;
+
   ~MeshCache();
 
  private:
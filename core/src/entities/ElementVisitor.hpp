@@ -10,6 +10,8 @@ struct Area;
 struct Relation;
 
 /// A base class for visiting entities - elements.
+/// Visited element can be reused by caller after visit method returns,
+/// so visitor should copy data it needs to keep.
 class ElementVisitor {
  public:
   /// Visits node.
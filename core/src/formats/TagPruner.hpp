@@ -0,0 +1,62 @@
+#ifndef FORMATS_TAGPRUNER_HPP_DEFINED
+#define FORMATS_TAGPRUNER_HPP_DEFINED
+
+#include "formats/FormatTypes.hpp"
+
+#include <algorithm>
+#include <string>
+#include <unordered_set>
+
+namespace utymap {
+namespace formats {
+
+/// Drops tags which nobody reads before they are added to string table.
+class TagPruner final {
+ public:
+  /// Creates pruner which keeps every tag.
+  TagPruner() : keepsAll_(true), keys_() {
+  }
+
+  /// Creates pruner which keeps only tags with given keys.
+  explicit TagPruner(std::unordered_set<std::string> keys) :
+      keepsAll_(false), keys_(std::move(keys)) {
+  }
+
+  /// Checks whether tag with given key is kept.
+  bool keeps(const std::string &key) const {
+    return keepsAll_ || keys_.find(key)!=keys_.end();
+  }
+
+  /// Removes tags which are not kept.
+  void prune(utymap::formats::Tags &tags) const {
+    if (keepsAll_) return;
+    tags.erase(std::remove_if(tags.begin(), tags.end(), [&](const utymap::formats::Tag &tag) {
+      return !keeps(tag.key);
+    }), tags.end());
+  }
+
+  /// Removes tags which are not kept from relation. Multipolygon relation keeps all tags:
+  /// relation which has only type tag is processed as old-style one with tags of outer way.
+  void pruneRelation(utymap::formats::Tags &tags) const {
+    if (keepsAll_) return;
+    bool isMultipolygonRelation = std::any_of(tags.begin(), tags.end(), [](const utymap::formats::Tag &tag) {
+      return isMultipolygon(tag.key, tag.value);
+    });
+    if (!isMultipolygonRelation)
+      prune(tags);
+  }
+
+  /// Checks whether tag marks relation as multipolygon.
+  static bool isMultipolygon(const std::string &key, const std::string &value) {
+    return key=="type" && value=="multipolygon";
+  }
+
+ private:
+  bool keepsAll_;
+  std::unordered_set<std::string> keys_;
+};
+
+}
+}
+
+#endif // FORMATS_TAGPRUNER_HPP_DEFINED
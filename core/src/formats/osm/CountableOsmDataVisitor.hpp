@@ -22,22 +22,43 @@ struct CountableOsmDataVisitor : public utymap::entities::ElementVisitor {
       bounds(0), nodes(0), ways(0), areas(0), relations(0) {
   }
 
-  void visitBounds(utymap::BoundingBox bbox) {
+  void visitBounds(utymap::BoundingBox) {
     bounds++;
   }
 
-  void visitNode(uint64_t id, utymap::GeoCoordinate &coordinate, Tags &tags) {
+  void visitNode(uint64_t, utymap::GeoCoordinate &, Tags &) {
     nodes++;
   }
 
-  void visitWay(uint64_t id, std::vector<uint64_t> &nodeIds, Tags &tags) {
+  void visitWay(uint64_t, std::vector<uint64_t> &, Tags &) {
     ways++;
   }
 
-  void visitRelation(uint64_t id, RelationMembers &members, Tags &tags) {
+  void visitRelation(uint64_t, RelationMembers &, Tags &) {
     relations++;
   }
 
+  void visitNode(uint64_t, utymap::GeoCoordinate &, std::vector<utymap::entities::Tag> &) {
+    nodes++;
+  }
+
+  void visitWay(uint64_t, std::vector<uint64_t> &, std::vector<utymap::entities::Tag> &) {
+    ways++;
+  }
+
+  void visitRelation(uint64_t, RelationMembers &, std::vector<utymap::entities::Tag> &) {
+    relations++;
+  }
+
+  bool getKeyId(const std::string &, std::uint32_t &id) const {
+    id = 0;
+    return true;
+  }
+
+  std::uint32_t getValueId(const std::string &) const {
+    return 0;
+  }
+
   void visitNode(const utymap::entities::Node &) override {
     ++nodes;
   }
@@ -0,0 +1,203 @@
+#include "formats/osm/NodeLocationStore.hpp"
+#include "utils/CoreUtils.hpp"
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+using namespace utymap;
+using namespace utymap::formats;
+
+namespace {
+/// Multiplier of fixed point coordinates: osm keeps seven decimal digits.
+const double Precision = 1E7;
+/// Bit of id which marks resolved node: osm ids never use it.
+const std::uint64_t ResolvedBit = std::uint64_t(1) << 63;
+
+/// Location of single node.
+struct Location final {
+  std::uint64_t id;
+  std::int32_t latitude;
+  std::int32_t longitude;
+
+  std::uint64_t nodeId() const { return id & ~ResolvedBit; }
+};
+
+std::int32_t toFixed(double value) {
+  return static_cast<std::int32_t>(std::lround(value*Precision));
+}
+
+double fromFixed(std::int32_t value) {
+  return value/Precision;
+}
+}
+
+class NodeLocationStore::NodeLocationStoreImpl final {
+  typedef boost::interprocess::mapped_region MappedRegion;
+
+ public:
+  NodeLocationStoreImpl(const std::string &path, std::size_t maxMemorySize) :
+      path_(path),
+      maxMemorySize_(path.empty() ? std::numeric_limits<std::size_t>::max() : maxMemorySize),
+      isInFile_(false),
+      size_(0),
+      lastId_(0),
+      isSorted_(true) {
+  }
+
+  ~NodeLocationStoreImpl() {
+    if (!isInFile_) return;
+
+    region_.reset();
+    file_.close();
+    std::remove(path_.c_str());
+  }
+
+  void add(std::uint64_t id, const GeoCoordinate &coordinate, bool isResolved) {
+    Location location{isResolved ? id | ResolvedBit : id, toFixed(coordinate.latitude), toFixed(coordinate.longitude)};
+    // NOTE equal id is also out of order as the same node should be kept only once.
+    if (size_ > 0 && id <= lastId_)
+      isSorted_ = false;
+    lastId_ = std::max(lastId_, id);
+
+    if (!isInFile_ && (size_ + 1)*sizeof(Location) > maxMemorySize_)
+      moveToFile();
+
+    if (!isInFile_) {
+      locations_.push_back(location);
+    } else {
+      // NOTE mapping is recreated on the next lookup as file grows.
+      region_.reset();
+      file_.seekp(static_cast<std::streamoff>(size_*sizeof(Location)));
+      file_.write(reinterpret_cast<const char *>(&location), sizeof(location));
+    }
+    ++size_;
+  }
+
+  bool resolve(std::uint64_t id, GeoCoordinate &coordinate) {
+    if (size_==0) return false;
+
+    Location *begin = prepare();
+    Location *end = begin + size_;
+    Location *location = std::lower_bound(begin, end, id, [](const Location &l, std::uint64_t nodeId) {
+      return l.nodeId() < nodeId;
+    });
+    if (location==end || location->nodeId()!=id)
+      return false;
+
+    location->id |= ResolvedBit;
+    coordinate = GeoCoordinate(fromFixed(location->latitude), fromFixed(location->longitude));
+    return true;
+  }
+
+  void visitUnresolved(const std::function<void(std::uint64_t, const GeoCoordinate &)> &visitor) {
+    if (size_==0) return;
+
+    Location *locations = prepare();
+    for (std::size_t i = 0; i < size_; ++i) {
+      if ((locations[i].id & ResolvedBit)==0)
+        visitor(locations[i].id, GeoCoordinate(fromFixed(locations[i].latitude), fromFixed(locations[i].longitude)));
+    }
+  }
+
+  std::size_t size() const {
+    return size_;
+  }
+
+ private:
+  /// Gets locations sorted by id without duplicates.
+  Location *prepare() {
+    Location *locations = getLocations();
+    if (isSorted_)
+      return locations;
+
+    std::stable_sort(locations, locations + size_, [](const Location &lhs, const Location &rhs) {
+      return lhs.nodeId() < rhs.nodeId();
+    });
+
+    // NOTE the last added location of node wins.
+    std::size_t count = 0;
+    for (std::size_t i = 0; i < size_; ++i) {
+      if (count > 0 && locations[count - 1].nodeId()==locations[i].nodeId())
+        locations[count - 1] = locations[i];
+      else
+        locations[count++] = locations[i];
+    }
+
+    size_ = count;
+    if (!isInFile_)
+      locations_.resize(count);
+    isSorted_ = true;
+    return locations;
+  }
+
+  /// Writes locations kept in memory to file and releases memory.
+  void moveToFile() {
+    file_.open(path_, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file_.good())
+      throw std::domain_error("Cannot create node location file: " + path_);
+
+    file_.write(reinterpret_cast<const char *>(locations_.data()),
+                static_cast<std::streamsize>(locations_.size()*sizeof(Location)));
+    std::vector<Location>().swap(locations_);
+    isInFile_ = true;
+  }
+
+  Location *getLocations() {
+    if (!isInFile_)
+      return locations_.data();
+
+    if (region_==nullptr) {
+      using namespace boost::interprocess;
+      file_.flush();
+      file_mapping mapping(path_.c_str(), read_write);
+      region_ = utymap::utils::make_unique<MappedRegion>(mapping, read_write, 0, size_*sizeof(Location));
+    }
+    return static_cast<Location *>(region_->get_address());
+  }
+
+  const std::string path_;
+  const std::size_t maxMemorySize_;
+  bool isInFile_;
+  std::vector<Location> locations_;
+  std::fstream file_;
+  std::unique_ptr<MappedRegion> region_;
+
+  std::size_t size_;
+  std::uint64_t lastId_;
+  bool isSorted_;
+};
+
+NodeLocationStore::NodeLocationStore() :
+    pimpl_(utymap::utils::make_unique<NodeLocationStoreImpl>("", 0)) {
+}
+
+NodeLocationStore::NodeLocationStore(const std::string &path, std::size_t maxMemorySize) :
+    pimpl_(utymap::utils::make_unique<NodeLocationStoreImpl>(path, maxMemorySize)) {
+}
+
+NodeLocationStore::~NodeLocationStore() {
+}
+
+void NodeLocationStore::add(std::uint64_t id, const GeoCoordinate &coordinate, bool isResolved) {
+  pimpl_->add(id, coordinate, isResolved);
+}
+
+bool NodeLocationStore::resolve(std::uint64_t id, GeoCoordinate &coordinate) {
+  return pimpl_->resolve(id, coordinate);
+}
+
+void NodeLocationStore::visitUnresolved(const std::function<void(std::uint64_t, const GeoCoordinate &)> &visitor) {
+  pimpl_->visitUnresolved(visitor);
+}
+
+std::size_t NodeLocationStore::size() const {
+  return pimpl_->size();
+}
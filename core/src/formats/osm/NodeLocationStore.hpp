@@ -0,0 +1,54 @@
+#ifndef FORMATS_OSM_NODELOCATIONSTORE_HPP_DEFINED
+#define FORMATS_OSM_NODELOCATIONSTORE_HPP_DEFINED
+
+#include "GeoCoordinate.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace utymap {
+namespace formats {
+
+/// Keeps locations of untagged nodes which are needed only to build ways. Location takes
+/// 16 bytes: node id and coordinate in fixed point with osm precision. Locations are kept
+/// sorted by id, so lookup is binary search. Nodes are usually ordered by id in osm files,
+/// otherwise locations are sorted once before the first lookup.
+class NodeLocationStore final {
+ public:
+  /// Creates store which keeps locations in memory.
+  NodeLocationStore();
+
+  /// Creates store which keeps locations in memory until they take more than given amount
+  /// of bytes, then moves them to given file mapped to memory. File is truncated and it is
+  /// removed when store is destroyed.
+  explicit NodeLocationStore(const std::string &path, std::size_t maxMemorySize = 0);
+
+  ~NodeLocationStore();
+
+  NodeLocationStore(const NodeLocationStore &) = delete;
+  NodeLocationStore &operator=(const NodeLocationStore &) = delete;
+
+  /// Adds location of node. Location added later replaces previous one with the same id.
+  /// Node added as resolved one is not visited as unresolved, e.g. if it is built already.
+  void add(std::uint64_t id, const utymap::GeoCoordinate &coordinate, bool isResolved = false);
+
+  /// Gets location of node and marks node as resolved. Returns false if node is unknown.
+  bool resolve(std::uint64_t id, utymap::GeoCoordinate &coordinate);
+
+  /// Visits nodes which were never resolved.
+  void visitUnresolved(const std::function<void(std::uint64_t, const utymap::GeoCoordinate &)> &visitor);
+
+  /// Returns amount of stored locations.
+  std::size_t size() const;
+
+ private:
+  class NodeLocationStoreImpl;
+  std::unique_ptr<NodeLocationStoreImpl> pimpl_;
+};
+
+}
+}
+
+#endif // FORMATS_OSM_NODELOCATIONSTORE_HPP_DEFINED
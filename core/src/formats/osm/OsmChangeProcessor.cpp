@@ -0,0 +1,295 @@
+#include "entities/Node.hpp"
+#include "entities/Way.hpp"
+#include "entities/Area.hpp"
+#include "entities/Relation.hpp"
+#include "formats/osm/OsmChangeProcessor.hpp"
+#include "formats/osm/OsmDataVisitor.hpp"
+#include "formats/osm/xml/OsmChangeParser.hpp"
+#include "utils/CoreUtils.hpp"
+#include "utils/ElementUtils.hpp"
+
+#include <unordered_set>
+
+using namespace utymap;
+using namespace utymap::entities;
+using namespace utymap::formats;
+using namespace utymap::index;
+
+namespace {
+typedef std::unordered_set<std::uint64_t> IdSet;
+typedef OsmSourceStore::Way SourceWay;
+typedef OsmSourceStore::Relation SourceRelation;
+
+/// Node of change file.
+struct ChangedNode final {
+  GeoCoordinate coordinate;
+  std::vector<utymap::entities::Tag> tags;
+};
+
+/// Elements of change file passed to the same visitor.
+struct ChangedElements final {
+  std::unordered_map<std::uint64_t, ChangedNode> nodes;
+  OsmSourceStore::WayMap ways;
+  OsmSourceStore::RelationMap relations;
+};
+
+/// Collects elements of change file.
+class ChangeCollector final {
+ public:
+  ChangeCollector(const StringTable &stringTable, ChangedElements &elements) :
+      stringTable_(stringTable), elements_(elements) {
+  }
+
+  void visitNode(std::uint64_t id, GeoCoordinate &coordinate, utymap::formats::Tags &tags) {
+    elements_.nodes[id] = ChangedNode{coordinate, utymap::utils::convertTags(stringTable_, tags)};
+  }
+
+  void visitWay(std::uint64_t id, std::vector<std::uint64_t> &nodeIds, utymap::formats::Tags &tags) {
+    elements_.ways[id] = SourceWay{nodeIds, utymap::utils::convertTags(stringTable_, tags)};
+  }
+
+  void visitRelation(std::uint64_t id, RelationMembers &members, utymap::formats::Tags &tags) {
+    elements_.relations[id] = SourceRelation{members, utymap::utils::convertTags(stringTable_, tags)};
+  }
+
+ private:
+  const StringTable &stringTable_;
+  ChangedElements &elements_;
+};
+
+/// Checks whether element is node.
+class NodeDetector final : public ElementVisitor {
+ public:
+  bool isNode = false;
+
+  void visitNode(const Node &) override { isNode = true; }
+  void visitWay(const Way &) override {}
+  void visitArea(const Area &) override {}
+  void visitRelation(const Relation &) override {}
+};
+
+bool isNode(const Element &element) {
+  NodeDetector detector;
+  element.accept(detector);
+  return detector.isNode;
+}
+
+template<typename Map>
+void addKeys(const Map &map, IdSet &ids) {
+  for (const auto &pair : map)
+    ids.insert(pair.first);
+}
+
+/// Gets version of element from the first map which has it.
+template<typename Map>
+const typename Map::mapped_type *findVersion(std::uint64_t id, const Map &first, const Map &second) {
+  auto element = first.find(id);
+  if (element!=first.end())
+    return &element->second;
+  element = second.find(id);
+  return element!=second.end() ? &element->second : nullptr;
+}
+
+/// Builds elements from ways and relations which use nodes with given locations.
+/// Nodes are used only as vertices and members: node elements are not built.
+class ElementBuilder final {
+ public:
+  ElementBuilder(const StringTable &stringTable, const OsmChangeProcessor::ElementFunc &function) :
+      visitor_(stringTable, [&function](Element &element) {
+        return !isNode(element) && function(element);
+      }, TagPruner(), utymap::utils::make_unique<NodeLocationStore>()) {
+  }
+
+  void addNode(std::uint64_t id, const GeoCoordinate &coordinate) {
+    GeoCoordinate location = coordinate;
+    std::vector<utymap::entities::Tag> tags;
+    visitor_.visitNode(id, location, tags);
+  }
+
+  void addWay(std::uint64_t id, const SourceWay &way) {
+    // NOTE way without nodes, e.g. deleted one in change file, has no geometry.
+    if (way.nodeIds.empty()) return;
+
+    auto nodeIds = way.nodeIds;
+    auto tags = way.tags;
+    visitor_.visitWay(id, nodeIds, tags);
+  }
+
+  void addRelation(std::uint64_t id, const SourceRelation &relation) {
+    auto members = relation.members;
+    auto tags = relation.tags;
+    visitor_.visitRelation(id, members, tags);
+  }
+
+  void complete() {
+    visitor_.complete();
+  }
+
+ private:
+  OsmDataVisitor visitor_;
+};
+}
+
+OsmChangeProcessor::OsmChangeProcessor(const StringTable &stringTable, std::shared_ptr<OsmSourceStore> sourceStore) :
+    stringTable_(stringTable), sourceStore_(sourceStore) {
+}
+
+void OsmChangeProcessor::process(std::istream &stream, const ElementFunc &erase, const ElementFunc &add) {
+  ChangedElements updated, deleted;
+  ChangeCollector updateCollector(stringTable_, updated);
+  ChangeCollector deleteCollector(stringTable_, deleted);
+  OsmChangeParser<ChangeCollector>().parse(stream, updateCollector, deleteCollector);
+
+  IdSet nodeIds, wayIds, relationIds;
+  addKeys(updated.nodes, nodeIds);
+  addKeys(deleted.nodes, nodeIds);
+  addKeys(updated.ways, wayIds);
+  addKeys(deleted.ways, wayIds);
+  addKeys(updated.relations, relationIds);
+  addKeys(deleted.relations, relationIds);
+
+  // Previous versions of affected elements and unchanged elements they use.
+  OsmSourceStore::NodeMap nodes;
+  OsmSourceStore::WayMap ways;
+  OsmSourceStore::RelationMap relations;
+  if (sourceStore_!=nullptr) {
+    ways = sourceStore_->findWays(wayIds);
+    auto nodeWays = sourceStore_->findWaysByNodes(nodeIds);
+    ways.insert(nodeWays.begin(), nodeWays.end());
+    addKeys(ways, wayIds);
+
+    relations = sourceStore_->findRelations(relationIds);
+    auto memberOfRelations = sourceStore_->findRelationsByMembers(nodeIds, wayIds, relationIds);
+    relations.insert(memberOfRelations.begin(), memberOfRelations.end());
+    addKeys(relations, relationIds);
+
+    // NOTE relation is rebuilt with all its members, so unchanged members are needed too.
+    IdSet memberWayIds, memberRelationIds;
+    auto addMembers = [&](const OsmSourceStore::RelationMap &relationMap) {
+      for (const auto &pair : relationMap) {
+        for (const auto &member : pair.second.members) {
+          if (member.type=="w" && wayIds.find(member.refId)==wayIds.end())
+            memberWayIds.insert(member.refId);
+          else if (member.type=="r" && relationIds.find(member.refId)==relationIds.end())
+            memberRelationIds.insert(member.refId);
+        }
+      }
+    };
+    addMembers(relations);
+    addMembers(updated.relations);
+    auto memberRelations = sourceStore_->findRelations(memberRelationIds);
+    addMembers(memberRelations);
+    relations.insert(memberRelations.begin(), memberRelations.end());
+    auto memberWays = sourceStore_->findWays(memberWayIds);
+    ways.insert(memberWays.begin(), memberWays.end());
+
+    IdSet locationIds = nodeIds;
+    auto addWayNodes = [&](const OsmSourceStore::WayMap &wayMap) {
+      for (const auto &pair : wayMap)
+        locationIds.insert(pair.second.nodeIds.begin(), pair.second.nodeIds.end());
+    };
+    auto addNodeMembers = [&](const OsmSourceStore::RelationMap &relationMap) {
+      for (const auto &pair : relationMap) {
+        for (const auto &member : pair.second.members) {
+          if (member.type=="n")
+            locationIds.insert(member.refId);
+        }
+      }
+    };
+    addWayNodes(ways);
+    addWayNodes(updated.ways);
+    addNodeMembers(relations);
+    addNodeMembers(updated.relations);
+    nodes = sourceStore_->findNodes(locationIds);
+  }
+
+  // Erase previous versions. Element which is not in source store is taken from change file.
+  {
+    ElementBuilder builder(stringTable_, erase);
+    for (auto id : nodeIds) {
+      auto previous = nodes.find(id);
+      auto changed = findVersion(id, updated.nodes, deleted.nodes);
+      Node node;
+      node.id = id;
+      node.coordinate = previous!=nodes.end() ? previous->second : changed->coordinate;
+      if (node.coordinate.isValid())
+        erase(node);
+    }
+
+    for (const auto &pair : nodes)
+      builder.addNode(pair.first, pair.second);
+    for (const auto &pair : updated.nodes) {
+      if (nodes.find(pair.first)==nodes.end())
+        builder.addNode(pair.first, pair.second.coordinate);
+    }
+
+    for (auto id : wayIds) {
+      auto way = findVersion(id, ways, updated.ways);
+      builder.addWay(id, way!=nullptr ? *way : deleted.ways[id]);
+    }
+    for (const auto &pair : ways) {
+      if (wayIds.find(pair.first)==wayIds.end())
+        builder.addWay(pair.first, pair.second);
+    }
+
+    for (auto id : relationIds) {
+      auto relation = findVersion(id, relations, updated.relations);
+      builder.addRelation(id, relation!=nullptr ? *relation : deleted.relations[id]);
+    }
+    for (const auto &pair : relations) {
+      if (relationIds.find(pair.first)==relationIds.end())
+        builder.addRelation(pair.first, pair.second);
+    }
+    builder.complete();
+  }
+
+  // Add new versions.
+  {
+    ElementBuilder builder(stringTable_, add);
+    for (auto &pair : updated.nodes) {
+      Node node;
+      node.id = pair.first;
+      node.coordinate = pair.second.coordinate;
+      node.tags = pair.second.tags;
+      add(node);
+      builder.addNode(pair.first, pair.second.coordinate);
+    }
+    for (const auto &pair : nodes) {
+      if (nodeIds.find(pair.first)==nodeIds.end())
+        builder.addNode(pair.first, pair.second);
+    }
+
+    for (const auto &pair : updated.ways)
+      builder.addWay(pair.first, pair.second);
+    for (const auto &pair : ways) {
+      if (updated.ways.find(pair.first)==updated.ways.end() && deleted.ways.find(pair.first)==deleted.ways.end())
+        builder.addWay(pair.first, pair.second);
+    }
+
+    for (const auto &pair : updated.relations)
+      builder.addRelation(pair.first, pair.second);
+    for (const auto &pair : relations) {
+      if (updated.relations.find(pair.first)==updated.relations.end() &&
+          deleted.relations.find(pair.first)==deleted.relations.end())
+        builder.addRelation(pair.first, pair.second);
+    }
+    builder.complete();
+  }
+
+  if (sourceStore_==nullptr)
+    return;
+
+  for (const auto &pair : updated.nodes)
+    sourceStore_->addNode(pair.first, pair.second.coordinate);
+  for (const auto &pair : deleted.nodes)
+    sourceStore_->removeNode(pair.first);
+  for (const auto &pair : updated.ways)
+    sourceStore_->addWay(pair.first, pair.second.nodeIds, pair.second.tags);
+  for (const auto &pair : deleted.ways)
+    sourceStore_->removeWay(pair.first);
+  for (const auto &pair : updated.relations)
+    sourceStore_->addRelation(pair.first, pair.second.members, pair.second.tags);
+  for (const auto &pair : deleted.relations)
+    sourceStore_->removeRelation(pair.first);
+  sourceStore_->flush();
+}
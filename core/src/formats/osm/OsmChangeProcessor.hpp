@@ -0,0 +1,39 @@
+#ifndef FORMATS_OSM_OSMCHANGEPROCESSOR_HPP_DEFINED
+#define FORMATS_OSM_OSMCHANGEPROCESSOR_HPP_DEFINED
+
+#include "entities/Element.hpp"
+#include "formats/osm/OsmSourceStore.hpp"
+#include "index/StringTable.hpp"
+
+#include <functional>
+#include <istream>
+#include <memory>
+
+namespace utymap {
+namespace formats {
+
+/// Applies osm change file to elements built from osm data. Previous versions of changed
+/// elements and of ways and relations which use changed nodes or ways are passed to erase
+/// function, then their new versions are passed to add function. Previous versions and
+/// unchanged nodes and ways are taken from source store which is updated by the change.
+/// Without source store, only elements of change file are known, so ways which nodes are
+/// missing in the file are skipped and ones which use changed nodes are not rebuilt.
+class OsmChangeProcessor final {
+ public:
+  typedef std::function<bool(utymap::entities::Element &)> ElementFunc;
+
+  OsmChangeProcessor(const utymap::index::StringTable &stringTable,
+                     std::shared_ptr<utymap::formats::OsmSourceStore> sourceStore = nullptr);
+
+  /// Reads change from stream and passes affected elements to given functions.
+  void process(std::istream &stream, const ElementFunc &erase, const ElementFunc &add);
+
+ private:
+  const utymap::index::StringTable &stringTable_;
+  std::shared_ptr<utymap::formats::OsmSourceStore> sourceStore_;
+};
+
+}
+}
+
+#endif // FORMATS_OSM_OSMCHANGEPROCESSOR_HPP_DEFINED
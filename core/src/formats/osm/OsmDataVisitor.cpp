@@ -6,6 +6,7 @@
 #include "formats/osm/MultipolygonProcessor.hpp"
 #include "formats/osm/RelationProcessor.hpp"
 #include "formats/osm/OsmDataVisitor.hpp"
+#include "utils/CoreUtils.hpp"
 #include "utils/GeometryUtils.hpp"
 
 #include <unordered_set>
@@ -19,18 +20,63 @@ void OsmDataVisitor::visitBounds(BoundingBox bbox) {
 }
 
 void OsmDataVisitor::visitNode(std::uint64_t id, GeoCoordinate &coordinate, utymap::formats::Tags &tags) {
+  pruner_.prune(tags);
+  auto elementTags = utymap::utils::convertTags(stringTable_, tags);
+  visitNode(id, coordinate, elementTags);
+}
+
+void OsmDataVisitor::visitWay(std::uint64_t id, std::vector<std::uint64_t> &nodeIds, utymap::formats::Tags &tags) {
+  pruner_.prune(tags);
+  auto elementTags = utymap::utils::convertTags(stringTable_, tags);
+  visitWay(id, nodeIds, elementTags);
+}
+
+void OsmDataVisitor::visitRelation(std::uint64_t id, RelationMembers &members, utymap::formats::Tags &tags) {
+  pruner_.pruneRelation(tags);
+  auto elementTags = utymap::utils::convertTags(stringTable_, tags);
+  visitRelation(id, members, elementTags);
+}
+
+void OsmDataVisitor::visitNode(std::uint64_t id,
+                               GeoCoordinate &coordinate,
+                               std::vector<utymap::entities::Tag> &tags) {
+  if (sourceStore_!=nullptr)
+    sourceStore_->addNode(id, coordinate);
+
+  if (memberCollector_!=nullptr) {
+    // NOTE tagged node can be way vertex too. It is built here, so it is marked as resolved
+    // to be skipped when untagged nodes are built.
+    nodeLocations_->add(id, coordinate, !tags.empty());
+    if (tags.empty()) return;
+  } else if (nodeLocations_!=nullptr && tags.empty()) {
+    nodeLocations_->add(id, coordinate);
+    return;
+  }
+
   auto node = std::make_shared<Node>();
   node->id = id;
   node->coordinate = coordinate;
-  utymap::utils::setTags(stringTable_, *node, tags);
-  context_.nodeMap[id] = node;
+  setTags(*node, tags);
+  if (isReleased(id, false))
+    add_(*node);
+  else
+    context_.nodeMap[id] = node;
 }
 
-void OsmDataVisitor::visitWay(std::uint64_t id, std::vector<std::uint64_t> &nodeIds, utymap::formats::Tags &tags) {
+void OsmDataVisitor::visitWay(std::uint64_t id,
+                              std::vector<std::uint64_t> &nodeIds,
+                              std::vector<utymap::entities::Tag> &tags) {
+  if (sourceStore_!=nullptr)
+    sourceStore_->addWay(id, nodeIds, tags);
+
   std::vector<GeoCoordinate> coordinates;
   coordinates.reserve(nodeIds.size());
   for (auto nodeId : nodeIds) {
-    coordinates.push_back(context_.nodeMap[nodeId]->coordinate);
+    GeoCoordinate coordinate;
+    // NOTE way cannot be built if some of its nodes are unknown, e.g. in change file.
+    if (!getCoordinate(nodeId, coordinate))
+      return;
+    coordinates.push_back(coordinate);
   }
   auto size = coordinates.size();
   if (size > 3 && coordinates[0]==coordinates[size - 1]) {
@@ -42,22 +88,33 @@ void OsmDataVisitor::visitWay(std::uint64_t id, std::vector<std::uint64_t> &node
       std::reverse(coordinates.begin(), coordinates.end());
     }
     area->coordinates = std::move(coordinates);
-    utymap::utils::setTags(stringTable_, *area, tags);
-    context_.areaMap[id] = area;
+    setTags(*area, tags);
+    if (isReleased(id, true))
+      add_(*area);
+    else
+      context_.areaMap[id] = area;
 
   } else {
     auto way = std::make_shared<Way>();
     way->id = id;
     way->coordinates = std::move(coordinates);
-    utymap::utils::setTags(stringTable_, *way, tags);
-    context_.wayMap[id] = way;
+    setTags(*way, tags);
+    if (isReleased(id, true))
+      add_(*way);
+    else
+      context_.wayMap[id] = way;
   }
 }
 
-void OsmDataVisitor::visitRelation(std::uint64_t id, RelationMembers &members, utymap::formats::Tags &tags) {
+void OsmDataVisitor::visitRelation(std::uint64_t id,
+                                   RelationMembers &members,
+                                   std::vector<utymap::entities::Tag> &tags) {
+  if (sourceStore_!=nullptr)
+    sourceStore_->addRelation(id, members, tags);
+
   auto relation = std::make_shared<Relation>();
   relation->id = id;
-  relation->tags = utymap::utils::convertTags(stringTable_, tags);
+  setTags(*relation, tags);
 
   // NOTE Assume, relation may refer to another relations which are not yet processed.
   // So, store all relation members to resolve them once all relations are visited.
@@ -65,6 +122,58 @@ void OsmDataVisitor::visitRelation(std::uint64_t id, RelationMembers &members, u
   context_.relationMap[id] = relation;
 }
 
+bool OsmDataVisitor::getKeyId(const std::string &key, std::uint32_t &id) const {
+  if (!pruner_.keeps(key))
+    return false;
+  id = stringTable_.getId(key);
+  return true;
+}
+
+std::uint32_t OsmDataVisitor::getValueId(const std::string &value) const {
+  return stringTable_.getId(value);
+}
+
+void OsmDataVisitor::setTags(Element &element, std::vector<utymap::entities::Tag> &tags) {
+  // NOTE: tags should be sorted to speed up mapcss styling
+  std::sort(tags.begin(), tags.end());
+  element.tags = std::move(tags);
+}
+
+bool OsmDataVisitor::isReleased(std::uint64_t id, bool isWay) const {
+  if (memberCollector_==nullptr)
+    return false;
+  return isWay ? !memberCollector_->isWayMember(id) : !memberCollector_->isNodeMember(id);
+}
+
+bool OsmDataVisitor::getCoordinate(std::uint64_t nodeId, GeoCoordinate &coordinate) {
+  if (nodeLocations_!=nullptr && nodeLocations_->resolve(nodeId, coordinate))
+    return true;
+
+  auto node = context_.nodeMap.find(nodeId);
+  if (node==context_.nodeMap.end())
+    return false;
+
+  coordinate = node->second->coordinate;
+  return true;
+}
+
+/// Moves untagged nodes which are relation members from location store to node map.
+void OsmDataVisitor::addNodeMembers() {
+  for (const auto &membersPair : relationMembers_) {
+    for (const auto &member : membersPair.second) {
+      GeoCoordinate coordinate;
+      if (member.type!="n" || context_.nodeMap.find(member.refId)!=context_.nodeMap.end() ||
+          !nodeLocations_->resolve(member.refId, coordinate))
+        continue;
+
+      auto node = std::make_shared<Node>();
+      node->id = member.refId;
+      node->coordinate = coordinate;
+      context_.nodeMap[member.refId] = node;
+    }
+  }
+}
+
 void OsmDataVisitor::add(utymap::entities::Element &element) {
   add_(element);
 }
@@ -93,6 +202,9 @@ void OsmDataVisitor::resolve(Relation &relation) {
 }
 
 void OsmDataVisitor::complete() {
+  if (nodeLocations_!=nullptr)
+    addNodeMembers();
+
   // All relations are visited can start to resolve them
   for (auto &membersPair : relationMembers_) {
     auto relationPair = context_.relationMap.find(membersPair.first);
@@ -108,6 +220,15 @@ void OsmDataVisitor::complete() {
     add_(*pair.second);
   }
 
+  if (nodeLocations_!=nullptr) {
+    nodeLocations_->visitUnresolved([&](std::uint64_t id, const GeoCoordinate &coordinate) {
+      Node node;
+      node.id = id;
+      node.coordinate = coordinate;
+      add_(node);
+    });
+  }
+
   for (const auto &pair : context_.wayMap) {
     add_(*pair.second);
   }
@@ -118,6 +239,15 @@ void OsmDataVisitor::complete() {
 
 }
 
-OsmDataVisitor::OsmDataVisitor(const StringTable &stringTable, std::function<bool(Element &)> add)
-    : stringTable_(stringTable), add_(add), context_() {
+OsmDataVisitor::OsmDataVisitor(const StringTable &stringTable,
+                               std::function<bool(Element &)> add,
+                               const TagPruner &pruner,
+                               std::unique_ptr<NodeLocationStore> nodeLocations,
+                               std::shared_ptr<const RelationMemberCollector> memberCollector,
+                               std::shared_ptr<OsmSourceStore> sourceStore)
+    : stringTable_(stringTable), add_(add), pruner_(pruner),
+      nodeLocations_(std::move(nodeLocations)), memberCollector_(memberCollector), sourceStore_(sourceStore),
+      context_() {
+  if (memberCollector_!=nullptr && nodeLocations_==nullptr)
+    nodeLocations_ = utymap::utils::make_unique<NodeLocationStore>();
 }
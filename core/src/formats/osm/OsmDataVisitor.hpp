@@ -5,10 +5,15 @@
 #include "GeoCoordinate.hpp"
 #include "entities/Element.hpp"
 #include "formats/FormatTypes.hpp"
+#include "formats/TagPruner.hpp"
+#include "formats/osm/NodeLocationStore.hpp"
 #include "formats/osm/OsmDataContext.hpp"
+#include "formats/osm/OsmSourceStore.hpp"
+#include "formats/osm/RelationMemberCollector.hpp"
 #include "index/StringTable.hpp"
 
 #include <functional>
+#include <memory>
 #include <string>
 #include <vector>
 #include <unordered_map>
@@ -19,8 +24,18 @@ namespace formats {
 class OsmDataVisitor final {
  public:
 
+  /// Creates visitor. If node location store is given, untagged nodes are kept there
+  /// and only those which are not way vertices are added as elements.
+  /// If relation members are given, nodes and ways which are not members are added as
+  /// soon as they are visited, only relations and their members are kept till complete.
+  /// It requires nodes to be visited before ways, untagged nodes are not added then.
+  /// If source store is given, osm data of visited elements is recorded there.
   OsmDataVisitor(const utymap::index::StringTable &stringTable,
-                 std::function<bool(utymap::entities::Element &)> add);
+                 std::function<bool(utymap::entities::Element &)> add,
+                 const utymap::formats::TagPruner &pruner = utymap::formats::TagPruner(),
+                 std::unique_ptr<utymap::formats::NodeLocationStore> nodeLocations = nullptr,
+                 std::shared_ptr<const utymap::formats::RelationMemberCollector> memberCollector = nullptr,
+                 std::shared_ptr<utymap::formats::OsmSourceStore> sourceStore = nullptr);
 
   void visitBounds(utymap::BoundingBox bbox);
 
@@ -30,6 +45,23 @@ class OsmDataVisitor final {
 
   void visitRelation(std::uint64_t id, utymap::formats::RelationMembers &members, utymap::formats::Tags &tags);
 
+  /// Visits node which tags are already added to string table.
+  void visitNode(std::uint64_t id, utymap::GeoCoordinate &coordinate, std::vector<utymap::entities::Tag> &tags);
+
+  /// Visits way which tags are already added to string table.
+  void visitWay(std::uint64_t id, std::vector<std::uint64_t> &nodeIds, std::vector<utymap::entities::Tag> &tags);
+
+  /// Visits relation which tags are already added to string table.
+  void visitRelation(std::uint64_t id,
+                     utymap::formats::RelationMembers &members,
+                     std::vector<utymap::entities::Tag> &tags);
+
+  /// Gets id of tag key in string table. Returns false if tags with this key are pruned.
+  bool getKeyId(const std::string &key, std::uint32_t &id) const;
+
+  /// Gets id of tag value in string table.
+  std::uint32_t getValueId(const std::string &value) const;
+
   void add(utymap::entities::Element &element);
 
   void complete();
@@ -37,10 +69,18 @@ class OsmDataVisitor final {
  private:
 
   bool hasTag(const std::string &key, const std::string &value, const std::vector<utymap::entities::Tag> &tags) const;
+  static void setTags(utymap::entities::Element &element, std::vector<utymap::entities::Tag> &tags);
+  bool isReleased(std::uint64_t id, bool isWay) const;
+  bool getCoordinate(std::uint64_t nodeId, utymap::GeoCoordinate &coordinate);
+  void addNodeMembers();
   void resolve(utymap::entities::Relation &relation);
 
   const utymap::index::StringTable &stringTable_;
   std::function<bool(utymap::entities::Element &)> add_;
+  const utymap::formats::TagPruner pruner_;
+  std::unique_ptr<utymap::formats::NodeLocationStore> nodeLocations_;
+  std::shared_ptr<const utymap::formats::RelationMemberCollector> memberCollector_;
+  std::shared_ptr<utymap::formats::OsmSourceStore> sourceStore_;
   utymap::formats::OsmDataContext context_;
   std::unordered_map<std::uint64_t, utymap::formats::RelationMembers> relationMembers_;
 };
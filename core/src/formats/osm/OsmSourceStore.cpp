@@ -0,0 +1,449 @@
+#include "formats/osm/OsmSourceStore.hpp"
+#include "utils/CoreUtils.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+using namespace utymap;
+using namespace utymap::entities;
+using namespace utymap::formats;
+
+namespace {
+const std::string NodeFileExtension = ".nodes";
+const std::string WayFileExtension = ".ways";
+const std::string RelationFileExtension = ".relations";
+const std::string IndexFileExtension = ".idx";
+const std::string ReferenceFileExtension = ".refs";
+
+/// Multiplier of fixed point coordinates: osm keeps seven decimal digits.
+const double Precision = 1E7;
+/// Latitude of the record which removes node.
+const std::int32_t RemovedLatitude = std::numeric_limits<std::int32_t>::min();
+/// Tag count of the record which removes way or relation.
+const std::uint32_t RemovedCount = std::numeric_limits<std::uint32_t>::max();
+
+template<typename T>
+void write(std::ostream &stream, T value) {
+  stream.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+template<typename T>
+bool read(std::istream &stream, T &value) {
+  return static_cast<bool>(stream.read(reinterpret_cast<char *>(&value), sizeof(value)));
+}
+
+void open(std::ofstream &file, const std::string &path) {
+  file.open(path, std::ios::out | std::ios::binary | std::ios::app | std::ios::ate);
+  if (!file.good())
+    throw std::domain_error("Cannot open osm source file: " + path);
+}
+
+void writeTags(std::ostream &stream, const std::vector<utymap::entities::Tag> &tags) {
+  write(stream, static_cast<std::uint32_t>(tags.size()));
+  for (const auto &tag : tags) {
+    write(stream, tag.key);
+    write(stream, tag.value);
+  }
+}
+
+/// Reads tags of record. Returns false if record removes element.
+bool readTags(std::istream &stream, std::vector<utymap::entities::Tag> &tags) {
+  std::uint32_t count = 0;
+  read(stream, count);
+  if (count==RemovedCount)
+    return false;
+
+  tags.resize(count);
+  for (auto &tag : tags) {
+    read(stream, tag.key);
+    read(stream, tag.value);
+  }
+  return true;
+}
+
+/// Maps element id to offset of its last record in log file. Pairs are appended to index
+/// file and loaded on first lookup.
+class OffsetIndex final {
+ public:
+  explicit OffsetIndex(const std::string &path) : path_(path), isLoaded_(false) {
+    open(file_, path_);
+  }
+
+  void add(std::uint64_t id, std::uint64_t offset) {
+    write(file_, id);
+    write(file_, offset);
+    if (isLoaded_)
+      offsets_[id] = offset;
+  }
+
+  /// Gets offset of the last record of element. Returns false if there is no record.
+  bool find(std::uint64_t id, std::uint64_t &offset) {
+    load();
+    auto pair = offsets_.find(id);
+    if (pair==offsets_.end())
+      return false;
+    offset = pair->second;
+    return true;
+  }
+
+  void flush() {
+    file_.flush();
+  }
+
+ private:
+  void load() {
+    if (isLoaded_) return;
+
+    file_.flush();
+    std::ifstream file(path_, std::ios::in | std::ios::binary);
+    std::uint64_t id, offset;
+    while (read(file, id) && read(file, offset))
+      offsets_[id] = offset;
+    isLoaded_ = true;
+  }
+
+  const std::string path_;
+  std::ofstream file_;
+  bool isLoaded_;
+  std::unordered_map<std::uint64_t, std::uint64_t> offsets_;
+};
+
+/// Maps id of node, way or relation to ids of elements which refer to it. References of
+/// every version are kept, so element which used to refer to it is found as well. They are
+/// appended to reference file and loaded on first lookup.
+class ReferenceIndex final {
+  /// Element which refers to another one of given kind.
+  struct Reference final {
+    std::uint64_t id;
+    char type;
+  };
+
+ public:
+  explicit ReferenceIndex(const std::string &path) : path_(path), isLoaded_(false) {
+    open(file_, path_);
+  }
+
+  /// Adds reference from element with given id to element of given type, e.g. 'n' for node.
+  void add(std::uint64_t id, char type, std::uint64_t refId) {
+    write(file_, refId);
+    write(file_, type);
+    write(file_, id);
+    if (isLoaded_)
+      apply(id, type, refId);
+  }
+
+  /// Adds ids of elements which refer to elements of given type with given ids.
+  void find(char type, const OsmSourceStore::IdSet &refIds, OsmSourceStore::IdSet &ids) {
+    load();
+    for (auto refId : refIds) {
+      auto references = references_.find(refId);
+      if (references==references_.end())
+        continue;
+      for (const auto &reference : references->second) {
+        if (reference.type==type)
+          ids.insert(reference.id);
+      }
+    }
+  }
+
+  void flush() {
+    file_.flush();
+  }
+
+ private:
+  void apply(std::uint64_t id, char type, std::uint64_t refId) {
+    auto &references = references_[refId];
+    // NOTE new version of element mostly keeps its references.
+    bool exists = std::any_of(references.begin(), references.end(), [&](const Reference &reference) {
+      return reference.id==id && reference.type==type;
+    });
+    if (!exists)
+      references.push_back(Reference{id, type});
+  }
+
+  void load() {
+    if (isLoaded_) return;
+
+    file_.flush();
+    std::ifstream file(path_, std::ios::in | std::ios::binary);
+    std::uint64_t refId, id;
+    char type;
+    while (read(file, refId) && read(file, type) && read(file, id))
+      apply(id, type, refId);
+    isLoaded_ = true;
+  }
+
+  const std::string path_;
+  std::ofstream file_;
+  bool isLoaded_;
+  std::unordered_map<std::uint64_t, std::vector<Reference>> references_;
+};
+
+/// Log of way or relation records with its offset and reference indices.
+struct ElementLog final {
+  explicit ElementLog(const std::string &path) :
+      path(path), offsets(path + IndexFileExtension), references(path + ReferenceFileExtension) {
+    open(file, path);
+  }
+
+  /// Starts record of element with given id.
+  void begin(std::uint64_t id) {
+    offsets.add(id, static_cast<std::uint64_t>(file.tellp()));
+    write(file, id);
+  }
+
+  /// Writes buffered data to disk. Log is written first as index refers to it.
+  void flush() {
+    file.flush();
+    offsets.flush();
+    references.flush();
+  }
+
+  /// Reads the last versions of elements with given ids. Removed ones are skipped.
+  template<typename T, typename Reader>
+  std::unordered_map<std::uint64_t, T> find(const OsmSourceStore::IdSet &ids, const Reader &reader) {
+    std::unordered_map<std::uint64_t, T> elements;
+    file.flush();
+    std::ifstream stream(path, std::ios::in | std::ios::binary);
+    for (auto id : ids) {
+      std::uint64_t offset, recordId;
+      if (!offsets.find(id, offset))
+        continue;
+
+      T element;
+      stream.seekg(static_cast<std::streamoff>(offset), std::ios::beg);
+      if (!read(stream, recordId) || recordId!=id)
+        throw std::domain_error("Osm source index does not match its log: " + path);
+      if (!readTags(stream, element.tags))
+        continue;
+      reader(stream, element);
+      if (!stream.good())
+        throw std::domain_error("Cannot read osm source record: " + path);
+      elements.emplace(id, std::move(element));
+    }
+    return elements;
+  }
+
+  const std::string path;
+  std::ofstream file;
+  OffsetIndex offsets;
+  ReferenceIndex references;
+};
+}
+
+class OsmSourceStore::OsmSourceStoreImpl final {
+ public:
+  explicit OsmSourceStoreImpl(const std::string &path) :
+      nodePath_(path + NodeFileExtension),
+      isNodesLoaded_(false),
+      ways_(path + WayFileExtension),
+      relations_(path + RelationFileExtension) {
+    open(nodeFile_, nodePath_);
+  }
+
+  void addNode(std::uint64_t id, const GeoCoordinate &coordinate) {
+    write(nodeFile_, id);
+    write(nodeFile_, static_cast<std::int32_t>(std::lround(coordinate.latitude*Precision)));
+    write(nodeFile_, static_cast<std::int32_t>(std::lround(coordinate.longitude*Precision)));
+    if (isNodesLoaded_)
+      nodes_[id] = coordinate;
+  }
+
+  void addWay(std::uint64_t id,
+              const std::vector<std::uint64_t> &nodeIds,
+              const std::vector<utymap::entities::Tag> &tags) {
+    ways_.begin(id);
+    writeTags(ways_.file, tags);
+    write(ways_.file, static_cast<std::uint32_t>(nodeIds.size()));
+    for (auto nodeId : nodeIds) {
+      write(ways_.file, nodeId);
+      ways_.references.add(id, 'n', nodeId);
+    }
+  }
+
+  void addRelation(std::uint64_t id,
+                   const RelationMembers &members,
+                   const std::vector<utymap::entities::Tag> &tags) {
+    relations_.begin(id);
+    writeTags(relations_.file, tags);
+    write(relations_.file, static_cast<std::uint32_t>(members.size()));
+    for (const auto &member : members) {
+      char type = member.type.empty() ? 'r' : member.type[0];
+      write(relations_.file, member.refId);
+      write(relations_.file, type);
+      write(relations_.file, static_cast<std::uint16_t>(member.role.size()));
+      relations_.file.write(member.role.data(), static_cast<std::streamsize>(member.role.size()));
+      relations_.references.add(id, type, member.refId);
+    }
+  }
+
+  void removeNode(std::uint64_t id) {
+    write(nodeFile_, id);
+    write(nodeFile_, RemovedLatitude);
+    write(nodeFile_, std::int32_t(0));
+    if (isNodesLoaded_)
+      nodes_.erase(id);
+  }
+
+  void removeWay(std::uint64_t id) {
+    ways_.begin(id);
+    write(ways_.file, RemovedCount);
+  }
+
+  void removeRelation(std::uint64_t id) {
+    relations_.begin(id);
+    write(relations_.file, RemovedCount);
+  }
+
+  NodeMap findNodes(const IdSet &ids) {
+    loadNodes();
+    NodeMap nodes;
+    for (auto id : ids) {
+      auto node = nodes_.find(id);
+      if (node!=nodes_.end())
+        nodes.insert(*node);
+    }
+    return nodes;
+  }
+
+  WayMap findWays(const IdSet &ids) {
+    return ways_.find<Way>(ids, [](std::istream &stream, Way &way) {
+      std::uint32_t count = 0;
+      read(stream, count);
+      way.nodeIds.resize(count);
+      for (auto &nodeId : way.nodeIds)
+        read(stream, nodeId);
+    });
+  }
+
+  WayMap findWaysByNodes(const IdSet &nodeIds) {
+    IdSet ids;
+    ways_.references.find('n', nodeIds, ids);
+    return findWays(ids);
+  }
+
+  RelationMap findRelations(const IdSet &ids) {
+    return relations_.find<Relation>(ids, [](std::istream &stream, Relation &relation) {
+      std::uint32_t count = 0;
+      read(stream, count);
+      relation.members.resize(count);
+      for (auto &member : relation.members) {
+        char type = 0;
+        std::uint16_t length = 0;
+        read(stream, member.refId);
+        read(stream, type);
+        read(stream, length);
+        member.type = std::string(1, type);
+        member.role.resize(length);
+        stream.read(&member.role[0], length);
+      }
+    });
+  }
+
+  RelationMap findRelationsByMembers(const IdSet &nodeIds, const IdSet &wayIds, const IdSet &relationIds) {
+    IdSet ids;
+    relations_.references.find('n', nodeIds, ids);
+    relations_.references.find('w', wayIds, ids);
+    relations_.references.find('r', relationIds, ids);
+    return findRelations(ids);
+  }
+
+  void flush() {
+    nodeFile_.flush();
+    ways_.flush();
+    relations_.flush();
+  }
+
+ private:
+  /// Loads the last locations of nodes if they are not loaded yet.
+  void loadNodes() {
+    if (isNodesLoaded_) return;
+
+    nodeFile_.flush();
+    std::ifstream file(nodePath_, std::ios::in | std::ios::binary);
+    std::uint64_t id;
+    std::int32_t latitude, longitude;
+    while (read(file, id) && read(file, latitude) && read(file, longitude)) {
+      if (latitude==RemovedLatitude)
+        nodes_.erase(id);
+      else
+        nodes_[id] = GeoCoordinate(latitude/Precision, longitude/Precision);
+    }
+    isNodesLoaded_ = true;
+  }
+
+  const std::string nodePath_;
+  std::ofstream nodeFile_;
+  bool isNodesLoaded_;
+  NodeMap nodes_;
+  ElementLog ways_;
+  ElementLog relations_;
+};
+
+OsmSourceStore::OsmSourceStore(const std::string &path) :
+    pimpl_(utymap::utils::make_unique<OsmSourceStoreImpl>(path)) {
+}
+
+OsmSourceStore::~OsmSourceStore() {
+}
+
+bool OsmSourceStore::exists(const std::string &path) {
+  return std::ifstream(path + NodeFileExtension).good();
+}
+
+void OsmSourceStore::addNode(std::uint64_t id, const GeoCoordinate &coordinate) {
+  pimpl_->addNode(id, coordinate);
+}
+
+void OsmSourceStore::addWay(std::uint64_t id,
+                            const std::vector<std::uint64_t> &nodeIds,
+                            const std::vector<utymap::entities::Tag> &tags) {
+  pimpl_->addWay(id, nodeIds, tags);
+}
+
+void OsmSourceStore::addRelation(std::uint64_t id,
+                                 const RelationMembers &members,
+                                 const std::vector<utymap::entities::Tag> &tags) {
+  pimpl_->addRelation(id, members, tags);
+}
+
+void OsmSourceStore::removeNode(std::uint64_t id) {
+  pimpl_->removeNode(id);
+}
+
+void OsmSourceStore::removeWay(std::uint64_t id) {
+  pimpl_->removeWay(id);
+}
+
+void OsmSourceStore::removeRelation(std::uint64_t id) {
+  pimpl_->removeRelation(id);
+}
+
+OsmSourceStore::NodeMap OsmSourceStore::findNodes(const IdSet &ids) {
+  return pimpl_->findNodes(ids);
+}
+
+OsmSourceStore::WayMap OsmSourceStore::findWays(const IdSet &ids) {
+  return pimpl_->findWays(ids);
+}
+
+OsmSourceStore::WayMap OsmSourceStore::findWaysByNodes(const IdSet &nodeIds) {
+  return pimpl_->findWaysByNodes(nodeIds);
+}
+
+OsmSourceStore::RelationMap OsmSourceStore::findRelations(const IdSet &ids) {
+  return pimpl_->findRelations(ids);
+}
+
+OsmSourceStore::RelationMap OsmSourceStore::findRelationsByMembers(const IdSet &nodeIds,
+                                                                   const IdSet &wayIds,
+                                                                   const IdSet &relationIds) {
+  return pimpl_->findRelationsByMembers(nodeIds, wayIds, relationIds);
+}
+
+void OsmSourceStore::flush() {
+  pimpl_->flush();
+}
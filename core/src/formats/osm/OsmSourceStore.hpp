@@ -0,0 +1,101 @@
+#ifndef FORMATS_OSM_OSMSOURCESTORE_HPP_DEFINED
+#define FORMATS_OSM_OSMSOURCESTORE_HPP_DEFINED
+
+#include "GeoCoordinate.hpp"
+#include "entities/Element.hpp"
+#include "formats/FormatTypes.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace utymap {
+namespace formats {
+
+/// Keeps osm data of imported elements: node locations, node ids of ways and members of
+/// relations with their tags. It lets change files which refer to unchanged elements be
+/// applied: previous versions are rebuilt from it and ways and relations which use changed
+/// nodes or ways are found. Data is appended to log files, later record of element replaces
+/// previous one. Ways and relations are found by offset of their last record which is kept
+/// in index file, and by references of their versions to nodes, ways and relations which
+/// are kept in reference file. Node locations, offsets and references are loaded into memory
+/// on first lookup, so memory grows with amount of kept elements; until then, records are
+/// just appended to files.
+class OsmSourceStore final {
+ public:
+  /// Source data of way.
+  struct Way final {
+    std::vector<std::uint64_t> nodeIds;
+    std::vector<utymap::entities::Tag> tags;
+  };
+
+  /// Source data of relation.
+  struct Relation final {
+    utymap::formats::RelationMembers members;
+    std::vector<utymap::entities::Tag> tags;
+  };
+
+  typedef std::unordered_map<std::uint64_t, utymap::GeoCoordinate> NodeMap;
+  typedef std::unordered_map<std::uint64_t, Way> WayMap;
+  typedef std::unordered_map<std::uint64_t, Relation> RelationMap;
+  typedef std::unordered_set<std::uint64_t> IdSet;
+
+  /// Creates store which keeps data in files with given path prefix.
+  explicit OsmSourceStore(const std::string &path);
+
+  /// Checks whether data is kept in files with given path prefix.
+  static bool exists(const std::string &path);
+
+  ~OsmSourceStore();
+
+  OsmSourceStore(const OsmSourceStore &) = delete;
+  OsmSourceStore &operator=(const OsmSourceStore &) = delete;
+
+  void addNode(std::uint64_t id, const utymap::GeoCoordinate &coordinate);
+
+  void addWay(std::uint64_t id,
+              const std::vector<std::uint64_t> &nodeIds,
+              const std::vector<utymap::entities::Tag> &tags);
+
+  void addRelation(std::uint64_t id,
+                   const utymap::formats::RelationMembers &members,
+                   const std::vector<utymap::entities::Tag> &tags);
+
+  void removeNode(std::uint64_t id);
+
+  void removeWay(std::uint64_t id);
+
+  void removeRelation(std::uint64_t id);
+
+  /// Finds the last locations of nodes with given ids.
+  NodeMap findNodes(const IdSet &ids);
+
+  /// Finds the last versions of ways with given ids.
+  WayMap findWays(const IdSet &ids);
+
+  /// Finds the last versions of ways which use any of given nodes. Way is returned if any
+  /// of its versions uses them, unless it is removed.
+  WayMap findWaysByNodes(const IdSet &nodeIds);
+
+  /// Finds the last versions of relations with given ids.
+  RelationMap findRelations(const IdSet &ids);
+
+  /// Finds the last versions of relations which have any of given nodes, ways or relations
+  /// as members. Relation is returned if any of its versions has them, unless it is removed.
+  RelationMap findRelationsByMembers(const IdSet &nodeIds, const IdSet &wayIds, const IdSet &relationIds);
+
+  /// Writes buffered data to disk.
+  void flush();
+
+ private:
+  class OsmSourceStoreImpl;
+  std::unique_ptr<OsmSourceStoreImpl> pimpl_;
+};
+
+}
+}
+
+#endif // FORMATS_OSM_OSMSOURCESTORE_HPP_DEFINED
@@ -0,0 +1,81 @@
+#ifndef FORMATS_OSM_RELATIONMEMBERCOLLECTOR_HPP_DEFINED
+#define FORMATS_OSM_RELATIONMEMBERCOLLECTOR_HPP_DEFINED
+
+#include "BoundingBox.hpp"
+#include "GeoCoordinate.hpp"
+#include "entities/Element.hpp"
+#include "formats/FormatTypes.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace utymap {
+namespace formats {
+
+/// Collects ids of nodes and ways which are members of relations. It is used by the first
+/// pass over osm data, so it ignores everything else and does not add strings to string table.
+class RelationMemberCollector final {
+ public:
+  void visitBounds(utymap::BoundingBox) {}
+
+  void visitNode(std::uint64_t, utymap::GeoCoordinate &, utymap::formats::Tags &) {}
+
+  void visitNode(std::uint64_t, utymap::GeoCoordinate &, std::vector<utymap::entities::Tag> &) {}
+
+  void visitWay(std::uint64_t, std::vector<std::uint64_t> &, utymap::formats::Tags &) {}
+
+  void visitWay(std::uint64_t, std::vector<std::uint64_t> &, std::vector<utymap::entities::Tag> &) {}
+
+  void visitRelation(std::uint64_t, utymap::formats::RelationMembers &members, utymap::formats::Tags &) {
+    add(members);
+  }
+
+  void visitRelation(std::uint64_t, utymap::formats::RelationMembers &members, std::vector<utymap::entities::Tag> &) {
+    add(members);
+  }
+
+  /// Drops all tags: they are not needed to collect members.
+  bool getKeyId(const std::string &, std::uint32_t &) const { return false; }
+
+  std::uint32_t getValueId(const std::string &) const { return 0; }
+
+  /// Prepares collected ids for lookup.
+  void complete() {
+    sort(nodeIds_);
+    sort(wayIds_);
+  }
+
+  /// Checks whether node is member of some relation.
+  bool isNodeMember(std::uint64_t id) const {
+    return std::binary_search(nodeIds_.begin(), nodeIds_.end(), id);
+  }
+
+  /// Checks whether way or area is member of some relation.
+  bool isWayMember(std::uint64_t id) const {
+    return std::binary_search(wayIds_.begin(), wayIds_.end(), id);
+  }
+
+ private:
+  void add(const utymap::formats::RelationMembers &members) {
+    for (const auto &member : members) {
+      if (member.type=="n") nodeIds_.push_back(member.refId);
+      else if (member.type=="w") wayIds_.push_back(member.refId);
+    }
+  }
+
+  static void sort(std::vector<std::uint64_t> &ids) {
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    ids.shrink_to_fit();
+  }
+
+  std::vector<std::uint64_t> nodeIds_;
+  std::vector<std::uint64_t> wayIds_;
+};
+
+}
+}
+
+#endif // FORMATS_OSM_RELATIONMEMBERCOLLECTOR_HPP_DEFINED
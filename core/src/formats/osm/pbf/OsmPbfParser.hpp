@@ -2,20 +2,35 @@
 #define FORMATS_PBF_OSMPBFPARSER_HPP_INCLUDED
 
 #include "BoundingBox.hpp"
+#include "entities/Element.hpp"
 #include "formats/FormatTypes.hpp"
+#include "formats/TagPruner.hpp"
+#include "utils/BoundedQueue.hpp"
 
 #include <fileformat.pb.h>
 #include <osmformat.pb.h>
 #include <zlib.h>
 
+#include <atomic>
+#include <condition_variable>
 #include <cstdint>
+#include <cstring>
+#include <exception>
 #include <istream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <stdexcept>
+#include <thread>
 #include <vector>
 
 namespace utymap {
 namespace formats {
 
+/// Parses osm pbf files. Tags are passed to visitor as ids which visitor resolves
+/// by getKeyId and getValueId once per string of block string table. Keys of multipolygon
+/// relation are resolved by getValueId as such relation keeps all its tags.
 template<typename Visitor>
 class OsmPbfParser final {
   const static int MaxBlobHeaderSize = 64*1024;
@@ -23,19 +38,29 @@ class OsmPbfParser final {
 
  public:
 
-  OsmPbfParser() :
-      buffer_(MaxUncompressedBlobSize),
-      unpack_buffer_(MaxUncompressedBlobSize),
+  /// Creates parser. If worker count is not zero, blobs are read by reader thread and
+  /// inflated and decoded by worker threads, but visitor is still called by parsing thread
+  /// in the order of blocks in file.
+  explicit OsmPbfParser(std::size_t workerCount = 0) :
+      workerCount_(workerCount),
+      buffer_(workerCount==0 ? MaxUncompressedBlobSize : 0),
+      unpack_buffer_(workerCount==0 ? MaxUncompressedBlobSize : 0),
       finished_(false) {
   }
 
   void parse(std::istream &stream, Visitor &visitor) {
+    if (workerCount_ > 0) {
+      ParallelDecoder(stream, workerCount_).parse(*this, visitor);
+      return;
+    }
+
     finished_ = false;
 
     while (!stream.eof() && !stream.fail() && !finished_) {
-      OSMPBF::BlobHeader header = readHeader(stream);
+      OSMPBF::BlobHeader header = readHeader(stream, buffer_, finished_);
       if (!finished_) {
-        std::int32_t sz = readBlob(header, stream);
+        readBlobData(header, stream, buffer_);
+        std::int32_t sz = unpackBlob(buffer_.data(), header.datasize(), unpack_buffer_);
         if (header.type()=="OSMData") {
           parsePrimitiveBlock(sz, visitor);
         } else if (header.type()=="OSMHeader") {
@@ -47,17 +72,223 @@ class OsmPbfParser final {
 
  private:
 
+  /// Decodes blocks using worker threads and passes them to visitor in file order.
+  class ParallelDecoder final {
+    /// Raw data of blob with its number in file.
+    struct Blob final {
+      std::uint64_t sequence;
+      std::vector<char> data;
+    };
+
+    typedef std::shared_ptr<const OSMPBF::PrimitiveBlock> BlockPtr;
+
+   public:
+    ParallelDecoder(std::istream &stream, std::size_t workerCount) :
+        stream_(stream),
+        workerCount_(workerCount),
+        maxPending_(workerCount*4),
+        blobs_(workerCount*2),
+        readCount_(0),
+        visitCount_(0),
+        isRead_(false),
+        hasError_(false) {
+    }
+
+    void parse(OsmPbfParser &parser, Visitor &visitor) {
+      try {
+        reader_ = std::thread(&ParallelDecoder::read, this);
+        for (std::size_t i = 0; i < workerCount_; ++i)
+          workers_.push_back(std::thread(&ParallelDecoder::decode, this));
+
+        BlockPtr block;
+        while ((block = next())!=nullptr)
+          parser.visitPrimitiveBlock(*block, visitor);
+      } catch (...) {
+        fail(std::current_exception());
+      }
+
+      join();
+      if (error_!=nullptr)
+        std::rethrow_exception(error_);
+    }
+
+   private:
+    /// Slices stream into blobs of primitive blocks.
+    void read() {
+      try {
+        std::vector<char> buffer(MaxBlobHeaderSize);
+        bool isFinished = false;
+        while (!stream_.eof() && !stream_.fail()) {
+          OSMPBF::BlobHeader header = readHeader(stream_, buffer, isFinished);
+          if (isFinished) break;
+
+          Blob blob;
+          readBlobData(header, stream_, blob.data);
+          if (header.type()!="OSMData") continue;
+
+          {
+            std::unique_lock<std::mutex> lock(lock_);
+            // NOTE limits amount of blocks which wait for visitor as they take a lot of memory.
+            changed_.wait(lock, [&] { return hasError_ || readCount_ - visitCount_ < maxPending_; });
+            if (hasError_) break;
+            blob.sequence = readCount_++;
+          }
+          if (!blobs_.push(std::move(blob))) break;
+        }
+      } catch (...) {
+        fail(std::current_exception());
+      }
+
+      blobs_.close();
+      std::lock_guard<std::mutex> lock(lock_);
+      isRead_ = true;
+      changed_.notify_all();
+    }
+
+    /// Inflates and decodes blobs.
+    void decode() {
+      std::vector<char> unpacked;
+      Blob blob;
+      while (blobs_.pop(blob)) {
+        if (hasError_) continue;
+        try {
+          std::int32_t size = unpackBlob(blob.data.data(), static_cast<std::int32_t>(blob.data.size()), unpacked);
+          auto block = std::make_shared<OSMPBF::PrimitiveBlock>();
+          if (!block->ParseFromArray(unpacked.data(), size))
+            throw std::domain_error("Unable to parse primitive block");
+
+          std::lock_guard<std::mutex> lock(lock_);
+          decoded_.emplace(blob.sequence, block);
+          changed_.notify_all();
+        } catch (...) {
+          fail(std::current_exception());
+        }
+      }
+    }
+
+    /// Waits for the next block in file order. Returns null if there are no more blocks.
+    BlockPtr next() {
+      std::unique_lock<std::mutex> lock(lock_);
+      changed_.wait(lock, [&] {
+        return hasError_ || decoded_.find(visitCount_)!=decoded_.end() || (isRead_ && visitCount_==readCount_);
+      });
+
+      auto block = decoded_.find(visitCount_);
+      if (hasError_ || block==decoded_.end())
+        return nullptr;
+
+      BlockPtr result = block->second;
+      decoded_.erase(block);
+      ++visitCount_;
+      changed_.notify_all();
+      return result;
+    }
+
+    /// Keeps the first error and stops all threads.
+    void fail(std::exception_ptr error) {
+      std::lock_guard<std::mutex> lock(lock_);
+      if (error_==nullptr)
+        error_ = error;
+      hasError_ = true;
+      blobs_.close();
+      changed_.notify_all();
+    }
+
+    void join() {
+      if (reader_.joinable())
+        reader_.join();
+      for (auto &worker : workers_) {
+        if (worker.joinable())
+          worker.join();
+      }
+    }
+
+    std::istream &stream_;
+    const std::size_t workerCount_;
+    const std::uint64_t maxPending_;
+
+    utymap::utils::BoundedQueue<Blob> blobs_;
+    std::map<std::uint64_t, BlockPtr> decoded_;
+    std::thread reader_;
+    std::vector<std::thread> workers_;
+
+    std::uint64_t readCount_;
+    std::uint64_t visitCount_;
+    bool isRead_;
+    std::atomic<bool> hasError_;
+    std::exception_ptr error_;
+    std::mutex lock_;
+    std::condition_variable changed_;
+  };
+
+  typedef std::vector<utymap::entities::Tag> ElementTags;
+
+  /// Maps strings of block string table to ids given by visitor. Every string is resolved
+  /// at most once per block and only if it is used by tag.
+  class BlockStringTable final {
+    enum : std::uint32_t {
+      UnresolvedId = std::numeric_limits<std::uint32_t>::max(),
+      DroppedId = UnresolvedId - 1
+    };
+
+   public:
+    BlockStringTable(const OSMPBF::StringTable &strings, Visitor &visitor) :
+        strings_(strings),
+        visitor_(visitor),
+        keyIds_(static_cast<std::size_t>(strings.s_size()), static_cast<std::uint32_t>(UnresolvedId)),
+        valueIds_(static_cast<std::size_t>(strings.s_size()), static_cast<std::uint32_t>(UnresolvedId)) {
+    }
+
+    /// Gets id of tag key with given index. Returns false if visitor drops tags with this key.
+    bool getKeyId(std::uint32_t index, std::uint32_t &id) {
+      std::uint32_t &keyId = get(keyIds_, index);
+      if (keyId==UnresolvedId)
+        keyId = visitor_.getKeyId(strings_.s(index), id) ? id : static_cast<std::uint32_t>(DroppedId);
+      id = keyId;
+      return keyId!=DroppedId;
+    }
+
+    /// Gets id of tag value with given index.
+    std::uint32_t getValueId(std::uint32_t index) {
+      std::uint32_t &valueId = get(valueIds_, index);
+      if (valueId==UnresolvedId)
+        valueId = visitor_.getValueId(strings_.s(index));
+      return valueId;
+    }
+
+    /// Checks whether tag with given key and value indices marks relation as multipolygon.
+    bool isMultipolygon(std::uint32_t keyIndex, std::uint32_t valueIndex) const {
+      if (keyIndex >= keyIds_.size() || valueIndex >= valueIds_.size())
+        throw std::domain_error("Invalid string index in primitive block");
+      return utymap::formats::TagPruner::isMultipolygon(strings_.s(keyIndex), strings_.s(valueIndex));
+    }
+
+   private:
+    static std::uint32_t &get(std::vector<std::uint32_t> &ids, std::uint32_t index) {
+      if (index >= ids.size())
+        throw std::domain_error("Invalid string index in primitive block");
+      return ids[index];
+    }
+
+    const OSMPBF::StringTable &strings_;
+    Visitor &visitor_;
+    std::vector<std::uint32_t> keyIds_;
+    std::vector<std::uint32_t> valueIds_;
+  };
+
+  const std::size_t workerCount_;
   std::vector<char> buffer_;
   std::vector<char> unpack_buffer_;
   bool finished_;
 
-  OSMPBF::BlobHeader readHeader(std::istream &stream) {
+  /// Reads header of the next blob. Sets finished flag if stream has no more blobs.
+  static OSMPBF::BlobHeader readHeader(std::istream &stream, std::vector<char> &buffer, bool &finished) {
     std::int32_t sz;
     OSMPBF::BlobHeader result;
 
     // read size of blob-header
     if (!stream.read(reinterpret_cast<char *>(&sz), 4)) {
-      finished_ = true;
+      finished = true;
       return result;
     }
 
@@ -67,44 +298,57 @@ class OsmPbfParser final {
     if (sz > MaxBlobHeaderSize)
       throw std::domain_error("Blob header size is bigger than allowed");
 
-    stream.read(buffer_.data(), sz);
+    if (buffer.size() < static_cast<std::size_t>(sz))
+      buffer.resize(sz);
+    stream.read(buffer.data(), sz);
     if (!stream.good())
       throw std::domain_error("Unable to read blob header from file");
 
-    if (!result.ParseFromArray(buffer_.data(), sz))
+    if (!result.ParseFromArray(buffer.data(), sz))
       throw std::domain_error("Unable to parse blob header");
 
     return result;
   }
 
-  std::int32_t readBlob(const OSMPBF::BlobHeader &header, std::istream &stream) {
-    OSMPBF::Blob blob;
-
+  /// Reads serialized blob which follows given header.
+  static void readBlobData(const OSMPBF::BlobHeader &header, std::istream &stream, std::vector<char> &buffer) {
     std::int32_t sz = header.datasize();
 
     if (sz > MaxUncompressedBlobSize)
       throw std::domain_error("Blob size is bigger then allowed");
 
-    if (!stream.read(buffer_.data(), sz))
+    if (buffer.size() < static_cast<std::size_t>(sz))
+      buffer.resize(sz);
+    if (!stream.read(buffer.data(), sz))
       throw std::domain_error("Unable to read blob from file");
+  }
+
+  /// Parses serialized blob and puts its uncompressed content to buffer. Returns content size.
+  static std::int32_t unpackBlob(const char *data, std::int32_t size, std::vector<char> &buffer) {
+    OSMPBF::Blob blob;
 
-    if (!blob.ParseFromArray(buffer_.data(), sz))
+    if (!blob.ParseFromArray(data, size))
       throw std::domain_error("Unable to parse blob");
 
     // uncompressed
     if (blob.has_raw()) {
-      sz = static_cast<std::int32_t>(blob.raw().size());
-      memcpy(unpack_buffer_.data(), buffer_.data(), sz);
+      std::int32_t sz = static_cast<std::int32_t>(blob.raw().size());
+      if (buffer.size() < static_cast<std::size_t>(sz))
+        buffer.resize(sz);
+      memcpy(buffer.data(), blob.raw().data(), sz);
       return sz;
     }
 
     if (blob.has_zlib_data()) {
-      sz = static_cast<std::int32_t>(blob.zlib_data().size());
+      if (blob.raw_size() > MaxUncompressedBlobSize)
+        throw std::domain_error("Blob size is bigger then allowed");
+      if (buffer.size() < static_cast<std::size_t>(blob.raw_size()))
+        buffer.resize(blob.raw_size());
 
       z_stream z;
       z.next_in = (unsigned char *) blob.zlib_data().c_str();
-      z.avail_in = sz;
-      z.next_out = reinterpret_cast<unsigned char *>(unpack_buffer_.data());
+      z.avail_in = static_cast<std::int32_t>(blob.zlib_data().size());
+      z.next_out = reinterpret_cast<unsigned char *>(buffer.data());
       z.avail_out = blob.raw_size();
       z.zalloc = Z_NULL;
       z.zfree = Z_NULL;
@@ -134,54 +378,57 @@ class OsmPbfParser final {
     if (!primblock.ParseFromArray(unpack_buffer_.data(), sz))
       throw std::domain_error("Unable to parse primitive block");
 
+    visitPrimitiveBlock(primblock, visitor);
+  }
+
+  void visitPrimitiveBlock(const OSMPBF::PrimitiveBlock &primblock, Visitor &visitor) {
+    BlockStringTable strings(primblock.stringtable(), visitor);
+
     for (int i = 0, l = primblock.primitivegroup_size(); i < l; i++) {
-      OSMPBF::PrimitiveGroup pg = primblock.primitivegroup(i);
+      const OSMPBF::PrimitiveGroup &pg = primblock.primitivegroup(i);
 
       // simple nodes
       for (int i = 0; i < pg.nodes_size(); ++i) {
-        OSMPBF::Node n = pg.nodes(i);
+        const OSMPBF::Node &n = pg.nodes(i);
         GeoCoordinate coordinate;
         coordinate.latitude = 0.000000001*(primblock.lat_offset() + (primblock.granularity()*n.lat()));
         coordinate.longitude = 0.000000001*(primblock.lon_offset() + (primblock.granularity()*n.lon()));
         std::uint64_t id = n.id();
-        Tags tags;
-        setTags(n, primblock, tags);
+        ElementTags tags;
+        setTags(n, strings, tags);
         visitor.visitNode(id, coordinate, tags);
       }
 
       // dense nodes
       if (pg.has_dense()) {
-        OSMPBF::DenseNodes dn = pg.dense();
+        const OSMPBF::DenseNodes &dn = pg.dense();
         uint64_t id = 0;
-        double lon = 0;
-        double lat = 0;
+        std::int64_t lon = 0;
+        std::int64_t lat = 0;
 
         int current_kv = 0;
 
         for (int i = 0; i < dn.id_size(); ++i) {
           id += dn.id(i);
-          lat += 0.000000001*(primblock.lat_offset() + (primblock.granularity()*dn.lat(i)));
-          lon += 0.000000001*(primblock.lon_offset() + (primblock.granularity()*dn.lon(i)));
+          lat += dn.lat(i);
+          lon += dn.lon(i);
 
-          Tags tags;
-          tags.reserve(2);
+          ElementTags tags;
           while (current_kv < dn.keys_vals_size() && dn.keys_vals(current_kv)!=0) {
-            auto key = dn.keys_vals(current_kv);
-            auto val = dn.keys_vals(current_kv + 1);
-            Tag tag;
-            tag.key = primblock.stringtable().s(key);
-            tag.value = primblock.stringtable().s(val);
+            std::uint32_t key;
+            if (strings.getKeyId(dn.keys_vals(current_kv), key))
+              tags.emplace_back(key, strings.getValueId(dn.keys_vals(current_kv + 1)));
             current_kv += 2;
-            tags.push_back(tag);
           }
           ++current_kv;
-          GeoCoordinate coordinate(lat, lon);
+          GeoCoordinate coordinate(0.000000001*(primblock.lat_offset() + (primblock.granularity()*lat)),
+                                   0.000000001*(primblock.lon_offset() + (primblock.granularity()*lon)));
           visitor.visitNode(id, coordinate, tags);
         }
       }
 
       for (int i = 0; i < pg.ways_size(); ++i) {
-        OSMPBF::Way w = pg.ways(i);
+        const OSMPBF::Way &w = pg.ways(i);
 
         uint64_t ref = 0;
         std::vector<uint64_t> nodeIds;
@@ -191,13 +438,13 @@ class OsmPbfParser final {
           nodeIds.push_back(ref);
         }
         uint64_t id = w.id();
-        Tags tags;
-        setTags(w, primblock, tags);
+        ElementTags tags;
+        setTags(w, strings, tags);
         visitor.visitWay(id, nodeIds, tags);
       }
 
       for (int i = 0; i < pg.relations_size(); ++i) {
-        OSMPBF::Relation rel = pg.relations(i);
+        const OSMPBF::Relation &rel = pg.relations(i);
         uint64_t id = 0;
         RelationMembers refs;
         refs.reserve(rel.memids_size());
@@ -211,14 +458,14 @@ class OsmPbfParser final {
         }
 
         uint64_t rel_id = rel.id();
-        Tags tags;
-        setTags(rel, primblock, tags);
+        ElementTags tags;
+        setRelationTags(rel, strings, tags);
         visitor.visitRelation(rel_id, refs, tags);
       }
     }
   }
 
-  static std::string parseType(OSMPBF::Relation &rel, int index) {
+  static std::string parseType(const OSMPBF::Relation &rel, int index) {
     switch (rel.types(index)) {
       case OSMPBF::Relation::NODE:return "n";
       case OSMPBF::Relation::WAY:return "w";
@@ -228,16 +475,29 @@ class OsmPbfParser final {
   }
 
   template<typename T>
-  void setTags(const T &object, const OSMPBF::PrimitiveBlock &primblock, Tags &tags) {
+  static void setTags(const T &object, BlockStringTable &strings, ElementTags &tags) {
     tags.reserve(object.keys_size());
     for (int i = 0; i < object.keys_size(); ++i) {
-      Tag tag;
-      auto key = object.keys(i);
-      auto val = object.vals(i);
-      tag.key = primblock.stringtable().s(key);
-      tag.value = primblock.stringtable().s(val);
-      tags.push_back(tag);
+      std::uint32_t key;
+      if (strings.getKeyId(object.keys(i), key))
+        tags.emplace_back(key, strings.getValueId(object.vals(i)));
+    }
+  }
+
+  /// Sets tags of relation. Multipolygon relation keeps all its tags, see TagPruner.
+  static void setRelationTags(const OSMPBF::Relation &relation, BlockStringTable &strings, ElementTags &tags) {
+    bool isMultipolygon = false;
+    for (int i = 0; i < relation.keys_size() && !isMultipolygon; ++i)
+      isMultipolygon = strings.isMultipolygon(relation.keys(i), relation.vals(i));
+
+    if (!isMultipolygon) {
+      setTags(relation, strings, tags);
+      return;
     }
+
+    tags.reserve(relation.keys_size());
+    for (int i = 0; i < relation.keys_size(); ++i)
+      tags.emplace_back(strings.getValueId(relation.keys(i)), strings.getValueId(relation.vals(i)));
   }
 };
 
@@ -0,0 +1,109 @@
+#ifndef FORMATS_XML_OSMCHANGEPARSER_HPP_INCLUDED
+#define FORMATS_XML_OSMCHANGEPARSER_HPP_INCLUDED
+
+#include "GeoCoordinate.hpp"
+#include "formats/FormatTypes.hpp"
+
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/xml_parser.hpp>
+
+#include <map>
+#include <utility>
+
+namespace utymap {
+namespace formats {
+
+/// Parses osm change file. Elements of create and modify blocks are passed to update
+/// visitor, elements of delete blocks are passed to delete visitor. If element occurs
+/// several times, then only its last occurrence is taken into account. Deleted node
+/// without coordinate is passed with invalid one.
+template<typename Visitor>
+class OsmChangeParser {
+  using ptree = boost::property_tree::ptree;
+  /// Element type and id.
+  typedef std::pair<std::string, std::uint64_t> ElementKey;
+
+ public:
+  /// Parses osm change data from stream calling visitors.
+  void parse(std::istream &istream, Visitor &updateVisitor, Visitor &deleteVisitor) const {
+    ptree pt;
+    read_xml(istream, pt);
+    const ptree &root = pt.get_child("osmChange");
+
+    std::map<ElementKey, const ptree *> lastOccurrences;
+    visitElements(root, [&](const std::string &, const ptree::value_type &element) {
+      lastOccurrences[getKey(element)] = &element.second;
+    });
+
+    visitElements(root, [&](const std::string &action, const ptree::value_type &element) {
+      bool isDeleted = action=="delete";
+      if (lastOccurrences[getKey(element)]==&element.second)
+        visitElement(element.first, element.second, isDeleted, isDeleted ? deleteVisitor : updateVisitor);
+    });
+  }
+
+ private:
+  /// Visits elements of all action blocks in document order.
+  template<typename Function>
+  static void visitElements(const ptree &root, const Function &function) {
+    for (const ptree::value_type &action : root) {
+      if (action.first!="create" && action.first!="modify" && action.first!="delete")
+        continue;
+
+      for (const ptree::value_type &element : action.second) {
+        if (element.first=="node" || element.first=="way" || element.first=="relation")
+          function(action.first, element);
+      }
+    }
+  }
+
+  static ElementKey getKey(const ptree::value_type &element) {
+    return ElementKey(element.first, element.second.get<std::uint64_t>("<xmlattr>.id"));
+  }
+
+  static void visitElement(const std::string &type, const ptree &element, bool isDeleted, Visitor &visitor) {
+    auto id = element.get<std::uint64_t>("<xmlattr>.id");
+    Tags tags;
+    std::vector<std::uint64_t> nodeIds;
+    RelationMembers members;
+    for (const ptree::value_type &child : element) {
+      if (child.first=="tag")
+        tags.push_back(Tag(child.second.get<std::string>("<xmlattr>.k"), child.second.get<std::string>("<xmlattr>.v")));
+      else if (child.first=="nd")
+        nodeIds.push_back(child.second.get<std::uint64_t>("<xmlattr>.ref"));
+      else if (child.first=="member")
+        members.push_back(RelationMember{child.second.get<std::uint64_t>("<xmlattr>.ref"),
+                                         mapType(child.second.get<std::string>("<xmlattr>.type")),
+                                         child.second.get<std::string>("<xmlattr>.role", "")});
+    }
+
+    if (type=="node") {
+      // NOTE deleted node can come without coordinate, then it is visited with invalid one.
+      auto latitude = element.get_optional<double>("<xmlattr>.lat");
+      auto longitude = element.get_optional<double>("<xmlattr>.lon");
+      GeoCoordinate coordinate;
+      if (latitude && longitude)
+        coordinate = GeoCoordinate(*latitude, *longitude);
+      else if (!isDeleted)
+        return;
+
+      visitor.visitNode(id, coordinate, tags);
+    } else if (type=="way")
+      visitor.visitWay(id, nodeIds, tags);
+    else
+      visitor.visitRelation(id, members, tags);
+  }
+
+  static std::string mapType(const std::string &type) {
+    if (type=="node")
+      return "n";
+    if (type=="way")
+      return "w";
+    return "r";
+  }
+};
+
+}
+}
+
+#endif  // FORMATS_XML_OSMCHANGEPARSER_HPP_INCLUDED
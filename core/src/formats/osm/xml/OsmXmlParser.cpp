@@ -292,6 +292,7 @@ void OsmXmlParser<Visitor>::parse(std::istream& istream, Visitor& visitor) {
 
 template class OsmXmlParser<OsmDataVisitor>;
 template class OsmXmlParser<CountableOsmDataVisitor>;
+template class OsmXmlParser<RelationMemberCollector>;
 
 }
 }
@@ -3,6 +3,7 @@
 
 #include "formats/osm/OsmDataVisitor.hpp"
 #include "formats/osm/CountableOsmDataVisitor.hpp"
+#include "formats/osm/RelationMemberCollector.hpp"
 
 namespace utymap {
 namespace formats {
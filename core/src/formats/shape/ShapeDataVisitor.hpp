@@ -8,6 +8,7 @@
 #include "entities/Area.hpp"
 #include "entities/Relation.hpp"
 #include "formats/FormatTypes.hpp"
+#include "formats/TagPruner.hpp"
 #include "index/StringTable.hpp"
 #include "utils/ElementUtils.hpp"
 
@@ -26,25 +27,29 @@ struct ShapeDataVisitor final {
   int relations;
 
   ShapeDataVisitor(const utymap::index::StringTable &stringTable,
-                   std::function<bool(utymap::entities::Element &)> functor) :
+                   std::function<bool(utymap::entities::Element &)> functor,
+                   const utymap::formats::TagPruner &pruner = utymap::formats::TagPruner()) :
       nodes(0),
       ways(0),
       areas(0),
       relations(0),
       stringTable_(stringTable),
-      functor_(functor) {
+      functor_(functor),
+      pruner_(pruner) {
   }
 
   void visitNode(utymap::GeoCoordinate &coordinate, utymap::formats::Tags &tags) {
     utymap::entities::Node node;
     node.id = 0;
     node.coordinate = coordinate;
+    pruner_.prune(tags);
     utymap::utils::setTags(stringTable_, node, tags);
     if (functor_(node))
       nodes++;
   }
 
   void visitWay(utymap::formats::Coordinates &coordinates, utymap::formats::Tags &tags, bool isRing) {
+    pruner_.prune(tags);
     if (isRing) {
       utymap::entities::Area area;
       area.id = 0;
@@ -65,6 +70,7 @@ struct ShapeDataVisitor final {
   void visitRelation(utymap::formats::PolygonMembers &members, utymap::formats::Tags &tags) {
     utymap::entities::Relation relation;
     relation.id = 0;
+    pruner_.prune(tags);
     utymap::utils::setTags(stringTable_, relation, tags);
     for (const auto &member : members) {
       if (member.coordinates.size()==1) {
@@ -93,6 +99,7 @@ struct ShapeDataVisitor final {
  private:
   const utymap::index::StringTable &stringTable_;
   std::function<bool(utymap::entities::Element &)> functor_;
+  const utymap::formats::TagPruner pruner_;
 };
 
 }
@@ -0,0 +1,21 @@
+#ifndef INDEX_COMPACTIONOPTIONS_HPP_DEFINED
+#define INDEX_COMPACTIONOPTIONS_HPP_DEFINED
+
+#include <chrono>
+
+namespace utymap {
+namespace index {
+
+/// Specifies how tiles fragmented by updated and erased elements are compacted.
+struct CompactionOptions final {
+  /// Min share of superseded and erased entries in tile index which triggers tile rewrite.
+  double minGarbageRatio = 0.25;
+  /// Pause after each rewritten tile, so compaction running in background
+  /// leaves disk bandwidth for tile loading.
+  std::chrono::milliseconds pause = std::chrono::milliseconds(0);
+};
+
+}
+}
+
+#endif // INDEX_COMPACTIONOPTIONS_HPP_DEFINED
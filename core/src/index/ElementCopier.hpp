@@ -0,0 +1,53 @@
+#ifndef INDEX_ELEMENTCOPIER_HPP_DEFINED
+#define INDEX_ELEMENTCOPIER_HPP_DEFINED
+
+#include "entities/Node.hpp"
+#include "entities/Way.hpp"
+#include "entities/Area.hpp"
+#include "entities/Relation.hpp"
+
+#include <memory>
+
+namespace utymap {
+namespace index {
+
+/// Creates deep copy of element.
+class ElementCopier final : public utymap::entities::ElementVisitor {
+ public:
+  std::shared_ptr<utymap::entities::Element> element;
+
+  void visitNode(const utymap::entities::Node &node) override {
+    element = std::make_shared<utymap::entities::Node>(node);
+  }
+
+  void visitWay(const utymap::entities::Way &way) override {
+    element = std::make_shared<utymap::entities::Way>(way);
+  }
+
+  void visitArea(const utymap::entities::Area &area) override {
+    element = std::make_shared<utymap::entities::Area>(area);
+  }
+
+  void visitRelation(const utymap::entities::Relation &relation) override {
+    auto copy = std::make_shared<utymap::entities::Relation>();
+    copy->id = relation.id;
+    copy->tags = relation.tags;
+    for (const auto &member : relation.elements) {
+      member->accept(*this);
+      copy->elements.push_back(element);
+    }
+    element = copy;
+  }
+
+  /// Creates deep copy of given element.
+  static std::shared_ptr<utymap::entities::Element> copy(const utymap::entities::Element &element) {
+    ElementCopier copier;
+    element.accept(copier);
+    return copier.element;
+  }
+};
+
+}
+}
+
+#endif // INDEX_ELEMENTCOPIER_HPP_DEFINED
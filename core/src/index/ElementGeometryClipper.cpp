@@ -7,6 +7,9 @@
 #include "entities/Relation.hpp"
 #include "index/ElementStore.hpp"
 #include "index/ElementGeometryClipper.hpp"
+#include "index/RectangleClipper.hpp"
+
+#include <cmath>
 
 using namespace utymap;
 using namespace utymap::entities;
@@ -19,16 +22,46 @@ const double Scale = 1E7;
 
 using PointLocation = utymap::index::ElementGeometryClipper::PointLocation;
 
+/// Keeps clippers used for quadkey: rectangle clipper is tried first, general one is
+/// used only for cases which rectangle clipper cannot handle.
+struct Clippers final {
+  ClipperLib::ClipperEx &general;
+  const utymap::index::RectangleClipper &rectangle;
+
+  ClipperLib::Paths clip(const ClipperLib::Path &path, bool isClosed) {
+    ClipperLib::Paths solution;
+    if (isClosed ? rectangle.clipRing(path, solution) : rectangle.clipPolyline(path, solution))
+      return solution;
+
+    ClipperLib::PolyTree polyTree;
+    general.AddPath(path, ClipperLib::ptSubject, isClosed);
+    general.Execute(ClipperLib::ctIntersection, polyTree);
+    general.removeSubject();
+
+    solution.clear();
+    for (ClipperLib::PolyNode *polyNode = polyTree.GetFirst(); polyNode!=nullptr; polyNode = polyNode->GetNext())
+      solution.push_back(std::move(polyNode->Contour));
+    return solution;
+  }
+};
+
 template<typename T, typename std::enable_if<std::is_same<T, Way>::value, std::size_t>::type = 0>
 bool areConnected(const BoundingBox &, const BoundingBox &, bool allOutside) {
   return !allOutside;
 }
 
 template<typename T, typename std::enable_if<std::is_same<T, Area>::value, std::size_t>::type = 0>
-bool areConnected(const BoundingBox &quadKeyBbox, const BoundingBox &elementBbox, bool allOutside) {
+bool areConnected(const BoundingBox &quadKeyBbox, const BoundingBox &elementBbox, bool) {
   return quadKeyBbox.intersects(elementBbox);
 }
 
+/// Converts coordinate to fixed point. NOTE rounding keeps already clipped coordinates
+/// unchanged when they are clipped again by tiles of the next level of details.
+ClipperLib::IntPoint createPoint(double longitude, double latitude) {
+  return ClipperLib::IntPoint(static_cast<ClipperLib::cInt>(std::llround(longitude*Scale)),
+                              static_cast<ClipperLib::cInt>(std::llround(latitude*Scale)));
+}
+
 template<typename T>
 PointLocation checkElement(const BoundingBox &quadKeyBbox, const T &element, ClipperLib::Path &elementShape) {
   elementShape.reserve(element.coordinates.size());
@@ -41,9 +74,7 @@ PointLocation checkElement(const BoundingBox &quadKeyBbox, const T &element, Cli
     allOutside &= !contains;
     elementBbox.expand(coord);
 
-    auto x = static_cast<ClipperLib::cInt>(coord.longitude*Scale);
-    auto y = static_cast<ClipperLib::cInt>(coord.latitude*Scale);
-    elementShape.push_back(ClipperLib::IntPoint(x, y));
+    elementShape.push_back(createPoint(coord.longitude, coord.latitude));
   }
 
   return allInside ? PointLocation::AllInside :
@@ -65,26 +96,20 @@ void setData(T &t, const utymap::entities::Element &element, const ClipperLib::P
   setCoordinates<T>(t, path);
 }
 
+
 ClipperLib::Path createPathFromBoundingBox(const BoundingBox &quadKeyBbox) {
   double xMin = quadKeyBbox.minPoint.longitude, yMin = quadKeyBbox.minPoint.latitude,
       xMax = quadKeyBbox.maxPoint.longitude, yMax = quadKeyBbox.maxPoint.latitude;
   ClipperLib::Path rect;
-  rect.push_back(ClipperLib::IntPoint(static_cast<ClipperLib::cInt>(xMin*Scale),
-                                      static_cast<ClipperLib::cInt>(yMin*Scale)));
-
-  rect.push_back(ClipperLib::IntPoint(static_cast<ClipperLib::cInt>(xMax*Scale),
-                                      static_cast<ClipperLib::cInt>(yMin*Scale)));
-
-  rect.push_back(ClipperLib::IntPoint(static_cast<ClipperLib::cInt>(xMax*Scale),
-                                      static_cast<ClipperLib::cInt>(yMax*Scale)));
-
-  rect.push_back(ClipperLib::IntPoint(static_cast<ClipperLib::cInt>(xMin*Scale),
-                                      static_cast<ClipperLib::cInt>(yMax*Scale)));
-  return std::move(rect);
+  rect.push_back(createPoint(xMin, yMin));
+  rect.push_back(createPoint(xMax, yMin));
+  rect.push_back(createPoint(xMax, yMax));
+  rect.push_back(createPoint(xMin, yMax));
+  return rect;
 }
 
 template<typename T>
-std::shared_ptr<Element> clipElement(ClipperLib::ClipperEx &clipper,
+std::shared_ptr<Element> clipElement(Clippers &clippers,
                                      const BoundingBox &bbox,
                                      const T &element,
                                      bool isClosed) {
@@ -100,17 +125,13 @@ std::shared_ptr<Element> clipElement(ClipperLib::ClipperEx &clipper,
     return nullptr;
   }
 
-  ClipperLib::PolyTree solution;
-  clipper.AddPath(elementShape, ClipperLib::ptSubject, isClosed);
-  clipper.Execute(ClipperLib::ctIntersection, solution);
-  clipper.removeSubject();
-
-  std::size_t count = static_cast<std::size_t>(solution.Total());
+  ClipperLib::Paths solution = clippers.clip(elementShape, isClosed);
+  std::size_t count = solution.size();
 
   // 3. way intersects border only once: store a copy with clipped geometry
   if (count==1) {
     auto clippedElement = std::make_shared<T>();
-    setData(*clippedElement, element, solution.GetFirst()->Contour);
+    setData(*clippedElement, element, solution.front());
     return clippedElement;
   }
   // 4. in this case, result should be stored as relation (collection of ways)
@@ -119,13 +140,11 @@ std::shared_ptr<Element> clipElement(ClipperLib::ClipperEx &clipper,
     relation->id = element.id;
     relation->tags = element.tags;
     relation->elements.reserve(count);
-    ClipperLib::PolyNode *polyNode = solution.GetFirst();
-    while (polyNode) {
+    for (const auto &path : solution) {
       auto clippedElement = std::make_shared<T>();
       clippedElement->id = element.id;
-      setCoordinates(*clippedElement, polyNode->Contour);
+      setCoordinates(*clippedElement, path);
       relation->elements.push_back(clippedElement);
-      polyNode = polyNode->GetNext();
     }
     return relation;
   }
@@ -134,22 +153,22 @@ std::shared_ptr<Element> clipElement(ClipperLib::ClipperEx &clipper,
   return nullptr;
 }
 
-std::shared_ptr<Element> clipWay(ClipperLib::ClipperEx &clipper, const BoundingBox &bbox, const Way &way) {
-  return clipElement(clipper, bbox, way, false);
+std::shared_ptr<Element> clipWay(Clippers &clippers, const BoundingBox &bbox, const Way &way) {
+  return clipElement(clippers, bbox, way, false);
 }
 
-std::shared_ptr<Element> clipArea(ClipperLib::ClipperEx &clipper, const BoundingBox &bbox, const Area &area) {
-  return clipElement(clipper, bbox, area, true);
+std::shared_ptr<Element> clipArea(Clippers &clippers, const BoundingBox &bbox, const Area &area) {
+  return clipElement(clippers, bbox, area, true);
 }
 
-std::shared_ptr<Element> clipRelation(ClipperLib::ClipperEx &clipper,
+std::shared_ptr<Element> clipRelation(Clippers &clippers,
                                       const BoundingBox &bbox,
                                       const Relation &relation);
 
 /// Visits relation and collects clipped elements
 struct RelationVisitor : public ElementVisitor {
-  RelationVisitor(ClipperLib::ClipperEx &clipper, const BoundingBox &quadKeyBbox) :
-      relation(nullptr), clipper_(clipper), bbox_(quadKeyBbox) {
+  RelationVisitor(Clippers &clippers, const BoundingBox &quadKeyBbox) :
+      relation(nullptr), clippers_(clippers), bbox_(quadKeyBbox) {
   }
 
   void visitNode(const Node &node) override {
@@ -160,15 +179,15 @@ struct RelationVisitor : public ElementVisitor {
   }
 
   void visitWay(const Way &way) override {
-    addElement(clipWay(clipper_, bbox_, way), way);
+    addElement(clipWay(clippers_, bbox_, way), way);
   }
 
   void visitArea(const Area &area) override {
-    addElement(clipArea(clipper_, bbox_, area), area);
+    addElement(clipArea(clippers_, bbox_, area), area);
   }
 
   void visitRelation(const Relation &relation) override {
-    addElement(clipRelation(clipper_, bbox_, relation), relation);
+    addElement(clipRelation(clippers_, bbox_, relation), relation);
   }
 
   std::shared_ptr<Relation> relation;
@@ -192,14 +211,14 @@ struct RelationVisitor : public ElementVisitor {
     relation->elements.push_back(element);
   }
 
-  ClipperLib::ClipperEx &clipper_;
+  Clippers &clippers_;
   const BoundingBox &bbox_;
 };
 
-std::shared_ptr<Element> clipRelation(ClipperLib::ClipperEx &clipper,
+std::shared_ptr<Element> clipRelation(Clippers &clippers,
                                       const BoundingBox &bbox,
                                       const Relation &relation) {
-  RelationVisitor visitor(clipper, bbox);
+  RelationVisitor visitor(clippers, bbox);
 
   for (const auto &element : relation.elements)
     element->accept(visitor);
@@ -222,40 +241,45 @@ namespace utymap {
 namespace index {
 
 ElementGeometryClipper::ElementGeometryClipper(Callback callback) :
-    callback_(callback), quadKey_(), quadKeyBbox_(), clipper_() {
+    callback_(callback), quadKeyBbox_(), clipped_(), clipper_(), rectangleClipper_() {
 }
 
 void ElementGeometryClipper::clipAndCall(const Element &element,
                                          const QuadKey &quadKey,
                                          const BoundingBox &quadKeyBbox) {
-  quadKey_ = quadKey;
+  auto clipped = clip(element, quadKeyBbox);
+  if (clipped!=nullptr)
+    callback_(*clipped, quadKey);
+}
+
+std::shared_ptr<Element> ElementGeometryClipper::clip(const Element &element, const BoundingBox &quadKeyBbox) {
   quadKeyBbox_ = quadKeyBbox;
+  auto rect = createPathFromBoundingBox(quadKeyBbox_);
+  rectangleClipper_ = RectangleClipper(rect[0].X, rect[0].Y, rect[2].X, rect[2].Y);
   clipper_.Clear();
-  clipper_.AddPath(createPathFromBoundingBox(quadKeyBbox_), ClipperLib::ptClip, true);
+  clipper_.AddPath(rect, ClipperLib::ptClip, true);
   element.accept(*this);
+  return std::move(clipped_);
 }
 
 void ElementGeometryClipper::visitNode(const Node &node) {
   if (quadKeyBbox_.contains(node.coordinate))
-    callback_(node, quadKey_);
+    clipped_ = std::make_shared<Node>(node);
 }
 
 void ElementGeometryClipper::visitWay(const Way &way) {
-  auto element = clipWay(clipper_, quadKeyBbox_, way);
-  if (element!=nullptr)
-    callback_(*element, quadKey_);
+  Clippers clippers{clipper_, rectangleClipper_};
+  clipped_ = clipWay(clippers, quadKeyBbox_, way);
 }
 
 void ElementGeometryClipper::visitArea(const Area &area) {
-  auto element = clipArea(clipper_, quadKeyBbox_, area);
-  if (element!=nullptr)
-    callback_(*element, quadKey_);
+  Clippers clippers{clipper_, rectangleClipper_};
+  clipped_ = clipArea(clippers, quadKeyBbox_, area);
 }
 
 void ElementGeometryClipper::visitRelation(const Relation &relation) {
-  auto element = clipRelation(clipper_, quadKeyBbox_, relation);
-  if (element!=nullptr)
-    callback_(*element, quadKey_);
+  Clippers clippers{clipper_, rectangleClipper_};
+  clipped_ = clipRelation(clippers, quadKeyBbox_, relation);
 }
 
 }
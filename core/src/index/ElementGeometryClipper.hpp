@@ -6,8 +6,10 @@
 #include "QuadKey.hpp"
 #include "entities/Element.hpp"
 #include "entities/ElementVisitor.hpp"
+#include "index/RectangleClipper.hpp"
 
 #include <functional>
+#include <memory>
 
 namespace utymap {
 namespace index {
@@ -24,6 +26,10 @@ class ElementGeometryClipper final : private utymap::entities::ElementVisitor {
 
   void clipAndCall(const utymap::entities::Element &element, const QuadKey &quadKey, const BoundingBox &quadKeyBbox);
 
+  /// Returns copy of element clipped by given bounding box or nullptr if there is no intersection.
+  std::shared_ptr<utymap::entities::Element> clip(const utymap::entities::Element &element,
+                                                  const BoundingBox &quadKeyBbox);
+
  private:
 
   void visitNode(const utymap::entities::Node &node) override;
@@ -35,9 +41,10 @@ class ElementGeometryClipper final : private utymap::entities::ElementVisitor {
   void visitRelation(const utymap::entities::Relation &relation) override;
 
   Callback callback_;
-  QuadKey quadKey_;
   BoundingBox quadKeyBbox_;
+  std::shared_ptr<utymap::entities::Element> clipped_;
   ClipperLib::ClipperEx clipper_;
+  RectangleClipper rectangleClipper_;
 };
 
 }
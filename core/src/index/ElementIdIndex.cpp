@@ -0,0 +1,132 @@
+#include "index/ElementIdIndex.hpp"
+#include "utils/GeoUtils.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+
+using namespace utymap;
+using namespace utymap::index;
+using namespace utymap::utils;
+
+namespace {
+/// Offset of the record which removes location.
+const std::uint32_t RemovedOffset = 0xFFFFFFFF;
+/// Extension of file written by compaction before it replaces log file.
+const std::string TempFileExtension = ".tmp";
+
+void writeRecord(std::ostream &stream, std::uint64_t id, const ElementIdIndex::Location &location) {
+  stream.write(reinterpret_cast<const char *>(&id), sizeof(id));
+  stream.write(reinterpret_cast<const char *>(&location.code), sizeof(location.code));
+  stream.write(reinterpret_cast<const char *>(&location.offset), sizeof(location.offset));
+  stream.write(reinterpret_cast<const char *>(&location.type), sizeof(location.type));
+}
+
+bool readRecord(std::istream &stream, std::uint64_t &id, ElementIdIndex::Location &location) {
+  return stream.read(reinterpret_cast<char *>(&id), sizeof(id)) &&
+      stream.read(reinterpret_cast<char *>(&location.code), sizeof(location.code)) &&
+      stream.read(reinterpret_cast<char *>(&location.offset), sizeof(location.offset)) &&
+      stream.read(reinterpret_cast<char *>(&location.type), sizeof(location.type));
+}
+}
+
+ElementIdIndex::ElementIdIndex(const std::string &path) :
+    path_(path), isLoaded_(false) {
+}
+
+void ElementIdIndex::add(std::uint64_t id, std::uint8_t type, const QuadKey &quadKey, std::uint32_t offset) {
+  if (id==0) return;
+
+  std::lock_guard<std::mutex> lock(lock_);
+  write(id, Location{GeoUtils::quadKeyToCode(quadKey), offset, type});
+}
+
+void ElementIdIndex::remove(std::uint64_t id, std::uint8_t type, const QuadKey &quadKey) {
+  if (id==0) return;
+
+  std::lock_guard<std::mutex> lock(lock_);
+  write(id, Location{GeoUtils::quadKeyToCode(quadKey), RemovedOffset, type});
+}
+
+std::vector<ElementIdIndex::Location> ElementIdIndex::find(std::uint64_t id) {
+  std::lock_guard<std::mutex> lock(lock_);
+  load();
+  auto locations = locations_.find(id);
+  return locations==locations_.end() ? std::vector<Location>() : locations->second;
+}
+
+bool ElementIdIndex::contains(std::uint64_t id, std::uint8_t type) {
+  std::lock_guard<std::mutex> lock(lock_);
+  load();
+  auto locations = locations_.find(id);
+  return locations!=locations_.end() &&
+      std::any_of(locations->second.begin(), locations->second.end(), [type](const Location &location) {
+        return location.type==type;
+      });
+}
+
+void ElementIdIndex::flush() {
+  std::lock_guard<std::mutex> lock(lock_);
+  if (file_.is_open())
+    file_.flush();
+}
+
+void ElementIdIndex::compact() {
+  std::lock_guard<std::mutex> lock(lock_);
+  load();
+  {
+    std::ofstream file(path_ + TempFileExtension, std::ios::out | std::ios::binary | std::ios::trunc);
+    for (const auto &pair : locations_) {
+      for (const auto &location : pair.second)
+        writeRecord(file, pair.first, location);
+    }
+  }
+
+  file_.close();
+  // NOTE rename does not overwrite existing file on some platforms.
+  if (std::rename((path_ + TempFileExtension).c_str(), path_.c_str())!=0 &&
+      (std::remove(path_.c_str())!=0 || std::rename((path_ + TempFileExtension).c_str(), path_.c_str())!=0))
+    throw std::domain_error("Cannot replace element id index file: " + path_);
+}
+
+void ElementIdIndex::write(std::uint64_t id, const Location &location) {
+  if (!file_.is_open()) {
+    file_.clear();
+    file_.open(path_, std::ios::out | std::ios::binary | std::ios::app);
+    if (!file_.good())
+      throw std::domain_error("Cannot open element id index file: " + path_);
+  }
+  writeRecord(file_, id, location);
+  if (isLoaded_)
+    apply(id, location);
+}
+
+void ElementIdIndex::apply(std::uint64_t id, const Location &location) {
+  auto &locations = locations_[id];
+  auto existing = std::find_if(locations.begin(), locations.end(), [&](const Location &l) {
+    return l.code==location.code && l.type==location.type;
+  });
+
+  if (location.offset==RemovedOffset) {
+    if (existing!=locations.end())
+      locations.erase(existing);
+    if (locations.empty())
+      locations_.erase(id);
+  } else if (existing!=locations.end())
+    existing->offset = location.offset;
+  else
+    locations.push_back(location);
+}
+
+void ElementIdIndex::load() {
+  if (isLoaded_) return;
+
+  if (file_.is_open())
+    file_.flush();
+  std::ifstream file(path_, std::ios::in | std::ios::binary);
+  std::uint64_t id;
+  Location location;
+  while (readRecord(file, id, location))
+    apply(id, location);
+  isLoaded_ = true;
+}
@@ -0,0 +1,71 @@
+#ifndef INDEX_ELEMENTIDINDEX_HPP_DEFINED
+#define INDEX_ELEMENTIDINDEX_HPP_DEFINED
+
+#include "QuadKey.hpp"
+
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace utymap {
+namespace index {
+
+/// Maps element id to locations of its stored versions: quadkey and offset in its data file.
+/// Changes are appended to log file, later record of the same element kind and quadkey
+/// replaces previous one. The whole log is loaded into memory on first lookup, so memory
+/// grows with amount of stored elements; until then, changes are just appended to it.
+/// Log file is opened on first change. Elements without id are not indexed. All operations
+/// can be called concurrently.
+class ElementIdIndex final {
+ public:
+  /// Location of element stored in quadkey.
+  struct Location final {
+    std::uint64_t code;
+    std::uint32_t offset;
+    std::uint8_t type;
+  };
+
+  explicit ElementIdIndex(const std::string &path);
+
+  /// Adds location of element with given id and type, replaces existing one in the same quadkey.
+  void add(std::uint64_t id, std::uint8_t type, const utymap::QuadKey &quadKey, std::uint32_t offset);
+
+  /// Removes location of element with given id and type from quadkey.
+  void remove(std::uint64_t id, std::uint8_t type, const utymap::QuadKey &quadKey);
+
+  /// Gets all locations of elements with given id.
+  std::vector<Location> find(std::uint64_t id);
+
+  /// Checks whether element with given id and type is stored in any quadkey.
+  bool contains(std::uint64_t id, std::uint8_t type);
+
+  /// Writes buffered records to disk.
+  void flush();
+
+  /// Rewrites log file keeping only current locations.
+  void compact();
+
+ private:
+  /// Writes record to log and applies it to loaded locations. Should be called under lock.
+  void write(std::uint64_t id, const Location &location);
+
+  /// Applies record to locations. Should be called under lock.
+  void apply(std::uint64_t id, const Location &location);
+
+  /// Loads locations from log file if they are not loaded yet. Should be called under lock.
+  void load();
+
+  const std::string path_;
+  std::ofstream file_;
+  bool isLoaded_;
+  std::unordered_map<std::uint64_t, std::vector<Location>> locations_;
+  std::mutex lock_;
+};
+
+}
+}
+
+#endif // INDEX_ELEMENTIDINDEX_HPP_DEFINED
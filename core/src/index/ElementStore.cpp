@@ -6,9 +6,13 @@
 #include "entities/Area.hpp"
 #include "entities/Relation.hpp"
 #include "formats/FormatTypes.hpp"
+#include "index/BoundingBoxVisitor.hpp"
 #include "index/ElementGeometryClipper.hpp"
 #include "index/ElementStore.hpp"
-#include <mapcss/StyleConsts.hpp>
+#include "index/TileCoverage.hpp"
+
+#include <algorithm>
+#include <stdexcept>
 
 using namespace utymap;
 using namespace utymap::entities;
@@ -16,39 +20,128 @@ using namespace utymap::formats;
 using namespace utymap::mapcss;
 
 namespace {
-const std::string TrueValue = "true";
-
-/// Creates bounding box of given element.
-class BoundingBoxVisitor : public ElementVisitor {
+/// Passes to visitor only elements which intersect given bounding box.
+class BoundingBoxFilter : public ElementVisitor {
  public:
-  BoundingBox boundingBox;
+  BoundingBoxFilter(const BoundingBox &bbox, ElementVisitor &visitor) :
+      bbox_(bbox), visitor_(visitor) {
+  }
+
+  void visitNode(const Node &node) override { visit(node); }
+  void visitWay(const Way &way) override { visit(way); }
+  void visitArea(const Area &area) override { visit(area); }
+  void visitRelation(const Relation &relation) override { visit(relation); }
+
+ private:
+  void visit(const Element &element) {
+    if (utymap::index::BoundingBoxVisitor::create(element).intersects(bbox_))
+      element.accept(visitor_);
+  }
+
+  const BoundingBox &bbox_;
+  ElementVisitor &visitor_;
+};
 
-  void visitNode(const Node &node) override {
-    boundingBox.expand(node.coordinate);
+/// Passes to visitor only elements which tags match given filter.
+class TagFilterVisitor : public ElementVisitor {
+ public:
+  TagFilterVisitor(const utymap::index::TagFilter &filter, ElementVisitor &visitor) :
+      filter_(filter), visitor_(visitor) {
   }
 
-  void visitWay(const Way &way) override {
-    boundingBox.expand(way.coordinates.cbegin(), way.coordinates.cend());
+  void visitNode(const Node &node) override { visit(node); }
+  void visitWay(const Way &way) override { visit(way); }
+  void visitArea(const Area &area) override { visit(area); }
+  void visitRelation(const Relation &relation) override { visit(relation); }
+
+ private:
+  void visit(const Element &element) {
+    if (filter_.matches(element.tags))
+      element.accept(visitor_);
   }
 
-  void visitArea(const Area &area) override {
-    boundingBox.expand(area.coordinates.cbegin(), area.coordinates.cend());
+  const utymap::index::TagFilter &filter_;
+  ElementVisitor &visitor_;
+};
+
+/// Clips element walking quadtree top-down: each tile is clipped by the piece of its
+/// parent tile, so huge elements are not processed again for every tile.
+class QuadTreeClipper final {
+ public:
+  typedef std::function<void(const Element &, const QuadKey &)> StoreFunc;
+  typedef std::function<bool(const BoundingBox &)> FilterFunc;
+
+  QuadTreeClipper(const StyleSpan &styleSpan, int endLod, StoreFunc storeFunc, FilterFunc filterFunc) :
+      styleSpan_(styleSpan), endLod_(endLod), storeFunc_(storeFunc), filterFunc_(filterFunc),
+      clipper_(nullptr) {
   }
 
-  void visitRelation(const Relation &relation) override {
-    for (const auto &element: relation.elements) {
-      element->accept(*this);
+  /// Clips element by given tile and its children. Returns true if any piece is stored.
+  bool clip(const Element &element, const QuadKey &quadKey, const BoundingBox &quadKeyBbox) {
+    auto piece = clipper_.clip(element, quadKeyBbox);
+    if (piece==nullptr)
+      return false;
+
+    bool wasStored = false;
+    int lod = quadKey.levelOfDetail;
+    if (styleSpan_.isStored(lod) && styleSpan_.isClipped(lod) && filterFunc_(quadKeyBbox)) {
+      storeFunc_(*piece, quadKey);
+      wasStored = true;
+    }
+
+    if (lod < endLod_) {
+      // NOTE coverage of piece can include neighbours touched on parent border.
+      utymap::index::TileCoverage::visit(*piece, lod + 1, [&](const QuadKey &child, const BoundingBox &childBbox) {
+        if ((child.tileX >> 1)==quadKey.tileX && (child.tileY >> 1)==quadKey.tileY)
+          wasStored |= clip(*piece, child, childBbox);
+      });
     }
+
+    return wasStored;
   }
+
+ private:
+  const StyleSpan &styleSpan_;
+  const int endLod_;
+  const StoreFunc storeFunc_;
+  const FilterFunc filterFunc_;
+  utymap::index::ElementGeometryClipper clipper_;
 };
 }
 
 namespace utymap {
 namespace index {
 
-ElementStore::ElementStore(const StringTable &stringTable) :
-    clipKeyId_(stringTable.getId(StyleConsts::ClipKey())),
-    skipKeyId_(stringTable.getId(StyleConsts::SkipKey())) {
+ElementStore::ElementStore(const StringTable &) {
+}
+
+bool ElementStore::hasDescendantData(const QuadKey &) const {
+  return false;
+}
+
+bool ElementStore::hasAncestorData(const QuadKey &quadKey) const {
+  for (int lod = quadKey.levelOfDetail - 1; lod > 0; --lod) {
+    int shift = quadKey.levelOfDetail - lod;
+    if (hasData(QuadKey(lod, quadKey.tileX >> shift, quadKey.tileY >> shift)))
+      return true;
+  }
+  return false;
+}
+
+void ElementStore::search(const QuadKey &quadKey,
+                          const BoundingBox &bbox,
+                          ElementVisitor &visitor,
+                          const utymap::CancellationToken &cancelToken) {
+  BoundingBoxFilter filter(bbox, visitor);
+  search(quadKey, filter, cancelToken);
+}
+
+void ElementStore::search(const QuadKey &quadKey,
+                          const TagFilter &filter,
+                          ElementVisitor &visitor,
+                          const utymap::CancellationToken &cancelToken) {
+  TagFilterVisitor filterVisitor(filter, visitor);
+  search(quadKey, filterVisitor, cancelToken);
 }
 
 bool ElementStore::store(const Element &element, const utymap::LodRange &range, const StyleProvider &styleProvider) {
@@ -68,6 +161,60 @@ bool ElementStore::store(const Element &element, const QuadKey &quadKey, const S
                });
 }
 
+void ElementStore::store(const Element &element, const QuadKey &quadKey) {
+  storeImpl(element, quadKey);
+}
+
+bool ElementStore::erase(const Element &element, const utymap::LodRange &range) {
+  return erase(element, range, [](const QuadKey &) {});
+}
+
+bool ElementStore::erase(const Element &element,
+                         const utymap::LodRange &range,
+                         const std::function<void(const QuadKey &)> &visitor) {
+  bool wasErased = false;
+  auto eraseFrom = [&](const QuadKey &quadKey) {
+    eraseImpl(element, quadKey);
+    visitor(quadKey);
+    wasErased = true;
+  };
+
+  for (int lod = range.start; lod <= range.end; ++lod) {
+    // NOTE element without id cannot be located by id.
+    std::vector<QuadKey> quadKeys;
+    if (element.id!=0 && locate(element, lod, quadKeys)) {
+      std::for_each(quadKeys.begin(), quadKeys.end(), eraseFrom);
+      continue;
+    }
+
+    TileCoverage::visit(element, lod, [&](const QuadKey &quadKey, const BoundingBox &) {
+      if (hasData(quadKey))
+        eraseFrom(quadKey);
+    });
+  }
+  return wasErased;
+}
+
+bool ElementStore::eraseLocated(const Element &element, const utymap::LodRange &range) {
+  if (element.id==0)
+    return false;
+
+  bool wasErased = false;
+  for (int lod = range.start; lod <= range.end; ++lod) {
+    std::vector<QuadKey> quadKeys;
+    if (!locate(element, lod, quadKeys))
+      continue;
+    for (const auto &quadKey : quadKeys)
+      eraseImpl(element, quadKey);
+    wasErased = wasErased || !quadKeys.empty();
+  }
+  return wasErased;
+}
+
+void ElementStore::eraseImpl(const Element &, const QuadKey &) {
+  throw std::domain_error("Element store does not support erase.");
+}
+
 bool ElementStore::store(const Element &element,
                          const BoundingBox &bbox,
                          const utymap::LodRange &range,
@@ -85,34 +232,46 @@ bool ElementStore::store(const Element &element,
                          const LodRange &range,
                          const StyleProvider &styleProvider,
                          const Visitor &visitor) {
+  StyleSpan styleSpan = styleProvider.forLodRange(element, range);
+  if (styleSpan.stored==0)
+    return false;
+
   BoundingBoxVisitor bboxVisitor;
-  using namespace std::placeholders;
-  ElementGeometryClipper geometryClipper(std::bind(&ElementStore::storeImpl, this, _1, _2));
+  element.accept(bboxVisitor);
   bool wasStored = false;
+  int clipStartLod = -1, clipEndLod = -1;
   for (int lod = range.start; lod <= range.end; ++lod) {
-    Style style = styleProvider.forElement(element, lod);
-    if (style.empty() || style.has(skipKeyId_, TrueValue))
+    if (!styleSpan.isStored(lod))
       continue;
 
-    // initialize bounding box only once
-    if (!bboxVisitor.boundingBox.isValid())
-      element.accept(bboxVisitor);
+    // clipped levels are processed by walking quadtree from the coarsest one.
+    if (styleSpan.isClipped(lod)) {
+      if (clipStartLod < 0) clipStartLod = lod;
+      clipEndLod = lod;
+      continue;
+    }
 
-    utymap::utils::GeoUtils::visitTileRange(bboxVisitor.boundingBox, lod,
-                                            [&](const QuadKey &quadKey, const BoundingBox &quadKeyBbox) {
-                                              if (!visitor(bboxVisitor.boundingBox, quadKeyBbox))
-                                                return;
+    // NOTE only tiles intersected by geometry are visited, not the whole bounding box range.
+    TileCoverage::visit(element, lod, [&](const QuadKey &quadKey, const BoundingBox &quadKeyBbox) {
+      if (!visitor(bboxVisitor.boundingBox, quadKeyBbox))
+        return;
 
-                                              if (style.has(clipKeyId_, TrueValue))
-                                                geometryClipper.clipAndCall(element, quadKey, quadKeyBbox);
-                                              else
-                                                storeImpl(element, quadKey);
+      storeImpl(element, quadKey);
+      wasStored = true;
+    });
+  }
 
-                                              wasStored = true;
-                                            });
+  if (clipStartLod >= 0) {
+    using namespace std::placeholders;
+    QuadTreeClipper clipper(styleSpan, clipEndLod, std::bind(&ElementStore::storeImpl, this, _1, _2),
+                            [&](const BoundingBox &quadKeyBbox) {
+                              return visitor(bboxVisitor.boundingBox, quadKeyBbox);
+                            });
+    TileCoverage::visit(element, clipStartLod, [&](const QuadKey &quadKey, const BoundingBox &quadKeyBbox) {
+      wasStored |= clipper.clip(element, quadKey, quadKeyBbox);
+    });
   }
 
-  // NOTE still might be clipped and then skipped
   return wasStored;
 }
 
@@ -7,8 +7,12 @@
 #include "QuadKey.hpp"
 #include "entities/Element.hpp"
 #include "entities/ElementVisitor.hpp"
+#include "index/TagFilter.hpp"
 #include "mapcss/StyleProvider.hpp"
 
+#include <functional>
+#include <vector>
+
 namespace utymap {
 namespace index {
 
@@ -19,14 +23,68 @@ class ElementStore {
 
   virtual ~ElementStore() = default;
 
-  /// Searches for elements for given quadKey
+  /// Searches for elements for given quadKey.
+  /// NOTE visited element is guaranteed to be valid only during visit call.
   virtual void search(const utymap::QuadKey &quadKey,
                       utymap::entities::ElementVisitor &visitor,
                       const utymap::CancellationToken &cancelToken) = 0;
 
+  /// Searches for elements of given quadkey which bounding boxes intersect given one.
+  /// Default implementation checks every element of the quadkey.
+  virtual void search(const utymap::QuadKey &quadKey,
+                      const utymap::BoundingBox &bbox,
+                      utymap::entities::ElementVisitor &visitor,
+                      const utymap::CancellationToken &cancelToken);
+
+  /// Searches for elements of given quadkey which tags match given filter.
+  /// Default implementation checks every element of the quadkey.
+  virtual void search(const utymap::QuadKey &quadKey,
+                      const utymap::index::TagFilter &filter,
+                      utymap::entities::ElementVisitor &visitor,
+                      const utymap::CancellationToken &cancelToken);
+
   /// Checks whether there is data for given quadkey.
   virtual bool hasData(const utymap::QuadKey &quadKey) const = 0;
 
+  /// Checks whether there is data for any quadkey of higher level of details inside given one.
+  /// Default implementation reports no data as it cannot enumerate quadkeys.
+  virtual bool hasDescendantData(const utymap::QuadKey &quadKey) const;
+
+  /// Checks whether there is data for any quadkey of lower level of details containing given one.
+  /// Default implementation checks every ancestor using hasData.
+  virtual bool hasAncestorData(const utymap::QuadKey &quadKey) const;
+
+  /// Starts import session. Within session, store implementation may keep
+  /// resources open and buffer writes until the session is committed.
+  /// NOTE sessions can be nested: only the outermost commit flushes data.
+  virtual void beginImport() {}
+
+  /// Commits import session: flushes all buffered data and releases resources.
+  virtual void commitImport() {}
+
+  /// Visits elements with given id stored at given level of details. Element is visited once
+  /// per quadkey where it is stored, so clipped one is visited as several pieces. Elements of
+  /// different kinds can share id. Default implementation visits nothing as store has no id index.
+  virtual void find(std::uint64_t,
+                    int,
+                    utymap::entities::ElementVisitor &,
+                    const utymap::CancellationToken &) {}
+
+  /// Checks whether element with the same id and kind is stored.
+  /// Default implementation returns false as store has no id index.
+  virtual bool contains(const utymap::entities::Element &) const { return false; }
+
+  /// Checks whether store can erase elements. Default implementation returns false as
+  /// erase is not implemented.
+  virtual bool canErase() const { return false; }
+
+  /// Gets quadkeys of given level of details where element with the same id and kind is stored.
+  /// Returns false if element cannot be located by id, e.g. it is not in id index. Default
+  /// implementation returns false as store has no id index.
+  virtual bool locate(const utymap::entities::Element &,
+                      int,
+                      std::vector<utymap::QuadKey> &) const { return false; }
+
   /// Stores element in storage in all affected tiles at given level of details range.
   bool store(const utymap::entities::Element &element,
              const utymap::LodRange &range,
@@ -42,18 +100,39 @@ class ElementStore {
              const utymap::BoundingBox &bbox,
              const utymap::LodRange &range,
              const utymap::mapcss::StyleProvider &styleProvider);
+
+  /// Stores element in given quadkey as is: no clipping or style checks are performed.
+  void store(const utymap::entities::Element &element, const utymap::QuadKey &quadKey);
+
+  /// Erases element from all tiles where it is stored at given level of details range.
+  /// Element is identified by its id and kind. Tiles are found by id if store can locate
+  /// elements, otherwise they are the tiles with data which geometry of element covers, so
+  /// geometry should be the one used to store it. Returns true if any tile is affected.
+  bool erase(const utymap::entities::Element &element, const utymap::LodRange &range);
+
+  /// Erases element as above and calls given function for every affected quadkey.
+  bool erase(const utymap::entities::Element &element,
+             const utymap::LodRange &range,
+             const std::function<void(const utymap::QuadKey &)> &visitor);
+
+  /// Erases stored versions of element only from tiles where they are located by id at given
+  /// level of details range. Nothing is erased if store cannot locate elements. Returns true
+  /// if any tile is affected.
+  bool eraseLocated(const utymap::entities::Element &element, const utymap::LodRange &range);
+
  protected:
   /// Stores element in given quadkey.
   virtual void storeImpl(const utymap::entities::Element &element, const utymap::QuadKey &quadKey) = 0;
 
+  /// Erases element from given quadkey. Default implementation throws as store does not support it.
+  virtual void eraseImpl(const utymap::entities::Element &element, const utymap::QuadKey &quadKey);
+
  private:
   template<typename Visitor>
   bool store(const utymap::entities::Element &element,
              const utymap::LodRange &range,
              const utymap::mapcss::StyleProvider &styleProvider,
              const Visitor &visitor);
-
-  const std::uint32_t clipKeyId_, skipKeyId_;
 };
 
 }
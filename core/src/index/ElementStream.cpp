@@ -6,6 +6,10 @@
 #include "index/ElementStream.hpp"
 #include "utils/CoreUtils.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
 using namespace utymap;
 using namespace utymap::entities;
 using namespace utymap::index;
@@ -17,6 +21,11 @@ const char WayType = 1;
 const char AreaType = 2;
 const char RelationType = 3;
 
+/// Magic bytes which start header of versioned data.
+const char HeaderMagic[] = {'U', 'T', 'Y', 'E'};
+/// Fixed-point precision of coordinates in compact format.
+const double Scale = 1E7;
+
 std::ostream &operator<<(std::ostream &stream, const Tag &tag) {
   stream.write(reinterpret_cast<const char *>(&tag.key), sizeof(tag.key));
   stream.write(reinterpret_cast<const char *>(&tag.value), sizeof(tag.value));
@@ -60,7 +69,7 @@ std::istream &operator>>(std::istream &stream, std::vector<T> &data) {
   return stream;
 }
 
-/// Writes element to stream.
+/// Writes element to stream using first version of format.
 struct ElementWriter : ElementVisitor {
   explicit ElementWriter(std::ostream &s) : stream_(s) {}
 
@@ -89,73 +98,424 @@ struct ElementWriter : ElementVisitor {
   std::ostream &stream_;
 };
 
-/// Reads element from stream.
+/// Allocates new instance of element every time.
+template<template<typename...> class Pointer>
+struct HeapAllocator final {
+  template<typename T>
+  Pointer<T> create() { return Pointer<T>(new T()); }
+};
+
+/// Reads element of type stored in stream into instance provided by allocator.
+template<typename Pointer, typename Reader, typename Allocator>
+Pointer readElement(const Reader &reader, Allocator &allocator) {
+  switch (reader.readType()) {
+    case NodeType:return reader.fill(allocator.template create<Node>());
+    case WayType:return reader.fill(allocator.template create<Way>());
+    case AreaType:return reader.fill(allocator.template create<Area>());
+    case RelationType:return reader.fill(allocator.template create<Relation>());
+    default:throw std::domain_error("Unknown element type.");
+  }
+}
+
+/// Reads element from stream using first version of format.
+/// Relation members are created by given allocator.
+template<typename Allocator>
 class ElementReader final {
  public:
-  explicit ElementReader(std::istream &stream) : stream_(stream) {
+  ElementReader(std::istream &stream, Allocator &allocator) : stream_(stream), allocator_(allocator) {
   }
 
-  std::unique_ptr<Element> read() const {
-    char elementType;
-    stream_ >> elementType;
+  int readType() const {
+    return stream_.get();
+  }
 
-    switch (elementType) {
-      case NodeType:return readNode();
-      case WayType:return readWay();
-      case AreaType:return readArea();
-      case RelationType:return readRelation();
-      default:throw std::domain_error("Unknown element type.");
-    }
+  template<typename Pointer>
+  Pointer fill(Pointer element) const {
+    read(*element);
+    return element;
   }
 
  private:
-  std::unique_ptr<Node> readNode() const {
-    auto node = utymap::utils::make_unique<Node>();
-    stream_ >> node->tags >> node->coordinate;
-    return std::move(node);
+  void read(Node &node) const {
+    stream_ >> node.tags >> node.coordinate;
   }
 
-  std::unique_ptr<Way> readWay() const {
-    auto way = utymap::utils::make_unique<Way>();
-    stream_ >> way->tags >> way->coordinates;
-    return std::move(way);
+  void read(Way &way) const {
+    stream_ >> way.tags >> way.coordinates;
   }
 
-  std::unique_ptr<Area> readArea() const {
-    auto area = utymap::utils::make_unique<Area>();
-    stream_ >> area->tags >> area->coordinates;
-    return std::move(area);
+  void read(Area &area) const {
+    stream_ >> area.tags >> area.coordinates;
   }
 
-  std::unique_ptr<Relation> readRelation() const {
-    auto relation = utymap::utils::make_unique<Relation>();
-    stream_ >> relation->tags;
+  void read(Relation &relation) const {
+    stream_ >> relation.tags;
 
     std::uint16_t elementSize = 0;
     stream_.read(reinterpret_cast<char *>(&elementSize), sizeof(elementSize));
 
+    relation.elements.clear();
     for (std::uint16_t i = 0; i < elementSize; ++i) {
       std::uint64_t id;
       stream_.read(reinterpret_cast<char *>(&id), sizeof(id));
-      auto element = read();
+      auto element = readElement<std::shared_ptr<Element>>(*this, allocator_);
+      element->id = id;
+      relation.elements.push_back(std::move(element));
+    }
+  }
+
+  std::istream &stream_;
+  Allocator &allocator_;
+};
+
+/// Writes unsigned integer as varint.
+void writeVarint(std::ostream &stream, std::uint64_t value) {
+  char buffer[10];
+  int size = 0;
+  while (value >= 0x80) {
+    buffer[size++] = static_cast<char>((value & 0x7F) | 0x80);
+    value >>= 7;
+  }
+  buffer[size++] = static_cast<char>(value);
+  stream.write(buffer, size);
+}
+
+/// Reads unsigned integer stored as varint.
+std::uint64_t readVarint(std::istream &stream) {
+  std::uint64_t value = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    auto byte = stream.get();
+    if (byte==std::char_traits<char>::eof())
+      throw std::domain_error("Unexpected end of element stream.");
+    value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+    if ((byte & 0x80)==0)
+      break;
+  }
+  return value;
+}
+
+/// Writes signed integer as zig-zag encoded varint.
+void writeSignedVarint(std::ostream &stream, std::int64_t value) {
+  writeVarint(stream, (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63));
+}
+
+/// Reads signed integer stored as zig-zag encoded varint.
+std::int64_t readSignedVarint(std::istream &stream) {
+  std::uint64_t value = readVarint(stream);
+  return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+}
+
+/// Converts degrees to fixed-point value. Non finite values are clamped.
+std::int64_t toFixed(double value) {
+  const double Limit = std::numeric_limits<std::int32_t>::max()/Scale;
+  return std::llround(std::isnan(value) ? Limit : std::max(-Limit, std::min(Limit, value))*Scale);
+}
+
+double fromFixed(std::int64_t value) {
+  return value/Scale;
+}
+
+/// Writes element to stream using compact (second) version of format.
+class CompactElementWriter final : public ElementVisitor {
+ public:
+  explicit CompactElementWriter(std::ostream &s) : stream_(s) {}
+
+  void visitNode(const Node &node) override {
+    stream_.put(NodeType);
+    writeTags(node.tags);
+    writeSignedVarint(stream_, toFixed(node.coordinate.latitude));
+    writeSignedVarint(stream_, toFixed(node.coordinate.longitude));
+  }
+
+  void visitWay(const Way &way) override {
+    stream_.put(WayType);
+    writeTags(way.tags);
+    writeCoordinates(way.coordinates);
+  }
+
+  void visitArea(const Area &area) override {
+    stream_.put(AreaType);
+    writeTags(area.tags);
+    writeCoordinates(area.coordinates);
+  }
+
+  void visitRelation(const Relation &relation) override {
+    stream_.put(RelationType);
+    writeTags(relation.tags);
+    writeVarint(stream_, relation.elements.size());
+    for (const auto &element : relation.elements) {
+      writeVarint(stream_, element->id);
+      element->accept(*this);
+    }
+  }
+
+ private:
+  /// Writes tags storing keys as delta from previous one.
+  void writeTags(const std::vector<Tag> &tags) {
+    writeVarint(stream_, tags.size());
+    std::int64_t lastKey = 0;
+    for (const auto &tag : tags) {
+      writeSignedVarint(stream_, tag.key - lastKey);
+      writeVarint(stream_, tag.value);
+      lastKey = tag.key;
+    }
+  }
+
+  /// Writes coordinates storing each one as delta from previous one.
+  void writeCoordinates(const std::vector<GeoCoordinate> &coordinates) {
+    writeVarint(stream_, coordinates.size());
+    std::int64_t lastLatitude = 0, lastLongitude = 0;
+    for (const auto &coordinate : coordinates) {
+      auto latitude = toFixed(coordinate.latitude);
+      auto longitude = toFixed(coordinate.longitude);
+      writeSignedVarint(stream_, latitude - lastLatitude);
+      writeSignedVarint(stream_, longitude - lastLongitude);
+      lastLatitude = latitude;
+      lastLongitude = longitude;
+    }
+  }
+
+  std::ostream &stream_;
+};
+
+/// Reads element from stream using compact (second) version of format.
+/// Relation members are created by given allocator.
+template<typename Allocator>
+class CompactElementReader final {
+ public:
+  CompactElementReader(std::istream &stream, Allocator &allocator) : stream_(stream), allocator_(allocator) {
+  }
+
+  int readType() const {
+    return stream_.get();
+  }
+
+  template<typename Pointer>
+  Pointer fill(Pointer element) const {
+    read(*element);
+    return element;
+  }
+
+ private:
+  void read(Node &node) const {
+    readTags(node.tags);
+    node.coordinate.latitude = fromFixed(readSignedVarint(stream_));
+    node.coordinate.longitude = fromFixed(readSignedVarint(stream_));
+  }
+
+  void read(Way &way) const {
+    readTags(way.tags);
+    readCoordinates(way.coordinates);
+  }
+
+  void read(Area &area) const {
+    readTags(area.tags);
+    readCoordinates(area.coordinates);
+  }
+
+  void read(Relation &relation) const {
+    readTags(relation.tags);
+
+    auto size = static_cast<std::size_t>(readVarint(stream_));
+    relation.elements.clear();
+    relation.elements.reserve(size);
+    for (std::size_t i = 0; i < size; ++i) {
+      std::uint64_t id = readVarint(stream_);
+      auto element = readElement<std::shared_ptr<Element>>(*this, allocator_);
       element->id = id;
-      relation->elements.push_back(std::move(element));
+      relation.elements.push_back(std::move(element));
+    }
+  }
+
+  void readTags(std::vector<Tag> &tags) const {
+    auto size = static_cast<std::size_t>(readVarint(stream_));
+    tags.resize(size);
+    std::int64_t lastKey = 0;
+    for (auto &tag : tags) {
+      lastKey += readSignedVarint(stream_);
+      tag.key = static_cast<std::uint32_t>(lastKey);
+      tag.value = static_cast<std::uint32_t>(readVarint(stream_));
+    }
+  }
+
+  void readCoordinates(std::vector<GeoCoordinate> &coordinates) const {
+    auto size = static_cast<std::size_t>(readVarint(stream_));
+    coordinates.resize(size);
+    std::int64_t latitude = 0, longitude = 0;
+    for (auto &coordinate : coordinates) {
+      latitude += readSignedVarint(stream_);
+      longitude += readSignedVarint(stream_);
+      coordinate.latitude = fromFixed(latitude);
+      coordinate.longitude = fromFixed(longitude);
     }
-    return relation;
   }
 
   std::istream &stream_;
+  Allocator &allocator_;
+};
+
+/// Reads element using reader of given format version.
+template<typename Pointer, typename Allocator, typename MemberAllocator>
+Pointer readElement(std::istream &stream,
+                    ElementStream::Version version,
+                    Allocator &allocator,
+                    MemberAllocator &memberAllocator) {
+  return version==ElementStream::Version::V1
+         ? readElement<Pointer>(ElementReader<MemberAllocator>(stream, memberAllocator), allocator)
+         : readElement<Pointer>(CompactElementReader<MemberAllocator>(stream, memberAllocator), allocator);
+}
+
+/// Keeps instances of given element type to be reused by subsequent reads.
+template<typename T>
+class ElementPool final {
+ public:
+  ElementPool() : used_(0) {}
+
+  std::shared_ptr<T> create() {
+    if (used_==items_.size())
+      items_.push_back(std::make_shared<T>());
+
+    auto &item = items_[used_++];
+    // NOTE element is still referenced outside, so it cannot be reused.
+    if (item.use_count() > 1)
+      item = std::make_shared<T>();
+    return item;
+  }
+
+  void reset() { used_ = 0; }
+
+  std::vector<std::shared_ptr<T>> &items() { return items_; }
+
+ private:
+  std::vector<std::shared_ptr<T>> items_;
+  std::size_t used_;
 };
 }
 
-std::unique_ptr<utymap::entities::Element> ElementStream::read(std::istream &stream, std::uint64_t id) {
-  auto reader = ElementReader(stream);
-  auto element = reader.read();
+class ElementDecoder::ElementDecoderImpl final {
+ public:
+  template<typename T>
+  std::shared_ptr<T> create() {
+    return getPool(static_cast<T *>(nullptr)).create();
+  }
+
+  const Element &read(std::istream &stream, std::uint64_t id, ElementStream::Version version) {
+    reset();
+    current_ = readElement<std::shared_ptr<Element>>(stream, version, *this, *this);
+    current_->id = id;
+    return *current_;
+  }
+
+ private:
+  void reset() {
+    current_.reset();
+    // NOTE members of previously read relations hold references to pooled elements.
+    for (auto &relation : relations_.items())
+      relation->elements.clear();
+
+    nodes_.reset();
+    ways_.reset();
+    areas_.reset();
+    relations_.reset();
+  }
+
+  ElementPool<Node> &getPool(Node *) { return nodes_; }
+  ElementPool<Way> &getPool(Way *) { return ways_; }
+  ElementPool<Area> &getPool(Area *) { return areas_; }
+  ElementPool<Relation> &getPool(Relation *) { return relations_; }
+
+  ElementPool<Node> nodes_;
+  ElementPool<Way> ways_;
+  ElementPool<Area> areas_;
+  ElementPool<Relation> relations_;
+  std::shared_ptr<Element> current_;
+};
+
+ElementDecoder::ElementDecoder() : pimpl_(utymap::utils::make_unique<ElementDecoderImpl>()) {
+}
+
+ElementDecoder::~ElementDecoder() {
+}
+
+const Element &ElementDecoder::read(std::istream &stream, std::uint64_t id, ElementStream::Version version) {
+  return pimpl_->read(stream, id, version);
+}
+
+const ElementStream::Version ElementStream::CurrentVersion = ElementStream::Version::V2;
+
+void ElementStream::writeHeader(std::ostream &stream, Version version) {
+  // NOTE first version has no header.
+  if (version==Version::V1) return;
+
+  stream.write(HeaderMagic, sizeof(HeaderMagic));
+  stream.put(static_cast<char>(version));
+}
+
+ElementStream::Version ElementStream::readHeader(std::istream &stream) {
+  // NOTE data of the first version starts from element type which cannot match magic.
+  if (stream.peek()!=HeaderMagic[0])
+    return Version::V1;
+
+  auto position = stream.tellg();
+  char magic[sizeof(HeaderMagic)];
+  if (!stream.read(magic, sizeof(magic)) || !std::equal(magic, magic + sizeof(magic), HeaderMagic)) {
+    stream.clear();
+    stream.seekg(position);
+    return Version::V1;
+  }
+
+  auto version = static_cast<Version>(stream.get());
+  if (version!=Version::V2)
+    throw std::domain_error("Unsupported element stream version.");
+
+  return version;
+}
+
+std::uint8_t ElementStream::getType(const Element &element) {
+  struct TypeVisitor : ElementVisitor {
+    void visitNode(const Node &) override { type = NodeType; }
+    void visitWay(const Way &) override { type = WayType; }
+    void visitArea(const Area &) override { type = AreaType; }
+    void visitRelation(const Relation &) override { type = RelationType; }
+    char type = NodeType;
+  } visitor;
+  element.accept(visitor);
+  return static_cast<std::uint8_t>(visitor.type);
+}
+
+std::uint8_t ElementStream::getSourceType(const Element &element) {
+  auto type = getType(element);
+  const auto *relation = type==RelationType ? static_cast<const Relation *>(&element) : nullptr;
+  if (relation==nullptr || relation->elements.empty())
+    return type;
+
+  // NOTE clipper stores pieces of way or area as relation of elements with the same id.
+  auto pieceType = getType(*relation->elements.front());
+  if (pieceType!=WayType && pieceType!=AreaType)
+    return type;
+  for (const auto &piece : relation->elements) {
+    if (piece->id!=relation->id || getType(*piece)!=pieceType)
+      return type;
+  }
+  return pieceType;
+}
+
+std::unique_ptr<utymap::entities::Element> ElementStream::read(std::istream &stream,
+                                                               std::uint64_t id,
+                                                               Version version) {
+  HeapAllocator<std::unique_ptr> allocator;
+  HeapAllocator<std::shared_ptr> memberAllocator;
+  auto element = readElement<std::unique_ptr<Element>>(stream, version, allocator, memberAllocator);
   element->id = id;
   return element;
 }
 
-void ElementStream::write(std::ostream &stream, const utymap::entities::Element &element) {
-  auto writer = ElementWriter(stream);
-  element.accept(writer);
+void ElementStream::write(std::ostream &stream, const utymap::entities::Element &element, Version version) {
+  if (version==Version::V1) {
+    auto writer = ElementWriter(stream);
+    element.accept(writer);
+  } else {
+    auto writer = CompactElementWriter(stream);
+    element.accept(writer);
+  }
 }
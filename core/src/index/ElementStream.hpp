@@ -9,13 +9,61 @@
 namespace utymap {
 namespace index {
 
+/// Provides the way to serialize elements into binary format.
+/// Version 1 stores raw doubles and integers; version 2 stores coordinates in
+/// fixed-point with 1E7 precision, delta encoded and varint packed together
+/// with tags and lengths.
 class ElementStream final {
  public:
+  /// Defines binary format version.
+  enum class Version : std::uint8_t { V1 = 1, V2 = 2 };
+
+  /// Version used to write new data.
+  static const Version CurrentVersion;
+
+  /// Writes header which identifies format version of the following data.
+  static void writeHeader(std::ostream &stream, Version version = CurrentVersion);
+
+  /// Reads header and returns format version. If there is no header, then
+  /// data is considered to be of the first version and stream position is not changed.
+  static Version readHeader(std::istream &stream);
+
+  /// Gets type code which precedes element data in every format version, so
+  /// elements of different kinds with the same id can be told apart without decoding.
+  static std::uint8_t getType(const utymap::entities::Element &element);
+
+  /// Gets type code of element which was stored: pieces of clipped way or area are
+  /// stored as relation with the same id, but they have type of the way or area.
+  static std::uint8_t getSourceType(const utymap::entities::Element &element);
+
   /// Reads element with given id from input stream.
-  static std::unique_ptr<utymap::entities::Element> read(std::istream &stream, std::uint64_t id);
+  static std::unique_ptr<utymap::entities::Element> read(std::istream &stream,
+                                                         std::uint64_t id,
+                                                         Version version = CurrentVersion);
 
   /// Writes element to output stream.
-  static void write(std::ostream &stream, const utymap::entities::Element &element);
+  static void write(std::ostream &stream,
+                    const utymap::entities::Element &element,
+                    Version version = CurrentVersion);
+};
+
+/// Reads elements reusing previously decoded instances, so no memory is allocated
+/// per element in steady state. Element returned by read is valid only until next
+/// read call or decoder destruction.
+class ElementDecoder final {
+ public:
+  ElementDecoder();
+
+  ~ElementDecoder();
+
+  /// Reads element with given id from input stream.
+  const utymap::entities::Element &read(std::istream &stream,
+                                        std::uint64_t id,
+                                        ElementStream::Version version = ElementStream::CurrentVersion);
+
+ private:
+  class ElementDecoderImpl;
+  std::unique_ptr<ElementDecoderImpl> pimpl_;
 };
 
 }
@@ -1,19 +1,210 @@
 #include "entities/Element.hpp"
+#include "entities/Node.hpp"
+#include "entities/Way.hpp"
+#include "entities/Area.hpp"
+#include "entities/Relation.hpp"
 #include "LodRange.hpp"
 #include "formats/shape/ShapeDataVisitor.hpp"
 #include "formats/shape/ShapeParser.hpp"
+#include "formats/osm/OsmChangeProcessor.hpp"
 #include "formats/osm/json/OsmJsonParser.hpp"
 #include "formats/osm/xml/OsmXmlParser.hpp"
 #ifdef PBF_SUPPORTED_ENABLED
 #include "formats/osm/pbf/OsmPbfParser.hpp"
 #endif
+#include "index/ElementCopier.hpp"
+#include "index/ElementStream.hpp"
 #include "index/GeoStore.hpp"
+#include "index/ImportPipeline.hpp"
 #include "index/InMemoryElementStore.hpp"
+#include "index/TileCoverage.hpp"
+#include "utils/GeoUtils.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <set>
 
 using namespace utymap::entities;
 using namespace utymap::formats;
 using namespace utymap::index;
 using namespace utymap::mapcss;
+using namespace utymap::utils;
+
+namespace {
+/// Keeps import session of element store open while in scope. Session should be committed
+/// explicitly, otherwise it is committed when it goes out of scope, e.g. on exception, and
+/// commit error is only reported as destructor must not throw. Strings added during session
+/// are written to disk before element data which refers to them.
+class ImportSession final {
+ public:
+  ImportSession(ElementStore &elementStore, const StringTable &stringTable) :
+      elementStore_(elementStore), stringTable_(stringTable), isCommitted_(false) {
+    elementStore_.beginImport();
+  }
+
+  ~ImportSession() {
+    if (isCommitted_) return;
+    try {
+      commit();
+    } catch (const std::exception &ex) {
+      std::cerr << "Cannot commit import session: " << ex.what() << std::endl;
+    }
+  }
+
+  /// Commits session passing errors to caller.
+  void commit() {
+    // NOTE session is not committed again by destructor if commit fails.
+    isCommitted_ = true;
+    stringTable_.flush();
+    elementStore_.commitImport();
+  }
+
+ private:
+  ElementStore &elementStore_;
+  const StringTable &stringTable_;
+  bool isCommitted_;
+};
+
+/// Calculates distance in meters from given point to element geometry.
+class DistanceVisitor final : public ElementVisitor {
+ public:
+  explicit DistanceVisitor(const utymap::GeoCoordinate &point) :
+      distance(std::numeric_limits<double>::max()), point_(point) {
+  }
+
+  double distance;
+
+  void visitNode(const Node &node) override {
+    distance = std::min(distance, GeoUtils::distance(point_, node.coordinate));
+  }
+
+  void visitWay(const Way &way) override {
+    visitSegments(way.coordinates, false);
+  }
+
+  void visitArea(const Area &area) override {
+    if (GeoUtils::isPointInPolygon(point_, area.coordinates.cbegin(), area.coordinates.cend()))
+      distance = 0;
+    else
+      visitSegments(area.coordinates, true);
+  }
+
+  void visitRelation(const Relation &relation) override {
+    for (const auto &element : relation.elements)
+      element->accept(*this);
+  }
+
+ private:
+  void visitSegments(const std::vector<utymap::GeoCoordinate> &coordinates, bool isClosed) {
+    if (coordinates.empty()) return;
+
+    distance = std::min(distance, GeoUtils::distance(point_, coordinates.front()));
+    for (std::size_t i = 1; i < coordinates.size(); ++i)
+      visitSegment(coordinates[i - 1], coordinates[i]);
+
+    if (isClosed)
+      visitSegment(coordinates.back(), coordinates.front());
+  }
+
+  /// Finds the closest point of segment using local planar projection.
+  void visitSegment(const utymap::GeoCoordinate &start, const utymap::GeoCoordinate &end) {
+    double scale = std::cos(deg2Rad(point_.latitude));
+    double dx = (end.longitude - start.longitude)*scale;
+    double dy = end.latitude - start.latitude;
+    double px = (point_.longitude - start.longitude)*scale;
+    double py = point_.latitude - start.latitude;
+
+    double length = dx*dx + dy*dy;
+    double t = length > 0 ? std::max(0., std::min(1., (px*dx + py*dy)/length)) : 0;
+    distance = std::min(distance, GeoUtils::distance(point_, GeoUtils::newPoint(start, end, t)));
+  }
+
+  const utymap::GeoCoordinate point_;
+};
+
+/// Identifies stored element: osm nodes, ways and relations have separate id spaces.
+typedef std::pair<std::uint64_t, std::uint8_t> ElementKey;
+
+ElementKey getElementKey(const Element &element) {
+  return ElementKey(element.id, ElementStream::getSourceType(element));
+}
+
+/// Passes element to visitor only once using its id and kind. Clipped element is
+/// passed as its first visited piece.
+class UniqueElementFilter final : public ElementVisitor {
+ public:
+  explicit UniqueElementFilter(ElementVisitor &visitor) : visitor_(visitor) {}
+
+  void visitNode(const Node &node) override { visit(node); }
+  void visitWay(const Way &way) override { visit(way); }
+  void visitArea(const Area &area) override { visit(area); }
+  void visitRelation(const Relation &relation) override { visit(relation); }
+
+ private:
+  void visit(const Element &element) {
+    // NOTE element without id cannot be identified.
+    if (element.id==0 || keys_.insert(getElementKey(element)).second)
+      element.accept(visitor_);
+  }
+
+  ElementVisitor &visitor_;
+  std::set<ElementKey> keys_;
+};
+
+/// Collects copies of elements within given distance, each element only once.
+class NearestElementCollector final : public ElementVisitor {
+  typedef std::pair<double, std::shared_ptr<Element>> Result;
+
+ public:
+  NearestElementCollector(const utymap::GeoCoordinate &point, double radius) :
+      point_(point), radius_(radius) {
+  }
+
+  void visitNode(const Node &node) override { visit(node); }
+  void visitWay(const Way &way) override { visit(way); }
+  void visitArea(const Area &area) override { visit(area); }
+  void visitRelation(const Relation &relation) override { visit(relation); }
+
+  /// Visits collected elements in distance order.
+  void accept(ElementVisitor &visitor, const utymap::CancellationToken &cancelToken) {
+    std::stable_sort(results_.begin(), results_.end(), [](const Result &lhs, const Result &rhs) {
+      return lhs.first < rhs.first;
+    });
+    for (const auto &result : results_) {
+      if (cancelToken.isCancelled()) break;
+      result.second->accept(visitor);
+    }
+  }
+
+ private:
+  void visit(const Element &element) {
+    DistanceVisitor distanceVisitor(point_);
+    element.accept(distanceVisitor);
+    if (distanceVisitor.distance > radius_) return;
+
+    // NOTE element can be clipped into several quadkeys, only the closest part is kept.
+    auto existing = element.id==0 ? indices_.end() : indices_.find(getElementKey(element));
+    if (existing!=indices_.end() && results_[existing->second].first <= distanceVisitor.distance)
+      return;
+
+    Result result(distanceVisitor.distance, ElementCopier::copy(element));
+    if (existing!=indices_.end()) {
+      results_[existing->second] = result;
+    } else {
+      if (element.id!=0) indices_[getElementKey(element)] = results_.size();
+      results_.push_back(result);
+    }
+  }
+
+  const utymap::GeoCoordinate point_;
+  const double radius_;
+  std::vector<Result> results_;
+  std::map<ElementKey, std::size_t> indices_;
+};
+}
 
 class GeoStore::GeoStoreImpl final {
  public:
@@ -22,8 +213,18 @@ class GeoStore::GeoStoreImpl final {
       stringTable_(stringTable) {
   }
 
-  void registerStore(const std::string &storeKey, std::unique_ptr<ElementStore> store) {
+  void registerStore(const std::string &storeKey, std::unique_ptr<ElementStore> store, const std::string &sourcePath) {
     storeMap_.emplace(storeKey, std::move(store));
+    if (!sourcePath.empty())
+      sourcePathMap_.emplace(storeKey, sourcePath);
+  }
+
+  void beginImport(const std::string &storeKey) {
+    storeMap_[storeKey]->beginImport();
+  }
+
+  void commitImport(const std::string &storeKey) {
+    storeMap_[storeKey]->commitImport();
   }
 
   void add(const std::string &storeKey,
@@ -31,26 +232,69 @@ class GeoStore::GeoStoreImpl final {
            const LodRange &range,
            const StyleProvider &styleProvider) {
     auto &elementStore = storeMap_[storeKey];
+    // NOTE strings of element are written first, so stored element never refers to missing ones.
+    stringTable_.flush();
+    // NOTE previous version can cover quadkeys which new one does not, so it is erased there.
+    elementStore->eraseLocated(element, range);
     elementStore->store(element, range, styleProvider);
   }
 
+  void erase(const std::string &storeKey, const Element &element, const LodRange &range) {
+    checkErase(storeKey);
+    storeMap_[storeKey]->erase(element, range);
+  }
+
+  std::vector<QuadKey> applyChanges(const std::string &storeKey,
+                                    const std::string &path,
+                                    const LodRange &range,
+                                    const StyleProvider &styleProvider) {
+    checkErase(storeKey);
+    std::ifstream file(path);
+    if (!file.good())
+      throw std::domain_error("Cannot open change file: " + path);
+
+    auto &elementStore = storeMap_[storeKey];
+    std::set<QuadKey, QuadKey::Comparator> quadKeys;
+    auto addQuadKey = [&](const QuadKey &quadKey) {
+      quadKeys.insert(quadKey);
+    };
+
+    ImportSession session(*elementStore, stringTable_);
+    // NOTE osm data is used if it was kept by previous imports.
+    OsmChangeProcessor(stringTable_, getSourceStore(storeKey, false)).process(file, [&](Element &element) {
+      return elementStore->erase(element, range, addQuadKey);
+    }, [&](Element &element) {
+      // NOTE previous version is erased again as it might be unknown, e.g. without osm data.
+      elementStore->erase(element, range, addQuadKey);
+      for (int lod = range.start; lod <= range.end; ++lod) {
+        TileCoverage::visit(element, lod, [&](const QuadKey &quadKey, const BoundingBox &) {
+          quadKeys.insert(quadKey);
+        });
+      }
+      return elementStore->store(element, range, styleProvider);
+    });
+    session.commit();
+
+    return std::vector<QuadKey>(quadKeys.begin(), quadKeys.end());
+  }
+
   void add(const std::string &storeKey,
            const std::string &path,
            const QuadKey &quadKey,
-           const StyleProvider &styleProvider) {
-    auto &elementStore = storeMap_[storeKey];
-    add(path, styleProvider, [&](Element &element) {
-      return elementStore->store(element, quadKey, styleProvider);
+           const StyleProvider &styleProvider,
+           const ImportOptions &options) {
+    add(storeKey, path, styleProvider, options, [&](ElementStore &elementStore, const Element &element) {
+      return elementStore.store(element, quadKey, styleProvider);
     });
   }
 
   void add(const std::string &storeKey,
            const std::string &path,
            const LodRange &range,
-           const StyleProvider &styleProvider) {
-    auto &elementStore = storeMap_[storeKey];
-    add(path, styleProvider, [&](Element &element) {
-      return elementStore->store(element, range, styleProvider);
+           const StyleProvider &styleProvider,
+           const ImportOptions &options) {
+    add(storeKey, path, styleProvider, options, [&](ElementStore &elementStore, const Element &element) {
+      return elementStore.store(element, range, styleProvider);
     });
   }
 
@@ -58,37 +302,124 @@ class GeoStore::GeoStoreImpl final {
            const std::string &path,
            const BoundingBox &bbox,
            const LodRange &range,
-           const StyleProvider &styleProvider) {
+           const StyleProvider &styleProvider,
+           const ImportOptions &options) {
+    add(storeKey, path, styleProvider, options, [&](ElementStore &elementStore, const Element &element) {
+      return elementStore.store(element, bbox, range, styleProvider);
+    });
+  }
+
+  /// Imports data from file to selected store either serially or using import pipeline.
+  void add(const std::string &storeKey,
+           const std::string &path,
+           const StyleProvider &styleProvider,
+           const ImportOptions &options,
+           const ImportPipeline::StoreFunc &storeFunc) {
     auto &elementStore = storeMap_[storeKey];
-    add(path, styleProvider, [&](Element &element) {
-      return elementStore->store(element, bbox, range, styleProvider);
+    ImportPipeline::StoreFunc importFunc = storeFunc;
+    if (options.skipExisting) {
+      // NOTE given store can be recording one of import pipeline, so target store is checked.
+      importFunc = [&](ElementStore &store, const Element &element) {
+        return !elementStore->contains(element) && storeFunc(store, element);
+      };
+    }
+
+    ImportSession session(*elementStore, stringTable_);
+    auto pruner = createTagPruner(styleProvider, options);
+    auto sourceStore = getSourceStore(storeKey, options.keepsSourceData);
+    if (options.workerCount==0) {
+      add(path, options, pruner, sourceStore, [&](Element &element) {
+        return importFunc(*elementStore, element);
+      });
+      session.commit();
+      return;
+    }
+
+    // NOTE element is only queued here, so result of storing is not known.
+    ImportPipeline pipeline(*elementStore, stringTable_, options, importFunc);
+    add(path, options, pruner, sourceStore, [&](Element &element) {
+      pipeline.add(element);
+      return true;
     });
+    pipeline.complete();
+    session.commit();
+  }
+
+  /// Creates pruner which keeps tags used by styles and allowed by options.
+  static TagPruner createTagPruner(const StyleProvider &styleProvider, const ImportOptions &options) {
+    if (!options.pruneTags)
+      return TagPruner();
+
+    auto keys = styleProvider.getTagKeys();
+    keys.insert(options.tagAllowlist.begin(), options.tagAllowlist.end());
+    // NOTE relation type is used to resolve multipolygons and buildings.
+    keys.insert("type");
+    return TagPruner(std::move(keys));
+  }
+
+  /// Creates node location store if options require it.
+  static std::unique_ptr<NodeLocationStore> createNodeLocationStore(const std::string &path,
+                                                                    const ImportOptions &options) {
+    if (options.isExternal)
+      return utymap::utils::make_unique<NodeLocationStore>(
+          options.nodeLocationPath.empty() ? path + ".nodes" : options.nodeLocationPath,
+          options.nodeLocationMemoryBudget);
+
+    if (!options.storesNodeLocations)
+      return nullptr;
+
+    return options.nodeLocationPath.empty()
+           ? utymap::utils::make_unique<NodeLocationStore>()
+           : utymap::utils::make_unique<NodeLocationStore>(options.nodeLocationPath);
+  }
+
+  /// Collects ids of relation members by separate pass over osm file if nodes and ways
+  /// which are not members should be stored as soon as they are read.
+  template<typename Parser>
+  static std::shared_ptr<const RelationMemberCollector> collectRelationMembers(Parser parser,
+                                                                               const std::string &path,
+                                                                               const ImportOptions &options) {
+    if (!options.isExternal && !options.releasesElements)
+      return nullptr;
+
+    auto collector = std::make_shared<RelationMemberCollector>();
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    parser.parse(file, *collector);
+    collector->complete();
+    return collector;
   }
 
   void add(const std::string &path,
-           const StyleProvider &styleProvider,
+           const ImportOptions &options,
+           const TagPruner &pruner,
+           const std::shared_ptr<OsmSourceStore> &sourceStore,
            const std::function<bool(Element &)> &functor) const {
     switch (getFormatTypeFromPath(path)) {
       case FormatType::Shape: {
         ShapeParser<ShapeDataVisitor> parser;
-        ShapeDataVisitor visitor(stringTable_, functor);
+        ShapeDataVisitor visitor(stringTable_, functor, pruner);
         parser.parse(path, visitor);
         visitor.complete();
         break;
       }
       case FormatType::Xml: {
+        auto collector = collectRelationMembers(OsmXmlParser<RelationMemberCollector>(), path, options);
         OsmXmlParser<OsmDataVisitor> parser;
         std::ifstream xmlFile(path);
-        OsmDataVisitor visitor(stringTable_, functor);
+        OsmDataVisitor visitor(stringTable_, functor, pruner, createNodeLocationStore(path, options), collector,
+                               sourceStore);
         parser.parse(xmlFile, visitor);
         visitor.complete();
         break;
       }
 #ifdef PBF_SUPPORTED_ENABLED
       case FormatType::Pbf: {
-        OsmPbfParser<OsmDataVisitor> parser;
+        auto collector = collectRelationMembers(
+            OsmPbfParser<RelationMemberCollector>(options.parserWorkerCount), path, options);
+        OsmPbfParser<OsmDataVisitor> parser(options.parserWorkerCount);
         std::ifstream pbfFile(path, std::ios::in | std::ios::binary);
-        OsmDataVisitor visitor(stringTable_, functor);
+        OsmDataVisitor visitor(stringTable_, functor, pruner, createNodeLocationStore(path, options), collector,
+                               sourceStore);
         parser.parse(pbfFile, visitor);
         visitor.complete();
         break;
@@ -97,13 +428,37 @@ class GeoStore::GeoStoreImpl final {
       case FormatType::Json: {
         OsmJsonParser<OsmDataVisitor> parser(stringTable_);
         std::ifstream jsonFile(path);
-        OsmDataVisitor visitor(stringTable_, functor);
+        OsmDataVisitor visitor(stringTable_, functor, pruner, nullptr, nullptr, sourceStore);
         parser.parse(jsonFile, visitor);
         visitor.complete();
         break;
       }
       default:throw std::domain_error("Not supported.");
     }
+
+    if (sourceStore!=nullptr)
+      sourceStore->flush();
+  }
+
+  /// Throws if selected store cannot erase elements, so nothing is changed partially.
+  void checkErase(const std::string &storeKey) {
+    if (!storeMap_[storeKey]->canErase())
+      throw std::domain_error("Element store does not support erase, so elements cannot be removed or changed: " +
+          storeKey);
+  }
+
+  /// Gets store of osm data kept for selected element store or null if data is not kept.
+  /// Store is created if data already exists or if it should be kept from now on.
+  std::shared_ptr<OsmSourceStore> getSourceStore(const std::string &storeKey, bool keepsData) {
+    std::lock_guard<std::mutex> lock(sourceLock_);
+    auto sourceStore = sourceStoreMap_.find(storeKey);
+    if (sourceStore!=sourceStoreMap_.end())
+      return sourceStore->second;
+
+    auto sourcePath = sourcePathMap_.find(storeKey);
+    if (sourcePath==sourcePathMap_.end() || (!keepsData && !OsmSourceStore::exists(sourcePath->second)))
+      return nullptr;
+    return sourceStoreMap_.emplace(storeKey, std::make_shared<OsmSourceStore>(sourcePath->second)).first->second;
   }
 
   void search(const QuadKey &quadKey,
@@ -117,12 +472,47 @@ class GeoStore::GeoStoreImpl final {
     }
   }
 
+  void search(const QuadKey &quadKey,
+              const TagFilter &filter,
+              ElementVisitor &visitor,
+              const CancellationToken &cancelToken) {
+    for (const auto &pair : storeMap_) {
+      if (!cancelToken.isCancelled() && pair.second->hasData(quadKey))
+        pair.second->search(quadKey, filter, visitor, cancelToken);
+    }
+  }
+
+  void search(const BoundingBox &bbox,
+              int levelOfDetail,
+              ElementVisitor &visitor,
+              const CancellationToken &cancelToken) {
+    UniqueElementFilter filter(visitor);
+    searchTiles(bbox, levelOfDetail, filter, cancelToken);
+  }
+
   void search(const GeoCoordinate &coordinate,
               double radius,
-              const StyleProvider &styleProvider,
+              int levelOfDetail,
               ElementVisitor &visitor,
-              const CancellationToken &cancelToken) const {
-    throw std::domain_error("Not implemented.");
+              const CancellationToken &cancelToken) {
+    double latitudeOffset = GeoUtils::getOffset(coordinate, radius);
+    double longitudeOffset = latitudeOffset/std::max(std::cos(deg2Rad(coordinate.latitude)), 1E-6);
+    BoundingBox bbox(GeoCoordinate(coordinate.latitude - latitudeOffset, coordinate.longitude - longitudeOffset),
+                     GeoCoordinate(coordinate.latitude + latitudeOffset, coordinate.longitude + longitudeOffset));
+
+    NearestElementCollector collector(coordinate, radius);
+    searchTiles(bbox, levelOfDetail, collector, cancelToken);
+    collector.accept(visitor, cancelToken);
+  }
+
+  void findElementById(std::uint64_t id,
+                       int levelOfDetail,
+                       ElementVisitor &visitor,
+                       const CancellationToken &cancelToken) {
+    for (const auto &pair : storeMap_) {
+      if (!cancelToken.isCancelled())
+        pair.second->find(id, levelOfDetail, visitor, cancelToken);
+    }
   }
 
   bool hasData(const QuadKey &quadKey) {
@@ -133,9 +523,41 @@ class GeoStore::GeoStoreImpl final {
     return false;
   }
 
+  bool hasDescendantData(const QuadKey &quadKey) {
+    for (const auto &pair : storeMap_) {
+      if (pair.second->hasDescendantData(quadKey))
+        return true;
+    }
+    return false;
+  }
+
+  bool hasAncestorData(const QuadKey &quadKey) {
+    for (const auto &pair : storeMap_) {
+      if (pair.second->hasAncestorData(quadKey))
+        return true;
+    }
+    return false;
+  }
+
  private:
   const StringTable &stringTable_;
   std::map<std::string, std::unique_ptr<ElementStore>> storeMap_;
+  std::map<std::string, std::string> sourcePathMap_;
+  std::map<std::string, std::shared_ptr<OsmSourceStore>> sourceStoreMap_;
+  std::mutex sourceLock_;
+
+  /// Searches all stores for elements intersecting bounding box at given level of details.
+  void searchTiles(const BoundingBox &bbox,
+                   int levelOfDetail,
+                   ElementVisitor &visitor,
+                   const CancellationToken &cancelToken) {
+    GeoUtils::visitTileRange(bbox, levelOfDetail, [&](const QuadKey &quadKey, const BoundingBox &) {
+      for (const auto &pair : storeMap_) {
+        if (!cancelToken.isCancelled() && pair.second->hasData(quadKey))
+          pair.second->search(quadKey, bbox, visitor, cancelToken);
+      }
+    });
+  }
 
   static FormatType getFormatTypeFromPath(const std::string &path) {
     if (utymap::utils::endsWith(path, "pbf"))
@@ -155,8 +577,18 @@ GeoStore::GeoStore(const StringTable &stringTable) : pimpl_(utymap::utils::make_
 GeoStore::~GeoStore() {
 }
 
-void utymap::index::GeoStore::registerStore(const std::string &storeKey, std::unique_ptr<ElementStore> store) {
-  pimpl_->registerStore(storeKey, std::move(store));
+void utymap::index::GeoStore::registerStore(const std::string &storeKey,
+                                            std::unique_ptr<ElementStore> store,
+                                            const std::string &sourcePath) {
+  pimpl_->registerStore(storeKey, std::move(store), sourcePath);
+}
+
+void utymap::index::GeoStore::beginImport(const std::string &storeKey) {
+  pimpl_->beginImport(storeKey);
+}
+
+void utymap::index::GeoStore::commitImport(const std::string &storeKey) {
+  pimpl_->commitImport(storeKey);
 }
 
 void utymap::index::GeoStore::add(const std::string &storeKey,
@@ -166,26 +598,42 @@ void utymap::index::GeoStore::add(const std::string &storeKey,
   pimpl_->add(storeKey, element, range, styleProvider);
 }
 
+std::vector<utymap::QuadKey> utymap::index::GeoStore::applyChanges(const std::string &storeKey,
+                                                                  const std::string &path,
+                                                                  const LodRange &range,
+                                                                  const StyleProvider &styleProvider) {
+  return pimpl_->applyChanges(storeKey, path, range, styleProvider);
+}
+
+void utymap::index::GeoStore::erase(const std::string &storeKey,
+                                    const Element &element,
+                                    const LodRange &range) {
+  pimpl_->erase(storeKey, element, range);
+}
+
 void utymap::index::GeoStore::add(const std::string &storeKey,
                                   const std::string &path,
                                   const LodRange &range,
-                                  const StyleProvider &styleProvider) {
-  pimpl_->add(storeKey, path, range, styleProvider);
+                                  const StyleProvider &styleProvider,
+                                  const ImportOptions &options) {
+  pimpl_->add(storeKey, path, range, styleProvider, options);
 }
 
 void utymap::index::GeoStore::add(const std::string &storeKey,
                                   const std::string &path,
                                   const QuadKey &quadKey,
-                                  const StyleProvider &styleProvider) {
-  pimpl_->add(storeKey, path, quadKey, styleProvider);
+                                  const StyleProvider &styleProvider,
+                                  const ImportOptions &options) {
+  pimpl_->add(storeKey, path, quadKey, styleProvider, options);
 }
 
 void utymap::index::GeoStore::add(const std::string &storeKey,
                                   const std::string &path,
                                   const BoundingBox &bbox,
                                   const LodRange &range,
-                                  const StyleProvider &styleProvider) {
-  pimpl_->add(storeKey, path, bbox, range, styleProvider);
+                                  const StyleProvider &styleProvider,
+                                  const ImportOptions &options) {
+  pimpl_->add(storeKey, path, bbox, range, styleProvider, options);
 }
 
 void utymap::index::GeoStore::search(const QuadKey &quadKey,
@@ -195,14 +643,43 @@ void utymap::index::GeoStore::search(const QuadKey &quadKey,
   pimpl_->search(quadKey, styleProvider, visitor, cancelToken);
 }
 
+void utymap::index::GeoStore::search(const QuadKey &quadKey,
+                                     const TagFilter &filter,
+                                     ElementVisitor &visitor,
+                                     const utymap::CancellationToken &cancelToken) {
+  pimpl_->search(quadKey, filter, visitor, cancelToken);
+}
+
+void utymap::index::GeoStore::search(const BoundingBox &bbox,
+                                     int levelOfDetail,
+                                     ElementVisitor &visitor,
+                                     const utymap::CancellationToken &cancelToken) {
+  pimpl_->search(bbox, levelOfDetail, visitor, cancelToken);
+}
+
 void utymap::index::GeoStore::search(const GeoCoordinate &coordinate,
                                      double radius,
-                                     const StyleProvider &styleProvider,
+                                     int levelOfDetail,
                                      ElementVisitor &visitor,
                                      const utymap::CancellationToken &cancelToken) {
-  pimpl_->search(coordinate, radius, styleProvider, visitor, cancelToken);
+  pimpl_->search(coordinate, radius, levelOfDetail, visitor, cancelToken);
+}
+
+void utymap::index::GeoStore::findElementById(std::uint64_t id,
+                                              int levelOfDetail,
+                                              ElementVisitor &visitor,
+                                              const utymap::CancellationToken &cancelToken) {
+  pimpl_->findElementById(id, levelOfDetail, visitor, cancelToken);
 }
 
 bool utymap::index::GeoStore::hasData(const QuadKey &quadKey) const {
   return pimpl_->hasData(quadKey);
 }
+
+bool utymap::index::GeoStore::hasDescendantData(const QuadKey &quadKey) const {
+  return pimpl_->hasDescendantData(quadKey);
+}
+
+bool utymap::index::GeoStore::hasAncestorData(const QuadKey &quadKey) const {
+  return pimpl_->hasAncestorData(quadKey);
+}
@@ -9,10 +9,13 @@
 #include "entities/Element.hpp"
 #include "entities/ElementVisitor.hpp"
 #include "index/ElementStore.hpp"
+#include "index/ImportOptions.hpp"
 #include "index/StringTable.hpp"
+#include "index/TagFilter.hpp"
 #include "mapcss/StyleProvider.hpp"
 
 #include <memory>
+#include <vector>
 
 namespace utymap {
 namespace index {
@@ -24,34 +27,65 @@ class GeoStore final {
 
   ~GeoStore();
 
-  /// Adds underlying element store for usage.
+  /// Adds underlying element store for usage. If source path is given, osm data imported
+  /// with keepsSourceData option is kept in files with this path prefix, so change files
+  /// can be applied to elements which are not fully listed in them.
   void registerStore(const std::string &storeKey,
-                     std::unique_ptr<ElementStore> store);
+                     std::unique_ptr<ElementStore> store,
+                     const std::string &sourcePath = "");
 
-  /// Adds element to selected store.
+  /// Starts import session for selected store: data added to the store
+  /// can be buffered until the session is committed.
+  void beginImport(const std::string &storeKey);
+
+  /// Commits import session for selected store.
+  void commitImport(const std::string &storeKey);
+
+  /// Adds element to selected store. Previous version of element is erased if store
+  /// can locate it by id.
   void add(const std::string &storeKey,
            const utymap::entities::Element &element,
            const utymap::LodRange &range,
            const utymap::mapcss::StyleProvider &styleProvider);
 
+  /// Erases element from selected store in given level of detail range. Throws if the store
+  /// cannot erase elements.
+  void erase(const std::string &storeKey,
+             const utymap::entities::Element &element,
+             const utymap::LodRange &range);
+
+  /// Applies osm change file to selected store in given level of detail range: created and
+  /// modified elements replace their previous versions, deleted ones are erased. Ways and
+  /// relations which use changed nodes or ways are rebuilt. Previous versions are built from
+  /// osm data kept for the store and located by id if the store has id index. Without kept
+  /// osm data, only elements of the file are known. Returns quadkeys affected by the change.
+  /// Throws if the store cannot erase elements or the file cannot be opened.
+  std::vector<utymap::QuadKey> applyChanges(const std::string &storeKey,
+                                            const std::string &path,
+                                            const utymap::LodRange &range,
+                                            const utymap::mapcss::StyleProvider &styleProvider);
+
   /// Adds all data from file to selected store in given level of detail range.
   void add(const std::string &storeKey,
            const std::string &path,
            const utymap::LodRange &range,
-           const utymap::mapcss::StyleProvider &styleProvider);
+           const utymap::mapcss::StyleProvider &styleProvider,
+           const ImportOptions &options = ImportOptions());
 
   /// Adds all data from file to selected store in given quad key.
   void add(const std::string &storeKey,
            const std::string &path,
            const utymap::QuadKey &quadKey,
-           const utymap::mapcss::StyleProvider &styleProvider);
+           const utymap::mapcss::StyleProvider &styleProvider,
+           const ImportOptions &options = ImportOptions());
 
   /// Adds all data from file to selected store in given boundging box.
   void add(const std::string &storeKey,
            const std::string &path,
            const utymap::BoundingBox &bbox,
            const utymap::LodRange &range,
-           const utymap::mapcss::StyleProvider &styleProvider);
+           const utymap::mapcss::StyleProvider &styleProvider,
+           const ImportOptions &options = ImportOptions());
 
   /// Searches for elements inside quadkey.
   void search(const QuadKey &quadKey,
@@ -59,16 +93,44 @@ class GeoStore final {
               utymap::entities::ElementVisitor &visitor,
               const utymap::CancellationToken &cancelToken);
 
-  /// Searches for elements inside circle with given parameters.
+  /// Searches for elements inside quadkey which tags match given filter.
+  void search(const QuadKey &quadKey,
+              const TagFilter &filter,
+              utymap::entities::ElementVisitor &visitor,
+              const utymap::CancellationToken &cancelToken);
+
+  /// Searches for elements which bounding boxes intersect given one using data of given
+  /// level of details. Each element is visited only once: element clipped into several
+  /// quadkeys is visited as the piece from the first quadkey which has it.
+  void search(const BoundingBox &bbox,
+              int levelOfDetail,
+              utymap::entities::ElementVisitor &visitor,
+              const utymap::CancellationToken &cancelToken);
+
+  /// Searches for elements within given radius in meters from coordinate using
+  /// data of given level of details. Elements are visited in distance order.
   void search(const GeoCoordinate &coordinate,
               double radius,
-              const utymap::mapcss::StyleProvider &styleProvider,
+              int levelOfDetail,
               utymap::entities::ElementVisitor &visitor,
               const utymap::CancellationToken &cancelToken);
 
+  /// Finds elements with given id stored at given level of details in all stores
+  /// which have id index. Clipped element is visited once per quadkey where it is stored.
+  void findElementById(std::uint64_t id,
+                       int levelOfDetail,
+                       utymap::entities::ElementVisitor &visitor,
+                       const utymap::CancellationToken &cancelToken);
+
   /// Checks whether there is data for given quadkey.
   bool hasData(const QuadKey &quadKey) const;
 
+  /// Checks whether there is data for any quadkey of higher level of details inside given one.
+  bool hasDescendantData(const QuadKey &quadKey) const;
+
+  /// Checks whether there is data for any quadkey of lower level of details containing given one.
+  bool hasAncestorData(const QuadKey &quadKey) const;
+
  private:
   class GeoStoreImpl;
   std::unique_ptr<GeoStoreImpl> pimpl_;
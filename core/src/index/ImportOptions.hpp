@@ -0,0 +1,66 @@
+#ifndef INDEX_IMPORTOPTIONS_HPP_DEFINED
+#define INDEX_IMPORTOPTIONS_HPP_DEFINED
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace utymap {
+namespace index {
+
+/// Specifies how elements from data file are imported into element store.
+struct ImportOptions final {
+  /// Amount of threads which style, assign tiles and clip elements.
+  /// Zero means that everything is done serially by calling thread.
+  std::size_t workerCount = 0;
+  /// Amount of threads which inflate and decode blocks of pbf file. Zero means that
+  /// blocks are decoded by parsing thread.
+  std::size_t parserWorkerCount = 0;
+  /// Amount of threads which write elements to element store. Each writer
+  /// owns distinct set of quadkeys.
+  std::size_t writerCount = 1;
+  /// Max amount of element batches waiting in each stage queue.
+  std::size_t queueSize = 16;
+  /// Amount of elements passed between stages at once.
+  std::size_t batchSize = 256;
+  /// Skips elements which are already stored with the same id and kind, so
+  /// overlapping extracts can be imported without duplicates.
+  /// NOTE only stores with id index can detect existing elements. The first lookup loads
+  /// the whole id index into memory, and elements edited since previous import are skipped
+  /// as well, so use changes to update them.
+  bool skipExisting = false;
+  /// Drops tags which are not referenced by style conditions or evaluated declarations
+  /// before they are added to string table, so they do not take space in store.
+  bool pruneTags = false;
+  /// Keeps osm data of imported elements in source files of the store, so change files
+  /// which refer to unchanged elements can be applied later. Store should be registered
+  /// with source path. NOTE it takes disk space comparable to the data file itself.
+  bool keepsSourceData = false;
+  /// Keeps locations of untagged osm nodes in compact store instead of node elements.
+  /// Such nodes are not imported as elements if they are way vertices.
+  bool storesNodeLocations = false;
+  /// File where node locations are kept while data file is imported. Empty path means
+  /// that locations are kept in memory or, for external import, in file next to data file.
+  std::string nodeLocationPath;
+  /// Imports osm xml and pbf files which do not fit into memory. The first pass collects
+  /// ids of relation members, the second one stores other nodes and ways as soon as they
+  /// are read, so only relations and their members are kept in memory.
+  /// NOTE only node locations are bounded by nodeLocationMemoryBudget: member ids, relations
+  /// and member ways and areas stay in memory till the end of import, so files with huge
+  /// amount of relations still need memory proportional to them.
+  bool isExternal = false;
+  /// Stores osm nodes and ways which are not referenced by relations as soon as they are
+  /// read instead of keeping them till the end of import. Relation members are collected by
+  /// extra pass over file, nodes and ways are expected to precede relations in it.
+  bool releasesElements = false;
+  /// Max amount of bytes which node locations take in memory during external import.
+  /// Locations are moved to file once they exceed it. Other import data is not limited.
+  std::size_t nodeLocationMemoryBudget = 256*1024*1024;
+  /// Keys of tags which are kept by tag pruning even if styles do not use them, e.g. name.
+  std::vector<std::string> tagAllowlist;
+};
+
+}
+}
+
+#endif // INDEX_IMPORTOPTIONS_HPP_DEFINED
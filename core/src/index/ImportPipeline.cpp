@@ -0,0 +1,283 @@
+#include "index/ElementCopier.hpp"
+#include "index/ImportPipeline.hpp"
+#include "utils/BoundedQueue.hpp"
+#include "utils/CoreUtils.hpp"
+#include "utils/GeoUtils.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace utymap;
+using namespace utymap::entities;
+using namespace utymap::index;
+using namespace utymap::utils;
+
+namespace {
+typedef std::shared_ptr<const Element> ElementPtr;
+
+/// Element prepared by worker with quadkey where it should be written.
+struct Output final {
+  QuadKey quadKey;
+  ElementPtr element;
+};
+
+typedef std::shared_ptr<const std::vector<Output>> OutputsPtr;
+
+/// Elements added by parser thread with their sequence number.
+struct Batch final {
+  std::uint64_t sequence;
+  std::vector<ElementPtr> elements;
+};
+
+/// Records elements instead of storing them, so they can be written by writer thread later.
+class RecordingElementStore final : public ElementStore {
+ public:
+  explicit RecordingElementStore(const StringTable &stringTable) : ElementStore(stringTable) {
+  }
+
+  /// Records results of storing given element.
+  std::vector<Output> record(const std::vector<ElementPtr> &elements, const ImportPipeline::StoreFunc &storeFunc) {
+    std::vector<Output> outputs;
+    outputs_ = &outputs;
+    for (const auto &element : elements) {
+      current_ = element;
+      storeFunc(*this, *element);
+    }
+    current_.reset();
+    outputs_ = nullptr;
+    return outputs;
+  }
+
+  void search(const QuadKey &, ElementVisitor &, const utymap::CancellationToken &) override {
+  }
+
+  bool hasData(const QuadKey &) const override {
+    return false;
+  }
+
+ protected:
+  void storeImpl(const Element &element, const QuadKey &quadKey) override {
+    // NOTE clipped element is temporary, original one is shared as it is immutable.
+    outputs_->push_back(Output{quadKey, &element==current_.get() ? current_ : ElementCopier::copy(element)});
+  }
+
+ private:
+  ElementPtr current_;
+  std::vector<Output> *outputs_ = nullptr;
+};
+}
+
+class ImportPipeline::ImportPipelineImpl final {
+ public:
+  ImportPipelineImpl(ElementStore &elementStore,
+                     const StringTable &stringTable,
+                     const ImportOptions &options,
+                     const StoreFunc &storeFunc) :
+      elementStore_(elementStore),
+      stringTable_(stringTable),
+      storeFunc_(storeFunc),
+      batchSize_(std::max<std::size_t>(options.batchSize, 1)),
+      maxPending_(std::max<std::size_t>(options.queueSize, 1)),
+      batches_(std::max<std::size_t>(options.queueSize, 1)),
+      nextSequence_(0),
+      nextOutput_(0),
+      isPublishing_(false),
+      isCompleted_(false),
+      hasError_(false) {
+    std::size_t writerCount = std::max<std::size_t>(options.writerCount, 1);
+    for (std::size_t i = 0; i < writerCount; ++i)
+      outputs_.push_back(utymap::utils::make_unique<BoundedQueue<OutputsPtr>>(std::max<std::size_t>(options.queueSize, 1)));
+
+    try {
+      for (std::size_t i = 0; i < writerCount; ++i)
+        writers_.push_back(std::thread(&ImportPipelineImpl::write, this, i));
+      for (std::size_t i = 0; i < std::max<std::size_t>(options.workerCount, 1); ++i)
+        workers_.push_back(std::thread(&ImportPipelineImpl::work, this));
+    } catch (...) {
+      abort();
+      throw;
+    }
+  }
+
+  ~ImportPipelineImpl() {
+    if (!isCompleted_)
+      abort();
+  }
+
+  void add(const Element &element) {
+    throwIfFailed();
+    batch_.elements.push_back(ElementCopier::copy(element));
+    if (batch_.elements.size() >= batchSize_)
+      submit();
+  }
+
+  void complete() {
+    if (!batch_.elements.empty())
+      submit();
+
+    // NOTE all batches are passed to writers when workers are finished.
+    batches_.close();
+    join(workers_);
+    for (const auto &queue : outputs_)
+      queue->close();
+    join(writers_);
+
+    isCompleted_ = true;
+    throwIfFailed();
+  }
+
+ private:
+  /// Passes current batch to workers.
+  void submit() {
+    batch_.sequence = nextSequence_++;
+    bool isAccepted = batches_.push(std::move(batch_));
+    batch_ = Batch();
+    if (!isAccepted)
+      throwIfFailed();
+  }
+
+  /// Styles, assigns tiles and clips elements of batches.
+  void work() {
+    RecordingElementStore recordingStore(stringTable_);
+    Batch batch;
+    while (batches_.pop(batch)) {
+      if (hasError_) continue;
+      try {
+        auto outputs = std::make_shared<const std::vector<Output>>(recordingStore.record(batch.elements, storeFunc_));
+        publish(batch.sequence, outputs);
+      } catch (...) {
+        fail(std::current_exception());
+      }
+    }
+  }
+
+  /// Passes outputs to writers in the order of batch sequence numbers. Only one worker
+  /// passes outputs at a time and it does not hold the lock while writer queues are full,
+  /// other workers leave their outputs and continue unless too many of them are pending.
+  void publish(std::uint64_t sequence, const OutputsPtr &outputs) {
+    std::unique_lock<std::mutex> lock(orderLock_);
+    pending_.emplace(sequence, outputs);
+    if (isPublishing_) {
+      published_.wait(lock, [&] { return !isPublishing_ || pending_.size() <= maxPending_; });
+      return;
+    }
+
+    isPublishing_ = true;
+    for (auto it = pending_.find(nextOutput_); it!=pending_.end(); it = pending_.find(nextOutput_)) {
+      auto ready = it->second;
+      pending_.erase(it);
+      ++nextOutput_;
+
+      lock.unlock();
+      for (const auto &queue : outputs_)
+        queue->push(ready);
+      lock.lock();
+      published_.notify_all();
+    }
+    isPublishing_ = false;
+    published_.notify_all();
+  }
+
+  /// Writes elements of quadkeys which belong to given shard.
+  void write(std::size_t shard) {
+    OutputsPtr outputs;
+    while (outputs_[shard]->pop(outputs)) {
+      if (hasError_) continue;
+      try {
+        for (const auto &output : *outputs) {
+          if (getShard(output.quadKey)==shard)
+            elementStore_.store(*output.element, output.quadKey);
+        }
+      } catch (...) {
+        fail(std::current_exception());
+      }
+    }
+  }
+
+  std::size_t getShard(const QuadKey &quadKey) const {
+    return static_cast<std::size_t>(utymap::utils::GeoUtils::quadKeyToCode(quadKey) % outputs_.size());
+  }
+
+  /// Keeps the first error and stops processing of remaining data.
+  void fail(std::exception_ptr error) {
+    {
+      std::lock_guard<std::mutex> lock(errorLock_);
+      if (error_==nullptr)
+        error_ = error;
+    }
+    hasError_ = true;
+    batches_.close();
+    for (const auto &queue : outputs_)
+      queue->close();
+  }
+
+  void throwIfFailed() {
+    std::lock_guard<std::mutex> lock(errorLock_);
+    if (error_!=nullptr)
+      std::rethrow_exception(error_);
+  }
+
+  /// Stops all threads discarding not written data.
+  void abort() {
+    hasError_ = true;
+    batches_.close();
+    for (const auto &queue : outputs_)
+      queue->close();
+    join(workers_);
+    join(writers_);
+  }
+
+  static void join(std::vector<std::thread> &threads) {
+    for (auto &thread : threads) {
+      if (thread.joinable())
+        thread.join();
+    }
+  }
+
+  ElementStore &elementStore_;
+  const StringTable &stringTable_;
+  const StoreFunc storeFunc_;
+  const std::size_t batchSize_;
+  const std::size_t maxPending_;
+
+  Batch batch_;
+  BoundedQueue<Batch> batches_;
+  std::vector<std::unique_ptr<BoundedQueue<OutputsPtr>>> outputs_;
+  std::vector<std::thread> workers_;
+  std::vector<std::thread> writers_;
+
+  std::uint64_t nextSequence_;
+  std::uint64_t nextOutput_;
+  std::map<std::uint64_t, OutputsPtr> pending_;
+  bool isPublishing_;
+  std::mutex orderLock_;
+  std::condition_variable published_;
+
+  bool isCompleted_;
+  std::atomic<bool> hasError_;
+  std::exception_ptr error_;
+  std::mutex errorLock_;
+};
+
+ImportPipeline::ImportPipeline(ElementStore &elementStore,
+                               const StringTable &stringTable,
+                               const ImportOptions &options,
+                               const StoreFunc &storeFunc) :
+    pimpl_(utymap::utils::make_unique<ImportPipelineImpl>(elementStore, stringTable, options, storeFunc)) {
+}
+
+ImportPipeline::~ImportPipeline() {
+}
+
+void ImportPipeline::add(const Element &element) {
+  pimpl_->add(element);
+}
+
+void ImportPipeline::complete() {
+  pimpl_->complete();
+}
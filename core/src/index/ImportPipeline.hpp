@@ -0,0 +1,50 @@
+#ifndef INDEX_IMPORTPIPELINE_HPP_DEFINED
+#define INDEX_IMPORTPIPELINE_HPP_DEFINED
+
+#include "entities/Element.hpp"
+#include "index/ElementStore.hpp"
+#include "index/ImportOptions.hpp"
+#include "index/StringTable.hpp"
+
+#include <functional>
+#include <memory>
+
+namespace utymap {
+namespace index {
+
+/// Imports elements into element store using staged pipeline: elements added by parser
+/// thread are styled, assigned to tiles and clipped by worker threads, then written by
+/// writer threads sharded by quadkey. Elements of each quadkey are written in the order
+/// they were added, so the result is identical to serial import.
+class ImportPipeline final {
+ public:
+  /// Stores element in given element store. It is called by worker threads with the store
+  /// which records results instead of writing them.
+  typedef std::function<bool(ElementStore &, const utymap::entities::Element &)> StoreFunc;
+
+  ImportPipeline(ElementStore &elementStore,
+                 const utymap::index::StringTable &stringTable,
+                 const ImportOptions &options,
+                 const StoreFunc &storeFunc);
+
+  /// Stops all threads. Elements which are not written yet are discarded if
+  /// complete was not called.
+  ~ImportPipeline();
+
+  /// Adds element to pipeline. Element is copied, so it can be changed after the call.
+  /// Blocks when pipeline queues are full.
+  void add(const utymap::entities::Element &element);
+
+  /// Waits until all added elements are written to element store.
+  /// Rethrows the first exception raised by pipeline threads.
+  void complete();
+
+ private:
+  class ImportPipelineImpl;
+  std::unique_ptr<ImportPipelineImpl> pimpl_;
+};
+
+}
+}
+
+#endif // INDEX_IMPORTPIPELINE_HPP_DEFINED
@@ -1,91 +1,315 @@
-#include "entities/Node.hpp"
-#include "entities/Way.hpp"
-#include "entities/Area.hpp"
-#include "entities/Relation.hpp"
+#include "index/BoundingBoxVisitor.hpp"
+#include "index/ElementStream.hpp"
 #include "index/InMemoryElementStore.hpp"
+#include "index/QuadKeyOccupancy.hpp"
+#include "index/SpatialIndex.hpp"
+#include "utils/GeoUtils.hpp"
+
+#include <limits>
+#include <list>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
 
 using namespace utymap;
 using namespace utymap::index;
 using namespace utymap::entities;
 using namespace utymap::mapcss;
+using namespace utymap::utils;
 
 namespace {
-typedef std::vector<std::shared_ptr<Element>> Elements;
-typedef std::map<QuadKey, Elements, QuadKey::Comparator> ElementMap;
-
-class ElementMapVisitor : public ElementVisitor {
+/// Provides output stream API which appends data to string.
+class ArenaBuffer final : public std::streambuf {
  public:
-  ElementMapVisitor(const QuadKey &quadKey, ElementMap &elementsMap) :
-      quadKey_(quadKey), elementsMap_(elementsMap) {
-  }
+  explicit ArenaBuffer(std::string &data) : data_(data) {}
 
-  void visitNode(const utymap::entities::Node &node) override {
-    elementsMap_[quadKey_].push_back(std::make_shared<Node>(node));
+ protected:
+  int_type overflow(int_type c) override {
+    if (!traits_type::eq_int_type(c, traits_type::eof()))
+      data_.push_back(traits_type::to_char_type(c));
+    return c;
   }
 
-  void visitWay(const utymap::entities::Way &way) override {
-    elementsMap_[quadKey_].push_back(std::make_shared<Way>(way));
+  std::streamsize xsputn(const char *s, std::streamsize n) override {
+    data_.append(s, static_cast<std::size_t>(n));
+    return n;
   }
 
-  void visitArea(const utymap::entities::Area &area) override {
-    elementsMap_[quadKey_].push_back(std::make_shared<Area>(area));
+ private:
+  std::string &data_;
+};
+
+/// Provides input stream API over memory range.
+class MemoryBuffer final : public std::streambuf {
+ public:
+  MemoryBuffer(const char *begin, const char *end) {
+    setg(const_cast<char *>(begin), const_cast<char *>(begin), const_cast<char *>(end));
   }
 
-  void visitRelation(const utymap::entities::Relation &relation) override {
-    elementsMap_[quadKey_].push_back(std::make_shared<Relation>(relation));
+  /// Returns read position relative to the beginning of the range.
+  std::size_t position() const {
+    return static_cast<std::size_t>(gptr() - eback());
   }
- private:
-  const QuadKey &quadKey_;
-  ElementMap &elementsMap_;
 };
 }
 
-class InMemoryElementStore::InMemoryElementStoreImpl {
+class InMemoryElementStore::InMemoryElementStoreImpl final {
+  typedef std::shared_ptr<std::string> Arena;
+  typedef std::list<std::uint64_t> UsageList;
+
+  /// Keeps encoded elements of single tile.
+  struct Tile final {
+    QuadKey quadKey;
+    /// Element records: id followed by element stream data.
+    /// NOTE arena is copied on write if it is still used by search.
+    Arena arena;
+    /// Position in usage list.
+    UsageList::iterator usage;
+    /// Spatial index of elements where item is record offset inside arena.
+    /// NOTE it is built on first bounding box search and reset on store.
+    std::shared_ptr<const SpatialIndex> index;
+  };
+
  public:
-  ElementMap elementsMap;
+  InMemoryElementStoreImpl(std::size_t memoryBudget, std::unique_ptr<ElementStore> spillStore) :
+      memoryBudget_(memoryBudget), memoryUsage_(0), spillStore_(std::move(spillStore)) {
+  }
+
+  void beginImport() {
+    if (spillStore_!=nullptr)
+      spillStore_->beginImport();
+  }
+
+  void commitImport() {
+    if (spillStore_!=nullptr)
+      spillStore_->commitImport();
+  }
+
+  void store(const Element &element, const QuadKey &quadKey) {
+    occupancy_.add(quadKey);
+    std::lock_guard<std::mutex> lock(lock_);
+    auto &tile = getTile(quadKey);
+    if (tile.arena.use_count() > 1)
+      tile.arena = std::make_shared<std::string>(*tile.arena);
+    tile.index.reset();
+
+    auto size = tile.arena->size();
+    ArenaBuffer buffer(*tile.arena);
+    std::ostream stream(&buffer);
+    stream.write(reinterpret_cast<const char *>(&element.id), sizeof(element.id));
+    ElementStream::write(stream, element);
+    memoryUsage_ += tile.arena->size() - size;
+
+    if (memoryUsage_ > memoryBudget_)
+      evict();
+  }
+
+  void search(const QuadKey &quadKey, ElementVisitor &visitor, const utymap::CancellationToken &cancelToken) {
+    Arena arena;
+    bool isSpilled;
+    {
+      std::lock_guard<std::mutex> lock(lock_);
+      auto code = GeoUtils::quadKeyToCode(quadKey);
+      isSpilled = spilled_.find(code)!=spilled_.end();
+      auto tile = tiles_.find(code);
+      if (tile!=tiles_.end()) {
+        usage_.splice(usage_.begin(), usage_, tile->second.usage);
+        arena = tile->second.arena;
+      }
+    }
+
+    // NOTE spilled data is older than the one in memory.
+    if (isSpilled)
+      spillStore_->search(quadKey, visitor, cancelToken);
+
+    if (arena!=nullptr)
+      read(*arena, visitor, cancelToken);
+  }
+
+  void search(const QuadKey &quadKey,
+              const BoundingBox &bbox,
+              ElementVisitor &visitor,
+              const utymap::CancellationToken &cancelToken) {
+    Arena arena;
+    std::shared_ptr<const SpatialIndex> index;
+    bool isSpilled;
+    auto code = GeoUtils::quadKeyToCode(quadKey);
+    {
+      std::lock_guard<std::mutex> lock(lock_);
+      isSpilled = spilled_.find(code)!=spilled_.end();
+      auto tile = tiles_.find(code);
+      if (tile!=tiles_.end()) {
+        usage_.splice(usage_.begin(), usage_, tile->second.usage);
+        arena = tile->second.arena;
+        index = tile->second.index;
+      }
+    }
+
+    if (isSpilled)
+      spillStore_->search(quadKey, bbox, visitor, cancelToken);
+
+    if (arena==nullptr)
+      return;
+
+    if (index==nullptr) {
+      index = buildIndex(*arena);
+      std::lock_guard<std::mutex> lock(lock_);
+      auto tile = tiles_.find(code);
+      // NOTE arena is replaced on store while it is used here.
+      if (tile!=tiles_.end() && tile->second.arena==arena)
+        tile->second.index = index;
+    }
+
+    ElementDecoder decoder;
+    index->query(bbox, [&](std::uint32_t offset) {
+      if (cancelToken.isCancelled()) return;
+      MemoryBuffer buffer(arena->data() + offset, arena->data() + arena->size());
+      std::istream stream(&buffer);
+      std::uint64_t id;
+      stream.read(reinterpret_cast<char *>(&id), sizeof(id));
+      decoder.read(stream, id).accept(visitor);
+    });
+  }
 
-  ElementMap::const_iterator begin(const utymap::QuadKey &quadKey) const {
-    return elementsMap.find(quadKey);
+  /// NOTE tile has data either in memory or in spill store.
+  const QuadKeyOccupancy &getOccupancy() const {
+    return occupancy_;
   }
 
-  ElementMap::const_iterator end() const {
-    return elementsMap.cend();
+  std::size_t memoryUsage() const {
+    std::lock_guard<std::mutex> lock(lock_);
+    return memoryUsage_;
   }
 
-  bool hasData(const utymap::QuadKey &quadKey) const {
-    return elementsMap.find(quadKey)!=elementsMap.end();
+ private:
+  /// Gets tile for given quadkey creating it if necessary.
+  Tile &getTile(const QuadKey &quadKey) {
+    auto code = GeoUtils::quadKeyToCode(quadKey);
+    auto tile = tiles_.find(code);
+    if (tile!=tiles_.end())
+      return tile->second;
+
+    usage_.push_front(code);
+    return tiles_[code] = Tile{quadKey, std::make_shared<std::string>(), usage_.begin(), nullptr};
+  }
+
+  /// Moves least recently used tiles to spill store until memory usage fits budget.
+  void evict() {
+    while (memoryUsage_ > memoryBudget_ && !usage_.empty()) {
+      auto code = usage_.back();
+      auto tile = tiles_.find(code);
+
+      read(*tile->second.arena, utymap::CancellationToken(), [&](const Element &element) {
+        spillStore_->store(element, tile->second.quadKey);
+      });
+      spilled_.insert(code);
+
+      memoryUsage_ -= tile->second.arena->size();
+      usage_.pop_back();
+      tiles_.erase(tile);
+    }
+  }
+
+  /// Builds spatial index for elements of given arena.
+  static std::shared_ptr<const SpatialIndex> buildIndex(const std::string &arena) {
+    std::vector<SpatialIndex::Entry> entries;
+    ElementDecoder decoder;
+    MemoryBuffer buffer(arena.data(), arena.data() + arena.size());
+    std::istream stream(&buffer);
+    while (stream.peek()!=std::char_traits<char>::eof()) {
+      auto offset = static_cast<std::uint32_t>(buffer.position());
+      std::uint64_t id;
+      stream.read(reinterpret_cast<char *>(&id), sizeof(id));
+      entries.push_back(SpatialIndex::Entry{BoundingBoxVisitor::create(decoder.read(stream, id)), offset});
+    }
+    return std::make_shared<const SpatialIndex>(std::move(entries));
   }
+
+  static void read(const std::string &arena, ElementVisitor &visitor, const utymap::CancellationToken &cancelToken) {
+    read(arena, cancelToken, [&](const Element &element) { element.accept(visitor); });
+  }
+
+  /// Decodes all elements of given arena.
+  template<typename Callback>
+  static void read(const std::string &arena, const utymap::CancellationToken &cancelToken, const Callback &callback) {
+    ElementDecoder decoder;
+    MemoryBuffer buffer(arena.data(), arena.data() + arena.size());
+    std::istream stream(&buffer);
+    while (!cancelToken.isCancelled() && stream.peek()!=std::char_traits<char>::eof()) {
+      std::uint64_t id;
+      stream.read(reinterpret_cast<char *>(&id), sizeof(id));
+      callback(decoder.read(stream, id));
+    }
+  }
+
+  const std::size_t memoryBudget_;
+  std::size_t memoryUsage_;
+  std::unique_ptr<ElementStore> spillStore_;
+
+  std::unordered_map<std::uint64_t, Tile> tiles_;
+  std::unordered_set<std::uint64_t> spilled_;
+  QuadKeyOccupancy occupancy_;
+  /// Tile codes ordered by last usage, most recent first.
+  UsageList usage_;
+  mutable std::mutex lock_;
 };
 
 InMemoryElementStore::InMemoryElementStore(const StringTable &stringTable) :
-    ElementStore(stringTable), pimpl_(utymap::utils::make_unique<InMemoryElementStoreImpl>()) {
+    ElementStore(stringTable),
+    pimpl_(utymap::utils::make_unique<InMemoryElementStoreImpl>(std::numeric_limits<std::size_t>::max(), nullptr)) {
+}
+
+InMemoryElementStore::InMemoryElementStore(const StringTable &stringTable,
+                                           std::size_t memoryBudget,
+                                           std::unique_ptr<ElementStore> spillStore) :
+    ElementStore(stringTable),
+    pimpl_(nullptr) {
+  if (spillStore==nullptr)
+    throw std::invalid_argument("Spill store is required when memory budget is set.");
+  pimpl_ = utymap::utils::make_unique<InMemoryElementStoreImpl>(memoryBudget, std::move(spillStore));
 }
 
 InMemoryElementStore::~InMemoryElementStore() {
 }
 
 void InMemoryElementStore::storeImpl(const utymap::entities::Element &element, const QuadKey &quadKey) {
-  ElementMapVisitor visitor(quadKey, pimpl_->elementsMap);
-  element.accept(visitor);
+  pimpl_->store(element, quadKey);
 }
 
 bool InMemoryElementStore::hasData(const utymap::QuadKey &quadKey) const {
-  return pimpl_->hasData(quadKey);
+  return pimpl_->getOccupancy().hasData(quadKey);
+}
+
+bool InMemoryElementStore::hasDescendantData(const utymap::QuadKey &quadKey) const {
+  return pimpl_->getOccupancy().hasDescendantData(quadKey);
+}
+
+bool InMemoryElementStore::hasAncestorData(const utymap::QuadKey &quadKey) const {
+  return pimpl_->getOccupancy().hasAncestorData(quadKey);
+}
+
+void InMemoryElementStore::search(const utymap::QuadKey &quadKey,
+                                  utymap::entities::ElementVisitor &visitor,
+                                  const utymap::CancellationToken &cancelToken) {
+  pimpl_->search(quadKey, visitor, cancelToken);
 }
 
 void InMemoryElementStore::search(const utymap::QuadKey &quadKey,
+                                  const utymap::BoundingBox &bbox,
                                   utymap::entities::ElementVisitor &visitor,
                                   const utymap::CancellationToken &cancelToken) {
-  auto it = pimpl_->begin(quadKey);
+  pimpl_->search(quadKey, bbox, visitor, cancelToken);
+}
 
-  // No elements for this quadkey
-  if (it==pimpl_->end())
-    return;
+void InMemoryElementStore::beginImport() {
+  pimpl_->beginImport();
+}
 
-  for (const auto &element : it->second) {
-    if (cancelToken.isCancelled())
-      break;
+void InMemoryElementStore::commitImport() {
+  pimpl_->commitImport();
+}
 
-    element->accept(visitor);
-  }
+std::size_t InMemoryElementStore::memoryUsage() const {
+  return pimpl_->memoryUsage();
 }
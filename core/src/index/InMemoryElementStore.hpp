@@ -11,18 +11,46 @@ namespace utymap {
 namespace index {
 
 /// Provides API to store elements in memory.
+/// Elements of each tile are encoded into single contiguous buffer using
+/// element stream format. Optionally, memory usage can be limited: least
+/// recently searched tiles are moved to attached store when budget is exceeded.
 class InMemoryElementStore final : public ElementStore {
  public:
   explicit InMemoryElementStore(const utymap::index::StringTable &stringTable);
 
+  /// Creates store which keeps at most given amount of bytes of element data
+  /// in memory and moves tiles to spill store when the budget is exceeded.
+  InMemoryElementStore(const utymap::index::StringTable &stringTable,
+                       std::size_t memoryBudget,
+                       std::unique_ptr<ElementStore> spillStore);
+
   virtual ~InMemoryElementStore();
 
+  using ElementStore::search;
+
+  void search(const utymap::QuadKey &quadKey,
+              utymap::entities::ElementVisitor &visitor,
+              const utymap::CancellationToken &cancelToken) override;
+
+  /// Searches elements using spatial index of the quadkey.
   void search(const utymap::QuadKey &quadKey,
+              const utymap::BoundingBox &bbox,
               utymap::entities::ElementVisitor &visitor,
               const utymap::CancellationToken &cancelToken) override;
 
   bool hasData(const utymap::QuadKey &quadKey) const override;
 
+  bool hasDescendantData(const utymap::QuadKey &quadKey) const override;
+
+  bool hasAncestorData(const utymap::QuadKey &quadKey) const override;
+
+  void beginImport() override;
+
+  void commitImport() override;
+
+  /// Returns amount of bytes used by element data kept in memory.
+  std::size_t memoryUsage() const;
+
  protected:
   void storeImpl(const utymap::entities::Element &element, const utymap::QuadKey &quadKey) override;
 
@@ -0,0 +1,339 @@
+#include "index/ElementStream.hpp"
+#include "index/PackedElementStore.hpp"
+#include "utils/GeoUtils.hpp"
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+
+using namespace utymap;
+using namespace utymap::index;
+using namespace utymap::entities;
+using namespace utymap::utils;
+
+namespace {
+const std::string DataFileName = "tiles.dat";
+const std::string DirectoryFileName = "tiles.dir";
+
+/// Mask of quadkey code bits which encode tile position.
+const std::uint64_t PositionMask = (std::uint64_t(1) << 48) - 1;
+
+/// Size of buffered tile data which triggers flush to disk.
+const std::size_t MaxPendingSize = 32*1024*1024;
+
+/// Directory entry which points to the block of tile data inside data file.
+struct TileEntry final {
+  std::uint64_t code;
+  std::uint64_t offset;
+  std::uint32_t length;
+};
+
+/// Provides input stream API over memory range.
+class MemoryBuffer final : public std::streambuf {
+ public:
+  MemoryBuffer(const char *begin, const char *end) {
+    setg(const_cast<char *>(begin), const_cast<char *>(begin), const_cast<char *>(end));
+  }
+};
+
+template<typename T>
+void writeValue(std::ostream &stream, const T &value) {
+  stream.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+template<typename T>
+bool readValue(std::istream &stream, T &value) {
+  return static_cast<bool>(stream.read(reinterpret_cast<char *>(&value), sizeof(value)));
+}
+}
+
+class PackedElementStore::PackedElementStoreImpl final {
+  typedef boost::interprocess::mapped_region MappedRegion;
+
+  /// Keeps state of single level of details.
+  struct LodData final {
+    /// True if directory is read from disk.
+    bool isLoaded = false;
+    /// True if directory should be written to disk.
+    bool isChanged = false;
+    /// Tile entries sorted by quadkey code. Tile can have multiple blocks.
+    std::vector<TileEntry> directory;
+    /// Tile data which is not yet written to disk.
+    std::map<std::uint64_t, std::string> pending;
+    /// Memory mapped data file.
+    std::shared_ptr<const MappedRegion> region;
+    /// Format version of elements in data file.
+    ElementStream::Version version = ElementStream::CurrentVersion;
+  };
+
+ public:
+  explicit PackedElementStoreImpl(const std::string &dataPath) :
+      dataPath_(dataPath), sessions_(0), pendingSize_(0), lods_(GeoUtils::MaxLevelOfDetails + 1) {
+  }
+
+  ~PackedElementStoreImpl() {
+    flush();
+  }
+
+  void beginImport() {
+    std::lock_guard<std::mutex> lock(lock_);
+    ++sessions_;
+  }
+
+  void commitImport() {
+    std::lock_guard<std::mutex> lock(lock_);
+    if (sessions_ > 0 && --sessions_==0)
+      flush();
+  }
+
+  void store(const Element &element, const QuadKey &quadKey) {
+    std::lock_guard<std::mutex> lock(lock_);
+
+    auto &lodData = getLodData(quadKey.levelOfDetail);
+    encoder_.str(std::string());
+    writeValue(encoder_, element.id);
+    ElementStream::write(encoder_, element, lodData.version);
+
+    auto data = encoder_.str();
+    lodData.pending[GeoUtils::quadKeyToCode(quadKey)].append(data);
+    pendingSize_ += data.size();
+
+    // NOTE without import session element is written immediately, so it survives crash.
+    if (sessions_==0 || pendingSize_ > MaxPendingSize)
+      flushPending();
+  }
+
+  void search(const QuadKey &quadKey, ElementVisitor &visitor, const utymap::CancellationToken &cancelToken) {
+    std::vector<TileEntry> entries;
+    std::shared_ptr<const MappedRegion> region;
+    ElementStream::Version version;
+    {
+      std::lock_guard<std::mutex> lock(lock_);
+      auto &lodData = getLodData(quadKey.levelOfDetail);
+      auto code = GeoUtils::quadKeyToCode(quadKey);
+
+      // NOTE data of the quadkey can be still buffered by import session.
+      if (lodData.pending.find(code)!=lodData.pending.end())
+        flushPending();
+
+      auto range = findEntries(lodData, code);
+      if (range.first==range.second)
+        return;
+
+      entries.assign(range.first, range.second);
+      region = getRegion(lodData, quadKey.levelOfDetail);
+      version = lodData.version;
+    }
+
+    ElementDecoder decoder;
+    const char *data = static_cast<const char *>(region->get_address());
+    for (const auto &entry : entries) {
+      MemoryBuffer buffer(data + entry.offset, data + entry.offset + entry.length);
+      std::istream stream(&buffer);
+      while (!cancelToken.isCancelled() && stream.peek()!=std::char_traits<char>::eof()) {
+        std::uint64_t id;
+        readValue(stream, id);
+        decoder.read(stream, id, version).accept(visitor);
+      }
+    }
+  }
+
+  bool hasData(const QuadKey &quadKey) {
+    std::lock_guard<std::mutex> lock(lock_);
+    auto &lodData = getLodData(quadKey.levelOfDetail);
+    auto code = GeoUtils::quadKeyToCode(quadKey);
+    auto range = findEntries(lodData, code);
+    return range.first!=range.second || lodData.pending.find(code)!=lodData.pending.end();
+  }
+
+  /// Checks directories of higher levels of details: descendants of the quadkey have
+  /// consecutive codes on each level as position is encoded using z-order curve.
+  bool hasDescendantData(const QuadKey &quadKey) {
+    std::lock_guard<std::mutex> lock(lock_);
+    auto position = GeoUtils::quadKeyToCode(quadKey) & PositionMask;
+    for (int lod = quadKey.levelOfDetail + 1; lod <= GeoUtils::MaxLevelOfDetails; ++lod) {
+      auto shift = 2*static_cast<std::uint64_t>(lod - quadKey.levelOfDetail);
+      auto first = (static_cast<std::uint64_t>(lod) << 48) | (position << shift);
+      auto last = first + (std::uint64_t(1) << shift);
+
+      auto &lodData = getLodData(lod);
+      auto entry = std::lower_bound(lodData.directory.cbegin(), lodData.directory.cend(), TileEntry{first, 0, 0},
+                                    [](const TileEntry &lhs, const TileEntry &rhs) { return lhs.code < rhs.code; });
+      auto pending = lodData.pending.lower_bound(first);
+      if ((entry!=lodData.directory.cend() && entry->code < last) ||
+          (pending!=lodData.pending.end() && pending->first < last))
+        return true;
+    }
+    return false;
+  }
+
+ private:
+  typedef std::vector<TileEntry>::const_iterator EntryIterator;
+
+  /// Gets data of given level of details reading directory from disk if necessary.
+  LodData &getLodData(int levelOfDetail) {
+    auto &lodData = lods_.at(static_cast<std::size_t>(levelOfDetail));
+    if (!lodData.isLoaded) {
+      readDirectory(lodData, levelOfDetail);
+      readVersion(lodData, levelOfDetail);
+      lodData.isLoaded = true;
+    }
+    return lodData;
+  }
+
+  /// Finds directory entries of the tile using binary search.
+  static std::pair<EntryIterator, EntryIterator> findEntries(const LodData &lodData, std::uint64_t code) {
+    return std::equal_range(lodData.directory.cbegin(), lodData.directory.cend(), TileEntry{code, 0, 0},
+                            [](const TileEntry &lhs, const TileEntry &rhs) { return lhs.code < rhs.code; });
+  }
+
+  /// Gets memory mapped data file of given level of details.
+  std::shared_ptr<const MappedRegion> getRegion(LodData &lodData, int levelOfDetail) const {
+    if (lodData.region==nullptr) {
+      using namespace boost::interprocess;
+      file_mapping mapping(getFilePath(levelOfDetail, DataFileName).c_str(), read_only);
+      lodData.region = std::make_shared<const MappedRegion>(mapping, read_only);
+    }
+    return lodData.region;
+  }
+
+  /// Writes all buffered data and changed directories to disk.
+  void flush() {
+    flushPending();
+    for (std::size_t lod = 0; lod < lods_.size(); ++lod) {
+      if (lods_[lod].isChanged) {
+        writeDirectory(lods_[lod], static_cast<int>(lod));
+        lods_[lod].isChanged = false;
+      }
+    }
+  }
+
+  /// Appends buffered tile data to data files. Within import session, directories are kept in
+  /// memory till commit, otherwise new entries are appended to directory files.
+  void flushPending() {
+    for (std::size_t lod = 0; lod < lods_.size(); ++lod) {
+      auto &lodData = lods_[lod];
+      if (lodData.pending.empty()) continue;
+
+      // NOTE data file is remapped on next read.
+      lodData.region.reset();
+
+      std::ofstream dataFile(getFilePath(static_cast<int>(lod), DataFileName),
+                             std::ios::out | std::ios::binary | std::ios::app | std::ios::ate);
+      if (dataFile.tellp()==0)
+        ElementStream::writeHeader(dataFile, lodData.version);
+      auto offset = static_cast<std::uint64_t>(dataFile.tellp());
+      std::vector<TileEntry> entries;
+      // NOTE pending map is sorted, so blocks are written in quadkey order.
+      for (const auto &pair : lodData.pending) {
+        dataFile.write(pair.second.data(), pair.second.size());
+        auto length = static_cast<std::uint32_t>(pair.second.size());
+        entries.push_back(TileEntry{pair.first, offset, length});
+        offset += length;
+      }
+      dataFile.close();
+
+      if (sessions_==0)
+        appendDirectory(entries, static_cast<int>(lod));
+      else
+        lodData.isChanged = true;
+      lodData.directory.insert(lodData.directory.end(), entries.begin(), entries.end());
+
+      // NOTE stable sort keeps older blocks of the same tile first.
+      std::stable_sort(lodData.directory.begin(), lodData.directory.end(),
+                       [](const TileEntry &lhs, const TileEntry &rhs) { return lhs.code < rhs.code; });
+      lodData.pending.clear();
+    }
+    pendingSize_ = 0;
+  }
+
+  void readDirectory(LodData &lodData, int levelOfDetail) const {
+    std::ifstream file(getFilePath(levelOfDetail, DirectoryFileName), std::ios::in | std::ios::binary);
+    TileEntry entry;
+    while (readValue(file, entry.code) && readValue(file, entry.offset) && readValue(file, entry.length))
+      lodData.directory.push_back(entry);
+
+    // NOTE entries appended outside of import session are not sorted.
+    std::stable_sort(lodData.directory.begin(), lodData.directory.end(),
+                     [](const TileEntry &lhs, const TileEntry &rhs) { return lhs.code < rhs.code; });
+  }
+
+  /// Reads format version from existing data file, new files use current one.
+  void readVersion(LodData &lodData, int levelOfDetail) const {
+    std::ifstream file(getFilePath(levelOfDetail, DataFileName), std::ios::in | std::ios::binary);
+    if (file.good() && file.peek()!=std::char_traits<char>::eof())
+      lodData.version = ElementStream::readHeader(file);
+  }
+
+  void writeDirectory(const LodData &lodData, int levelOfDetail) const {
+    std::ofstream file(getFilePath(levelOfDetail, DirectoryFileName),
+                       std::ios::out | std::ios::binary | std::ios::trunc);
+    writeEntries(file, lodData.directory);
+  }
+
+  void appendDirectory(const std::vector<TileEntry> &entries, int levelOfDetail) const {
+    std::ofstream file(getFilePath(levelOfDetail, DirectoryFileName),
+                       std::ios::out | std::ios::binary | std::ios::app);
+    writeEntries(file, entries);
+  }
+
+  static void writeEntries(std::ostream &stream, const std::vector<TileEntry> &entries) {
+    for (const auto &entry : entries) {
+      writeValue(stream, entry.code);
+      writeValue(stream, entry.offset);
+      writeValue(stream, entry.length);
+    }
+  }
+
+  /// Gets full file path for given level of details.
+  std::string getFilePath(int levelOfDetail, const std::string &fileName) const {
+    std::stringstream ss;
+    ss << dataPath_ << "data/" << levelOfDetail << "/" << fileName;
+    return ss.str();
+  }
+
+  const std::string dataPath_;
+  int sessions_;
+  std::size_t pendingSize_;
+  std::vector<LodData> lods_;
+  std::ostringstream encoder_;
+  std::mutex lock_;
+};
+
+PackedElementStore::PackedElementStore(const std::string &dataPath, const StringTable &stringTable) :
+    ElementStore(stringTable), pimpl_(utymap::utils::make_unique<PackedElementStoreImpl>(dataPath)) {
+}
+
+PackedElementStore::~PackedElementStore() {
+}
+
+void PackedElementStore::beginImport() {
+  pimpl_->beginImport();
+}
+
+void PackedElementStore::commitImport() {
+  pimpl_->commitImport();
+}
+
+void PackedElementStore::storeImpl(const Element &element, const QuadKey &quadKey) {
+  pimpl_->store(element, quadKey);
+}
+
+void PackedElementStore::search(const QuadKey &quadKey,
+                                ElementVisitor &visitor,
+                                const utymap::CancellationToken &cancelToken) {
+  pimpl_->search(quadKey, visitor, cancelToken);
+}
+
+bool PackedElementStore::hasData(const QuadKey &quadKey) const {
+  return pimpl_->hasData(quadKey);
+}
+
+bool PackedElementStore::hasDescendantData(const QuadKey &quadKey) const {
+  return pimpl_->hasDescendantData(quadKey);
+}
@@ -0,0 +1,51 @@
+#ifndef INDEX_PACKEDELEMENTSTORE_HPP_DEFINED
+#define INDEX_PACKEDELEMENTSTORE_HPP_DEFINED
+
+#include "QuadKey.hpp"
+#include "entities/Element.hpp"
+#include "index/ElementStore.hpp"
+
+#include <memory>
+
+namespace utymap {
+namespace index {
+
+/// Provides API to store elements in persistent store which keeps all tiles
+/// of one level of details in a single append-only data file.
+/// Data file is accompanied by sorted directory of quadkey->(offset, length)
+/// entries and is memory mapped for reading. Within import session, stored data is buffered
+/// in memory and written to disk in batches, directory is rewritten on commit. Outside of
+/// session, data is written immediately and its entry is appended to directory.
+class PackedElementStore final : public ElementStore {
+ public:
+  explicit PackedElementStore(const std::string &path,
+                              const utymap::index::StringTable &stringTable);
+
+  virtual ~PackedElementStore();
+
+  using ElementStore::search;
+
+  void search(const utymap::QuadKey &quadKey,
+              utymap::entities::ElementVisitor &visitor,
+              const utymap::CancellationToken &cancelToken) override;
+
+  bool hasData(const utymap::QuadKey &quadKey) const override;
+
+  bool hasDescendantData(const utymap::QuadKey &quadKey) const override;
+
+  void beginImport() override;
+
+  void commitImport() override;
+
+ protected:
+  void storeImpl(const utymap::entities::Element &element, const utymap::QuadKey &quadKey) override;
+
+ private:
+  class PackedElementStoreImpl;
+  std::unique_ptr<PackedElementStoreImpl> pimpl_;
+};
+
+}
+}
+
+#endif // INDEX_PACKEDELEMENTSTORE_HPP_DEFINED
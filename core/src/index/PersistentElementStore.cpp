@@ -1,8 +1,21 @@
+#include "index/BoundingBoxVisitor.hpp"
+#include "index/ElementIdIndex.hpp"
 #include "index/ElementStream.hpp"
 #include "index/PersistentElementStore.hpp"
+#include "index/QuadKeyOccupancy.hpp"
+#include "index/SpatialIndex.hpp"
+#include "index/TagIndex.hpp"
+#include "utils/FileUtils.hpp"
+#include "utils/LruCache.hpp"
 
+#include <algorithm>
+#include <cstdio>
 #include <fstream>
 #include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
 
 using namespace utymap;
 using namespace utymap::index;
@@ -13,9 +26,130 @@ using namespace utymap::utils;
 namespace {
 const std::string IndexFileExtension = ".idf";
 const std::string DataFileExtension = ".dat";
+const std::string SpatialIndexFileExtension = ".rtx";
+const std::string TagIndexFileExtension = ".tix";
+/// Extension of files written by compaction before they replace tile files.
+const std::string TempFileExtension = ".tmp";
+/// Keeps codes of quadkeys which have data.
+const std::string ManifestFileName = "occupancy.dat";
+/// Keeps locations of elements by their ids.
+const std::string IdIndexFileName = "ids.dat";
+
+/// Max amount of quadkeys which keep their files open during import session.
+const std::size_t MaxOpenWriters = 128;
+/// Size of index buffer which triggers flush to disk.
+const std::size_t MaxIndexBufferSize = 64*1024;
+/// Size of data file stream buffer.
+const std::size_t DataBufferSize = 64*1024;
+/// Size of index entry: element id and data offset.
+const std::size_t IndexEntrySize = sizeof(std::uint64_t) + sizeof(std::uint32_t);
+/// Data offset of index entry which marks element as erased, lower bits keep element type.
+const std::uint32_t TombstoneOffset = 0xFFFFFF00;
+/// Upper bits of data offset keep type of source element increased by one, so pieces of
+/// clipped way stored as relation are replaced by the next version of the way. Zero means
+/// that entry was written without type, so it is read from element data.
+const int SourceTypeShift = 29;
+const std::uint32_t OffsetMask = (std::uint32_t(1) << SourceTypeShift) - 1;
+/// Source type of index entry written without it.
+const std::uint8_t UnknownType = 0xFF;
+/// Amount of locks which guard tile files, quadkeys are mapped to them by code.
+const std::size_t TileLockCount = 64;
+
+bool isTombstone(std::uint32_t offset) {
+  return offset >= TombstoneOffset;
+}
+
+/// Encodes data offset and type of source element into offset of index entry.
+std::uint32_t encodeOffset(std::uint32_t offset, std::uint8_t type) {
+  if (offset > OffsetMask)
+    throw std::domain_error("Tile data file is too large.");
+  return type==UnknownType ? offset : offset | (static_cast<std::uint32_t>(type + 1) << SourceTypeShift);
+}
+
+/// Writes elements of single quadkey keeping its files open.
+class QuadKeyWriter final {
+ public:
+  QuadKeyWriter(const std::string &dataPath, const std::string &indexPath) :
+      dataBuffer_(DataBufferSize), indexBuffer_() {
+    using std::ios;
+    dataFile_.rdbuf()->pubsetbuf(dataBuffer_.data(), dataBuffer_.size());
+    dataFile_.open(dataPath, ios::out | ios::binary | ios::app | ios::ate);
+    indexFile_.open(indexPath, ios::out | ios::binary | ios::app | ios::ate);
+    if (!dataFile_.good() || !indexFile_.good())
+      throw std::domain_error("Cannot open files of quadkey: " + dataPath);
+    indexBuffer_.reserve(MaxIndexBufferSize);
+    version_ = readVersion(dataPath);
+  }
+
+  QuadKeyWriter(const QuadKeyWriter &) = delete;
+  QuadKeyWriter &operator=(const QuadKeyWriter &) = delete;
+
+  ~QuadKeyWriter() {
+    flush();
+  }
+
+  /// Writes element data and buffers its index entry. Returns offset of element data.
+  std::uint32_t write(const Element &element, std::uint8_t sourceType) {
+    auto offset = static_cast<std::uint32_t>(dataFile_.tellp());
+    if (offset==0) {
+      ElementStream::writeHeader(dataFile_, version_);
+      offset = static_cast<std::uint32_t>(dataFile_.tellp());
+    }
+    ElementStream::write(dataFile_, element, version_);
+
+    append(element.id);
+    append(encodeOffset(offset, sourceType));
+    if (indexBuffer_.size() >= MaxIndexBufferSize)
+      flush();
+    return offset;
+  }
+
+  /// Buffers index entry which marks element as erased.
+  void erase(const Element &element, std::uint8_t sourceType) {
+    std::uint32_t offset = TombstoneOffset + sourceType;
+    append(element.id);
+    append(offset);
+    if (indexBuffer_.size() >= MaxIndexBufferSize)
+      flush();
+  }
+
+  /// Flushes all buffered data to disk.
+  /// NOTE data is flushed first, so index never refers to unwritten data.
+  void flush() {
+    dataFile_.flush();
+    flushIndex();
+  }
+
+ private:
+  template<typename T>
+  void append(const T &value) {
+    const char *bytes = reinterpret_cast<const char *>(&value);
+    indexBuffer_.insert(indexBuffer_.end(), bytes, bytes + sizeof(value));
+  }
+
+  /// Gets format version of existing data file, new files use current one.
+  static ElementStream::Version readVersion(const std::string &dataPath) {
+    std::ifstream file(dataPath, std::ios::in | std::ios::binary);
+    return file.good() && file.peek()!=std::char_traits<char>::eof()
+           ? ElementStream::readHeader(file)
+           : ElementStream::CurrentVersion;
+  }
+
+  void flushIndex() {
+    if (indexBuffer_.empty()) return;
+    indexFile_.write(indexBuffer_.data(), indexBuffer_.size());
+    indexFile_.flush();
+    indexBuffer_.clear();
+  }
+
+  std::vector<char> dataBuffer_;
+  std::vector<char> indexBuffer_;
+  std::ofstream dataFile_;
+  std::ofstream indexFile_;
+  ElementStream::Version version_;
+};
 }
 
-// TODO improve thread safety!
 class PersistentElementStore::PersistentElementStoreImpl final {
   struct QuadKeyData {
     std::unique_ptr<std::fstream> dataFile;
@@ -43,55 +177,508 @@ class PersistentElementStore::PersistentElementStoreImpl final {
     }
   };
 
+  typedef std::shared_ptr<QuadKeyWriter> QuadKeyWriterPtr;
+  /// Id, data offset and type of source element. Erased element has tombstone offset.
+  struct IndexEntry {
+    std::uint64_t id;
+    std::uint32_t offset;
+    std::uint8_t type;
+  };
+  typedef std::vector<IndexEntry> IndexEntries;
+  /// New data offset of element moved by compaction.
+  struct Relocation {
+    std::uint64_t id;
+    std::uint8_t type;
+    std::uint32_t offset;
+  };
+
  public:
   explicit PersistentElementStoreImpl(const std::string &dataPath) :
-      dataPath_(dataPath) {
+      dataPath_(dataPath), sessions_(0), writers_(MaxOpenWriters), idIndex_(dataPath + "data/" + IdIndexFileName) {
+    // NOTE store can be created on fresh path, so its files are not opened before directory exists.
+    createDirectory(dataPath_ + "data/");
+    openManifest();
+  }
+
+  void beginImport() {
+    std::lock_guard<std::mutex> lock(lock_);
+    ++sessions_;
+  }
+
+  void commitImport() {
+    std::lock_guard<std::mutex> lock(lock_);
+    if (sessions_ > 0 && --sessions_==0) {
+      writers_.clear();
+      idIndex_.flush();
+    }
   }
 
+  /// Stores element. Elements of different quadkeys can be stored concurrently.
   void store(const Element &element, const QuadKey &quadKey) {
-    auto quadKeyData = createQuadKeyData(quadKey);
-    auto offset = static_cast<std::uint32_t>(quadKeyData.dataFile->tellg());
+    {
+      std::lock_guard<std::mutex> tileLock(getTileLock(quadKey));
+      auto type = ElementStream::getSourceType(element);
+      auto offset = getWriter(quadKey)->write(element, type);
+      idIndex_.add(element.id, type, quadKey, offset);
+    }
+    if (occupancy_.add(quadKey))
+      addToManifest(quadKey);
+    flushIdIndex();
+  }
 
-    // write element index
-    quadKeyData.indexFile->seekg(0, std::ios::end);
-    quadKeyData.indexFile->write(reinterpret_cast<const char *>(&element.id), sizeof(element.id));
-    quadKeyData.indexFile->write(reinterpret_cast<const char *>(&offset), sizeof(offset));
+  /// Marks element as erased in given quadkey.
+  void erase(const Element &element, const QuadKey &quadKey) {
+    {
+      std::lock_guard<std::mutex> tileLock(getTileLock(quadKey));
+      auto type = ElementStream::getSourceType(element);
+      getWriter(quadKey)->erase(element, type);
+      idIndex_.remove(element.id, type, quadKey);
+    }
+    flushIdIndex();
+  }
 
-    // write element data
-    quadKeyData.dataFile->seekg(0, std::ios::end);
-    ElementStream::write(*quadKeyData.dataFile, element);
+  /// Visits elements with given id stored in quadkeys of given level of details.
+  void find(std::uint64_t id, int levelOfDetail, ElementVisitor &visitor,
+            const utymap::CancellationToken &cancelToken) {
+    std::set<std::uint64_t> codes;
+    for (const auto &location : idIndex_.find(id)) {
+      if (GeoUtils::codeToQuadKey(location.code).levelOfDetail==levelOfDetail)
+        codes.insert(location.code);
+    }
+
+    ElementDecoder decoder;
+    for (auto code : codes) {
+      if (cancelToken.isCancelled()) break;
+
+      auto quadKey = GeoUtils::codeToQuadKey(code);
+      std::vector<std::uint32_t> offsets;
+      auto quadKeyData = openQuadKeyData(quadKey, [&]() {
+        // NOTE offsets are taken under tile lock as compaction moves element data.
+        for (const auto &location : idIndex_.find(id)) {
+          if (location.code==code)
+            offsets.push_back(location.offset);
+        }
+      });
+      if (offsets.empty()) continue;
+
+      quadKeyData.dataFile->seekg(0, std::ios::beg);
+      auto version = ElementStream::readHeader(*quadKeyData.dataFile);
+      for (auto offset : offsets) {
+        quadKeyData.dataFile->seekg(offset, std::ios::beg);
+        decoder.read(*quadKeyData.dataFile, id, version).accept(visitor);
+      }
+    }
+  }
+
+  /// Checks whether element with the same id and kind is stored.
+  bool contains(const Element &element) {
+    return idIndex_.contains(element.id, ElementStream::getSourceType(element));
+  }
+
+  /// Gets quadkeys of given level of details where element with the same id and kind is stored.
+  void locate(const Element &element, int levelOfDetail, std::vector<QuadKey> &quadKeys) {
+    auto type = ElementStream::getSourceType(element);
+    for (const auto &location : idIndex_.find(element.id)) {
+      auto quadKey = GeoUtils::codeToQuadKey(location.code);
+      if (location.type==type && quadKey.levelOfDetail==levelOfDetail)
+        quadKeys.push_back(quadKey);
+    }
   }
 
   void search(const QuadKey &quadKey, ElementVisitor &visitor, const utymap::CancellationToken &cancelToken) {
-    auto quadKeyData = createQuadKeyData(quadKey);
-    auto count = static_cast<std::uint32_t>(quadKeyData.indexFile->tellg()/
-        (sizeof(std::uint64_t) + sizeof(std::uint32_t)));
+    auto quadKeyData = openQuadKeyData(quadKey);
+    auto entries = readIndexEntries(*quadKeyData.indexFile);
+    quadKeyData.dataFile->seekg(0, std::ios::beg);
+    auto version = ElementStream::readHeader(*quadKeyData.dataFile);
+    auto live = getLiveEntries(entries, *quadKeyData.dataFile);
 
-    quadKeyData.indexFile->seekg(0, std::ios::beg);
-    for (std::uint32_t i = 0; i < count; ++i) {
+    ElementDecoder decoder;
+    for (std::size_t i = 0; i < entries.size(); ++i) {
       if (cancelToken.isCancelled()) break;
+      if (!live[i]) continue;
+
+      quadKeyData.dataFile->seekg(entries[i].offset, std::ios::beg);
+      decoder.read(*quadKeyData.dataFile, entries[i].id, version).accept(visitor);
+    }
+  }
+
+  void search(const QuadKey &quadKey,
+              const BoundingBox &bbox,
+              ElementVisitor &visitor,
+              const utymap::CancellationToken &cancelToken) {
+    auto quadKeyData = openQuadKeyData(quadKey);
+    auto entries = readIndexEntries(*quadKeyData.indexFile);
+    quadKeyData.dataFile->seekg(0, std::ios::beg);
+    auto version = ElementStream::readHeader(*quadKeyData.dataFile);
+    auto live = getLiveEntries(entries, *quadKeyData.dataFile);
 
-      std::uint64_t id;
-      std::uint32_t offset;
-      quadKeyData.indexFile->read(reinterpret_cast<char *>(&id), sizeof(id));
-      quadKeyData.indexFile->read(reinterpret_cast<char *>(&offset), sizeof(offset));
-      quadKeyData.dataFile->seekg(offset, std::ios::beg);
+    ElementDecoder decoder;
+    auto index = getTileIndex<SpatialIndex>(quadKey, SpatialIndexFileExtension, *quadKeyData.dataFile, entries,
+                                            live, version, [](const Element &element, std::uint32_t item) {
+          return SpatialIndex::Entry{BoundingBoxVisitor::create(element), item};
+        });
+    index.query(bbox, [&](std::uint32_t item) {
+      if (cancelToken.isCancelled()) return;
+      quadKeyData.dataFile->seekg(entries[item].offset, std::ios::beg);
+      decoder.read(*quadKeyData.dataFile, entries[item].id, version).accept(visitor);
+    });
+  }
+
+  void search(const QuadKey &quadKey,
+              const TagFilter &filter,
+              ElementVisitor &visitor,
+              const utymap::CancellationToken &cancelToken) {
+    auto quadKeyData = openQuadKeyData(quadKey);
+    auto entries = readIndexEntries(*quadKeyData.indexFile);
+    quadKeyData.dataFile->seekg(0, std::ios::beg);
+    auto version = ElementStream::readHeader(*quadKeyData.dataFile);
+    auto live = getLiveEntries(entries, *quadKeyData.dataFile);
 
-      ElementStream::read(*quadKeyData.dataFile, id)->accept(visitor);
+    ElementDecoder decoder;
+    auto index = getTileIndex<TagIndex>(quadKey, TagIndexFileExtension, *quadKeyData.dataFile, entries,
+                                        live, version, [](const Element &element, std::uint32_t item) {
+          return TagIndex::Entry{element.tags, item};
+        });
+    for (auto item : index.query(filter)) {
+      if (cancelToken.isCancelled()) break;
+
+      quadKeyData.dataFile->seekg(entries[item].offset, std::ios::beg);
+      const auto &element = decoder.read(*quadKeyData.dataFile, entries[item].id, version);
+      // NOTE index can find elements only by key when key has too many values.
+      if (filter.matches(element.tags))
+        element.accept(visitor);
     }
   }
 
   bool hasData(const QuadKey &quadKey) const {
-    std::ifstream file(getFilePath(quadKey, DataFileExtension));
-    return file.good();
+    return occupancy_.hasData(quadKey);
+  }
+
+  bool hasDescendantData(const QuadKey &quadKey) const {
+    return occupancy_.hasDescendantData(quadKey);
+  }
+
+  bool hasAncestorData(const QuadKey &quadKey) const {
+    return occupancy_.hasAncestorData(quadKey);
+  }
+
+  std::size_t compact(const CompactionOptions &options, const utymap::CancellationToken &cancelToken) {
+    std::size_t count = 0;
+    for (const auto &quadKey : occupancy_.getQuadKeys()) {
+      if (cancelToken.isCancelled()) break;
+      if (!compact(quadKey, options.minGarbageRatio)) continue;
+
+      ++count;
+      if (options.pause.count() > 0)
+        std::this_thread::sleep_for(options.pause);
+    }
+    if (!cancelToken.isCancelled())
+      idIndex_.compact();
+    return count;
   }
 
  private:
+  /// Rewrites files of the quadkey keeping only live elements if share of garbage entries is big enough.
+  bool compact(const QuadKey &quadKey, double minGarbageRatio) {
+    std::lock_guard<std::mutex> tileLock(getTileLock(quadKey));
+    {
+      // NOTE writer keeps old files open, so it is closed here and recreated by next store.
+      std::lock_guard<std::mutex> lock(lock_);
+      writers_.remove(quadKey);
+    }
+
+    auto dataPath = getFilePath(quadKey, DataFileExtension);
+    auto indexPath = getFilePath(quadKey, IndexFileExtension);
+    std::vector<Relocation> relocated;
+    {
+      std::ifstream dataFile(dataPath, std::ios::in | std::ios::binary);
+      std::ifstream indexFile(indexPath, std::ios::in | std::ios::binary);
+      if (!dataFile.good() || !indexFile.good())
+        return false;
+
+      auto entries = readIndexEntries(indexFile);
+      auto live = getLiveEntries(entries, dataFile);
+      auto garbage = static_cast<std::size_t>(std::count(live.begin(), live.end(), false));
+      if (garbage==0 || garbage < minGarbageRatio*entries.size())
+        return false;
+
+      // NOTE element data ends where data of the next one in the file starts.
+      std::vector<std::uint32_t> offsets;
+      for (const auto &entry : entries) {
+        if (!isTombstone(entry.offset))
+          offsets.push_back(entry.offset);
+      }
+      std::sort(offsets.begin(), offsets.end());
+      dataFile.seekg(0, std::ios::end);
+      auto dataSize = static_cast<std::uint32_t>(dataFile.tellg());
+
+      std::ofstream newDataFile(dataPath + TempFileExtension, std::ios::out | std::ios::binary | std::ios::trunc);
+      std::ofstream newIndexFile(indexPath + TempFileExtension, std::ios::out | std::ios::binary | std::ios::trunc);
+      std::vector<char> buffer;
+      relocated.reserve(entries.size());
+      copyData(dataFile, newDataFile, 0, offsets.empty() ? dataSize : offsets.front(), buffer);
+      for (std::size_t i = 0; i < entries.size(); ++i) {
+        if (!live[i]) continue;
+
+        auto next = std::upper_bound(offsets.begin(), offsets.end(), entries[i].offset);
+        auto offset = static_cast<std::uint32_t>(newDataFile.tellp());
+        copyData(dataFile, newDataFile, entries[i].offset, (next==offsets.end() ? dataSize : *next) - entries[i].offset,
+                 buffer);
+        auto type = entries[i].type;
+        if (type==UnknownType) {
+          dataFile.seekg(entries[i].offset, std::ios::beg);
+          type = static_cast<std::uint8_t>(dataFile.get());
+        }
+        auto encodedOffset = encodeOffset(offset, type);
+        newIndexFile.write(reinterpret_cast<const char *>(&entries[i].id), sizeof(entries[i].id));
+        newIndexFile.write(reinterpret_cast<const char *>(&encodedOffset), sizeof(encodedOffset));
+        relocated.push_back(Relocation{entries[i].id, type, offset});
+      }
+    }
+
+    // NOTE data file is replaced first: it is still valid for old index as long as index is not replaced.
+    if (!replaceFile(dataPath + TempFileExtension, dataPath)) {
+      std::remove((dataPath + TempFileExtension).c_str());
+      std::remove((indexPath + TempFileExtension).c_str());
+      return false;
+    }
+    if (!replaceFile(indexPath + TempFileExtension, indexPath))
+      throw std::domain_error("Cannot replace index file of compacted quadkey: " + indexPath);
+
+    std::remove(getFilePath(quadKey, SpatialIndexFileExtension).c_str());
+    std::remove(getFilePath(quadKey, TagIndexFileExtension).c_str());
+    for (const auto &relocation : relocated)
+      idIndex_.add(relocation.id, relocation.type, quadKey, relocation.offset);
+    return true;
+  }
+
+  /// Gets lock which guards files of the quadkey: they are replaced by compaction,
+  /// so they should not be opened or written at the same time.
+  std::mutex &getTileLock(const QuadKey &quadKey) const {
+    return tileLocks_[GeoUtils::quadKeyToCode(quadKey)%TileLockCount];
+  }
+
+  /// Gets writer for given quadkey. Within import session, writer is kept open.
+  QuadKeyWriterPtr getWriter(const QuadKey &quadKey) {
+    std::lock_guard<std::mutex> lock(lock_);
+    if (sessions_==0)
+      return createWriter(quadKey);
+
+    if (!writers_.exists(quadKey))
+      writers_.put(quadKey, createWriter(quadKey));
+
+    return writers_.get(quadKey);
+  }
+
+  /// Loads occupancy from manifest. Store created by version without manifest has no
+  /// manifest or has incomplete one, so it is rebuilt once from tile files on disk.
+  void openManifest() {
+    auto path = dataPath_ + "data/" + ManifestFileName;
+    bool isComplete = false;
+    {
+      std::ifstream file(path, std::ios::in | std::ios::binary);
+      char flag;
+      if (file.get(flag) && flag!=0) {
+        isComplete = true;
+        std::uint64_t code;
+        while (file.read(reinterpret_cast<char *>(&code), sizeof(code)))
+          occupancy_.add(GeoUtils::codeToQuadKey(code));
+      }
+    }
+
+    if (isComplete) {
+      manifest_.open(path, std::ios::out | std::ios::binary | std::ios::app);
+      return;
+    }
+
+    manifest_.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    manifest_.put(static_cast<char>(true));
+    for (int lod = 1; lod <= GeoUtils::MaxLevelOfDetails; ++lod) {
+      std::stringstream ss;
+      ss << dataPath_ << "data/" << lod << "/";
+      for (const auto &name : FileUtils::getEntryNames(ss.str())) {
+        QuadKey quadKey;
+        if (endsWith(name, DataFileExtension) &&
+            GeoUtils::stringToQuadKey(name.substr(0, name.size() - DataFileExtension.size()), quadKey) &&
+            quadKey.levelOfDetail==lod && occupancy_.add(quadKey))
+          writeManifestEntry(quadKey);
+      }
+    }
+    manifest_.flush();
+  }
+
+  /// Appends quadkey to manifest.
+  void addToManifest(const QuadKey &quadKey) {
+    std::lock_guard<std::mutex> lock(lock_);
+    writeManifestEntry(quadKey);
+    manifest_.flush();
+  }
+
+  /// Writes manifest entry. Should be called under lock.
+  void writeManifestEntry(const QuadKey &quadKey) {
+    auto code = GeoUtils::quadKeyToCode(quadKey);
+    manifest_.write(reinterpret_cast<const char *>(&code), sizeof(code));
+  }
+
+  /// Opens files of the quadkey flushing its data buffered by import session.
+  QuadKeyData openQuadKeyData(const QuadKey &quadKey) {
+    return openQuadKeyData(quadKey, []() {});
+  }
+
+  /// Opens files of the quadkey calling given function under the same tile lock.
+  template<typename Function>
+  QuadKeyData openQuadKeyData(const QuadKey &quadKey, const Function &function) {
+    std::lock_guard<std::mutex> tileLock(getTileLock(quadKey));
+    flush(quadKey);
+    function();
+    return createQuadKeyData(quadKey);
+  }
+
+  /// Flushes id index if there is no import session which buffers writes.
+  void flushIdIndex() {
+    std::lock_guard<std::mutex> lock(lock_);
+    if (sessions_==0)
+      idIndex_.flush();
+  }
+
+  /// Flushes data of the quadkey which can be still buffered by import session.
+  void flush(const QuadKey &quadKey) {
+    std::lock_guard<std::mutex> lock(lock_);
+    if (sessions_ > 0 && writers_.exists(quadKey))
+      writers_.get(quadKey)->flush();
+  }
+
+  /// Creates writer for given quadkey.
+  QuadKeyWriterPtr createWriter(const QuadKey &quadKey) const {
+    std::stringstream ss;
+    ss << dataPath_ << "data/" << quadKey.levelOfDetail << "/";
+    createDirectory(ss.str());
+    return std::make_shared<QuadKeyWriter>(getFilePath(quadKey, DataFileExtension),
+                                           getFilePath(quadKey, IndexFileExtension));
+  }
+
+  /// Reads all entries of index file.
+  static IndexEntries readIndexEntries(std::istream &indexFile) {
+    IndexEntries entries;
+    indexFile.seekg(0, std::ios::beg);
+    std::uint64_t id;
+    std::uint32_t offset;
+    while (indexFile.read(reinterpret_cast<char *>(&id), sizeof(id)) &&
+        indexFile.read(reinterpret_cast<char *>(&offset), sizeof(offset))) {
+      if (isTombstone(offset)) {
+        entries.push_back(IndexEntry{id, offset, static_cast<std::uint8_t>(offset - TombstoneOffset)});
+        continue;
+      }
+      auto typeBits = offset >> SourceTypeShift;
+      entries.push_back(IndexEntry{id, offset & OffsetMask,
+                                   typeBits==0 ? UnknownType : static_cast<std::uint8_t>(typeBits - 1)});
+    }
+    indexFile.clear();
+    return entries;
+  }
+
+  /// Finds entries which are neither superseded by later entry of the same element nor erased.
+  /// Entries are matched by id and type of source element. Elements without id, e.g. from
+  /// shape files, are never superseded.
+  /// NOTE type is read from data only for entries written without it.
+  static std::vector<bool> getLiveEntries(const IndexEntries &entries, std::istream &dataFile) {
+    std::vector<bool> live(entries.size(), true);
+    std::unordered_map<std::uint64_t, std::uint32_t> counts;
+    bool hasGarbage = false;
+    for (const auto &entry : entries)
+      hasGarbage |= (entry.id!=0 && ++counts[entry.id] > 1) || isTombstone(entry.offset);
+
+    if (!hasGarbage)
+      return live;
+
+    std::set<std::pair<std::uint64_t, std::uint8_t>> visited;
+    for (std::size_t i = entries.size(); i-- > 0;) {
+      const auto &entry = entries[i];
+      if (isTombstone(entry.offset)) {
+        live[i] = false;
+        visited.insert(std::make_pair(entry.id, entry.type));
+      } else if (entry.id!=0 && counts[entry.id] > 1) {
+        auto type = entry.type;
+        if (type==UnknownType) {
+          dataFile.seekg(entry.offset, std::ios::beg);
+          type = static_cast<std::uint8_t>(dataFile.get());
+        }
+        live[i] = visited.insert(std::make_pair(entry.id, type)).second;
+      }
+    }
+    dataFile.clear();
+    return live;
+  }
+
+  /// Copies given range of input stream to output one.
+  static void copyData(std::istream &input, std::ostream &output, std::uint32_t offset, std::uint32_t size,
+                       std::vector<char> &buffer) {
+    buffer.resize(size);
+    input.seekg(offset, std::ios::beg);
+    input.read(buffer.data(), size);
+    output.write(buffer.data(), size);
+  }
+
+  /// Replaces target file with source one.
+  static bool replaceFile(const std::string &source, const std::string &target) {
+    // NOTE rename does not overwrite existing file on some platforms.
+    return std::rename(source.c_str(), target.c_str())==0 ||
+        (std::remove(target.c_str())==0 && std::rename(source.c_str(), target.c_str())==0);
+  }
+
+  /// Reads index of the quadkey stored in file with given extension. If it is missing
+  /// or outdated, then builds it from live elements and writes it to disk.
+  template<typename Index, typename EntryFactory>
+  Index getTileIndex(const QuadKey &quadKey,
+                     const std::string &extension,
+                     std::istream &dataFile,
+                     const IndexEntries &entries,
+                     const std::vector<bool> &live,
+                     ElementStream::Version version,
+                     const EntryFactory &createEntry) const {
+    auto path = getFilePath(quadKey, extension);
+    {
+      std::ifstream file(path, std::ios::in | std::ios::binary);
+      std::uint32_t count;
+      if (file.read(reinterpret_cast<char *>(&count), sizeof(count)) && count==entries.size())
+        return Index::read(file);
+    }
+
+    ElementDecoder decoder;
+    std::vector<typename Index::Entry> indexEntries;
+    indexEntries.reserve(entries.size());
+    for (std::size_t i = 0; i < entries.size(); ++i) {
+      if (!live[i]) continue;
+      dataFile.seekg(entries[i].offset, std::ios::beg);
+      indexEntries.push_back(createEntry(decoder.read(dataFile, entries[i].id, version),
+                                         static_cast<std::uint32_t>(i)));
+    }
+
+    Index index(std::move(indexEntries));
+    // NOTE index is not saved if files are changed while it is built: tile could be compacted.
+    std::lock_guard<std::mutex> tileLock(getTileLock(quadKey));
+    std::ifstream indexFile(getFilePath(quadKey, IndexFileExtension), std::ios::in | std::ios::binary | std::ios::ate);
+    if (static_cast<std::size_t>(indexFile.tellg())!=entries.size()*IndexEntrySize)
+      return index;
+
+    std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    auto count = static_cast<std::uint32_t>(entries.size());
+    file.write(reinterpret_cast<const char *>(&count), sizeof(count));
+    index.write(file);
+    return index;
+  }
+
   /// Creates quadkey data.
   QuadKeyData createQuadKeyData(const QuadKey &quadKey) const {
     return QuadKeyData(getFilePath(quadKey, DataFileExtension), getFilePath(quadKey, IndexFileExtension));
   }
 
+  /// Creates directory if it does not exist.
+  static void createDirectory(const std::string &path) {
+    if (!FileUtils::createDirectories(path))
+      throw std::domain_error("Cannot create directory: " + path);
+  }
+
   /// Gets full file path for given quadkey
   std::string getFilePath(const QuadKey &quadKey, const std::string &extension) const {
     std::stringstream ss;
@@ -100,6 +687,13 @@ class PersistentElementStore::PersistentElementStoreImpl final {
   }
 
   const std::string dataPath_;
+  int sessions_;
+  utymap::utils::LruCache<QuadKey, QuadKeyWriterPtr, QuadKey::Comparator> writers_;
+  ElementIdIndex idIndex_;
+  QuadKeyOccupancy occupancy_;
+  std::ofstream manifest_;
+  std::mutex lock_;
+  mutable std::mutex tileLocks_[TileLockCount];
 };
 
 PersistentElementStore::PersistentElementStore(const std::string &dataPath, const StringTable &stringTable) :
@@ -109,16 +703,74 @@ PersistentElementStore::PersistentElementStore(const std::string &dataPath, cons
 PersistentElementStore::~PersistentElementStore() {
 }
 
+void PersistentElementStore::beginImport() {
+  pimpl_->beginImport();
+}
+
+void PersistentElementStore::commitImport() {
+  pimpl_->commitImport();
+}
+
 void PersistentElementStore::storeImpl(const Element &element, const QuadKey &quadKey) {
   pimpl_->store(element, quadKey);
 }
 
+void PersistentElementStore::eraseImpl(const Element &element, const QuadKey &quadKey) {
+  pimpl_->erase(element, quadKey);
+}
+
+void PersistentElementStore::find(std::uint64_t id,
+                                  int levelOfDetail,
+                                  ElementVisitor &visitor,
+                                  const utymap::CancellationToken &cancelToken) {
+  pimpl_->find(id, levelOfDetail, visitor, cancelToken);
+}
+
+bool PersistentElementStore::contains(const Element &element) const {
+  return pimpl_->contains(element);
+}
+
+bool PersistentElementStore::locate(const Element &element,
+                                    int levelOfDetail,
+                                    std::vector<QuadKey> &quadKeys) const {
+  auto size = quadKeys.size();
+  pimpl_->locate(element, levelOfDetail, quadKeys);
+  return quadKeys.size() > size;
+}
+
+std::size_t PersistentElementStore::compact(const CompactionOptions &options,
+                                            const utymap::CancellationToken &cancelToken) {
+  return pimpl_->compact(options, cancelToken);
+}
+
 void PersistentElementStore::search(const QuadKey &quadKey,
                                     ElementVisitor &visitor,
                                     const utymap::CancellationToken &cancelToken) {
   pimpl_->search(quadKey, visitor, cancelToken);
 }
 
+void PersistentElementStore::search(const QuadKey &quadKey,
+                                    const BoundingBox &bbox,
+                                    ElementVisitor &visitor,
+                                    const utymap::CancellationToken &cancelToken) {
+  pimpl_->search(quadKey, bbox, visitor, cancelToken);
+}
+
+void PersistentElementStore::search(const QuadKey &quadKey,
+                                    const TagFilter &filter,
+                                    ElementVisitor &visitor,
+                                    const utymap::CancellationToken &cancelToken) {
+  pimpl_->search(quadKey, filter, visitor, cancelToken);
+}
+
 bool PersistentElementStore::hasData(const QuadKey &quadKey) const {
   return pimpl_->hasData(quadKey);
 }
+
+bool PersistentElementStore::hasDescendantData(const QuadKey &quadKey) const {
+  return pimpl_->hasDescendantData(quadKey);
+}
+
+bool PersistentElementStore::hasAncestorData(const QuadKey &quadKey) const {
+  return pimpl_->hasAncestorData(quadKey);
+}
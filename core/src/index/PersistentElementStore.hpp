@@ -3,6 +3,7 @@
 
 #include "QuadKey.hpp"
 #include "entities/Element.hpp"
+#include "index/CompactionOptions.hpp"
 #include "index/ElementStore.hpp"
 
 #include <memory>
@@ -11,6 +12,16 @@ namespace utymap {
 namespace index {
 
 /// Provides API to store elements in persistent store.
+/// Each tile has data and index files; spatial and tag index files are built on
+/// first bounding box or tag search and rebuilt when tile data changes. Quadkeys with data
+/// are kept in manifest file which is loaded on creation or rebuilt from tile files once
+/// if store was created without it.
+/// Index is append-only: element stored again in the same tile replaces previous
+/// version with the same id and kind, erased element is marked by tombstone entry. Kind of
+/// clipped element is the kind of its source, so pieces of way are replaced by next version
+/// of the way. Elements without id are never replaced.
+/// Superseded data is skipped at read time and removed by compaction.
+/// Locations of elements are tracked by id index which is kept in separate file.
 class PersistentElementStore final : public ElementStore {
  public:
   explicit PersistentElementStore(const std::string &path,
@@ -22,11 +33,54 @@ class PersistentElementStore final : public ElementStore {
               utymap::entities::ElementVisitor &visitor,
               const utymap::CancellationToken &cancelToken) override;
 
+  /// Searches elements using spatial index of the quadkey.
+  void search(const utymap::QuadKey &quadKey,
+              const utymap::BoundingBox &bbox,
+              utymap::entities::ElementVisitor &visitor,
+              const utymap::CancellationToken &cancelToken) override;
+
+  /// Searches elements using tag index of the quadkey.
+  void search(const utymap::QuadKey &quadKey,
+              const utymap::index::TagFilter &filter,
+              utymap::entities::ElementVisitor &visitor,
+              const utymap::CancellationToken &cancelToken) override;
+
+  /// Checks data using in-memory occupancy loaded from manifest.
   bool hasData(const utymap::QuadKey &quadKey) const override;
 
+  bool hasDescendantData(const utymap::QuadKey &quadKey) const override;
+
+  bool hasAncestorData(const utymap::QuadKey &quadKey) const override;
+
+  void beginImport() override;
+
+  void commitImport() override;
+
+  /// Finds elements using id index.
+  void find(std::uint64_t id,
+            int levelOfDetail,
+            utymap::entities::ElementVisitor &visitor,
+            const utymap::CancellationToken &cancelToken) override;
+
+  bool contains(const utymap::entities::Element &element) const override;
+
+  bool canErase() const override { return true; }
+
+  /// Locates element using id index.
+  bool locate(const utymap::entities::Element &element,
+              int levelOfDetail,
+              std::vector<utymap::QuadKey> &quadKeys) const override;
+
+  /// Rewrites tiles which have enough superseded or erased entries keeping only live
+  /// elements. Can be run in background thread concurrently with store and search.
+  /// Returns amount of rewritten tiles.
+  std::size_t compact(const CompactionOptions &options, const utymap::CancellationToken &cancelToken);
+
  protected:
   void storeImpl(const utymap::entities::Element &element, const utymap::QuadKey &quadKey) override;
 
+  void eraseImpl(const utymap::entities::Element &element, const utymap::QuadKey &quadKey) override;
+
  private:
   class PersistentElementStoreImpl;
   std::unique_ptr<PersistentElementStoreImpl> pimpl_;
@@ -0,0 +1,73 @@
+#include "index/QuadKeyOccupancy.hpp"
+#include "utils/GeoUtils.hpp"
+
+using namespace utymap;
+using namespace utymap::index;
+using namespace utymap::utils;
+
+namespace {
+/// Flag of node which has data itself, lower bits keep mask of children.
+const std::uint8_t DataFlag = 1 << 4;
+const std::uint8_t ChildrenMask = DataFlag - 1;
+
+QuadKey getParent(const QuadKey &quadKey) {
+  return QuadKey(quadKey.levelOfDetail - 1, quadKey.tileX >> 1, quadKey.tileY >> 1);
+}
+
+std::uint8_t getChildFlag(const QuadKey &quadKey) {
+  return static_cast<std::uint8_t>(1 << ((quadKey.tileX & 1) | ((quadKey.tileY & 1) << 1)));
+}
+}
+
+bool QuadKeyOccupancy::add(const QuadKey &quadKey) {
+  std::lock_guard<std::mutex> lock(lock_);
+  auto &node = nodes_[GeoUtils::quadKeyToCode(quadKey)];
+  if ((node & DataFlag)!=0)
+    return false;
+  node |= DataFlag;
+
+  // NOTE ancestors are already marked if child flag is set.
+  for (QuadKey child = quadKey; child.levelOfDetail > 0; child = getParent(child)) {
+    auto &parent = nodes_[GeoUtils::quadKeyToCode(getParent(child))];
+    auto flag = getChildFlag(child);
+    if ((parent & flag)!=0)
+      break;
+    parent |= flag;
+  }
+  return true;
+}
+
+bool QuadKeyOccupancy::hasData(const QuadKey &quadKey) const {
+  std::lock_guard<std::mutex> lock(lock_);
+  return (getNode(quadKey) & DataFlag)!=0;
+}
+
+bool QuadKeyOccupancy::hasDescendantData(const QuadKey &quadKey) const {
+  std::lock_guard<std::mutex> lock(lock_);
+  return (getNode(quadKey) & ChildrenMask)!=0;
+}
+
+bool QuadKeyOccupancy::hasAncestorData(const QuadKey &quadKey) const {
+  std::lock_guard<std::mutex> lock(lock_);
+  for (QuadKey parent = quadKey; parent.levelOfDetail > 0;) {
+    parent = getParent(parent);
+    if ((getNode(parent) & DataFlag)!=0)
+      return true;
+  }
+  return false;
+}
+
+std::vector<QuadKey> QuadKeyOccupancy::getQuadKeys() const {
+  std::lock_guard<std::mutex> lock(lock_);
+  std::vector<QuadKey> quadKeys;
+  for (const auto &node : nodes_) {
+    if ((node.second & DataFlag)!=0)
+      quadKeys.push_back(GeoUtils::codeToQuadKey(node.first));
+  }
+  return quadKeys;
+}
+
+std::uint8_t QuadKeyOccupancy::getNode(const QuadKey &quadKey) const {
+  auto node = nodes_.find(GeoUtils::quadKeyToCode(quadKey));
+  return node!=nodes_.end() ? node->second : std::uint8_t(0);
+}
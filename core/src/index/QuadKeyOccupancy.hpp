@@ -0,0 +1,45 @@
+#ifndef INDEX_QUADKEYOCCUPANCY_HPP_DEFINED
+#define INDEX_QUADKEYOCCUPANCY_HPP_DEFINED
+
+#include "QuadKey.hpp"
+
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace utymap {
+namespace index {
+
+/// Keeps quadkeys which have data as sparse quadtree: every node stores flag of its
+/// own data and mask of children which have data in their subtrees. All operations
+/// are memory lookups and can be called concurrently.
+class QuadKeyOccupancy final {
+ public:
+  /// Marks quadkey as having data. Returns true if it was not marked before.
+  bool add(const utymap::QuadKey &quadKey);
+
+  /// Checks whether quadkey has data.
+  bool hasData(const utymap::QuadKey &quadKey) const;
+
+  /// Checks whether any quadkey of higher level of details inside given one has data.
+  bool hasDescendantData(const utymap::QuadKey &quadKey) const;
+
+  /// Checks whether any quadkey of lower level of details containing given one has data.
+  bool hasAncestorData(const utymap::QuadKey &quadKey) const;
+
+  /// Gets all quadkeys which have data.
+  std::vector<utymap::QuadKey> getQuadKeys() const;
+
+ private:
+  /// Gets node flags or zero if node does not exist. Should be called under lock.
+  std::uint8_t getNode(const utymap::QuadKey &quadKey) const;
+
+  std::unordered_map<std::uint64_t, std::uint8_t> nodes_;
+  mutable std::mutex lock_;
+};
+
+}
+}
+
+#endif // INDEX_QUADKEYOCCUPANCY_HPP_DEFINED
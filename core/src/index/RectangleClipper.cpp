@@ -0,0 +1,228 @@
+#include "index/RectangleClipper.hpp"
+
+#include <algorithm>
+
+using namespace ClipperLib;
+using namespace utymap::index;
+
+namespace {
+
+/// Rounds value in the same way as general clipper does.
+cInt round(double value) {
+  return value < 0 ? static_cast<cInt>(value - 0.5) : static_cast<cInt>(value + 0.5);
+}
+
+IntPoint interpolate(const IntPoint &start, const IntPoint &end, double t) {
+  return IntPoint(round(start.X + t*(end.X - start.X)), round(start.Y + t*(end.Y - start.Y)));
+}
+
+/// Checks whether three points are on the same line.
+/// NOTE products fit 64 bits for geographic coordinates with 1E7 scale.
+bool areCollinear(const IntPoint &a, const IntPoint &b, const IntPoint &c) {
+  return (b.X - a.X)*(c.Y - b.Y)==(b.Y - a.Y)*(c.X - b.X);
+}
+
+/// Appends point to ring skipping duplicates and collinear points.
+void append(Path &ring, const IntPoint &point) {
+  if (!ring.empty() && ring.back()==point)
+    return;
+
+  while (ring.size() >= 2 && areCollinear(ring[ring.size() - 2], ring.back(), point))
+    ring.pop_back();
+
+  ring.push_back(point);
+}
+
+/// Removes duplicate and collinear points where the ring is closed.
+void close(Path &ring) {
+  while (ring.size() > 1 && ring.front()==ring.back())
+    ring.pop_back();
+
+  while (ring.size() >= 3) {
+    if (areCollinear(ring[ring.size() - 2], ring.back(), ring.front()))
+      ring.pop_back();
+    else if (areCollinear(ring.back(), ring[0], ring[1]))
+      ring.erase(ring.begin());
+    else
+      break;
+  }
+}
+}
+
+RectangleClipper::RectangleClipper() :
+    RectangleClipper(0, 0, 0, 0) {
+}
+
+RectangleClipper::RectangleClipper(cInt minX, cInt minY, cInt maxX, cInt maxY) :
+    minX_(minX), minY_(minY), maxX_(maxX), maxY_(maxY) {
+}
+
+bool RectangleClipper::clipPolyline(const Path &path, Paths &solution) const {
+  for (const auto &point : path) {
+    if (isOnBorder(point))
+      return false;
+  }
+
+  solution.clear();
+  bool isOpen = false;
+  for (std::size_t i = 1; i < path.size(); ++i) {
+    const IntPoint &start = path[i - 1], &end = path[i];
+    double t0, t1;
+    if (!clipSegment(start, end, t0, t1)) {
+      isOpen = false;
+      continue;
+    }
+
+    // NOTE segment which only touches the corner is ambiguous.
+    if (t0 >= t1)
+      return false;
+
+    if (t0 > 0 || !isOpen)
+      solution.push_back(Path(1, t0 > 0 ? interpolate(start, end, t0) : start));
+
+    IntPoint point = t1 < 1 ? interpolate(start, end, t1) : end;
+    if (!(solution.back().back()==point))
+      solution.back().push_back(point);
+
+    isOpen = t1 >= 1;
+  }
+
+  solution.erase(std::remove_if(solution.begin(), solution.end(), [](const Path &part) {
+    return part.size() < 2;
+  }), solution.end());
+
+  return true;
+}
+
+bool RectangleClipper::clipRing(const Path &path, Paths &solution) const {
+  for (const auto &point : path) {
+    if (isOnBorder(point))
+      return false;
+  }
+
+  solution.clear();
+  std::size_t size = path.size(), start = 0;
+  while (start < size && isInside(path[start]))
+    ++start;
+
+  if (start==size) {
+    solution.push_back(path);
+    return true;
+  }
+
+  // NOTE walk starts outside, so the inner part is collected in single pass.
+  Path chain;
+  IntPoint entry, exit;
+  int crossings = 0;
+  for (std::size_t i = 0; i < size; ++i) {
+    const IntPoint &first = path[(start + i)%size], &second = path[(start + i + 1)%size];
+    double t0, t1;
+    if (!clipSegment(first, second, t0, t1))
+      continue;
+
+    if (t0 >= t1)
+      return false;
+
+    if (t0 > 0) {
+      if (++crossings > 2) return false;
+      entry = interpolate(first, second, t0);
+      chain.push_back(entry);
+    }
+
+    if (t1 < 1) {
+      if (++crossings > 2) return false;
+      exit = interpolate(first, second, t1);
+      chain.push_back(exit);
+    } else
+      chain.push_back(second);
+  }
+
+  IntPoint corners[] = {IntPoint(minX_, minY_), IntPoint(maxX_, minY_), IntPoint(maxX_, maxY_), IntPoint(minX_, maxY_)};
+
+  // No crossings: ring either contains the whole rectangle or is outside.
+  if (crossings==0) {
+    IntPoint center(minX_ + (maxX_ - minX_)/2, minY_ + (maxY_ - minY_)/2);
+    if (PointInPolygon(center, path)==1)
+      solution.push_back(Path(corners, corners + 4));
+    return true;
+  }
+
+  if (crossings!=2)
+    return false;
+
+  // Ring part inside is closed by the border part which keeps ring interior on the same side.
+  bool isCounterClockwise = Area(path) > 0;
+  double width = static_cast<double>(maxX_ - minX_), height = static_cast<double>(maxY_ - minY_);
+  double perimeter = 2*(width + height);
+  double cornerOffsets[] = {0, width, width + height, 2*width + height};
+  double exitOffset = getBorderOffset(exit), entryOffset = getBorderOffset(entry);
+  double arcLength = isCounterClockwise ? entryOffset - exitOffset : exitOffset - entryOffset;
+  if (arcLength <= 0) arcLength += perimeter;
+
+  std::vector<std::pair<double, int>> arc;
+  for (int i = 0; i < 4; ++i) {
+    double distance = isCounterClockwise ? cornerOffsets[i] - exitOffset : exitOffset - cornerOffsets[i];
+    if (distance <= 0) distance += perimeter;
+    if (distance < arcLength)
+      arc.push_back(std::make_pair(distance, i));
+  }
+  std::sort(arc.begin(), arc.end());
+
+  Path ring;
+  ring.reserve(chain.size() + arc.size());
+  for (const auto &point : chain)
+    append(ring, point);
+  for (const auto &corner : arc)
+    append(ring, corners[corner.second]);
+  close(ring);
+
+  if (ring.size() >= 3) {
+    if (!isCounterClockwise)
+      std::reverse(ring.begin(), ring.end());
+    solution.push_back(std::move(ring));
+  }
+
+  return true;
+}
+
+bool RectangleClipper::isInside(const IntPoint &point) const {
+  return point.X > minX_ && point.X < maxX_ && point.Y > minY_ && point.Y < maxY_;
+}
+
+bool RectangleClipper::isOnBorder(const IntPoint &point) const {
+  return point.X >= minX_ && point.X <= maxX_ && point.Y >= minY_ && point.Y <= maxY_ &&
+      (point.X==minX_ || point.X==maxX_ || point.Y==minY_ || point.Y==maxY_);
+}
+
+bool RectangleClipper::clipSegment(const IntPoint &start, const IntPoint &end, double &t0, double &t1) const {
+  double dx = static_cast<double>(end.X - start.X), dy = static_cast<double>(end.Y - start.Y);
+  double p[] = {-dx, dx, -dy, dy};
+  double q[] = {static_cast<double>(start.X - minX_), static_cast<double>(maxX_ - start.X),
+                static_cast<double>(start.Y - minY_), static_cast<double>(maxY_ - start.Y)};
+  t0 = 0;
+  t1 = 1;
+  for (int i = 0; i < 4; ++i) {
+    if (p[i]==0) {
+      if (q[i] < 0) return false;
+      continue;
+    }
+
+    double t = q[i]/p[i];
+    if (p[i] < 0) {
+      if (t > t1) return false;
+      if (t > t0) t0 = t;
+    } else {
+      if (t < t0) return false;
+      if (t < t1) t1 = t;
+    }
+  }
+  return true;
+}
+
+double RectangleClipper::getBorderOffset(const IntPoint &point) const {
+  double width = static_cast<double>(maxX_ - minX_), height = static_cast<double>(maxY_ - minY_);
+  if (point.Y==minY_) return static_cast<double>(point.X - minX_);
+  if (point.X==maxX_) return width + static_cast<double>(point.Y - minY_);
+  if (point.Y==maxY_) return width + height + static_cast<double>(maxX_ - point.X);
+  return 2*width + height + static_cast<double>(maxY_ - point.Y);
+}
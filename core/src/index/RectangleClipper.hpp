@@ -0,0 +1,46 @@
+#ifndef INDEX_RECTANGLECLIPPER_HPP_DEFINED
+#define INDEX_RECTANGLECLIPPER_HPP_DEFINED
+
+#include "clipper/clipper.hpp"
+
+namespace utymap {
+namespace index {
+
+/// Clips paths in fixed point coordinates by axis aligned rectangle. Polylines are clipped
+/// segment by segment using Liang-Barsky algorithm; rings which cross rectangle border once
+/// are closed along the border. Cases which cannot be handled are reported to caller, so
+/// general polygon clipping can be used instead.
+class RectangleClipper final {
+ public:
+  RectangleClipper();
+
+  RectangleClipper(ClipperLib::cInt minX, ClipperLib::cInt minY, ClipperLib::cInt maxX, ClipperLib::cInt maxY);
+
+  /// Clips polyline. Resulting parts keep direction and order of the original one.
+  /// Returns false if polyline cannot be clipped by this clipper.
+  bool clipPolyline(const ClipperLib::Path &path, ClipperLib::Paths &solution) const;
+
+  /// Clips ring. Resulting ring has positive orientation as produced by general clipper.
+  /// Returns false if ring cannot be clipped by this clipper.
+  bool clipRing(const ClipperLib::Path &path, ClipperLib::Paths &solution) const;
+
+ private:
+  /// Checks whether point is strictly inside the rectangle.
+  bool isInside(const ClipperLib::IntPoint &point) const;
+
+  /// Checks whether point is on the rectangle border.
+  bool isOnBorder(const ClipperLib::IntPoint &point) const;
+
+  /// Clips segment returning its parameters inside rectangle.
+  bool clipSegment(const ClipperLib::IntPoint &start, const ClipperLib::IntPoint &end, double &t0, double &t1) const;
+
+  /// Gets distance along the rectangle border from its min point in counter clockwise order.
+  double getBorderOffset(const ClipperLib::IntPoint &point) const;
+
+  ClipperLib::cInt minX_, minY_, maxX_, maxY_;
+};
+
+}
+}
+
+#endif // INDEX_RECTANGLECLIPPER_HPP_DEFINED
@@ -0,0 +1,102 @@
+#include "index/SpatialIndex.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+using namespace utymap;
+using namespace utymap::index;
+
+namespace {
+typedef std::vector<SpatialIndex::Entry>::iterator EntryIterator;
+
+template<typename T>
+void writeValue(std::ostream &stream, const T &value) {
+  stream.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+template<typename T>
+void readValue(std::istream &stream, T &value) {
+  if (!stream.read(reinterpret_cast<char *>(&value), sizeof(value)))
+    throw std::domain_error("Cannot read spatial index.");
+}
+
+/// Sorts entries by center of their bounding boxes along given axis.
+void sortByCenter(EntryIterator begin, EntryIterator end, bool byLongitude) {
+  std::sort(begin, end, [byLongitude](const SpatialIndex::Entry &lhs, const SpatialIndex::Entry &rhs) {
+    return byLongitude
+           ? lhs.bbox.minPoint.longitude + lhs.bbox.maxPoint.longitude <
+               rhs.bbox.minPoint.longitude + rhs.bbox.maxPoint.longitude
+           : lhs.bbox.minPoint.latitude + lhs.bbox.maxPoint.latitude <
+               rhs.bbox.minPoint.latitude + rhs.bbox.maxPoint.latitude;
+  });
+}
+}
+
+const std::size_t SpatialIndex::NodeCapacity;
+
+SpatialIndex::SpatialIndex() : levels_() {
+}
+
+SpatialIndex::SpatialIndex(std::vector<Entry> entries) : levels_() {
+  if (entries.empty()) return;
+
+  // NOTE sort-tile-recursive: split into vertical slices by longitude, then sort each slice by latitude.
+  auto nodeCount = static_cast<std::size_t>(std::ceil(entries.size()/static_cast<double>(NodeCapacity)));
+  auto sliceSize = NodeCapacity*static_cast<std::size_t>(std::ceil(std::sqrt(static_cast<double>(nodeCount))));
+  sortByCenter(entries.begin(), entries.end(), true);
+  for (std::size_t i = 0; i < entries.size(); i += sliceSize)
+    sortByCenter(entries.begin() + i, entries.begin() + std::min(i + sliceSize, entries.size()), false);
+
+  levels_.push_back(std::move(entries));
+  while (levels_.back().size() > 1) {
+    const auto &children = levels_.back();
+    std::vector<Entry> nodes;
+    nodes.reserve(children.size()/NodeCapacity + 1);
+    for (std::size_t i = 0; i < children.size(); i += NodeCapacity) {
+      Entry node{BoundingBox(), static_cast<std::uint32_t>(i)};
+      for (std::size_t j = i; j < std::min(i + NodeCapacity, children.size()); ++j)
+        node.bbox.expand(children[j].bbox);
+      nodes.push_back(node);
+    }
+    levels_.push_back(std::move(nodes));
+  }
+}
+
+std::size_t SpatialIndex::size() const {
+  return levels_.empty() ? 0 : levels_.front().size();
+}
+
+void SpatialIndex::write(std::ostream &stream) const {
+  writeValue(stream, static_cast<std::uint32_t>(levels_.size()));
+  for (const auto &level : levels_) {
+    writeValue(stream, static_cast<std::uint32_t>(level.size()));
+    for (const auto &entry : level) {
+      writeValue(stream, entry.bbox.minPoint.latitude);
+      writeValue(stream, entry.bbox.minPoint.longitude);
+      writeValue(stream, entry.bbox.maxPoint.latitude);
+      writeValue(stream, entry.bbox.maxPoint.longitude);
+      writeValue(stream, entry.item);
+    }
+  }
+}
+
+SpatialIndex SpatialIndex::read(std::istream &stream) {
+  SpatialIndex index;
+  std::uint32_t levelCount;
+  readValue(stream, levelCount);
+  index.levels_.resize(levelCount);
+  for (auto &level : index.levels_) {
+    std::uint32_t size;
+    readValue(stream, size);
+    level.resize(size);
+    for (auto &entry : level) {
+      readValue(stream, entry.bbox.minPoint.latitude);
+      readValue(stream, entry.bbox.minPoint.longitude);
+      readValue(stream, entry.bbox.maxPoint.latitude);
+      readValue(stream, entry.bbox.maxPoint.longitude);
+      readValue(stream, entry.item);
+    }
+  }
+  return index;
+}
@@ -0,0 +1,77 @@
+#ifndef INDEX_SPATIALINDEX_HPP_DEFINED
+#define INDEX_SPATIALINDEX_HPP_DEFINED
+
+#include "BoundingBox.hpp"
+
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+namespace utymap {
+namespace index {
+
+/// Packed R-tree over bounding boxes of items. Leaves are ordered using
+/// sort-tile-recursive algorithm, every parent node covers fixed amount of
+/// consecutive nodes of the level below. Tree is immutable once built.
+class SpatialIndex final {
+ public:
+  /// Represents indexed item or tree node.
+  struct Entry final {
+    utymap::BoundingBox bbox;
+    /// Item for leaf or index of the first child for node.
+    std::uint32_t item;
+  };
+
+  /// Max amount of children of single node.
+  static const std::size_t NodeCapacity = 16;
+
+  /// Creates empty index.
+  SpatialIndex();
+
+  /// Builds index for given items.
+  explicit SpatialIndex(std::vector<Entry> entries);
+
+  /// Returns amount of indexed items.
+  std::size_t size() const;
+
+  /// Calls visitor with item of each entry which bounding box intersects given one.
+  template<typename Visitor>
+  void query(const utymap::BoundingBox &bbox, const Visitor &visitor) const {
+    if (levels_.empty()) return;
+    query(bbox, levels_.size() - 1, 0, levels_.back().size(), visitor);
+  }
+
+  /// Writes index to stream.
+  void write(std::ostream &stream) const;
+
+  /// Reads index from stream.
+  static SpatialIndex read(std::istream &stream);
+
+ private:
+  template<typename Visitor>
+  void query(const utymap::BoundingBox &bbox,
+             std::size_t level,
+             std::size_t begin,
+             std::size_t end,
+             const Visitor &visitor) const {
+    const auto &entries = levels_[level];
+    for (std::size_t i = begin; i < end; ++i) {
+      if (!bbox.intersects(entries[i].bbox)) continue;
+
+      if (level==0) {
+        visitor(entries[i].item);
+      } else {
+        std::size_t first = entries[i].item;
+        query(bbox, level - 1, first, std::min(first + NodeCapacity, levels_[level - 1].size()), visitor);
+      }
+    }
+  }
+
+  /// Entries of tree levels: leaves first, root level last.
+  std::vector<std::vector<Entry>> levels_;
+};
+
+}
+}
+
+#endif // INDEX_SPATIALINDEX_HPP_DEFINED
@@ -2,114 +2,256 @@
 #include "index/StringTable.hpp"
 #include "utils/CoreUtils.hpp"
 
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
 #include <fstream>
 #include <mutex>
-#include <unordered_map>
+#include <stdexcept>
+#include <vector>
 
 using std::ios;
 using namespace utymap::index;
 
-/// Naive implementation of string table: reads all the time string from file; acquires lock
-/// TODO optimize it to avoid locks and expensive file reads.
+namespace {
+/// Amount of entries in the first segment of offset table. Each next segment is twice bigger.
+const std::uint32_t FirstSegmentBits = 10;
+/// Max amount of offset table segments which is enough to address all ids.
+const std::uint32_t MaxSegments = 32 - FirstSegmentBits + 1;
+/// Initial capacity of hash map, must be power of two.
+const std::size_t InitialCapacity = 4096;
+/// Size of memory chunk used to keep strings added at runtime.
+const std::size_t ChunkSize = 64*1024;
+
+/// Describes single string stored in the table.
+struct Entry final {
+  const char *data;
+  std::uint32_t size;
+  std::uint32_t hash;
+};
+
+/// Open addressing hash map which slots contain hash and id + 1 of the string, zero means empty slot.
+/// Slots are written only by single writer, so readers can probe them without locking.
+struct HashMap final {
+  explicit HashMap(std::size_t capacity) :
+      mask(capacity - 1), slots(new std::atomic<std::uint64_t>[capacity]) {
+    for (std::size_t i = 0; i < capacity; ++i)
+      slots[i].store(0, std::memory_order_relaxed);
+  }
+
+  std::size_t capacity() const { return mask + 1; }
+
+  const std::size_t mask;
+  std::unique_ptr<std::atomic<std::uint64_t>[]> slots;
+};
+
+/// Gets index of offset table segment which contains given id.
+std::uint32_t getSegment(std::uint32_t id, std::uint32_t &index) {
+  std::uint64_t value = static_cast<std::uint64_t>(id) + (1 << FirstSegmentBits);
+  std::uint32_t bit = 63;
+  while ((value >> bit)==0) --bit;
+  index = static_cast<std::uint32_t>(value - (std::uint64_t(1) << bit));
+  return bit - FirstSegmentBits;
+}
+}
+
+/// Keeps all strings in memory: strings from the data file are memory mapped, new ones are
+/// copied to in-memory chunks and appended to the files. Lookups and string reads are lock
+/// free, only insertion of new strings is serialized.
 class StringTable::StringTableImpl {
-  typedef std::vector<std::uint32_t> IdList;
-  typedef std::unordered_map<std::uint32_t, IdList> HashIdMap;
+  typedef boost::interprocess::mapped_region MappedRegion;
 
  public:
   StringTableImpl(const std::string &indexPath, const std::string &dataPath, std::uint32_t seed) :
-      indexFile_(indexPath, ios::in | ios::out | ios::binary | ios::ate | ios::app),
-      dataFile_(dataPath, ios::in | ios::out | ios::binary | ios::app),
-      seed_(seed),
-      nextId_(0),
-      map_(),
-      offsets_() {
-    nextId_ = static_cast<std::uint32_t>(indexFile_.tellg()/(sizeof(std::uint32_t)*2));
-    if (nextId_ > 0) {
-      std::uint32_t count = nextId_;
-      indexFile_.seekg(0, ios::beg);
-
-      // NOTE reserve some extra size for possible insertions
-      std::size_t capacity = count + 2048;
-      offsets_.reserve(capacity);
-      map_.reserve(capacity);
-
-      for (std::uint32_t i = 0; i < count; ++i) {
-        std::uint32_t hash, offset;
-        indexFile_.read(reinterpret_cast<char *>(&hash), sizeof(hash));
-        indexFile_.read(reinterpret_cast<char *>(&offset), sizeof(offset));
-        offsets_.push_back(offset);
-        map_[hash].push_back(i);
-      }
+      seed_(seed), size_(0), map_(nullptr), dataOffset_(0), chunkLeft_(0), chunkData_(nullptr) {
+    for (auto &segment : segments_)
+      segment.store(nullptr, std::memory_order_relaxed);
+
+    // NOTE files are created if they do not exist.
+    indexFile_.open(indexPath, ios::out | ios::binary | ios::app);
+    dataFile_.open(dataPath, ios::out | ios::binary | ios::app);
+    dataFile_.seekp(0, ios::end);
+    dataOffset_ = static_cast<std::uint32_t>(dataFile_.tellp());
+
+    const char *data = mapData(dataPath);
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> entries = readIndex(indexPath);
+
+    std::size_t capacity = InitialCapacity;
+    while (capacity < entries.size()*2) capacity <<= 1;
+    maps_.push_back(utymap::utils::make_unique<HashMap>(capacity));
+    map_.store(maps_.back().get(), std::memory_order_relaxed);
+
+    for (const auto &pair : entries) {
+      std::uint32_t offset = pair.second;
+      const void *end = offset < dataOffset_ ? std::memchr(data + offset, '\0', dataOffset_ - offset) : nullptr;
+      if (end==nullptr)
+        throw std::domain_error("String table data is corrupted.");
+      addEntry(Entry{data + offset, static_cast<std::uint32_t>(static_cast<const char *>(end) - data - offset),
+                     pair.first});
     }
   }
 
+  ~StringTableImpl() {
+    for (auto &segment : segments_)
+      delete[] segment.load(std::memory_order_relaxed);
+  }
+
   std::uint32_t getId(const std::string &str) {
     std::uint32_t hash;
     MurmurHash3_x86_32(str.c_str(), static_cast<int>(str.size()), seed_, &hash);
 
-    // TODO avoid lock there
+    std::uint32_t id;
+    if (find(str, hash, id))
+      return id;
+
     std::lock_guard<std::mutex> lock(lock_);
-    HashIdMap::iterator hashLookupResult = map_.find(hash);
-    if (hashLookupResult!=map_.end()) {
-      std::string data;
-      for (std::uint32_t id : hashLookupResult->second) {
-        data.clear();
-        readString(id, data);
-        if (str==data)
-          return id;
-      }
-    }
+    // NOTE string could be added by another thread while lock was acquired.
+    if (find(str, hash, id))
+      return id;
+
+    return insert(str, hash);
+  }
+
+  StringView getStringView(std::uint32_t id) const {
+    if (id >= size_.load(std::memory_order_acquire))
+      return StringView{"", 0};
 
-    writeString(hash, str);
-    return nextId_++;
+    const Entry &entry = getEntry(id);
+    return StringView{entry.data, entry.size};
   }
 
-  std::string getString(std::uint32_t id) {
-    std::string str;
-    // TODO avoid lock there
+  void flush() {
     std::lock_guard<std::mutex> lock(lock_);
-    readString(id, str);
-    return str;
+    // NOTE data is flushed first, so index never refers to unwritten data.
+    dataFile_.flush();
+    indexFile_.flush();
   }
 
  private:
+  /// Memory maps existing data file.
+  const char *mapData(const std::string &dataPath) {
+    if (dataOffset_==0) return nullptr;
 
-  /// Reads string by id.
-  void readString(std::uint32_t id, std::string &data) {
-    if (id < offsets_.size()) {
-      std::uint32_t offset = offsets_[id];
-      dataFile_.seekg(offset, ios::beg);
-      std::getline(dataFile_, data, '\0');
+    using namespace boost::interprocess;
+    file_mapping mapping(dataPath.c_str(), read_only);
+    region_ = utymap::utils::make_unique<MappedRegion>(mapping, read_only, 0, dataOffset_);
+    return static_cast<const char *>(region_->get_address());
+  }
+
+  /// Reads hash-offset pairs from index file.
+  static std::vector<std::pair<std::uint32_t, std::uint32_t>> readIndex(const std::string &indexPath) {
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> entries;
+    std::ifstream file(indexPath, ios::in | ios::binary);
+    std::uint32_t hash, offset;
+    while (file.read(reinterpret_cast<char *>(&hash), sizeof(hash)) &&
+        file.read(reinterpret_cast<char *>(&offset), sizeof(offset)))
+      entries.push_back(std::make_pair(hash, offset));
+    return entries;
+  }
+
+  /// Tries to find id of the string using lock free lookup.
+  bool find(const std::string &str, std::uint32_t hash, std::uint32_t &id) const {
+    const HashMap &map = *map_.load(std::memory_order_acquire);
+    for (std::size_t i = hash & map.mask;; i = (i + 1) & map.mask) {
+      std::uint64_t slot = map.slots[i].load(std::memory_order_acquire);
+      if (slot==0) return false;
+      if (static_cast<std::uint32_t>(slot >> 32)!=hash) continue;
+
+      id = static_cast<std::uint32_t>(slot) - 1;
+      const Entry &entry = getEntry(id);
+      if (entry.size==str.size() && std::memcmp(entry.data, str.data(), str.size())==0)
+        return true;
     }
   }
 
-  /// Writes string to index.
-  void writeString(std::uint32_t hash, const std::string &data) {
-    // get offset as file size
-    dataFile_.seekg(0, ios::end);
-    std::uint32_t offset = static_cast<std::uint32_t>(dataFile_.tellg());
+  /// Adds new string. Should be called under lock.
+  std::uint32_t insert(const std::string &str, std::uint32_t hash) {
+    dataFile_.write(str.c_str(), str.size() + 1);
+    indexFile_.write(reinterpret_cast<const char *>(&hash), sizeof(hash));
+    indexFile_.write(reinterpret_cast<const char *>(&dataOffset_), sizeof(dataOffset_));
+    dataOffset_ += static_cast<std::uint32_t>(str.size() + 1);
 
-    // write string
-    dataFile_.seekp(0, ios::end);
-    dataFile_ << data.c_str() << '\0';
+    return addEntry(Entry{copy(str), static_cast<std::uint32_t>(str.size()), hash});
+  }
+
+  /// Publishes entry in offset table and hash map. Should be called under lock.
+  std::uint32_t addEntry(const Entry &entry) {
+    std::uint32_t id = size_.load(std::memory_order_relaxed);
+    std::uint32_t index;
+    std::uint32_t segment = getSegment(id, index);
+    if (segments_[segment].load(std::memory_order_relaxed)==nullptr)
+      segments_[segment].store(new Entry[std::size_t(1) << (segment + FirstSegmentBits)], std::memory_order_release);
+    segments_[segment].load(std::memory_order_relaxed)[index] = entry;
+    size_.store(id + 1, std::memory_order_release);
+
+    HashMap *map = map_.load(std::memory_order_relaxed);
+    if ((static_cast<std::size_t>(id) + 1)*2 > map->capacity())
+      map = grow(*map);
+    put(*map, entry.hash, id);
+
+    return id;
+  }
+
+  /// Creates twice bigger hash map. Old one is kept alive as readers can still use it.
+  HashMap *grow(const HashMap &map) {
+    maps_.push_back(utymap::utils::make_unique<HashMap>(map.capacity()*2));
+    HashMap *newMap = maps_.back().get();
+    for (std::size_t i = 0; i < map.capacity(); ++i) {
+      std::uint64_t slot = map.slots[i].load(std::memory_order_relaxed);
+      if (slot!=0)
+        put(*newMap, static_cast<std::uint32_t>(slot >> 32), static_cast<std::uint32_t>(slot) - 1);
+    }
+    map_.store(newMap, std::memory_order_release);
+    return newMap;
+  }
+
+  static void put(HashMap &map, std::uint32_t hash, std::uint32_t id) {
+    std::size_t i = hash & map.mask;
+    while (map.slots[i].load(std::memory_order_relaxed)!=0)
+      i = (i + 1) & map.mask;
+    map.slots[i].store((static_cast<std::uint64_t>(hash) << 32) | (id + 1), std::memory_order_release);
+  }
 
-    // write index entry
-    indexFile_.seekp(0, ios::end);
-    indexFile_.write(reinterpret_cast<char *>(&hash), sizeof(hash));
-    indexFile_.write(reinterpret_cast<char *>(&offset), sizeof(offset));
+  const Entry &getEntry(std::uint32_t id) const {
+    std::uint32_t index;
+    std::uint32_t segment = getSegment(id, index);
+    return segments_[segment].load(std::memory_order_acquire)[index];
+  }
 
-    map_[hash].push_back(nextId_);
-    offsets_.push_back(offset);
+  /// Copies null terminated string to memory chunk which is never moved.
+  const char *copy(const std::string &str) {
+    std::size_t size = str.size() + 1;
+    if (size > chunkLeft_) {
+      std::size_t chunkSize = std::max(size, ChunkSize);
+      chunks_.push_back(std::unique_ptr<char[]>(new char[chunkSize]));
+      chunkData_ = chunks_.back().get();
+      chunkLeft_ = chunkSize;
+    }
+    char *data = chunkData_;
+    std::memcpy(data, str.c_str(), size);
+    chunkData_ += size;
+    chunkLeft_ -= size;
+    return data;
   }
 
-  std::fstream indexFile_;
-  std::fstream dataFile_;
-  std::uint32_t seed_;
-  std::uint32_t nextId_;
+  const std::uint32_t seed_;
 
-  /// TODO think about better data structure alternatives
-  HashIdMap map_;
-  std::vector<std::uint32_t> offsets_;
+  std::atomic<std::uint32_t> size_;
+  std::atomic<Entry *> segments_[MaxSegments];
+  std::atomic<HashMap *> map_;
+  std::vector<std::unique_ptr<HashMap>> maps_;
+
+  std::unique_ptr<MappedRegion> region_;
+  std::ofstream indexFile_;
+  std::ofstream dataFile_;
+  std::uint32_t dataOffset_;
+
+  std::vector<std::unique_ptr<char[]>> chunks_;
+  std::size_t chunkLeft_;
+  char *chunkData_;
 
   std::mutex lock_;
 };
@@ -125,5 +267,14 @@ std::uint32_t StringTable::getId(const std::string &str) const {
 }
 
 std::string StringTable::getString(std::uint32_t id) const {
-  return pimpl_->getString(id);
+  auto view = pimpl_->getStringView(id);
+  return std::string(view.data, view.size);
+}
+
+StringTable::StringView StringTable::getStringView(std::uint32_t id) const {
+  return pimpl_->getStringView(id);
+}
+
+void StringTable::flush() const {
+  pimpl_->flush();
 }
@@ -12,8 +12,15 @@ namespace index {
 /// Index file consists of id-offset pairs where id - string id,
 /// offset - first character of the string inside data file.
 /// data file contains list of null terminated strings.
+/// All strings are kept in memory, so lookups do not touch disk and do not take locks.
 class StringTable final {
  public:
+  /// Represents string stored in the table. Data is null terminated and
+  /// stays valid during table lifetime.
+  struct StringView {
+    const char *data;
+    std::size_t size;
+  };
 
   /// Creates instance of StringTable using file path provided.
   explicit StringTable(const std::string &path);
@@ -29,6 +36,12 @@ class StringTable final {
   /// Gets original string by id.
   std::string getString(std::uint32_t id) const;
 
+  /// Gets original string by id without copying it.
+  StringView getStringView(std::uint32_t id) const;
+
+  /// Writes buffered strings to disk. Strings are also written when table is destroyed.
+  void flush() const;
+
  private:
   class StringTableImpl;
   std::unique_ptr<StringTableImpl> pimpl_;
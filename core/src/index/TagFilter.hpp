@@ -0,0 +1,56 @@
+#ifndef INDEX_TAGFILTER_HPP_DEFINED
+#define INDEX_TAGFILTER_HPP_DEFINED
+
+#include "entities/Element.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace utymap {
+namespace index {
+
+/// Specifies tags which element should have. Element matches filter if it
+/// satisfies every condition, empty filter matches any element.
+class TagFilter final {
+ public:
+  /// Requires tag with given key and value or with given key and any value.
+  struct Condition final {
+    std::uint32_t key;
+    std::uint32_t value;
+    bool isAnyValue;
+  };
+
+  /// Requires tag with given key and any value.
+  TagFilter &hasKey(std::uint32_t key) {
+    conditions_.push_back(Condition{key, 0, true});
+    return *this;
+  }
+
+  /// Requires tag with given key and value.
+  TagFilter &hasTag(std::uint32_t key, std::uint32_t value) {
+    conditions_.push_back(Condition{key, value, false});
+    return *this;
+  }
+
+  const std::vector<Condition> &getConditions() const {
+    return conditions_;
+  }
+
+  /// Checks whether tags satisfy every condition.
+  bool matches(const std::vector<utymap::entities::Tag> &tags) const {
+    return std::all_of(conditions_.begin(), conditions_.end(), [&](const Condition &condition) {
+      return std::any_of(tags.begin(), tags.end(), [&](const utymap::entities::Tag &tag) {
+        return tag.key==condition.key && (condition.isAnyValue || tag.value==condition.value);
+      });
+    });
+  }
+
+ private:
+  std::vector<Condition> conditions_;
+};
+
+}
+}
+
+#endif // INDEX_TAGFILTER_HPP_DEFINED
@@ -0,0 +1,166 @@
+#include "index/TagIndex.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+using namespace utymap;
+using namespace utymap::entities;
+using namespace utymap::index;
+
+namespace {
+template<typename T>
+void writeValue(std::ostream &stream, const T &value) {
+  stream.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+template<typename T>
+void readValue(std::istream &stream, T &value) {
+  if (!stream.read(reinterpret_cast<char *>(&value), sizeof(value)))
+    throw std::domain_error("Cannot read tag index.");
+}
+
+void writeItems(std::ostream &stream, const std::vector<std::uint32_t> &items) {
+  writeValue(stream, static_cast<std::uint32_t>(items.size()));
+  for (auto item : items)
+    writeValue(stream, item);
+}
+
+void readItems(std::istream &stream, std::vector<std::uint32_t> &items) {
+  std::uint32_t size;
+  readValue(stream, size);
+  items.resize(size);
+  for (auto &item : items)
+    readValue(stream, item);
+}
+
+/// Adds item to the list unless it is already the last one: element can have the same tag twice.
+void addItem(std::vector<std::uint32_t> &items, std::uint32_t item) {
+  if (items.empty() || items.back()!=item)
+    items.push_back(item);
+}
+
+std::uint64_t getTagCode(std::uint32_t key, std::uint32_t value) {
+  return (static_cast<std::uint64_t>(key) << 32) | value;
+}
+
+const std::vector<std::uint32_t> EmptyItems;
+}
+
+const std::size_t TagIndex::MaxValueCount;
+
+TagIndex::TagIndex() : items_(), keys_(), values_() {
+}
+
+TagIndex::TagIndex(const std::vector<Entry> &entries) : items_(), keys_(), values_() {
+  std::vector<const Entry *> ordered;
+  ordered.reserve(entries.size());
+  for (const auto &entry : entries)
+    ordered.push_back(&entry);
+  std::sort(ordered.begin(), ordered.end(), [](const Entry *lhs, const Entry *rhs) {
+    return lhs->item < rhs->item;
+  });
+
+  std::unordered_map<std::uint32_t, std::size_t> valueCounts;
+  items_.reserve(ordered.size());
+  for (const auto *entry : ordered) {
+    items_.push_back(entry->item);
+    for (const auto &tag : entry->tags) {
+      addItem(keys_[tag.key].items, entry->item);
+      auto &items = values_[getTagCode(tag.key, tag.value)];
+      if (items.empty())
+        ++valueCounts[tag.key];
+      addItem(items, entry->item);
+    }
+  }
+
+  // NOTE values of keys like name or height are unique almost for every element: they are found by key.
+  for (auto &pair : keys_)
+    pair.second.hasValues = valueCounts[pair.first] <= MaxValueCount;
+  for (auto it = values_.begin(); it!=values_.end();) {
+    if (keys_[static_cast<std::uint32_t>(it->first >> 32)].hasValues)
+      ++it;
+    else
+      it = values_.erase(it);
+  }
+}
+
+std::size_t TagIndex::size() const {
+  return items_.size();
+}
+
+std::vector<std::uint32_t> TagIndex::query(const TagFilter &filter) const {
+  const auto &conditions = filter.getConditions();
+  if (conditions.empty())
+    return items_;
+
+  std::vector<const Items *> lists;
+  for (const auto &condition : conditions)
+    lists.push_back(&getItems(condition));
+  std::sort(lists.begin(), lists.end(), [](const Items *lhs, const Items *rhs) {
+    return lhs->size() < rhs->size();
+  });
+
+  // NOTE intersection starts from the shortest list, so it never grows.
+  Items result = *lists.front(), intersection;
+  for (std::size_t i = 1; i < lists.size() && !result.empty(); ++i) {
+    intersection.clear();
+    std::set_intersection(result.begin(), result.end(), lists[i]->begin(), lists[i]->end(),
+                          std::back_inserter(intersection));
+    result.swap(intersection);
+  }
+  return result;
+}
+
+const TagIndex::Items &TagIndex::getItems(const TagFilter::Condition &condition) const {
+  auto key = keys_.find(condition.key);
+  if (key==keys_.end())
+    return EmptyItems;
+
+  if (condition.isAnyValue || !key->second.hasValues)
+    return key->second.items;
+
+  auto value = values_.find(getTagCode(condition.key, condition.value));
+  return value==values_.end() ? EmptyItems : value->second;
+}
+
+void TagIndex::write(std::ostream &stream) const {
+  writeItems(stream, items_);
+  writeValue(stream, static_cast<std::uint32_t>(keys_.size()));
+  for (const auto &pair : keys_) {
+    writeValue(stream, pair.first);
+    writeValue(stream, static_cast<std::uint8_t>(pair.second.hasValues));
+    writeItems(stream, pair.second.items);
+  }
+  writeValue(stream, static_cast<std::uint32_t>(values_.size()));
+  for (const auto &pair : values_) {
+    writeValue(stream, pair.first);
+    writeItems(stream, pair.second);
+  }
+}
+
+TagIndex TagIndex::read(std::istream &stream) {
+  TagIndex index;
+  readItems(stream, index.items_);
+
+  std::uint32_t keyCount;
+  readValue(stream, keyCount);
+  for (std::uint32_t i = 0; i < keyCount; ++i) {
+    std::uint32_t key;
+    std::uint8_t hasValues;
+    readValue(stream, key);
+    readValue(stream, hasValues);
+    auto &keyItems = index.keys_[key];
+    keyItems.hasValues = hasValues!=0;
+    readItems(stream, keyItems.items);
+  }
+
+  std::uint32_t valueCount;
+  readValue(stream, valueCount);
+  for (std::uint32_t i = 0; i < valueCount; ++i) {
+    std::uint64_t code;
+    readValue(stream, code);
+    readItems(stream, index.values_[code]);
+  }
+  return index;
+}
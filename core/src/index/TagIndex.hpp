@@ -0,0 +1,72 @@
+#ifndef INDEX_TAGINDEX_HPP_DEFINED
+#define INDEX_TAGINDEX_HPP_DEFINED
+
+#include "entities/Element.hpp"
+#include "index/TagFilter.hpp"
+
+#include <cstdint>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+
+namespace utymap {
+namespace index {
+
+/// Inverted index from tags to items which have them. Every key has list of its
+/// items; keys with few distinct values also have list of items per value, others
+/// are resolved by key only, so query result should be checked against filter.
+/// Index is immutable once built.
+class TagIndex final {
+ public:
+  /// Represents tags of indexed item.
+  struct Entry final {
+    std::vector<utymap::entities::Tag> tags;
+    std::uint32_t item;
+  };
+
+  /// Max amount of distinct values of key which are indexed separately.
+  static const std::size_t MaxValueCount = 32;
+
+  /// Creates empty index.
+  TagIndex();
+
+  /// Builds index for given items.
+  explicit TagIndex(const std::vector<Entry> &entries);
+
+  /// Returns amount of indexed items.
+  std::size_t size() const;
+
+  /// Returns items which can match given filter in ascending order.
+  std::vector<std::uint32_t> query(const TagFilter &filter) const;
+
+  /// Writes index to stream.
+  void write(std::ostream &stream) const;
+
+  /// Reads index from stream.
+  static TagIndex read(std::istream &stream);
+
+ private:
+  typedef std::vector<std::uint32_t> Items;
+
+  /// Items of tag key.
+  struct KeyItems final {
+    Items items;
+    /// Whether items of every key value are indexed.
+    bool hasValues;
+  };
+
+  /// Gets items which can satisfy condition.
+  const Items &getItems(const TagFilter::Condition &condition) const;
+
+  /// Items of all entries.
+  Items items_;
+  /// Items per tag key.
+  std::unordered_map<std::uint32_t, KeyItems> keys_;
+  /// Items per tag key and value, only for keys with few values.
+  std::unordered_map<std::uint64_t, Items> values_;
+};
+
+}
+}
+
+#endif // INDEX_TAGINDEX_HPP_DEFINED
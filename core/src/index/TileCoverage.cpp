@@ -0,0 +1,151 @@
+#include "entities/Node.hpp"
+#include "entities/Way.hpp"
+#include "entities/Area.hpp"
+#include "entities/Relation.hpp"
+#include "index/TileCoverage.hpp"
+#include "utils/GeoUtils.hpp"
+
+#include <algorithm>
+#include <vector>
+
+using namespace utymap;
+using namespace utymap::entities;
+using namespace utymap::index;
+using namespace utymap::utils;
+
+namespace {
+/// Tolerance used to treat geometry lying on tile border as touching both tiles.
+const double Epsilon = 1E-7;
+
+/// Collects tiles covered by element geometry as (row, column) pairs.
+class CoverageBuilder final : public ElementVisitor {
+ public:
+  typedef std::pair<int, int> Cell;
+
+  explicit CoverageBuilder(int levelOfDetail) : levelOfDetail_(levelOfDetail) {
+  }
+
+  void visitNode(const Node &node) override {
+    addPoint(node.coordinate);
+  }
+
+  void visitWay(const Way &way) override {
+    addLines(way.coordinates, false);
+  }
+
+  void visitArea(const Area &area) override {
+    addLines(area.coordinates, true);
+    fill(area.coordinates);
+  }
+
+  void visitRelation(const Relation &relation) override {
+    for (const auto &element : relation.elements)
+      element->accept(*this);
+  }
+
+  /// Returns unique covered cells sorted by row and column.
+  const std::vector<Cell> &getCells() {
+    std::sort(cells_.begin(), cells_.end());
+    cells_.erase(std::unique(cells_.begin(), cells_.end()), cells_.end());
+    return cells_;
+  }
+
+ private:
+  void addPoint(const GeoCoordinate &coordinate) {
+    for (int column = getColumn(coordinate.longitude - Epsilon);
+         column <= getColumn(coordinate.longitude + Epsilon); ++column)
+      addRows(column, coordinate.latitude, coordinate.latitude);
+  }
+
+  void addLines(const std::vector<GeoCoordinate> &coordinates, bool isClosed) {
+    if (coordinates.size()==1)
+      addPoint(coordinates.front());
+
+    for (std::size_t i = 1; i < coordinates.size(); ++i)
+      addSegment(coordinates[i - 1], coordinates[i]);
+
+    if (isClosed && coordinates.size() > 2)
+      addSegment(coordinates.back(), coordinates.front());
+  }
+
+  /// Walks through columns crossed by segment adding rows covered by its part inside each column.
+  void addSegment(const GeoCoordinate &start, const GeoCoordinate &end) {
+    double minLon = std::min(start.longitude, end.longitude);
+    double maxLon = std::max(start.longitude, end.longitude);
+    double deltaLon = end.longitude - start.longitude;
+
+    for (int column = getColumn(minLon - Epsilon); column <= getColumn(maxLon + Epsilon); ++column) {
+      double lon0 = clamp(getLongitude(column), minLon, maxLon);
+      double lon1 = clamp(getLongitude(column + 1), minLon, maxLon);
+      double lat0 = start.latitude, lat1 = end.latitude;
+      if (deltaLon!=0) {
+        lat0 = start.latitude + (end.latitude - start.latitude)*(lon0 - start.longitude)/deltaLon;
+        lat1 = start.latitude + (end.latitude - start.latitude)*(lon1 - start.longitude)/deltaLon;
+      }
+      addRows(column, std::min(lat0, lat1), std::max(lat0, lat1));
+    }
+  }
+
+  /// Adds cells of rows between given latitudes inside the column.
+  void addRows(int column, double minLat, double maxLat) {
+    for (int row = getRow(maxLat + Epsilon); row <= getRow(minLat - Epsilon); ++row)
+      cells_.push_back(Cell(row, column));
+  }
+
+  /// Adds cells which centers are inside polygon using even-odd rule.
+  void fill(const std::vector<GeoCoordinate> &coordinates) {
+    if (coordinates.size() < 3) return;
+
+    BoundingBox bbox;
+    bbox.expand(coordinates.cbegin(), coordinates.cend());
+    std::vector<double> crossings;
+    for (int row = getRow(bbox.maxPoint.latitude); row <= getRow(bbox.minPoint.latitude); ++row) {
+      double latitude = (getLatitude(row) + getLatitude(row + 1))/2;
+      crossings.clear();
+      for (std::size_t i = 0, j = coordinates.size() - 1; i < coordinates.size(); j = i++) {
+        const GeoCoordinate &a = coordinates[i], &b = coordinates[j];
+        if ((a.latitude > latitude)!=(b.latitude > latitude))
+          crossings.push_back(a.longitude + (b.longitude - a.longitude)*(latitude - a.latitude)/
+              (b.latitude - a.latitude));
+      }
+
+      std::sort(crossings.begin(), crossings.end());
+      for (std::size_t i = 1; i < crossings.size(); i += 2) {
+        for (int column = getColumn(crossings[i - 1]); column <= getColumn(crossings[i]); ++column)
+          cells_.push_back(Cell(row, column));
+      }
+    }
+  }
+
+  int getColumn(double longitude) const {
+    return GeoUtils::GeoCoordinateToQuadKey(GeoCoordinate(0, longitude), levelOfDetail_).tileX;
+  }
+
+  int getRow(double latitude) const {
+    return GeoUtils::GeoCoordinateToQuadKey(GeoCoordinate(latitude, 0), levelOfDetail_).tileY;
+  }
+
+  /// Gets longitude of the column west border.
+  double getLongitude(int column) const {
+    return GeoUtils::quadKeyToBoundingBox(QuadKey(levelOfDetail_, column, 0)).minPoint.longitude;
+  }
+
+  /// Gets latitude of the row north border.
+  double getLatitude(int row) const {
+    return GeoUtils::quadKeyToBoundingBox(QuadKey(levelOfDetail_, 0, row)).maxPoint.latitude;
+  }
+
+  const int levelOfDetail_;
+  std::vector<Cell> cells_;
+};
+}
+
+void TileCoverage::visit(const Element &element, int levelOfDetail, const Visitor &visitor) {
+  CoverageBuilder builder(levelOfDetail);
+  element.accept(builder);
+
+  for (const auto &cell : builder.getCells()) {
+    QuadKey quadKey(levelOfDetail, cell.second, cell.first);
+    visitor(quadKey, GeoUtils::quadKeyToBoundingBox(quadKey));
+  }
+}
@@ -0,0 +1,28 @@
+#ifndef INDEX_TILECOVERAGE_HPP_DEFINED
+#define INDEX_TILECOVERAGE_HPP_DEFINED
+
+#include "BoundingBox.hpp"
+#include "QuadKey.hpp"
+#include "entities/Element.hpp"
+
+#include <functional>
+
+namespace utymap {
+namespace index {
+
+/// Finds tiles which are intersected by element geometry. Lines and polygon edges
+/// are rasterized using supercover walk over tile grid, polygon interiors are
+/// filled by scanlines passing through tile row centers.
+/// NOTE tiles touched by geometry on their border are also considered as covered.
+class TileCoverage final {
+ public:
+  typedef std::function<void(const utymap::QuadKey &, const utymap::BoundingBox &)> Visitor;
+
+  /// Visits covered tiles of given level of details row by row.
+  static void visit(const utymap::entities::Element &element, int levelOfDetail, const Visitor &visitor);
+};
+
+}
+}
+
+#endif // INDEX_TILECOVERAGE_HPP_DEFINED
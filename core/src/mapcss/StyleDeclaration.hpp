@@ -9,6 +9,7 @@
 
 #include <cstdint>
 #include <string>
+#include <unordered_set>
 #include <memory>
 #include <vector>
 
@@ -51,6 +52,12 @@ struct StyleDeclaration final {
     return StyleEvaluator::evaluate<T>(*tree_, tags, stringTable);
   }
 
+  /// Adds keys of tags used by evaluation to given set.
+  void getTagKeys(std::unordered_set<std::string> &keys) const {
+    if (isEval())
+      StyleEvaluator::getTagKeys(*tree_, keys);
+  }
+
  private:
 
   std::uint32_t key_;
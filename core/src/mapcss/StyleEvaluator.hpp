@@ -13,6 +13,7 @@
 #include <string>
 #include <list>
 #include <memory>
+#include <unordered_set>
 #include <vector>
 
 namespace utymap {
@@ -57,6 +58,12 @@ struct StyleEvaluator final {
     return EvaluatorType(tags, stringTable)(tree);
   }
 
+  /// Adds keys of tags referenced by expression to given set.
+  static void getTagKeys(const Tree &tree, std::unordered_set<std::string> &keys) {
+    TagKeyCollector collector(keys);
+    collector(tree);
+  }
+
  private:
 
   /// Specifies default AST evaluator behaviour.
@@ -139,6 +146,27 @@ struct StyleEvaluator final {
     }
   };
 
+  /// Collects tag keys from AST.
+  struct TagKeyCollector {
+    typedef void result_type;
+
+    explicit TagKeyCollector(std::unordered_set<std::string> &keys) : keys_(keys) {}
+
+    void operator()(Nil) const {}
+    void operator()(double) const {}
+    void operator()(const std::string &tagKey) const { keys_.insert(tagKey); }
+    void operator()(const Signed &s) const { boost::apply_visitor(*this, s.operand); }
+
+    void operator()(const Tree &tree) const {
+      boost::apply_visitor(*this, tree.first);
+      for (const Operation &oper : tree.rest)
+        boost::apply_visitor(*this, oper.operand);
+    }
+
+   private:
+    std::unordered_set<std::string> &keys_;
+  };
+
   std::string value_;
   std::unique_ptr<Tree> tree_;
 };
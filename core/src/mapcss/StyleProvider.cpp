@@ -5,9 +5,15 @@
 #include "entities/Area.hpp"
 #include "entities/Relation.hpp"
 #include "mapcss/Style.hpp"
+#include "mapcss/StyleConsts.hpp"
 #include "mapcss/StyleProvider.hpp"
 #include "utils/GradientUtils.hpp"
+#include "utils/LruCache.hpp"
 
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <iterator>
 #include <mutex>
 
 using namespace utymap::entities;
@@ -17,6 +23,7 @@ using namespace utymap::mapcss;
 namespace {
 
 const std::uint16_t DefaultTextureIndex = std::numeric_limits<std::uint16_t>::max();
+const std::string TrueValue = "true";
 
 /// Contains operation types supported by mapcss parser.
 enum class OpType { Exists, Equals, NotEquals, Less, Greater };
@@ -47,6 +54,27 @@ struct FilterCollection final {
   IdentifierFilterMap elements;
 };
 
+/// Condition filter which keeps its level of details span and only the declarations
+/// which affect storing of element. Used to resolve the whole range at once.
+struct SpanFilter final {
+  std::vector<ConditionType> conditions;
+  int startLod;
+  int endLod;
+  bool hasDeclarations;
+  /// Value of clip and skip declarations: -1 if not declared, otherwise 0 or 1.
+  int clip;
+  int skip;
+};
+
+typedef std::vector<SpanFilter> SpanFilters;
+
+struct SpanFilterCollection final {
+  SpanFilters nodes;
+  SpanFilters ways;
+  SpanFilters areas;
+  SpanFilters relations;
+};
+
 /// Alters tag with value specific for passed style declarations.
 void addTo(std::string &tag, const StyleDeclarations &styles) {
   for (const auto &style :styles) {
@@ -111,27 +139,246 @@ std::string getHashTag(const FilterCollection &filterCollection) {
   return MD5(tag).hexdigest();
 }
 
+typedef std::vector<Tag>::const_iterator TagIterator;
+
+/// Max amount of distinct tag sets which matched filters are cached for. Least recently
+/// used tag set of the same cache shard is evicted when limit of the shard is reached.
+const std::size_t MaxCachedMatches = 65536;
+/// Amount of independently locked parts of match cache, so concurrent styling of elements
+/// with different tags rarely waits for the same lock.
+const std::size_t MatchCacheShardCount = 16;
+
+template<typename T>
+void writeValue(std::ostream &stream, const T &value) {
+  stream.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+template<typename T>
+bool readValue(std::istream &stream, T &value) {
+  return static_cast<bool>(stream.read(reinterpret_cast<char *>(&value), sizeof(value)));
+}
+
+/// Caches indices of condition filters matched by element of given kind with given tags
+/// at level of details: elements with the same tags are styled by index lookup. Only tags
+/// which keys are used by conditions are part of cache key as others cannot change matches.
+/// Cache is split into shards by key hash, each shard has own lock and evicts its least
+/// recently used entries. Cached matches are shared, so they are not copied on lookup.
+/// NOTE element id rules depend on id, so they are never cached.
+class MatchCache final {
+  struct Key final {
+    std::uint8_t kind;
+    std::uint8_t levelOfDetail;
+    std::vector<Tag> tags;
+  };
+
+  struct KeyComparator final {
+    bool operator()(const Key &lhs, const Key &rhs) const {
+      if (lhs.kind!=rhs.kind) return lhs.kind < rhs.kind;
+      if (lhs.levelOfDetail!=rhs.levelOfDetail) return lhs.levelOfDetail < rhs.levelOfDetail;
+      return std::lexicographical_compare(lhs.tags.begin(), lhs.tags.end(), rhs.tags.begin(), rhs.tags.end(),
+                                          [](const Tag &l, const Tag &r) {
+                                            return l.key < r.key || (l.key==r.key && l.value < r.value);
+                                          });
+    }
+  };
+
+ public:
+  typedef std::vector<std::uint32_t> Matches;
+  typedef std::shared_ptr<const Matches> MatchesPtr;
+
+ private:
+  struct Shard final {
+    Shard() : matches(MaxCachedMatches/MatchCacheShardCount) {
+    }
+
+    utymap::utils::LruCache<Key, MatchesPtr, KeyComparator> matches;
+    std::mutex lock;
+  };
+
+ public:
+  MatchCache() : shards_(MatchCacheShardCount) {
+  }
+
+  /// Sets keys of tags used by conditions. Should be called before cache is used.
+  void setConditionKeys(std::unordered_set<std::uint32_t> &&keys) {
+    conditionKeys_ = std::move(keys);
+  }
+
+  /// Gets matches from cache or resolves and caches them.
+  template<typename Resolver>
+  MatchesPtr get(std::uint8_t kind, int levelOfDetail, const std::vector<Tag> &tags, const Resolver &resolve) {
+    Key key = createKey(kind, static_cast<std::uint8_t>(levelOfDetail), tags);
+    Shard &shard = getShard(key);
+    {
+      std::lock_guard<std::mutex> lock(shard.lock);
+      if (shard.matches.exists(key))
+        return shard.matches.get(key);
+    }
+
+    // NOTE matches are resolved without lock: another thread can cache the same ones meanwhile.
+    auto matches = std::make_shared<const Matches>(resolve());
+    std::lock_guard<std::mutex> lock(shard.lock);
+    if (shard.matches.exists(key))
+      return shard.matches.get(key);
+    shard.matches.put(key, MatchesPtr(matches));
+    return matches;
+  }
+
+  /// Writes cached matches of every shard from the least to the most recently used one.
+  void write(std::ostream &stream) {
+    std::vector<std::unique_lock<std::mutex>> locks;
+    std::size_t size = 0;
+    for (auto &shard : shards_) {
+      locks.emplace_back(shard.lock);
+      size += shard.matches.size();
+    }
+
+    writeValue(stream, static_cast<std::uint32_t>(size));
+    for (const auto &shard : shards_) {
+      shard.matches.visit([&](const Key &key, const MatchesPtr &matches) {
+        writeEntry(stream, key, *matches);
+      });
+    }
+  }
+
+  /// Reads cached matches. Filter counts are used to reject indices which do not exist.
+  void read(std::istream &stream, const std::function<std::size_t(std::uint8_t, int)> &getFilterCount) {
+    std::uint32_t count, size;
+    if (!readValue(stream, count)) return;
+
+    for (std::uint32_t i = 0; i < count; ++i) {
+      Key key;
+      if (!readValue(stream, key.kind) || !readValue(stream, key.levelOfDetail) || !readValue(stream, size))
+        return;
+      key.tags.resize(size);
+      for (auto &tag : key.tags) {
+        if (!readValue(stream, tag.key) || !readValue(stream, tag.value))
+          return;
+      }
+
+      Matches matches;
+      if (!readValue(stream, size)) return;
+      matches.resize(size);
+      auto filterCount = getFilterCount(key.kind, key.levelOfDetail);
+      for (auto &index : matches) {
+        if (!readValue(stream, index) || index >= filterCount)
+          return;
+      }
+      // NOTE tags are filtered again as conditions could change since matches were written.
+      key = createKey(key.kind, key.levelOfDetail, key.tags);
+      Shard &shard = getShard(key);
+      std::lock_guard<std::mutex> lock(shard.lock);
+      shard.matches.put(key, std::make_shared<const Matches>(std::move(matches)));
+    }
+  }
+
+ private:
+  /// Writes single cached entry.
+  static void writeEntry(std::ostream &stream, const Key &key, const Matches &matches) {
+    writeValue(stream, key.kind);
+    writeValue(stream, key.levelOfDetail);
+    writeValue(stream, static_cast<std::uint32_t>(key.tags.size()));
+    for (const auto &tag : key.tags) {
+      writeValue(stream, tag.key);
+      writeValue(stream, tag.value);
+    }
+    writeValue(stream, static_cast<std::uint32_t>(matches.size()));
+    for (auto index : matches)
+      writeValue(stream, index);
+  }
+
+  /// Gets shard of given key. Hash does not depend on process, so written matches are read
+  /// into the same shards.
+  Shard &getShard(const Key &key) {
+    std::size_t hash = key.kind*31 + key.levelOfDetail;
+    for (const auto &tag : key.tags)
+      hash = (hash*31 + tag.key)*31 + tag.value;
+    return shards_[hash%shards_.size()];
+  }
+
+  /// Creates key from tags used by conditions.
+  Key createKey(std::uint8_t kind, std::uint8_t levelOfDetail, const std::vector<Tag> &tags) const {
+    Key key{kind, levelOfDetail, {}};
+    std::copy_if(tags.begin(), tags.end(), std::back_inserter(key.tags), [&](const Tag &tag) {
+      return conditionKeys_.find(tag.key)!=conditionKeys_.end();
+    });
+    return key;
+  }
+
+  std::unordered_set<std::uint32_t> conditionKeys_;
+  std::vector<Shard> shards_;
+};
+
+/// Compares two raw string values using double conversion.
+template<typename Func>
+bool compareDoubles(const StringTable &stringTable, std::uint32_t left, std::uint32_t right, Func binaryOp) {
+  auto leftString = stringTable.getStringView(left);
+  auto rightString = stringTable.getStringView(right);
+  double leftValue = utymap::utils::parseDouble(leftString.data, leftString.size);
+  double rightValue = utymap::utils::parseDouble(rightString.data, rightString.size);
+
+  return binaryOp(leftValue, rightValue);
+}
+
+/// Checks tag's value assuming that the key is already checked.
+bool matchTag(const StringTable &stringTable, const Tag &tag, const ConditionType &condition) {
+  switch (condition.type) {
+    case OpType::Exists:return true;
+    case OpType::Equals:return tag.value==condition.value;
+    case OpType::NotEquals:return tag.value!=condition.value;
+    case OpType::Less:return compareDoubles(stringTable, tag.value, condition.value, std::less<double>());
+    case OpType::Greater:return compareDoubles(stringTable, tag.value, condition.value, std::greater<double>());
+    default:return false;
+  }
+}
+
+/// Tries to find tag which satisfy condition using binary search.
+bool matchTags(const StringTable &stringTable, TagIterator begin, TagIterator end, const ConditionType &condition) {
+  while (begin < end) {
+    const TagIterator middle = begin + (std::distance(begin, end)/2);
+    if (middle->key==condition.key)
+      return matchTag(stringTable, *middle, condition);
+    else if (middle->key > condition.key)
+      end = middle;
+    else
+      begin = middle + 1;
+  }
+  return false;
+}
+
+/// Checks whether tags satisfy all conditions.
+bool matchConditions(const StringTable &stringTable,
+                     const std::vector<Tag> &tags,
+                     const std::vector<ConditionType> &conditions) {
+  for (const auto &condition : conditions) {
+    if (!matchTags(stringTable, tags.cbegin(), tags.cend(), condition))
+      return false;
+  }
+  return true;
+}
+
 class StyleBuilder final : public ElementVisitor {
-  typedef std::vector<Tag>::const_iterator TagIterator;
  public:
 
   StyleBuilder(std::vector<Tag> tags, StringTable &stringTable,
-               const FilterCollection &filters, int levelOfDetail, bool onlyCheck = false) :
+               const FilterCollection &filters, MatchCache &matchCache,
+               int levelOfDetail, bool onlyCheck = false) :
       style(tags, stringTable),
       filters_(filters),
+      matchCache_(matchCache),
       levelOfDetail_(levelOfDetail),
       onlyCheck_(onlyCheck),
       canBuild_(false),
       stringTable_(stringTable) {
   }
 
-  void visitNode(const Node &node) override { checkOrBuild(node, filters_.nodes); }
+  void visitNode(const Node &node) override { checkOrBuild(node, 0, filters_.nodes); }
 
-  void visitWay(const Way &way) override { checkOrBuild(way, filters_.ways); }
+  void visitWay(const Way &way) override { checkOrBuild(way, 1, filters_.ways); }
 
-  void visitArea(const Area &area) override { checkOrBuild(area, filters_.areas); }
+  void visitArea(const Area &area) override { checkOrBuild(area, 2, filters_.areas); }
 
-  void visitRelation(const Relation &relation) override { checkOrBuild(relation, filters_.relations); }
+  void visitRelation(const Relation &relation) override { checkOrBuild(relation, 3, filters_.relations); }
 
   bool canBuild() const { return canBuild_; }
 
@@ -139,64 +386,34 @@ class StyleBuilder final : public ElementVisitor {
 
  private:
 
-  void checkOrBuild(const Element &element, const ConditionFilterMap &filters) {
+  void checkOrBuild(const Element &element, std::uint8_t kind, const ConditionFilterMap &filters) {
     if (!buildFromIdentifier(element))
-      buildFromCondition(element.tags, filters);
-  }
-
-  /// Checks tag's value assuming that the key is already checked.
-  bool matchTag(const Tag &tag, const ConditionType &condition) {
-    switch (condition.type) {
-      case OpType::Exists:return true;
-      case OpType::Equals:return tag.value==condition.value;
-      case OpType::NotEquals:return tag.value!=condition.value;
-      case OpType::Less:return compareDoubles(tag.value, condition.value, std::less<double>());
-      case OpType::Greater:return compareDoubles(tag.value, condition.value, std::greater<double>());
-      default:return false;
-    }
-  }
-
-  /// Compares two raw string values using double conversion.
-  template<typename Func>
-  bool compareDoubles(std::uint32_t left, std::uint32_t right, Func binaryOp) {
-    double leftValue = utymap::utils::parseDouble(stringTable_.getString(left));
-    double rightValue = utymap::utils::parseDouble(stringTable_.getString(right));
-
-    return binaryOp(leftValue, rightValue);
-  }
-
-  /// Tries to find tag which satisfy condition using binary search.
-  bool matchTags(TagIterator begin, TagIterator end, const ConditionType &condition) {
-    while (begin < end) {
-      const TagIterator middle = begin + (std::distance(begin, end)/2);
-      if (middle->key==condition.key)
-        return matchTag(*middle, condition);
-      else if (middle->key > condition.key)
-        end = middle;
-      else
-        begin = middle + 1;
-    }
-    return false;
+      buildFromCondition(element.tags, kind, filters);
   }
 
   /// Builds style object from regular mapcss rule encapsulated by condition filter.
-  void buildFromCondition(const std::vector<Tag> &tags, const ConditionFilterMap &filters) {
+  void buildFromCondition(const std::vector<Tag> &tags, std::uint8_t kind, const ConditionFilterMap &filters) {
     ConditionFilterMap::const_iterator iter = filters.find(levelOfDetail_);
-    if (iter!=filters.end()) {
-      for (const ConditionFilter &filter : iter->second) {
-        bool isMatched = true;
-        for (auto it = filter.conditions.cbegin(); it!=filter.conditions.cend() && isMatched; ++it) {
-          isMatched &= matchTags(tags.cbegin(), tags.cend(), *it);
-        }
-        // merge declarations to style
-        if (isMatched) {
-          canBuild_ = true;
-          if (onlyCheck_) return;
+    if (iter==filters.end())
+      return;
+
+    const auto &lodFilters = iter->second;
+    auto matches = matchCache_.get(kind, levelOfDetail_, tags, [&]() {
+      MatchCache::Matches matches;
+      for (std::uint32_t i = 0; i < lodFilters.size(); ++i) {
+        if (matchConditions(stringTable_, tags, lodFilters[i].conditions))
+          matches.push_back(i);
+      }
+      return matches;
+    });
 
-          for (const auto &d : filter.declarations) {
-            style.put(*d);
-          }
-        }
+    canBuild_ = !matches->empty();
+    if (onlyCheck_) return;
+
+    // merge declarations to style
+    for (auto index : *matches) {
+      for (const auto &d : lodFilters[index].declarations) {
+        style.put(*d);
       }
     }
   }
@@ -219,12 +436,94 @@ class StyleBuilder final : public ElementVisitor {
   }
 
   const FilterCollection &filters_;
+  MatchCache &matchCache_;
   int levelOfDetail_;
   bool onlyCheck_;
   bool canBuild_;
   StringTable &stringTable_;
 };
 
+/// Resolves style decisions of element for level of details range in one pass over filters.
+class StyleSpanResolver final : public ElementVisitor {
+  /// Decisions of single level of details.
+  struct LodState final {
+    bool hasDeclarations = false;
+    bool clip = false;
+    bool skip = false;
+  };
+
+ public:
+  StyleSpanResolver(const StringTable &stringTable,
+                    const FilterCollection &filters,
+                    const SpanFilterCollection &spanFilters,
+                    std::uint32_t clipKeyId,
+                    std::uint32_t skipKeyId,
+                    const utymap::LodRange &range) :
+      stringTable_(stringTable), filters_(filters), spanFilters_(spanFilters),
+      clipKeyId_(clipKeyId), skipKeyId_(skipKeyId), range_(range) {
+  }
+
+  void visitNode(const Node &node) override { resolve(node, spanFilters_.nodes); }
+
+  void visitWay(const Way &way) override { resolve(way, spanFilters_.ways); }
+
+  void visitArea(const Area &area) override { resolve(area, spanFilters_.areas); }
+
+  void visitRelation(const Relation &relation) override { resolve(relation, spanFilters_.relations); }
+
+  StyleSpan span;
+
+ private:
+  void resolve(const Element &element, const SpanFilters &filters) {
+    LodState states[utymap::utils::GeoUtils::MaxLevelOfDetails + 1];
+    for (const auto &filter : filters) {
+      int start = std::max(filter.startLod, range_.start);
+      int end = std::min(filter.endLod, range_.end);
+      if (start > end || !matchConditions(stringTable_, element.tags, filter.conditions))
+        continue;
+
+      // NOTE filters are kept in stylesheet order, so the last declaration wins as in style.
+      for (int lod = start; lod <= end; ++lod) {
+        states[lod].hasDeclarations |= filter.hasDeclarations;
+        if (filter.clip >= 0) states[lod].clip = filter.clip==1;
+        if (filter.skip >= 0) states[lod].skip = filter.skip==1;
+      }
+    }
+
+    for (int lod = range_.start; lod <= range_.end; ++lod) {
+      resolveIdentifier(element, lod, states[lod]);
+      if (states[lod].hasDeclarations && !states[lod].skip) {
+        span.stored |= 1u << lod;
+        if (states[lod].clip)
+          span.clipped |= 1u << lod;
+      }
+    }
+  }
+
+  /// Replaces decisions of level of details if there is element id rule for it.
+  void resolveIdentifier(const Element &element, int lod, LodState &state) const {
+    auto filterMap = filters_.elements.find(lod);
+    if (filterMap==filters_.elements.end()) return;
+
+    auto elementStyle = filterMap->second.find(element.id);
+    if (elementStyle==filterMap->second.end()) return;
+
+    state = LodState();
+    state.hasDeclarations = !elementStyle->second.empty();
+    for (const auto &declaration : elementStyle->second) {
+      if (declaration->key()==clipKeyId_) state.clip = declaration->value()==TrueValue;
+      if (declaration->key()==skipKeyId_) state.skip = declaration->value()==TrueValue;
+    }
+  }
+
+  const StringTable &stringTable_;
+  const FilterCollection &filters_;
+  const SpanFilterCollection &spanFilters_;
+  const std::uint32_t clipKeyId_;
+  const std::uint32_t skipKeyId_;
+  const utymap::LodRange &range_;
+};
+
 }
 
 /// Converts mapcss stylesheet to index optimized representation to speed search query up.
@@ -232,11 +531,19 @@ class StyleProvider::StyleProviderImpl {
  public:
 
   FilterCollection filters;
+  SpanFilterCollection spanFilters;
+  MatchCache matchCache;
   StringTable &stringTable;
+  const std::uint32_t clipKeyId;
+  const std::uint32_t skipKeyId;
 
   StyleProviderImpl(const StyleSheet &stylesheet, StringTable &stringTable) :
       filters(),
+      spanFilters(),
+      matchCache(),
       stringTable(stringTable),
+      clipKeyId(stringTable.getId(StyleConsts::ClipKey())),
+      skipKeyId(stringTable.getId(StyleConsts::SkipKey())),
       gradients(),
       textures() {
     filters.nodes.reserve(24);
@@ -250,10 +557,11 @@ class StyleProvider::StyleProviderImpl {
       for (const Selector &selector : rule.selectors) {
         for (const std::string &name : selector.names) {
           ConditionFilterMap *filtersPtr = nullptr;
-          if (name=="node") filtersPtr = &filters.nodes;
-          else if (name=="way") filtersPtr = &filters.ways;
-          else if (name=="area") filtersPtr = &filters.areas;
-          else if (name=="relation") filtersPtr = &filters.relations;
+          SpanFilters *spanFiltersPtr = nullptr;
+          if (name=="node") filtersPtr = &filters.nodes, spanFiltersPtr = &spanFilters.nodes;
+          else if (name=="way") filtersPtr = &filters.ways, spanFiltersPtr = &spanFilters.ways;
+          else if (name=="area") filtersPtr = &filters.areas, spanFiltersPtr = &spanFilters.areas;
+          else if (name=="relation") filtersPtr = &filters.relations, spanFiltersPtr = &spanFilters.relations;
           else if (name=="canvas") filtersPtr = &filters.canvases;
           else if (name=="element") {
             addIdentifierRule(selector, rule.declarations);
@@ -261,7 +569,7 @@ class StyleProvider::StyleProviderImpl {
           } else
             throw std::domain_error("Unexpected selector name:" + name);
 
-          addConditionRule(filtersPtr, rule, selector);
+          addConditionRule(filtersPtr, spanFiltersPtr, rule, selector);
         }
       }
     }
@@ -276,12 +584,60 @@ class StyleProvider::StyleProviderImpl {
     }
 
     hashTag_ = getHashTag(filters);
+    matchCache.setConditionKeys(getConditionKeys());
   }
 
   const std::string &getTag() const {
     return hashTag_;
   }
 
+  /// Gets keys of tags used by condition filters and element declarations.
+  std::unordered_set<std::string> getTagKeys() const {
+    std::unordered_set<std::string> keys;
+    const ConditionFilterMap *filterMaps[] = {&filters.nodes, &filters.ways, &filters.areas,
+                                              &filters.relations, &filters.canvases};
+    for (const auto *filterMap : filterMaps) {
+      for (const auto &pair : *filterMap) {
+        for (const auto &filter : pair.second) {
+          for (const auto &condition : filter.conditions)
+            keys.insert(stringTable.getString(condition.key));
+          for (const auto &declaration : filter.declarations)
+            declaration->getTagKeys(keys);
+        }
+      }
+    }
+    for (const auto &pair : filters.elements) {
+      for (const auto &idPair : pair.second) {
+        for (const auto &declaration : idPair.second)
+          declaration->getTagKeys(keys);
+      }
+    }
+    return keys;
+  }
+
+  /// Gets keys of tags used by conditions of element filters.
+  std::unordered_set<std::uint32_t> getConditionKeys() const {
+    std::unordered_set<std::uint32_t> keys;
+    const ConditionFilterMap *filterMaps[] = {&filters.nodes, &filters.ways, &filters.areas, &filters.relations};
+    for (const auto *filterMap : filterMaps) {
+      for (const auto &pair : *filterMap) {
+        for (const auto &filter : pair.second) {
+          for (const auto &condition : filter.conditions)
+            keys.insert(condition.key);
+        }
+      }
+    }
+    return keys;
+  }
+
+  /// Gets amount of condition filters of given element kind at level of details.
+  std::size_t getFilterCount(std::uint8_t kind, int levelOfDetail) const {
+    const ConditionFilterMap *filterMaps[] = {&filters.nodes, &filters.ways, &filters.areas, &filters.relations};
+    if (kind >= 4) return 0;
+    auto iter = filterMaps[kind]->find(levelOfDetail);
+    return iter==filterMaps[kind]->end() ? 0 : iter->second.size();
+  }
+
   const ColorGradient &getGradient(const std::string &key) {
     auto gradientPair = gradients.find(key);
     if (gradientPair==gradients.end()) {
@@ -328,13 +684,29 @@ class StyleProvider::StyleProviderImpl {
   }
 
   /// Adds rule for element.
-  void addConditionRule(ConditionFilterMap *filtersPtr, const Rule &rule, const Selector &selector) {
+  void addConditionRule(ConditionFilterMap *filtersPtr,
+                        SpanFilters *spanFiltersPtr,
+                        const Rule &rule,
+                        const Selector &selector) {
     ConditionFilter filter;
     addConditions(filter, selector.conditions);
     addDeclarations(rule.declarations, [&](std::shared_ptr<const StyleDeclaration> declaration) {
       filter.declarations.push_back(declaration);
     });
     addToFilterMap(filtersPtr, filter, selector);
+    if (spanFiltersPtr!=nullptr)
+      addToSpanFilters(*spanFiltersPtr, filter, selector);
+  }
+
+  /// Adds filter with sorted conditions to span filters.
+  void addToSpanFilters(SpanFilters &spanFilters, const ConditionFilter &filter, const Selector &selector) const {
+    SpanFilter spanFilter{filter.conditions, selector.zoom.start, selector.zoom.end,
+                          !filter.declarations.empty(), -1, -1};
+    for (const auto &declaration : filter.declarations) {
+      if (declaration->key()==clipKeyId) spanFilter.clip = declaration->value()==TrueValue ? 1 : 0;
+      if (declaration->key()==skipKeyId) spanFilter.skip = declaration->value()==TrueValue ? 1 : 0;
+    }
+    spanFilters.push_back(spanFilter);
   }
 
   void addConditions(ConditionFilter &filter, const std::vector<Condition> &conditions) {
@@ -402,18 +774,51 @@ const std::string &StyleProvider::getTag() const {
   return pimpl_->getTag();
 }
 
+void StyleProvider::writeMatches(std::ostream &stream) const {
+  writeValue(stream, static_cast<std::uint32_t>(pimpl_->getTag().size()));
+  stream.write(pimpl_->getTag().data(), pimpl_->getTag().size());
+  pimpl_->matchCache.write(stream);
+}
+
+bool StyleProvider::readMatches(std::istream &stream) const {
+  std::uint32_t size;
+  if (!readValue(stream, size) || size!=pimpl_->getTag().size())
+    return false;
+
+  std::string tag(size, '\0');
+  if (!stream.read(&tag[0], size) || tag!=pimpl_->getTag())
+    return false;
+
+  auto &impl = *pimpl_;
+  impl.matchCache.read(stream, [&](std::uint8_t kind, int levelOfDetail) {
+    return impl.getFilterCount(kind, levelOfDetail);
+  });
+  return true;
+}
+
+std::unordered_set<std::string> StyleProvider::getTagKeys() const {
+  return pimpl_->getTagKeys();
+}
+
 bool StyleProvider::hasStyle(const utymap::entities::Element &element, int levelOfDetails) const {
-  StyleBuilder builder(element.tags, pimpl_->stringTable, pimpl_->filters, levelOfDetails, true);
+  StyleBuilder builder(element.tags, pimpl_->stringTable, pimpl_->filters, pimpl_->matchCache, levelOfDetails, true);
   element.accept(builder);
   return builder.canBuild();
 }
 
 Style StyleProvider::forElement(const Element &element, int levelOfDetails) const {
-  StyleBuilder builder(element.tags, pimpl_->stringTable, pimpl_->filters, levelOfDetails);
+  StyleBuilder builder(element.tags, pimpl_->stringTable, pimpl_->filters, pimpl_->matchCache, levelOfDetails);
   element.accept(builder);
   return std::move(builder.style);
 }
 
+StyleSpan StyleProvider::forLodRange(const Element &element, const utymap::LodRange &range) const {
+  StyleSpanResolver resolver(pimpl_->stringTable, pimpl_->filters, pimpl_->spanFilters,
+                             pimpl_->clipKeyId, pimpl_->skipKeyId, range);
+  element.accept(resolver);
+  return resolver.span;
+}
+
 Style StyleProvider::forCanvas(int levelOfDetails) const {
   Style style({}, pimpl_->stringTable);
   for (const auto &filter : pimpl_->filters.canvases[levelOfDetails]) {
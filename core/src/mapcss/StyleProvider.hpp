@@ -1,6 +1,7 @@
 #ifndef INDEX_STYLEPROVIDER_HPP_DEFINED
 #define INDEX_STYLEPROVIDER_HPP_DEFINED
 
+#include "LodRange.hpp"
 #include "index/StringTable.hpp"
 #include "entities/Element.hpp"
 #include "mapcss/ColorGradient.hpp"
@@ -8,12 +9,26 @@
 #include "mapcss/Style.hpp"
 #include "lsys/LSystem.hpp"
 
+#include <iosfwd>
 #include <string>
 #include <memory>
+#include <unordered_set>
 
 namespace utymap {
 namespace mapcss {
 
+/// Describes how element is stored at levels of details of some range.
+struct StyleSpan final {
+  /// Bit is set if element has non empty style without skip at given level of details.
+  std::uint32_t stored = 0;
+  /// Bit is set if element should be clipped at given level of details.
+  std::uint32_t clipped = 0;
+
+  bool isStored(int levelOfDetails) const { return ((stored >> levelOfDetails) & 1)!=0; }
+
+  bool isClipped(int levelOfDetails) const { return ((clipped >> levelOfDetails) & 1)!=0; }
+};
+
 /// This class responsible for providing element styles.
 class StyleProvider final {
  public:
@@ -37,6 +52,22 @@ class StyleProvider final {
   /// Returns style for given element at given level of details.
   Style forElement(const utymap::entities::Element &, int levelOfDetails) const;
 
+  /// Resolves at which levels of details of given range element should be stored and clipped.
+  /// Unlike forElement, it does not build style and matches each rule only once.
+  StyleSpan forLodRange(const utymap::entities::Element &, const utymap::LodRange &range) const;
+
+  /// Writes condition rules matched by styled elements, so another provider created from
+  /// the same stylesheet can build styles by rule lookup instead of rule matching.
+  void writeMatches(std::ostream &stream) const;
+
+  /// Reads matched rules written by writeMatches. Returns false if they were written for
+  /// stylesheet with different tag: in this case rules are matched for every element.
+  bool readMatches(std::istream &stream) const;
+
+  /// Returns keys of tags referenced by selector conditions and evaluated declarations.
+  /// Tags with other keys cannot affect styles of elements.
+  std::unordered_set<std::string> getTagKeys() const;
+
   /// Returns style for canvas at given level of details.
   Style forCanvas(int levelOfDetails) const;
 
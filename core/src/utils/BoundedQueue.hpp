@@ -0,0 +1,62 @@
+#ifndef UTILS_BOUNDEDQUEUE_HPP_DEFINED
+#define UTILS_BOUNDEDQUEUE_HPP_DEFINED
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+
+namespace utymap {
+namespace utils {
+
+/// Blocking queue with limited capacity.
+template<typename T>
+class BoundedQueue final {
+ public:
+  explicit BoundedQueue(std::size_t capacity) : capacity_(capacity), isClosed_(false) {
+  }
+
+  /// Adds item waiting while queue is full. Returns false if queue is closed.
+  bool push(T item) {
+    std::unique_lock<std::mutex> lock(lock_);
+    notFull_.wait(lock, [&] { return isClosed_ || items_.size() < capacity_; });
+    if (isClosed_) return false;
+
+    items_.push_back(std::move(item));
+    notEmpty_.notify_one();
+    return true;
+  }
+
+  /// Takes item waiting while queue is empty. Returns false if queue is closed and empty.
+  bool pop(T &item) {
+    std::unique_lock<std::mutex> lock(lock_);
+    notEmpty_.wait(lock, [&] { return isClosed_ || !items_.empty(); });
+    if (items_.empty()) return false;
+
+    item = std::move(items_.front());
+    items_.pop_front();
+    notFull_.notify_one();
+    return true;
+  }
+
+  /// Closes queue: remaining items can be taken, new ones are rejected.
+  void close() {
+    std::lock_guard<std::mutex> lock(lock_);
+    isClosed_ = true;
+    notFull_.notify_all();
+    notEmpty_.notify_all();
+  }
+
+ private:
+  const std::size_t capacity_;
+  bool isClosed_;
+  std::deque<T> items_;
+  std::mutex lock_;
+  std::condition_variable notFull_;
+  std::condition_variable notEmpty_;
+};
+
+}
+}
+
+#endif // UTILS_BOUNDEDQUEUE_HPP_DEFINED
@@ -0,0 +1,91 @@
+#include "utils/FileUtils.hpp"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <cstdio>
+
+using namespace utymap::utils;
+
+std::vector<std::string> FileUtils::getEntryNames(const std::string &directory) {
+  std::vector<std::string> names;
+#ifdef _WIN32
+  WIN32_FIND_DATAA data;
+  HANDLE handle = FindFirstFileA((directory + "*").c_str(), &data);
+  if (handle==INVALID_HANDLE_VALUE)
+    return names;
+  do {
+    names.push_back(data.cFileName);
+  } while (FindNextFileA(handle, &data));
+  FindClose(handle);
+#else
+  DIR *dir = opendir(directory.c_str());
+  if (dir==nullptr)
+    return names;
+  while (dirent *entry = readdir(dir))
+    names.push_back(entry->d_name);
+  closedir(dir);
+#endif
+
+  // NOTE current and parent directories are listed too.
+  std::vector<std::string> entries;
+  for (const auto &name : names) {
+    if (name!="." && name!="..")
+      entries.push_back(name);
+  }
+  return entries;
+}
+
+bool FileUtils::createDirectories(const std::string &directory) {
+  // NOTE directory is created level by level: existing levels just fail to be created again.
+  for (std::size_t i = 1; i <= directory.size(); ++i) {
+    if (i!=directory.size() && directory[i]!='/' && directory[i]!='\\')
+      continue;
+    auto path = directory.substr(0, i);
+#ifdef _WIN32
+    CreateDirectoryA(path.c_str(), nullptr);
+#else
+    mkdir(path.c_str(), 0755);
+#endif
+  }
+
+#ifdef _WIN32
+  DWORD attributes = GetFileAttributesA(directory.c_str());
+  return attributes!=INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY)!=0;
+#else
+  struct stat status;
+  return stat(directory.c_str(), &status)==0 && S_ISDIR(status.st_mode);
+#endif
+}
+
+void FileUtils::removeDirectory(const std::string &directory) {
+  std::string path = directory;
+  if (!path.empty() && path.back()!='/' && path.back()!='\\')
+    path += '/';
+
+  for (const auto &name : getEntryNames(path)) {
+    auto entry = path + name;
+#ifdef _WIN32
+    DWORD attributes = GetFileAttributesA(entry.c_str());
+    bool isDirectory = attributes!=INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY)!=0;
+#else
+    struct stat status;
+    bool isDirectory = lstat(entry.c_str(), &status)==0 && S_ISDIR(status.st_mode);
+#endif
+    if (isDirectory)
+      removeDirectory(entry);
+    else
+      std::remove(entry.c_str());
+  }
+
+#ifdef _WIN32
+  RemoveDirectoryA(path.c_str());
+#else
+  rmdir(path.c_str());
+#endif
+}
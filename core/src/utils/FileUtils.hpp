@@ -0,0 +1,28 @@
+#ifndef UTILS_FILEUTILS_HPP_DEFINED
+#define UTILS_FILEUTILS_HPP_DEFINED
+
+#include <string>
+#include <vector>
+
+namespace utymap {
+namespace utils {
+
+/// Provides file system functions which are not available in standard library.
+class FileUtils final {
+ public:
+  /// Gets names of files and subdirectories inside given directory. Missing directory
+  /// has no entries.
+  static std::vector<std::string> getEntryNames(const std::string &directory);
+
+  /// Creates directory with all missing parent directories. Returns false if directory
+  /// does not exist afterwards.
+  static bool createDirectories(const std::string &directory);
+
+  /// Removes directory with all its content. Missing directory is ignored.
+  static void removeDirectory(const std::string &directory);
+};
+
+}
+}
+
+#endif // UTILS_FILEUTILS_HPP_DEFINED
@@ -7,6 +7,7 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstdint>
 #include <string>
 
 namespace utymap {
@@ -68,6 +69,43 @@ class GeoUtils final {
     return code;
   }
 
+  /// Parses quadkey string created by quadKeyToString. Returns false if string is not quadkey.
+  static bool stringToQuadKey(const std::string &code, QuadKey &quadKey) {
+    if (code.empty() || code.size() > static_cast<std::size_t>(MaxLevelOfDetails))
+      return false;
+
+    quadKey = QuadKey(static_cast<int>(code.size()), 0, 0);
+    for (char digit : code) {
+      if (digit < '0' || digit > '3')
+        return false;
+      quadKey.tileX = (quadKey.tileX << 1) | ((digit - '0') & 1);
+      quadKey.tileY = (quadKey.tileY << 1) | ((digit - '0') >> 1);
+    }
+    return true;
+  }
+
+  /// Converts quadkey to numeric code: level of details is stored in high bits,
+  /// tile position is encoded by interleaving bits of x and y (z-order curve).
+  /// NOTE codes of the same level of details are sorted in quadkey string order.
+  static std::uint64_t quadKeyToCode(const QuadKey &quadKey) {
+    std::uint64_t code = 0;
+    for (int i = 0; i < quadKey.levelOfDetail; ++i) {
+      code |= static_cast<std::uint64_t>((quadKey.tileX >> i) & 1) << (2*i);
+      code |= static_cast<std::uint64_t>((quadKey.tileY >> i) & 1) << (2*i + 1);
+    }
+    return (static_cast<std::uint64_t>(quadKey.levelOfDetail) << 48) | code;
+  }
+
+  /// Converts numeric code created by quadKeyToCode back to quadkey.
+  static QuadKey codeToQuadKey(std::uint64_t code) {
+    QuadKey quadKey(static_cast<int>(code >> 48), 0, 0);
+    for (int i = 0; i < quadKey.levelOfDetail; ++i) {
+      quadKey.tileX |= static_cast<int>((code >> (2*i)) & 1) << i;
+      quadKey.tileY |= static_cast<int>((code >> (2*i + 1)) & 1) << i;
+    }
+    return quadKey;
+  }
+
   /// Visits all tiles which are intersecting with given bounding box at given level of details
   template<typename Visitor>
   static void visitTileRange(const BoundingBox &bbox, int levelOfDetail, const Visitor &visitor) {
@@ -48,10 +48,31 @@ class LruCache final {
     return itemsMap_.find(key)!=itemsMap_.end();
   }
 
+  /// Removes item with given key if it exists.
+  void remove(const Key &key) {
+    auto it = itemsMap_.find(key);
+    if (it==itemsMap_.end()) return;
+    itemsList_.erase(it->second);
+    itemsMap_.erase(it);
+  }
+
+  /// Visits items from the least to the most recently used one.
+  template<typename Visitor>
+  void visit(const Visitor &visitor) const {
+    for (auto it = itemsList_.rbegin(); it!=itemsList_.rend(); ++it)
+      visitor(it->first, it->second);
+  }
+
   size_t size() const {
     return itemsMap_.size();
   }
 
+  /// Removes all items from cache.
+  void clear() {
+    itemsMap_.clear();
+    itemsList_.clear();
+  }
+
  private:
   std::list<KeyValuePair> itemsList_;
   std::map<Key, ListIterator, Comparator> itemsMap_;
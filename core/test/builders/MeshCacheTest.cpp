@@ -185,4 +185,38 @@ BOOST_AUTO_TEST_CASE(GivenMesh_WhenStoreAndFetch_ThenItIsStoredAndReadBack) {
   assertStoreAndFetch(mesh);
 }
 
+BOOST_AUTO_TEST_CASE(GivenCachedElement_WhenInvalidate_ThenItIsNotFetched) {
+  Node node = ElementUtils::createElement<Node>(*dependencyProvider.getStringTable(), 1, {{"any", "true"}});
+  wrapContext.elementCallback(node);
+  cache_.unwrap(wrapContext);
+  resetData();
+
+  cache_.invalidate(quadKey, dependencyProvider.getStyleProvider()->getTag());
+
+  BOOST_CHECK(!cache_.fetch(origContext));
+  BOOST_CHECK_EQUAL(lastId_, 0);
+}
+
+BOOST_AUTO_TEST_CASE(GivenCachedElement_WhenInvalidateForAllStyles_ThenItIsNotFetched) {
+  Node node = ElementUtils::createElement<Node>(*dependencyProvider.getStringTable(), 1, {{"any", "true"}});
+  wrapContext.elementCallback(node);
+  cache_.unwrap(wrapContext);
+  resetData();
+
+  cache_.invalidate(quadKey);
+
+  BOOST_CHECK(!cache_.fetch(origContext));
+  BOOST_CHECK_EQUAL(lastId_, 0);
+}
+
+BOOST_AUTO_TEST_CASE(GivenElementBeingCached_WhenInvalidate_ThenItIsDiscardedOnUnwrap) {
+  Node node = ElementUtils::createElement<Node>(*dependencyProvider.getStringTable(), 1, {{"any", "true"}});
+  wrapContext.elementCallback(node);
+
+  cache_.invalidate(quadKey, dependencyProvider.getStyleProvider()->getTag());
+  cache_.unwrap(wrapContext);
+
+  BOOST_CHECK(!cache_.fetch(origContext));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,102 @@
+#include "formats/osm/NodeLocationStore.hpp"
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+
+using namespace utymap;
+using namespace utymap::formats;
+
+namespace {
+const double Precision = 1E-7;
+const std::string LocationFile = "node_locations.dat";
+
+struct Formats_Osm_NodeLocationStoreFixture {
+  /// Adds nodes with ids from given list, coordinates are derived from ids.
+  static void addNodes(NodeLocationStore &store, const std::vector<std::uint64_t> &ids) {
+    for (auto id : ids)
+      store.add(id, GeoCoordinate(id/100., -(id/100.)));
+  }
+
+  static void checkResolve(NodeLocationStore &store, std::uint64_t id) {
+    GeoCoordinate coordinate;
+    BOOST_REQUIRE(store.resolve(id, coordinate));
+    BOOST_CHECK_CLOSE_FRACTION(coordinate.latitude, id/100., Precision);
+    BOOST_CHECK_CLOSE_FRACTION(coordinate.longitude, -(id/100.), Precision);
+  }
+};
+}
+
+BOOST_FIXTURE_TEST_SUITE(Formats_Osm_NodeLocationStore, Formats_Osm_NodeLocationStoreFixture)
+
+BOOST_AUTO_TEST_CASE(GivenSortedNodes_WhenResolve_ThenReturnsTheirLocations) {
+  NodeLocationStore store;
+  addNodes(store, {1, 5, 42, 1000, 1001});
+  GeoCoordinate coordinate;
+
+  for (auto id : {1, 5, 42, 1000, 1001})
+    checkResolve(store, id);
+  BOOST_CHECK(!store.resolve(2, coordinate));
+  BOOST_CHECK(!store.resolve(2000, coordinate));
+}
+
+BOOST_AUTO_TEST_CASE(GivenUnsortedNodesWithDuplicate_WhenResolve_ThenLastLocationIsReturned) {
+  NodeLocationStore store;
+  addNodes(store, {42, 5, 1000, 1});
+  store.add(5, GeoCoordinate(10, 20));
+  GeoCoordinate coordinate;
+
+  BOOST_REQUIRE(store.resolve(5, coordinate));
+
+  BOOST_CHECK_EQUAL(store.size(), 4);
+  BOOST_CHECK_CLOSE_FRACTION(coordinate.latitude, 10, Precision);
+  BOOST_CHECK_CLOSE_FRACTION(coordinate.longitude, 20, Precision);
+  checkResolve(store, 42);
+}
+
+BOOST_AUTO_TEST_CASE(GivenFileStore_WhenVisitUnresolved_ThenVisitsOnlyNotResolvedNodes) {
+  std::vector<std::uint64_t> unresolved;
+  {
+    NodeLocationStore store(LocationFile);
+    addNodes(store, {1, 2, 3});
+    checkResolve(store, 2);
+    addNodes(store, {7, 4});
+    checkResolve(store, 4);
+
+    store.visitUnresolved([&](std::uint64_t id, const GeoCoordinate &) { unresolved.push_back(id); });
+  }
+
+  BOOST_CHECK(unresolved==std::vector<std::uint64_t>({1, 3, 7}));
+  BOOST_CHECK(!boost::filesystem::exists(LocationFile));
+}
+
+BOOST_AUTO_TEST_CASE(GivenNodeAddedAsResolved_WhenVisitUnresolved_ThenItIsSkippedButCanBeResolved) {
+  std::vector<std::uint64_t> unresolved;
+  NodeLocationStore store;
+  addNodes(store, {3, 1});
+  store.add(2, GeoCoordinate(0.02, -0.02), true);
+
+  store.visitUnresolved([&](std::uint64_t id, const GeoCoordinate &) { unresolved.push_back(id); });
+
+  BOOST_CHECK(unresolved==std::vector<std::uint64_t>({1, 3}));
+  checkResolve(store, 2);
+}
+
+BOOST_AUTO_TEST_CASE(GivenMemoryBudget_WhenItIsExceeded_ThenLocationsAreMovedToFile) {
+  {
+    NodeLocationStore store(LocationFile, 3*16);
+    addNodes(store, {1, 2, 3});
+    BOOST_CHECK(!boost::filesystem::exists(LocationFile));
+
+    addNodes(store, {5, 4});
+
+    BOOST_CHECK(boost::filesystem::exists(LocationFile));
+    BOOST_CHECK_EQUAL(store.size(), 5);
+    for (auto id : {1, 2, 3, 4, 5})
+      checkResolve(store, id);
+  }
+  BOOST_CHECK(!boost::filesystem::exists(LocationFile));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,121 @@
+#include "entities/Node.hpp"
+#include "entities/Way.hpp"
+#include "entities/Area.hpp"
+#include "entities/Relation.hpp"
+#include "formats/osm/OsmChangeProcessor.hpp"
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "test_utils/DependencyProvider.hpp"
+
+#include <map>
+#include <sstream>
+
+using namespace utymap;
+using namespace utymap::entities;
+using namespace utymap::formats;
+using namespace utymap::tests;
+
+namespace {
+const std::string SourcePath = "osm_change_source";
+const std::string Header = "<?xml version='1.0' encoding='UTF-8'?><osmChange version=\"0.6\">";
+const std::string Footer = "</osmChange>";
+
+/// Keeps coordinates of visited ways and ids of visited nodes.
+struct ElementCollector final : public ElementVisitor {
+  std::vector<std::uint64_t> nodes;
+  std::map<std::uint64_t, std::vector<GeoCoordinate>> ways;
+
+  void visitNode(const Node &node) override { nodes.push_back(node.id); }
+  void visitWay(const Way &way) override { ways[way.id] = way.coordinates; }
+  void visitArea(const Area &) override {}
+  void visitRelation(const Relation &) override {}
+};
+
+struct Formats_Osm_OsmChangeProcessorFixture {
+  Formats_Osm_OsmChangeProcessorFixture() {
+    removeFiles();
+    sourceStore = std::make_shared<OsmSourceStore>(SourcePath);
+    sourceStore->addNode(1, GeoCoordinate(0, 0));
+    sourceStore->addNode(2, GeoCoordinate(0, 1));
+    sourceStore->addNode(3, GeoCoordinate(1, 1));
+    auto stringTable = dependencyProvider.getStringTable();
+    sourceStore->addWay(10, {1, 2, 3}, {utymap::entities::Tag(stringTable->getId("highway"),
+                                                              stringTable->getId("primary"))});
+  }
+
+  ~Formats_Osm_OsmChangeProcessorFixture() {
+    sourceStore.reset();
+    removeFiles();
+  }
+
+  static void removeFiles() {
+    for (const auto &extension : {".nodes", ".ways", ".ways.idx", ".ways.refs",
+                                  ".relations", ".relations.idx", ".relations.refs"})
+      boost::filesystem::remove(SourcePath + extension);
+  }
+
+  void process(const std::string &body, std::shared_ptr<OsmSourceStore> store) {
+    std::stringstream stream(Header + body + Footer);
+    OsmChangeProcessor(*dependencyProvider.getStringTable(), store).process(stream, [&](Element &element) {
+      element.accept(erased);
+      return true;
+    }, [&](Element &element) {
+      element.accept(added);
+      return true;
+    });
+  }
+
+  DependencyProvider dependencyProvider;
+  std::shared_ptr<OsmSourceStore> sourceStore;
+  ElementCollector erased;
+  ElementCollector added;
+};
+}
+
+BOOST_FIXTURE_TEST_SUITE(Formats_Osm_OsmChangeProcessor, Formats_Osm_OsmChangeProcessorFixture)
+
+BOOST_AUTO_TEST_CASE(GivenMovedNodeOfUnchangedWay_WhenProcess_ThenWayIsRebuilt) {
+  process("<modify><node id=\"2\" lat=\"0.5\" lon=\"0.5\"/></modify>", sourceStore);
+
+  BOOST_REQUIRE_EQUAL(erased.ways.count(10), 1);
+  BOOST_CHECK_EQUAL(erased.ways[10][1].longitude, 1);
+  BOOST_REQUIRE_EQUAL(added.ways.count(10), 1);
+  BOOST_CHECK_EQUAL(added.ways[10][1].longitude, 0.5);
+  BOOST_REQUIRE_EQUAL(erased.nodes.size(), 1);
+  BOOST_CHECK_EQUAL(erased.nodes[0], 2);
+  BOOST_REQUIRE_EQUAL(added.nodes.size(), 1);
+  BOOST_CHECK_EQUAL(added.nodes[0], 2);
+}
+
+BOOST_AUTO_TEST_CASE(GivenModifiedWayWithoutItsNodes_WhenProcess_ThenStoredNodesAreUsed) {
+  process("<modify><way id=\"10\"><nd ref=\"1\"/><nd ref=\"3\"/></way></modify>", sourceStore);
+
+  BOOST_REQUIRE_EQUAL(erased.ways.count(10), 1);
+  BOOST_CHECK_EQUAL(erased.ways[10].size(), 3);
+  BOOST_REQUIRE_EQUAL(added.ways.count(10), 1);
+  BOOST_CHECK_EQUAL(added.ways[10].size(), 2);
+  BOOST_CHECK(added.nodes.empty());
+}
+
+BOOST_AUTO_TEST_CASE(GivenDeletedWayWithoutNodes_WhenProcess_ThenPreviousVersionIsErased) {
+  process("<delete><way id=\"10\"/></delete>", sourceStore);
+
+  BOOST_REQUIRE_EQUAL(erased.ways.count(10), 1);
+  BOOST_CHECK_EQUAL(erased.ways[10].size(), 3);
+  BOOST_CHECK(added.ways.empty());
+  BOOST_CHECK(sourceStore->findWays({10}).empty());
+}
+
+BOOST_AUTO_TEST_CASE(GivenNoSourceStore_WhenProcess_ThenOnlyElementsOfFileAreUsed) {
+  process("<modify><node id=\"2\" lat=\"0.5\" lon=\"0.5\"/><node id=\"4\" lat=\"2\" lon=\"2\"/>"
+          "<way id=\"11\"><nd ref=\"2\"/><nd ref=\"4\"/></way></modify>", nullptr);
+
+  BOOST_CHECK_EQUAL(erased.ways.count(10), 0);
+  BOOST_CHECK_EQUAL(added.ways.count(10), 0);
+  BOOST_REQUIRE_EQUAL(added.ways.count(11), 1);
+  BOOST_CHECK_EQUAL(added.ways[11].size(), 2);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -1,3 +1,5 @@
+#include "entities/Node.hpp"
+#include "entities/Way.hpp"
 #include "entities/Relation.hpp"
 #include "formats/osm/OsmDataVisitor.hpp"
 
@@ -37,4 +39,102 @@ BOOST_AUTO_TEST_CASE(GivenRelationWithRecursion_WhenComplete_ThenDoesNotCrash) {
   visitor.complete();
 }
 
+BOOST_AUTO_TEST_CASE(GivenTagPruner_WhenVisitNode_ThenOnlyKeptTagsAreSet) {
+  auto stringTable = dependencyProvider.getStringTable();
+  std::vector<utymap::entities::Tag> nodeTags;
+  OsmDataVisitor prunedVisitor(*stringTable, [&](Element &element) {
+    nodeTags = element.tags;
+    return true;
+  }, TagPruner({"highway", "name"}));
+  utymap::GeoCoordinate coordinate(1, 1);
+  Tags tags = {{"highway", "bus_stop"}, {"name", "Stop"}, {"note", "moved"}, {"source", "survey"}};
+
+  prunedVisitor.visitNode(1, coordinate, tags);
+  prunedVisitor.complete();
+
+  BOOST_REQUIRE_EQUAL(nodeTags.size(), 2);
+  BOOST_CHECK(utymap::utils::hasTag(stringTable->getId("highway"), stringTable->getId("bus_stop"), nodeTags));
+  BOOST_CHECK(utymap::utils::hasTag(stringTable->getId("name"), stringTable->getId("Stop"), nodeTags));
+}
+
+BOOST_AUTO_TEST_CASE(GivenTagPruner_WhenVisitMultipolygonRelation_ThenItKeepsOwnTags) {
+  auto stringTable = dependencyProvider.getStringTable();
+  std::vector<utymap::entities::Tag> relationTags;
+  OsmDataVisitor prunedVisitor(*stringTable, [&](Element &element) {
+    if (dynamic_cast<const utymap::entities::Relation *>(&element))
+      relationTags = element.tags;
+    return true;
+  }, TagPruner({"building", "type"}));
+  Tags noTags;
+  for (std::uint64_t id = 1; id <= 3; ++id) {
+    utymap::GeoCoordinate coordinate(id, id%2);
+    prunedVisitor.visitNode(id, coordinate, noTags);
+  }
+  std::vector<std::uint64_t> nodeIds = {1, 2, 3, 1};
+  Tags wayTags = {{"building", "yes"}};
+  prunedVisitor.visitWay(10, nodeIds, wayTags);
+  RelationMembers members = {{10, "w", "outer"}};
+  Tags tags = {{"type", "multipolygon"}, {"natural", "water"}};
+
+  prunedVisitor.visitRelation(100, members, tags);
+  prunedVisitor.complete();
+
+  BOOST_CHECK_EQUAL(relationTags.size(), 2);
+  BOOST_CHECK(utymap::utils::hasTag(stringTable->getId("natural"), stringTable->getId("water"), relationTags));
+  BOOST_CHECK(!utymap::utils::hasTag(stringTable->getId("building"), stringTable->getId("yes"), relationTags));
+}
+
+BOOST_AUTO_TEST_CASE(GivenNodeLocationStore_WhenComplete_ThenUntaggedWayVerticesAreNotAdded) {
+  auto stringTable = dependencyProvider.getStringTable();
+  std::vector<std::uint64_t> nodeIds;
+  std::vector<utymap::GeoCoordinate> wayCoordinates;
+  OsmDataVisitor locationVisitor(*stringTable, [&](Element &element) {
+    if (auto node = dynamic_cast<const utymap::entities::Node *>(&element))
+      nodeIds.push_back(node->id);
+    else if (auto way = dynamic_cast<const utymap::entities::Way *>(&element))
+      wayCoordinates = way->coordinates;
+    return true;
+  }, TagPruner(), utymap::utils::make_unique<NodeLocationStore>());
+  Tags noTags, tags = {{"highway", "crossing"}};
+  for (std::uint64_t id = 1; id <= 4; ++id) {
+    utymap::GeoCoordinate coordinate(id, id);
+    locationVisitor.visitNode(id, coordinate, id==2 ? tags : noTags);
+  }
+  std::vector<std::uint64_t> wayNodeIds = {1, 2, 3};
+
+  locationVisitor.visitWay(10, wayNodeIds, tags);
+  locationVisitor.complete();
+
+  BOOST_CHECK(nodeIds==std::vector<std::uint64_t>({2, 4}));
+  BOOST_REQUIRE_EQUAL(wayCoordinates.size(), 3);
+  BOOST_CHECK_CLOSE_FRACTION(wayCoordinates[2].latitude, 3, 1E-7);
+}
+
+BOOST_AUTO_TEST_CASE(GivenRelationMemberCollector_WhenVisitWay_ThenOnlyNotMemberWayIsAddedImmediately) {
+  auto stringTable = dependencyProvider.getStringTable();
+  Tags tags = {{"highway", "primary"}};
+  RelationMembers members = {{1, "w", "outer"}};
+  auto collector = std::make_shared<RelationMemberCollector>();
+  collector->visitRelation(100, members, tags);
+  collector->complete();
+  std::vector<std::uint64_t> wayIds;
+  OsmDataVisitor streamingVisitor(*stringTable, [&](Element &element) {
+    wayIds.push_back(element.id);
+    return true;
+  }, TagPruner(), nullptr, collector);
+  for (std::uint64_t id = 1; id <= 3; ++id) {
+    utymap::GeoCoordinate coordinate(id, id);
+    Tags noTags;
+    streamingVisitor.visitNode(id, coordinate, noTags);
+  }
+  std::vector<std::uint64_t> nodeIds = {1, 2, 3};
+
+  streamingVisitor.visitWay(1, nodeIds, tags);
+  streamingVisitor.visitWay(2, nodeIds, tags);
+
+  BOOST_CHECK(wayIds==std::vector<std::uint64_t>({2}));
+  streamingVisitor.complete();
+  BOOST_CHECK(wayIds==std::vector<std::uint64_t>({2, 1}));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,115 @@
+#include "formats/osm/OsmSourceStore.hpp"
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/test/unit_test.hpp>
+
+using namespace utymap;
+using namespace utymap::formats;
+
+namespace {
+const double Precision = 1E-7;
+const std::string SourcePath = "osm_source";
+
+struct Formats_Osm_OsmSourceStoreFixture {
+  Formats_Osm_OsmSourceStoreFixture() {
+    removeFiles();
+  }
+
+  ~Formats_Osm_OsmSourceStoreFixture() {
+    removeFiles();
+  }
+
+  static void removeFiles() {
+    for (const auto &extension : {".nodes", ".ways", ".ways.idx", ".ways.refs",
+                                  ".relations", ".relations.idx", ".relations.refs"})
+      boost::filesystem::remove(SourcePath + extension);
+  }
+};
+}
+
+BOOST_FIXTURE_TEST_SUITE(Formats_Osm_OsmSourceStore, Formats_Osm_OsmSourceStoreFixture)
+
+BOOST_AUTO_TEST_CASE(GivenNodesWithNewerVersions_WhenFindNodes_ThenLastLocationsAreReturned) {
+  OsmSourceStore store(SourcePath);
+  store.addNode(1, GeoCoordinate(1, 1));
+  store.addNode(2, GeoCoordinate(2, 2));
+  store.addNode(3, GeoCoordinate(3, 3));
+  store.addNode(1, GeoCoordinate(10, -10));
+  store.removeNode(3);
+
+  auto nodes = store.findNodes({1, 3, 4});
+
+  BOOST_REQUIRE_EQUAL(nodes.size(), 1);
+  BOOST_CHECK_CLOSE_FRACTION(nodes[1].latitude, 10, Precision);
+  BOOST_CHECK_CLOSE_FRACTION(nodes[1].longitude, -10, Precision);
+}
+
+BOOST_AUTO_TEST_CASE(GivenWaysInClosedStore_WhenFindWaysByNode_ThenLastVersionsAreReturned) {
+  {
+    OsmSourceStore store(SourcePath);
+    store.addWay(1, {1, 2}, {utymap::entities::Tag(1, 2)});
+    store.addWay(2, {3, 4}, {});
+    store.addWay(3, {2, 5}, {});
+    store.addWay(1, {6, 7, 8}, {utymap::entities::Tag(3, 4)});
+    store.removeWay(3);
+  }
+  OsmSourceStore store(SourcePath);
+
+  auto ways = store.findWaysByNodes({2});
+
+  BOOST_REQUIRE_EQUAL(ways.size(), 1);
+  BOOST_CHECK_EQUAL(ways[1].nodeIds.size(), 3);
+  BOOST_REQUIRE_EQUAL(ways[1].tags.size(), 1);
+  BOOST_CHECK_EQUAL(ways[1].tags[0].key, 3);
+}
+
+BOOST_AUTO_TEST_CASE(GivenRelation_WhenFindRelations_ThenMembersAreReadBack) {
+  OsmSourceStore store(SourcePath);
+  store.addRelation(1, {RelationMember{2, "w", "outer"}, RelationMember{3, "n", ""}}, {utymap::entities::Tag(1, 2)});
+
+  auto relations = store.findRelations({1});
+
+  BOOST_REQUIRE_EQUAL(relations.size(), 1);
+  const auto &members = relations[1].members;
+  BOOST_REQUIRE_EQUAL(members.size(), 2);
+  BOOST_CHECK_EQUAL(members[0].refId, 2);
+  BOOST_CHECK_EQUAL(members[0].type, "w");
+  BOOST_CHECK_EQUAL(members[0].role, "outer");
+  BOOST_CHECK_EQUAL(members[1].type, "n");
+  BOOST_CHECK(members[1].role.empty());
+}
+
+BOOST_AUTO_TEST_CASE(GivenWaysAddedAfterLookup_WhenFindWays_ThenLastVersionsAreReturned) {
+  OsmSourceStore store(SourcePath);
+  store.addWay(1, {1, 2}, {});
+  BOOST_CHECK_EQUAL(store.findWays({1, 2}).size(), 1);
+  store.addWay(2, {2, 3}, {});
+  store.addWay(1, {4, 5, 6}, {});
+
+  auto ways = store.findWays({1, 2});
+  auto nodeWays = store.findWaysByNodes({3, 4});
+
+  BOOST_REQUIRE_EQUAL(ways.size(), 2);
+  BOOST_CHECK_EQUAL(ways[1].nodeIds.size(), 3);
+  BOOST_CHECK_EQUAL(nodeWays.size(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(GivenRelationsInClosedStore_WhenFindRelationsByMembers_ThenOnlyRelationsWithThemAreReturned) {
+  {
+    OsmSourceStore store(SourcePath);
+    store.addRelation(1, {RelationMember{2, "w", "outer"}}, {});
+    store.addRelation(2, {RelationMember{2, "n", ""}}, {});
+    store.addRelation(3, {RelationMember{1, "r", ""}}, {});
+    store.addRelation(4, {RelationMember{5, "w", "outer"}}, {});
+    store.removeRelation(4);
+  }
+  OsmSourceStore store(SourcePath);
+
+  auto relations = store.findRelationsByMembers({}, {2, 5}, {1});
+
+  BOOST_CHECK_EQUAL(relations.size(), 2);
+  BOOST_CHECK_EQUAL(relations.count(1), 1);
+  BOOST_CHECK_EQUAL(relations.count(3), 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -1,12 +1,21 @@
 #include "formats/osm/pbf/OsmPbfParser.hpp"
+#include "entities/Node.hpp"
+#include "entities/Relation.hpp"
 #include "formats/osm/CountableOsmDataVisitor.hpp"
+#include "formats/osm/OsmDataVisitor.hpp"
+#include "utils/ElementUtils.hpp"
 #include "config.hpp"
 
 #include <boost/test/unit_test.hpp>
+#include "test_utils/DependencyProvider.hpp"
 
 #include <fstream>
+#include <sstream>
 
 using namespace utymap::formats;
+using namespace utymap::tests;
+
+typedef std::vector<utymap::entities::Tag> ElementTags;
 
 namespace {
 
@@ -25,6 +34,53 @@ struct Formats_Osm_Pbf_OsmPbfParserFixture {
   std::ifstream istream;
 };
 
+/// Records ids of visited elements.
+struct RecordingVisitor {
+  std::vector<std::uint64_t> ids;
+
+  void visitNode(std::uint64_t id, utymap::GeoCoordinate &, ElementTags &) { ids.push_back(id); }
+  void visitWay(std::uint64_t id, std::vector<std::uint64_t> &, ElementTags &) { ids.push_back(id); }
+  void visitRelation(std::uint64_t id, RelationMembers &, ElementTags &) { ids.push_back(id); }
+  bool getKeyId(const std::string &, std::uint32_t &id) const { return id = 0, true; }
+  std::uint32_t getValueId(const std::string &) const { return 0; }
+};
+
+void writeBlob(std::ostream &stream, const std::string &type, const std::string &content) {
+  std::vector<Bytef> compressed(compressBound(static_cast<uLong>(content.size())));
+  uLongf compressedSize = static_cast<uLongf>(compressed.size());
+  compress(compressed.data(), &compressedSize, reinterpret_cast<const Bytef *>(content.data()),
+           static_cast<uLong>(content.size()));
+
+  OSMPBF::Blob blob;
+  blob.set_raw_size(static_cast<std::int32_t>(content.size()));
+  blob.set_zlib_data(compressed.data(), compressedSize);
+  std::string blobData = blob.SerializeAsString();
+
+  OSMPBF::BlobHeader header;
+  header.set_type(type);
+  header.set_datasize(static_cast<std::int32_t>(blobData.size()));
+  std::string headerData = header.SerializeAsString();
+
+  std::uint32_t size = static_cast<std::uint32_t>(headerData.size());
+  char sizeData[] = {static_cast<char>(size >> 24), static_cast<char>(size >> 16),
+                     static_cast<char>(size >> 8), static_cast<char>(size)};
+  stream.write(sizeData, 4);
+  stream << headerData << blobData;
+}
+
+/// Writes file where every block has ways with ids from block number times hundred.
+void writePbf(std::ostream &stream, int blockCount, int wayCount) {
+  writeBlob(stream, "OSMHeader", OSMPBF::HeaderBlock().SerializeAsString());
+  for (int i = 0; i < blockCount; ++i) {
+    OSMPBF::PrimitiveBlock block;
+    block.mutable_stringtable()->add_s("");
+    auto group = block.add_primitivegroup();
+    for (int j = 0; j < wayCount; ++j)
+      group->add_ways()->set_id(i*100 + j);
+    writeBlob(stream, "OSMData", block.SerializeAsString());
+  }
+}
+
 }
 
 BOOST_FIXTURE_TEST_SUITE(Formats_Osm_Pbf_PbfParser, Formats_Osm_Pbf_OsmPbfParserFixture)
@@ -37,4 +93,81 @@ BOOST_AUTO_TEST_CASE(GivenDefaultPbf_WhenParserParse_ThenHasExpectedElementCount
   BOOST_CHECK_EQUAL(visitor.relations, 3064);
 }
 
+BOOST_AUTO_TEST_CASE(GivenManyBlocks_WhenParseInParallel_ThenElementsAreVisitedInFileOrder) {
+  std::stringstream serialStream, parallelStream;
+  writePbf(serialStream, 50, 20);
+  writePbf(parallelStream, 50, 20);
+  RecordingVisitor serialVisitor, parallelVisitor;
+
+  OsmPbfParser<RecordingVisitor>().parse(serialStream, serialVisitor);
+  OsmPbfParser<RecordingVisitor>(3).parse(parallelStream, parallelVisitor);
+
+  BOOST_CHECK_EQUAL(serialVisitor.ids.size(), 1000);
+  BOOST_CHECK(parallelVisitor.ids==serialVisitor.ids);
+}
+
+BOOST_AUTO_TEST_CASE(GivenNodesWithTags_WhenParseWithPruningVisitor_ThenOnlyKeptTagsAreMapped) {
+  DependencyProvider dependencyProvider;
+  auto stringTable = dependencyProvider.getStringTable();
+  std::vector<ElementTags> nodeTags;
+  OsmDataVisitor visitor(*stringTable, [&](utymap::entities::Element &element) {
+    nodeTags.push_back(element.tags);
+    return true;
+  }, TagPruner({"amenity", "name"}));
+  OSMPBF::PrimitiveBlock block;
+  for (const auto &str : {"", "amenity", "cafe", "name", "note", "Corner"})
+    block.mutable_stringtable()->add_s(str);
+  auto group = block.add_primitivegroup();
+  for (int i = 0; i < 2; ++i) {
+    auto node = group->add_nodes();
+    node->set_id(i + 1);
+    node->set_lat(10);
+    node->set_lon(20);
+    for (int key : {4, 1, 3}) node->add_keys(key);
+    for (int value : {5, 2, 5}) node->add_vals(value);
+  }
+  std::stringstream stream;
+  writeBlob(stream, "OSMData", block.SerializeAsString());
+
+  OsmPbfParser<OsmDataVisitor>().parse(stream, visitor);
+  visitor.complete();
+
+  BOOST_REQUIRE_EQUAL(nodeTags.size(), 2);
+  for (const auto &tags : nodeTags) {
+    BOOST_REQUIRE_EQUAL(tags.size(), 2);
+    BOOST_CHECK(tags[0] < tags[1]);
+    BOOST_CHECK(utymap::utils::hasTag(stringTable->getId("amenity"), stringTable->getId("cafe"), tags));
+    BOOST_CHECK(utymap::utils::hasTag(stringTable->getId("name"), stringTable->getId("Corner"), tags));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(GivenMultipolygonRelation_WhenParseWithPruningVisitor_ThenAllItsTagsAreMapped) {
+  DependencyProvider dependencyProvider;
+  auto stringTable = dependencyProvider.getStringTable();
+  ElementTags relationTags;
+  OsmDataVisitor visitor(*stringTable, [&](utymap::entities::Element &element) {
+    if (dynamic_cast<const utymap::entities::Relation *>(&element))
+      relationTags = element.tags;
+    return true;
+  }, TagPruner({"building", "type"}));
+  OSMPBF::PrimitiveBlock block;
+  for (const auto &str : {"", "type", "multipolygon", "natural", "water", "outer"})
+    block.mutable_stringtable()->add_s(str);
+  auto relation = block.add_primitivegroup()->add_relations();
+  relation->set_id(100);
+  for (int key : {1, 3}) relation->add_keys(key);
+  for (int value : {2, 4}) relation->add_vals(value);
+  relation->add_memids(10);
+  relation->add_roles_sid(5);
+  relation->add_types(OSMPBF::Relation::WAY);
+  std::stringstream stream;
+  writeBlob(stream, "OSMData", block.SerializeAsString());
+
+  OsmPbfParser<OsmDataVisitor>().parse(stream, visitor);
+  visitor.complete();
+
+  BOOST_REQUIRE_EQUAL(relationTags.size(), 2);
+  BOOST_CHECK(utymap::utils::hasTag(stringTable->getId("natural"), stringTable->getId("water"), relationTags));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
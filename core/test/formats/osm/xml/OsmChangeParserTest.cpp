@@ -0,0 +1,104 @@
+#include "formats/osm/xml/OsmChangeParser.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <sstream>
+
+using namespace utymap;
+using namespace utymap::formats;
+
+namespace {
+const std::string Header = "<?xml version='1.0' encoding='UTF-8'?><osmChange version=\"0.6\">";
+const std::string Footer = "</osmChange>";
+
+struct TestVisitor {
+  std::vector<std::uint64_t> nodes;
+  std::vector<std::uint64_t> ways;
+  std::vector<std::uint64_t> relations;
+  GeoCoordinate lastCoordinate;
+  Tags lastTags;
+  std::vector<std::uint64_t> lastNodeIds;
+  RelationMembers lastMembers;
+
+  void visitNode(std::uint64_t id, GeoCoordinate &coordinate, Tags &tags) {
+    nodes.push_back(id);
+    lastCoordinate = coordinate;
+    lastTags = tags;
+  }
+
+  void visitWay(std::uint64_t id, std::vector<std::uint64_t> &nodeIds, Tags &tags) {
+    ways.push_back(id);
+    lastNodeIds = nodeIds;
+    lastTags = tags;
+  }
+
+  void visitRelation(std::uint64_t id, RelationMembers &members, Tags &tags) {
+    relations.push_back(id);
+    lastMembers = members;
+    lastTags = tags;
+  }
+};
+
+struct Formats_Osm_Xml_OsmChangeParserFixture {
+  void parse(const std::string &body) {
+    std::stringstream stream(Header + body + Footer);
+    OsmChangeParser<TestVisitor>().parse(stream, updateVisitor, deleteVisitor);
+  }
+
+  TestVisitor updateVisitor;
+  TestVisitor deleteVisitor;
+};
+}
+
+BOOST_FIXTURE_TEST_SUITE(Formats_Osm_Xml_OsmChangeParser, Formats_Osm_Xml_OsmChangeParserFixture)
+
+BOOST_AUTO_TEST_CASE(GivenCreateAndModifyBlocks_WhenParse_ThenElementsArePassedToUpdateVisitor) {
+  parse("<create><node id=\"1\" lat=\"52.5\" lon=\"13.4\"><tag k=\"amenity\" v=\"cafe\"/></node></create>"
+        "<modify><way id=\"2\"><nd ref=\"1\"/><nd ref=\"3\"/><tag k=\"highway\" v=\"road\"/></way></modify>");
+
+  BOOST_CHECK_EQUAL(updateVisitor.nodes.size(), 1);
+  BOOST_CHECK_EQUAL(updateVisitor.lastCoordinate.latitude, 52.5);
+  BOOST_CHECK_EQUAL(updateVisitor.lastCoordinate.longitude, 13.4);
+  BOOST_REQUIRE_EQUAL(updateVisitor.ways.size(), 1);
+  BOOST_CHECK_EQUAL(updateVisitor.ways[0], 2);
+  BOOST_CHECK_EQUAL(updateVisitor.lastNodeIds.size(), 2);
+  BOOST_CHECK_EQUAL(updateVisitor.lastTags[0].value, "road");
+  BOOST_CHECK(deleteVisitor.nodes.empty() && deleteVisitor.ways.empty());
+}
+
+BOOST_AUTO_TEST_CASE(GivenDeleteBlock_WhenParse_ThenElementsArePassedToDeleteVisitor) {
+  parse("<delete><relation id=\"5\"><member type=\"way\" ref=\"2\" role=\"outer\"/></relation></delete>");
+
+  BOOST_REQUIRE_EQUAL(deleteVisitor.relations.size(), 1);
+  BOOST_CHECK_EQUAL(deleteVisitor.lastMembers[0].type, "w");
+  BOOST_CHECK_EQUAL(deleteVisitor.lastMembers[0].role, "outer");
+  BOOST_CHECK(updateVisitor.relations.empty());
+}
+
+BOOST_AUTO_TEST_CASE(GivenElementModifiedAndDeleted_WhenParse_ThenOnlyLastActionIsVisited) {
+  parse("<modify><node id=\"1\" lat=\"1\" lon=\"1\"/><node id=\"2\" lat=\"2\" lon=\"2\"/></modify>"
+        "<delete><node id=\"1\" lat=\"1\" lon=\"1\"/></delete>"
+        "<modify><node id=\"2\" lat=\"3\" lon=\"3\"/><way id=\"1\"><nd ref=\"2\"/></way></modify>");
+
+  BOOST_REQUIRE_EQUAL(updateVisitor.nodes.size(), 1);
+  BOOST_CHECK_EQUAL(updateVisitor.nodes[0], 2);
+  BOOST_CHECK_EQUAL(updateVisitor.lastCoordinate.latitude, 3);
+  BOOST_CHECK_EQUAL(updateVisitor.ways.size(), 1);
+  BOOST_REQUIRE_EQUAL(deleteVisitor.nodes.size(), 1);
+  BOOST_CHECK_EQUAL(deleteVisitor.nodes[0], 1);
+}
+
+BOOST_AUTO_TEST_CASE(GivenDeletedNodeWithoutCoordinate_WhenParse_ThenItIsVisitedWithInvalidCoordinate) {
+  parse("<delete><node id=\"1\" version=\"2\"/></delete>");
+
+  BOOST_REQUIRE_EQUAL(deleteVisitor.nodes.size(), 1);
+  BOOST_CHECK(!deleteVisitor.lastCoordinate.isValid());
+}
+
+BOOST_AUTO_TEST_CASE(GivenModifiedNodeWithoutCoordinate_WhenParse_ThenItIsSkipped) {
+  parse("<modify><node id=\"1\" version=\"2\"/></modify>");
+
+  BOOST_CHECK(updateVisitor.nodes.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
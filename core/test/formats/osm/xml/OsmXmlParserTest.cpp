@@ -10,6 +10,7 @@
 #include <fstream>
 #include <boost/test/unit_test.hpp>
 #include <numeric>
+#include <set>
 
 using namespace utymap::entities;
 using namespace utymap::formats;
@@ -18,6 +19,21 @@ namespace {
 struct Formats_Osm_Xml_OsmXmlParserFixture {
   utymap::tests::DependencyProvider dependencyProvider;
 
+  /// Parses default xml file and returns ids of added elements.
+  std::multiset<std::uint64_t> parseDefault(std::shared_ptr<const RelationMemberCollector> collector) {
+    std::multiset<std::uint64_t> ids;
+    std::ifstream istream(TEST_XML_FILE, std::ios::in);
+    OsmXmlParser<OsmDataVisitor> parser;
+    OsmDataVisitor visitor(*dependencyProvider.getStringTable(), [&](Element &element) {
+      ids.insert(element.id);
+      return true;
+    }, TagPruner(), utymap::utils::make_unique<NodeLocationStore>(), collector);
+
+    parser.parse(istream, visitor);
+    visitor.complete();
+    return ids;
+  }
+
   utymap::entities::Tag createTag(const std::string &key, const std::string &value) {
     return utymap::tests::ElementUtils::createTag(*dependencyProvider.getStringTable(), key, value);
   }
@@ -78,6 +94,18 @@ BOOST_AUTO_TEST_CASE(GivenDefaultOsmXml_WhenParserParse_ThenHasExpectedElementCo
   BOOST_CHECK_EQUAL(92, visitor.relations);
 }
 
+BOOST_AUTO_TEST_CASE(GivenDefaultOsmXml_WhenElementsAreReleased_ThenSameElementsAreAdded) {
+  auto collector = std::make_shared<RelationMemberCollector>();
+  std::ifstream istream(TEST_XML_FILE, std::ios::in);
+  OsmXmlParser<RelationMemberCollector>().parse(istream, *collector);
+  collector->complete();
+
+  auto releasedIds = parseDefault(collector);
+
+  BOOST_CHECK(!releasedIds.empty());
+  BOOST_CHECK(releasedIds==parseDefault(nullptr));
+}
+
 BOOST_AUTO_TEST_CASE(GivenDummyOverpassXml_WhenParserParse_ThenHasExpectedElementCount) {
   std::ifstream istream(TEST_OVERPASS_DUMMY_FILE, std::ios::in);
   OsmXmlParser<CountableOsmDataVisitor> parser;
@@ -5,12 +5,15 @@
 #include "entities/Area.hpp"
 #include "entities/Relation.hpp"
 #include "index/ElementStore.hpp"
+#include "utils/GeoUtils.hpp"
 
 #include <boost/test/unit_test.hpp>
 
 #include "test_utils/DependencyProvider.hpp"
 #include "test_utils/ElementUtils.hpp"
 
+#include <map>
+
 using namespace utymap;
 using namespace utymap::entities;
 using namespace utymap::index;
@@ -18,6 +21,9 @@ using namespace utymap::mapcss;
 using namespace utymap::tests;
 
 namespace {
+/// Precision of clipped coordinates.
+const double Precision = 1E-7;
+
 typedef std::function<void(const Element &, const QuadKey &)> StoreCallback;
 
 class TestElementStore : public ElementStore {
@@ -73,9 +79,9 @@ BOOST_AUTO_TEST_CASE(GivenWayIntersectsTwoTilesOnce_WhenStore_GeometryIsClipped)
   TestElementStore elementStore(*dependencyProvider.getStringTable(),
                                 [&](const Element &element, const QuadKey &quadKey) {
                                   if (checkQuadKey(quadKey, 1, 0, 0)) {
-                                    checkGeometry<Way>(static_cast<const Way &>(element), {{10, -10}, {10, 0}});
+                                    checkGeometry<Way>(static_cast<const Way &>(element), {{10, 0}, {10, -10}});
                                   } else if (checkQuadKey(quadKey, 1, 1, 0)) {
-                                    checkGeometry<Way>(static_cast<const Way &>(element), {{10, 0}, {10, 10}});
+                                    checkGeometry<Way>(static_cast<const Way &>(element), {{10, 10}, {10, 0}});
                                   } else {
                                     BOOST_FAIL("Unexpected quadKey!");
                                   }
@@ -95,14 +101,14 @@ BOOST_AUTO_TEST_CASE(GivenWayIntersectsTwoTilesTwice_WhenStore_GeometryIsClipped
                                 [&](const Element &element, const QuadKey &quadKey) {
                                   if (checkQuadKey(quadKey, 1, 0, 0)) {
                                     checkGeometry<Way>(static_cast<const Way &>(element),
-                                                       {{20, 0}, {20, -10}, {10, -10}, {10, 0}});
+                                                       {{10, 0}, {10, -10}, {20, -10}, {20, 0}});
                                   } else if (checkQuadKey(quadKey, 1, 1, 0)) {
                                     const Relation &relation = static_cast<const Relation &>(element);
                                     BOOST_CHECK_EQUAL(relation.elements.size(), 2);
                                     checkGeometry<Way>(static_cast<const Way &>(*relation.elements[0]),
-                                                       {{20, 10}, {20, 0}});
+                                                       {{10, 10}, {10, 0}});
                                     checkGeometry<Way>(static_cast<const Way &>(*relation.elements[1]),
-                                                       {{10, 0}, {10, 10}});
+                                                       {{20, 0}, {20, 10}});
                                   } else {
                                     BOOST_FAIL("Unexpected quadKey!");
                                   }
@@ -148,7 +154,7 @@ BOOST_AUTO_TEST_CASE(GivenAreaIntersectsTwoTilesOnce_WhenStore_GeometryIsClipped
                                                         {{20, 0}, {20, -10}, {10, -10}, {10, 0}});
                                   } else if (checkQuadKey(quadKey, 1, 1, 0)) {
                                     checkGeometry<Area>(static_cast<const Area &>(element),
-                                                        {{20, 10}, {20, 0}, {10, 0}, {10, 10}});
+                                                        {{10, 0}, {10, 10}, {20, 10}, {20, 0}});
                                   } else {
                                     BOOST_FAIL("Unexpected quadKey!");
                                   }
@@ -222,9 +228,9 @@ BOOST_AUTO_TEST_CASE(GivenRelationOfPolygonWithHole_WhenStore_RelationIsReturned
                                   auto result = static_cast<const Relation &>(element);
                                   if (checkQuadKey(quadKey, 1, 1, 0)) {
                                     checkGeometry<Area>(static_cast<const Area &>(*result.elements[0]),
-                                                        {{15, 5}, {15, 0}, {10, 0}, {10, 5}});
+                                                        {{10, 0}, {10, 5}, {15, 5}, {15, 0}});
                                     checkGeometry<Area>(static_cast<const Area &>(*result.elements[1]),
-                                                        {{20, 10}, {20, 0}, {5, 0}, {5, 10}});
+                                                        {{5, 0}, {5, 10}, {20, 10}, {20, 0}});
                                   } else if (checkQuadKey(quadKey, 1, 0, 0)) {
                                     checkGeometry<Area>(static_cast<const Area &>(*result.elements[0]),
                                                         {{15, 0}, {15, -5}, {10, -5}, {10, 0}});
@@ -258,7 +264,7 @@ BOOST_AUTO_TEST_CASE(GivenRelationOfPolygonWithHole_WhenStore_RelationAndAreaRet
                                     checkGeometry<Area>(static_cast<const Area &>(*result.elements[0]),
                                                         {{10, 8}, {15, 8}, {15, 2}, {10, 2}});
                                     checkGeometry<Area>(static_cast<const Area &>(*result.elements[1]),
-                                                        {{20, 10}, {20, 0}, {5, 0}, {5, 10}});
+                                                        {{5, 0}, {5, 10}, {20, 10}, {20, 0}});
                                   } else if (checkQuadKey(quadKey, 1, 0, 0)) {
                                     checkGeometry<Area>(static_cast<const Area &>(element),
                                                         {{20, 0}, {20, -10}, {5, -10}, {5, 0}});
@@ -291,4 +297,37 @@ BOOST_AUTO_TEST_CASE(GivenWay_WhenStoreInsideQuadKey_IsStored) {
   BOOST_CHECK_EQUAL(elementStore.times, 1);
 }
 
+BOOST_AUTO_TEST_CASE(GivenAreaAndLodRange_WhenStore_ThenEachLevelIsClippedAsIfStoredSeparately) {
+  Area area = ElementUtils::createElement<Area>(*dependencyProvider.getStringTable(), 0,
+                                                {{"test", "Foo"}},
+                                                {{10, 10}, {35, -20}, {-5, -30}, {-20, 5}, {5, 2}});
+  auto styleProvider = dependencyProvider.getStyleProvider("area|z1-4[test=Foo] { key:val; clip: true;}");
+  std::map<std::string, std::size_t> expected, actual;
+  TestElementStore separateStore(*dependencyProvider.getStringTable(),
+                                 [&](const Element &element, const QuadKey &quadKey) {
+                                   expected[utymap::utils::GeoUtils::quadKeyToString(quadKey)] =
+                                       static_cast<const Area &>(element).coordinates.size();
+                                 });
+  TestElementStore elementStore(*dependencyProvider.getStringTable(),
+                                [&](const Element &element, const QuadKey &quadKey) {
+                                  const auto &clipped = static_cast<const Area &>(element);
+                                  auto bbox = utymap::utils::GeoUtils::quadKeyToBoundingBox(quadKey);
+                                  for (const auto &coordinate : clipped.coordinates) {
+                                    BOOST_CHECK(coordinate.latitude > bbox.minPoint.latitude - Precision);
+                                    BOOST_CHECK(coordinate.latitude < bbox.maxPoint.latitude + Precision);
+                                    BOOST_CHECK(coordinate.longitude > bbox.minPoint.longitude - Precision);
+                                    BOOST_CHECK(coordinate.longitude < bbox.maxPoint.longitude + Precision);
+                                  }
+                                  actual[utymap::utils::GeoUtils::quadKeyToString(quadKey)] =
+                                      clipped.coordinates.size();
+                                });
+  for (int lod = 1; lod <= 4; ++lod)
+    separateStore.store(area, LodRange(lod, lod), *styleProvider);
+
+  elementStore.store(area, LodRange(1, 4), *styleProvider);
+
+  BOOST_CHECK(expected==actual);
+  BOOST_CHECK_EQUAL(elementStore.times, separateStore.times);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,140 @@
+#include "entities/Node.hpp"
+#include "entities/Way.hpp"
+#include "entities/Relation.hpp"
+#include "index/ElementStream.hpp"
+
+#include <boost/test/unit_test.hpp>
+#include "test_utils/DependencyProvider.hpp"
+#include "test_utils/ElementUtils.hpp"
+
+#include <sstream>
+
+using namespace utymap;
+using namespace utymap::entities;
+using namespace utymap::index;
+using namespace utymap::tests;
+
+namespace {
+const double Precision = 1E-7;
+
+struct Index_ElementStreamFixture {
+  Way createWay(std::size_t size) {
+    Way way = ElementUtils::createElement<Way>(*dependencyProvider.getStringTable(), 1,
+                                               {{"highway", "primary"}, {"name", "some street"}});
+    for (std::size_t i = 0; i < size; ++i)
+      way.coordinates.push_back(GeoCoordinate(52.5 + i*1E-5, 13.4 - i*1E-5));
+    return way;
+  }
+
+  DependencyProvider dependencyProvider;
+};
+
+std::string serialize(const Element &element, ElementStream::Version version) {
+  std::stringstream stream;
+  ElementStream::writeHeader(stream, version);
+  ElementStream::write(stream, element, version);
+  return stream.str();
+}
+
+std::unique_ptr<Element> deserialize(const std::string &data, std::uint64_t id) {
+  std::stringstream stream(data);
+  auto version = ElementStream::readHeader(stream);
+  return ElementStream::read(stream, id, version);
+}
+
+void checkWay(const Way &expected, const Element &element) {
+  const auto &actual = dynamic_cast<const Way &>(element);
+  BOOST_CHECK_EQUAL(actual.id, expected.id);
+  BOOST_REQUIRE_EQUAL(actual.tags.size(), expected.tags.size());
+  for (std::size_t i = 0; i < expected.tags.size(); ++i) {
+    BOOST_CHECK_EQUAL(actual.tags[i].key, expected.tags[i].key);
+    BOOST_CHECK_EQUAL(actual.tags[i].value, expected.tags[i].value);
+  }
+  BOOST_REQUIRE_EQUAL(actual.coordinates.size(), expected.coordinates.size());
+  for (std::size_t i = 0; i < expected.coordinates.size(); ++i) {
+    BOOST_CHECK_SMALL(actual.coordinates[i].latitude - expected.coordinates[i].latitude, Precision);
+    BOOST_CHECK_SMALL(actual.coordinates[i].longitude - expected.coordinates[i].longitude, Precision);
+  }
+}
+}
+
+BOOST_FIXTURE_TEST_SUITE(Index_ElementStream, Index_ElementStreamFixture)
+
+BOOST_AUTO_TEST_CASE(GivenWay_WhenWriteAndReadCurrentVersion_ThenItIsRestored) {
+  Way way = createWay(10);
+
+  auto element = deserialize(serialize(way, ElementStream::CurrentVersion), way.id);
+
+  checkWay(way, *element);
+}
+
+BOOST_AUTO_TEST_CASE(GivenWay_WhenWriteFirstVersion_ThenItIsReadWithoutHeader) {
+  Way way = createWay(10);
+
+  auto data = serialize(way, ElementStream::Version::V1);
+  auto element = deserialize(data, way.id);
+
+  checkWay(way, *element);
+}
+
+BOOST_AUTO_TEST_CASE(GivenWay_WhenWriteCurrentVersion_ThenItIsSmallerThanFirstVersion) {
+  Way way = createWay(100);
+
+  auto compact = serialize(way, ElementStream::CurrentVersion);
+  auto raw = serialize(way, ElementStream::Version::V1);
+
+  BOOST_CHECK_LT(compact.size()*3, raw.size());
+}
+
+BOOST_AUTO_TEST_CASE(GivenRelation_WhenWriteAndReadCurrentVersion_ThenMembersAreRestored) {
+  Relation relation;
+  relation.id = 3;
+  auto node = std::make_shared<Node>();
+  node->id = 7;
+  node->coordinate = GeoCoordinate(-33.8, 151.2);
+  relation.elements.push_back(node);
+  relation.elements.push_back(std::make_shared<Way>(createWay(2)));
+
+  auto element = deserialize(serialize(relation, ElementStream::CurrentVersion), relation.id);
+
+  const auto &actual = dynamic_cast<const Relation &>(*element);
+  BOOST_REQUIRE_EQUAL(actual.elements.size(), 2);
+  BOOST_CHECK_EQUAL(actual.elements[0]->id, 7);
+  const auto &actualNode = dynamic_cast<const Node &>(*actual.elements[0]);
+  BOOST_CHECK_SMALL(actualNode.coordinate.latitude + 33.8, Precision);
+  BOOST_CHECK_SMALL(actualNode.coordinate.longitude - 151.2, Precision);
+  checkWay(*std::static_pointer_cast<Way>(relation.elements[1]), *actual.elements[1]);
+}
+
+BOOST_AUTO_TEST_CASE(GivenTwoWays_WhenDecode_ThenElementInstanceIsReused) {
+  Way first = createWay(5), second = createWay(3);
+  second.id = 2;
+  std::stringstream stream;
+  ElementStream::write(stream, first);
+  ElementStream::write(stream, second);
+  ElementDecoder decoder;
+
+  const Element *firstElement = &decoder.read(stream, first.id);
+  const Element &secondElement = decoder.read(stream, second.id);
+
+  BOOST_CHECK_EQUAL(firstElement, &secondElement);
+  checkWay(second, secondElement);
+}
+
+BOOST_AUTO_TEST_CASE(GivenRelationAndWay_WhenDecodeFirstVersion_ThenBothAreRestored) {
+  Way way = createWay(4);
+  Relation relation;
+  relation.id = 3;
+  relation.elements.push_back(std::make_shared<Way>(createWay(2)));
+  std::stringstream stream;
+  ElementStream::write(stream, relation, ElementStream::Version::V1);
+  ElementStream::write(stream, way, ElementStream::Version::V1);
+  ElementDecoder decoder;
+
+  const auto &actual = dynamic_cast<const Relation &>(decoder.read(stream, relation.id, ElementStream::Version::V1));
+  BOOST_REQUIRE_EQUAL(actual.elements.size(), 1);
+  checkWay(*std::static_pointer_cast<Way>(relation.elements[0]), *actual.elements[0]);
+  checkWay(way, decoder.read(stream, way.id, ElementStream::Version::V1));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
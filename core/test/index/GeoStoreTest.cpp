@@ -0,0 +1,222 @@
+#include "entities/Node.hpp"
+#include "entities/Way.hpp"
+#include "entities/Area.hpp"
+#include "entities/Relation.hpp"
+#include "index/GeoStore.hpp"
+#include "index/InMemoryElementStore.hpp"
+#include "index/PersistentElementStore.hpp"
+#include "utils/GeoUtils.hpp"
+
+#include <boost/test/unit_test.hpp>
+#include "test_utils/DependencyProvider.hpp"
+#include "test_utils/ElementUtils.hpp"
+
+#include <boost/filesystem/operations.hpp>
+#include <fstream>
+#include <vector>
+
+using namespace utymap;
+using namespace utymap::entities;
+using namespace utymap::index;
+using namespace utymap::utils;
+using namespace utymap::tests;
+
+namespace {
+const std::string StoreKey = "store";
+const std::string PersistentStoreKey = "persistent";
+const std::string PersistentStorePath = "geo_store/";
+const std::string stylesheet = "node|z1[any], way|z1[any], area|z1[any] { clip: false; }";
+
+/// Keeps ids of visited elements by their kind.
+struct ElementCollector final : public ElementVisitor {
+  std::vector<std::uint64_t> nodes;
+  std::vector<std::uint64_t> ways;
+
+  void visitNode(const Node &node) override { nodes.push_back(node.id); }
+  void visitWay(const Way &way) override { ways.push_back(way.id); }
+  void visitArea(const Area &) override {}
+  void visitRelation(const Relation &) override {}
+};
+
+struct Index_GeoStoreFixture {
+  Index_GeoStoreFixture() :
+      dependencyProvider(),
+      stringTable(*dependencyProvider.getStringTable()),
+      styleProvider(dependencyProvider.getStyleProvider(stylesheet)),
+      geoStore(stringTable) {
+    geoStore.registerStore(StoreKey, utymap::utils::make_unique<InMemoryElementStore>(stringTable));
+  }
+
+  ~Index_GeoStoreFixture() {
+    boost::filesystem::remove_all(PersistentStorePath);
+  }
+
+  /// Creates geo store with persistent store which keeps osm data next to its data.
+  std::unique_ptr<GeoStore> createPersistentGeoStore() {
+    auto persistentGeoStore = utymap::utils::make_unique<GeoStore>(stringTable);
+    persistentGeoStore->registerStore(PersistentStoreKey,
+                                      utymap::utils::make_unique<PersistentElementStore>(PersistentStorePath, stringTable),
+                                      PersistentStorePath + "osm");
+    return persistentGeoStore;
+  }
+
+  /// Writes xml file with single node at (5, 5) and returns its path.
+  std::string writeNodeFile() {
+    auto path = PersistentStorePath + "node.osm.xml";
+    boost::filesystem::create_directories(PersistentStorePath);
+    std::ofstream(path)
+        << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<osm version=\"0.6\">\n"
+        << " <node id=\"1\" lat=\"5\" lon=\"5\">\n  <tag k=\"any\" v=\"true\"/>\n </node>\n</osm>\n";
+    return path;
+  }
+
+  /// Imports node from xml file into persistent store which already has node with the same id
+  /// in another tile. Collects nodes of the stored and imported node tiles.
+  void importStoredNode(std::size_t workerCount, ElementCollector &storedCollector, ElementCollector &importedCollector) {
+    GeoCoordinate storedCoordinate(-5, -5);
+    GeoCoordinate importedCoordinate(5, 5);
+    auto path = writeNodeFile();
+    auto persistentGeoStore = createPersistentGeoStore();
+    Node node = ElementUtils::createElement<Node>(stringTable, 1, {{"any", "true"}});
+    node.coordinate = storedCoordinate;
+    persistentGeoStore->add(PersistentStoreKey, node, LodRange(1, 1), *styleProvider);
+    ImportOptions options;
+    options.skipExisting = true;
+    options.workerCount = workerCount;
+
+    persistentGeoStore->add(PersistentStoreKey, path, LodRange(1, 1), *styleProvider, options);
+
+    persistentGeoStore->search(GeoUtils::GeoCoordinateToQuadKey(storedCoordinate, 1), *styleProvider,
+                               storedCollector, CancellationToken());
+    persistentGeoStore->search(GeoUtils::GeoCoordinateToQuadKey(importedCoordinate, 1), *styleProvider,
+                               importedCollector, CancellationToken());
+  }
+
+  DependencyProvider dependencyProvider;
+  StringTable &stringTable;
+  std::shared_ptr<mapcss::StyleProvider> styleProvider;
+  GeoStore geoStore;
+};
+
+}
+
+BOOST_FIXTURE_TEST_SUITE(Index_GeoStore, Index_GeoStoreFixture)
+
+BOOST_AUTO_TEST_CASE(GivenNodeAndWayWithSameId_WhenSearchInBoundingBox_ThenBothAreVisited) {
+  Node node = ElementUtils::createElement<Node>(stringTable, 1, {{"any", "true"}});
+  node.coordinate = GeoCoordinate(5, 5);
+  geoStore.add(StoreKey, node, LodRange(1, 1), *styleProvider);
+  geoStore.add(StoreKey, ElementUtils::createElement<Way>(stringTable, 1, {{"any", "true"}}, {{4, 4}, {6, 6}}),
+               LodRange(1, 1), *styleProvider);
+  ElementCollector collector;
+
+  geoStore.search(BoundingBox(GeoCoordinate(0, 0), GeoCoordinate(10, 10)), 1, collector, CancellationToken());
+
+  BOOST_CHECK_EQUAL(collector.nodes.size(), 1);
+  BOOST_CHECK_EQUAL(collector.ways.size(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(GivenNodeAndWayWithSameId_WhenSearchInRadius_ThenBothAreVisited) {
+  Node node = ElementUtils::createElement<Node>(stringTable, 1, {{"any", "true"}});
+  node.coordinate = GeoCoordinate(5, 5);
+  geoStore.add(StoreKey, node, LodRange(1, 1), *styleProvider);
+  geoStore.add(StoreKey, ElementUtils::createElement<Way>(stringTable, 1, {{"any", "true"}}, {{5, 4}, {5, 6}}),
+               LodRange(1, 1), *styleProvider);
+  ElementCollector collector;
+
+  geoStore.search(GeoCoordinate(5, 5), 1000, 1, collector, CancellationToken());
+
+  BOOST_CHECK_EQUAL(collector.nodes.size(), 1);
+  BOOST_CHECK_EQUAL(collector.ways.size(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(GivenNodeMovedToAnotherTile_WhenSearchInOldTile_ThenItIsNotVisited) {
+  GeoCoordinate oldCoordinate(5, 5);
+  GeoCoordinate newCoordinate(-5, -5);
+  ElementCollector oldTileCollector;
+  ElementCollector newTileCollector;
+  auto persistentGeoStore = createPersistentGeoStore();
+  Node node = ElementUtils::createElement<Node>(stringTable, 1, {{"any", "true"}});
+  node.coordinate = oldCoordinate;
+  persistentGeoStore->add(PersistentStoreKey, node, LodRange(1, 1), *styleProvider);
+  node.coordinate = newCoordinate;
+
+  persistentGeoStore->add(PersistentStoreKey, node, LodRange(1, 1), *styleProvider);
+
+  persistentGeoStore->search(GeoUtils::GeoCoordinateToQuadKey(oldCoordinate, 1), *styleProvider,
+                             oldTileCollector, CancellationToken());
+  persistentGeoStore->search(GeoUtils::GeoCoordinateToQuadKey(newCoordinate, 1), *styleProvider,
+                             newTileCollector, CancellationToken());
+
+  BOOST_CHECK(oldTileCollector.nodes.empty());
+  BOOST_CHECK_EQUAL(newTileCollector.nodes.size(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(GivenStoredNodeAndSkipExisting_WhenImportItSerially_ThenItIsSkipped) {
+  ElementCollector storedCollector, importedCollector;
+
+  importStoredNode(0, storedCollector, importedCollector);
+
+  BOOST_CHECK_EQUAL(storedCollector.nodes.size(), 1);
+  BOOST_CHECK(importedCollector.nodes.empty());
+}
+
+BOOST_AUTO_TEST_CASE(GivenStoredNodeAndSkipExisting_WhenImportItWithPipeline_ThenItIsSkipped) {
+  ElementCollector storedCollector, importedCollector;
+
+  importStoredNode(2, storedCollector, importedCollector);
+
+  BOOST_CHECK_EQUAL(storedCollector.nodes.size(), 1);
+  BOOST_CHECK(importedCollector.nodes.empty());
+}
+
+BOOST_AUTO_TEST_CASE(GivenImportWithoutSourceDataOption_WhenImport_ThenOsmDataIsNotKept) {
+  auto path = writeNodeFile();
+  auto persistentGeoStore = createPersistentGeoStore();
+
+  persistentGeoStore->add(PersistentStoreKey, path, LodRange(1, 1), *styleProvider);
+
+  BOOST_CHECK(!boost::filesystem::exists(PersistentStorePath + "osm.nodes"));
+}
+
+BOOST_AUTO_TEST_CASE(GivenKeptSourceData_WhenApplyChangesMovingWayNode_ThenWayIsMovedInNewStore) {
+  auto path = PersistentStorePath + "way.osm.xml";
+  boost::filesystem::create_directories(PersistentStorePath);
+  std::ofstream(path)
+      << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<osm version=\"0.6\">\n"
+      << " <node id=\"1\" lat=\"5\" lon=\"5\"/>\n <node id=\"2\" lat=\"6\" lon=\"6\"/>\n"
+      << " <way id=\"10\">\n  <nd ref=\"1\"/>\n  <nd ref=\"2\"/>\n  <tag k=\"any\" v=\"true\"/>\n </way>\n</osm>\n";
+  std::ofstream(PersistentStorePath + "change.osc")
+      << "<?xml version='1.0' encoding='UTF-8'?><osmChange version=\"0.6\">"
+      << "<modify><node id=\"1\" lat=\"-5\" lon=\"-5\"/><node id=\"2\" lat=\"-6\" lon=\"-6\"/></modify>"
+      << "</osmChange>";
+  ImportOptions options;
+  options.keepsSourceData = true;
+  createPersistentGeoStore()->add(PersistentStoreKey, path, LodRange(1, 1), *styleProvider, options);
+  auto persistentGeoStore = createPersistentGeoStore();
+  ElementCollector oldTileCollector, newTileCollector;
+
+  persistentGeoStore->applyChanges(PersistentStoreKey, PersistentStorePath + "change.osc", LodRange(1, 1),
+                                   *styleProvider);
+
+  persistentGeoStore->search(QuadKey(1, 1, 0), *styleProvider, oldTileCollector, CancellationToken());
+  persistentGeoStore->search(QuadKey(1, 0, 1), *styleProvider, newTileCollector, CancellationToken());
+  BOOST_CHECK(oldTileCollector.ways.empty());
+  BOOST_CHECK(newTileCollector.ways==std::vector<std::uint64_t>({10}));
+}
+
+BOOST_AUTO_TEST_CASE(GivenMissingChangeFile_WhenApplyChanges_ThenThrows) {
+  auto persistentGeoStore = createPersistentGeoStore();
+
+  BOOST_CHECK_THROW(persistentGeoStore->applyChanges(PersistentStoreKey, PersistentStorePath + "missing.osc",
+                                                     LodRange(1, 1), *styleProvider), std::domain_error);
+}
+
+BOOST_AUTO_TEST_CASE(GivenStoreWithoutErase_WhenApplyChanges_ThenThrowsBeforeFileIsRead) {
+  BOOST_CHECK_THROW(geoStore.applyChanges(StoreKey, PersistentStorePath + "missing.osc", LodRange(1, 1),
+                                          *styleProvider), std::domain_error);
+  BOOST_CHECK_THROW(geoStore.erase(StoreKey, ElementUtils::createElement<Node>(stringTable, 1, {}),
+                                   LodRange(1, 1)), std::domain_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,113 @@
+#include "entities/Area.hpp"
+#include "entities/Way.hpp"
+#include "index/ElementStream.hpp"
+#include "index/ImportPipeline.hpp"
+
+#include <boost/test/unit_test.hpp>
+#include "test_utils/DependencyProvider.hpp"
+#include "test_utils/ElementUtils.hpp"
+
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+
+using namespace utymap;
+using namespace utymap::entities;
+using namespace utymap::index;
+using namespace utymap::tests;
+
+namespace {
+const std::string stylesheet = "way|z1-3[any], area|z1-3[any] { clip: true; }";
+
+/// Keeps serialized elements stored in each quadkey.
+class RecordingStore final : public ElementStore {
+ public:
+  typedef std::map<std::string, std::vector<std::string>> Records;
+
+  explicit RecordingStore(StringTable &stringTable) : ElementStore(stringTable) {}
+
+  Records records;
+
+  void search(const QuadKey &, ElementVisitor &, const CancellationToken &) override {}
+
+  bool hasData(const QuadKey &) const override { return true; }
+
+ protected:
+  void storeImpl(const Element &element, const QuadKey &quadKey) override {
+    std::stringstream stream;
+    ElementStream::write(stream, element);
+    std::lock_guard<std::mutex> lock(lock_);
+    records[utymap::utils::GeoUtils::quadKeyToString(quadKey)].push_back(stream.str());
+  }
+
+ private:
+  std::mutex lock_;
+};
+
+struct Index_ImportPipelineFixture {
+  Index_ImportPipelineFixture() :
+      stringTable(*dependencyProvider.getStringTable()),
+      styleProvider(dependencyProvider.getStyleProvider(stylesheet)),
+      storeFunc([&](ElementStore &store, const Element &element) {
+        return store.store(element, LodRange(1, 3), *styleProvider);
+      }) {
+  }
+
+  /// Creates areas which cross tile borders, so they are clipped.
+  std::vector<Area> createAreas(std::size_t count) {
+    std::vector<Area> areas;
+    for (std::size_t i = 0; i < count; ++i) {
+      double lat = -80 + static_cast<double>(i%160), lon = -170 + static_cast<double>((i*7)%340);
+      areas.push_back(ElementUtils::createElement<Area>(stringTable, i + 1, {{"any", "true"}},
+          {{lat, lon}, {lat + 15, lon}, {lat + 15, lon + 25}, {lat, lon + 25}}));
+    }
+    return areas;
+  }
+
+  DependencyProvider dependencyProvider;
+  StringTable &stringTable;
+  std::shared_ptr<mapcss::StyleProvider> styleProvider;
+  ImportPipeline::StoreFunc storeFunc;
+};
+}
+
+BOOST_FIXTURE_TEST_SUITE(Index_ImportPipeline, Index_ImportPipelineFixture)
+
+BOOST_AUTO_TEST_CASE(GivenAreas_WhenImportWithPipeline_ThenResultIsSameAsSerialImport) {
+  auto areas = createAreas(500);
+  RecordingStore serialStore(stringTable), pipelineStore(stringTable);
+  ImportOptions options;
+  options.workerCount = 4;
+  options.writerCount = 3;
+  options.queueSize = 2;
+  options.batchSize = 7;
+
+  for (const auto &area : areas)
+    storeFunc(serialStore, area);
+  ImportPipeline pipeline(pipelineStore, stringTable, options, storeFunc);
+  for (const auto &area : areas)
+    pipeline.add(area);
+  pipeline.complete();
+
+  BOOST_CHECK(!serialStore.records.empty());
+  BOOST_CHECK(serialStore.records==pipelineStore.records);
+}
+
+BOOST_AUTO_TEST_CASE(GivenFailingStoreFunction_WhenComplete_ThenExceptionIsRethrown) {
+  RecordingStore store(stringTable);
+  ImportOptions options;
+  options.workerCount = 2;
+  options.batchSize = 1;
+  ImportPipeline pipeline(store, stringTable, options, [](ElementStore &, const Element &) -> bool {
+    throw std::domain_error("Cannot store.");
+  });
+
+  BOOST_CHECK_THROW({
+    for (const auto &area : createAreas(10))
+      pipeline.add(area);
+    pipeline.complete();
+  }, std::domain_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -74,4 +74,28 @@ BOOST_AUTO_TEST_CASE(GivenNodeWayArea_WhenSearch_ThenAllSkipped) {
   BOOST_CHECK_EQUAL(counter.times, 0);
 }
 
+BOOST_AUTO_TEST_CASE(GivenSmallMemoryBudget_WhenStoreAndSearch_ThenElementsAreSpilledAndFound) {
+  auto &stringTable = *dependencyProvider.getStringTable();
+  auto styleProvider = dependencyProvider.getStyleProvider(stylesheet);
+  InMemoryElementStore boundedStore(stringTable, 1, utymap::utils::make_unique<InMemoryElementStore>(stringTable));
+  ElementCounter counter;
+
+  boundedStore.store(ElementUtils::createElement<Way>(stringTable, 1, {{"any", "true"}}, {{5, -5}, {5, -10}}),
+                     LodRange(1, 1), *styleProvider);
+  boundedStore.search(QuadKey(1, 0, 0), counter, CancellationToken());
+
+  BOOST_CHECK_EQUAL(boundedStore.memoryUsage(), 0);
+  BOOST_CHECK(boundedStore.hasData(QuadKey(1, 0, 0)));
+  BOOST_CHECK_EQUAL(counter.times, 1);
+}
+
+BOOST_AUTO_TEST_CASE(GivenNodeWayArea_WhenSearchInBoundingBox_ThenOnlyIntersectingFound) {
+  QuadKey quadKey(1, 0, 0);
+  ElementCounter counter;
+
+  elementStore.search(quadKey, BoundingBox(GeoCoordinate(7, -11), GeoCoordinate(11, -9)), counter, CancellationToken());
+
+  BOOST_CHECK_EQUAL(counter.times, 1);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
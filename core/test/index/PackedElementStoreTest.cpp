@@ -0,0 +1,134 @@
+#include "entities/Node.hpp"
+#include "entities/Way.hpp"
+#include "entities/Area.hpp"
+#include "entities/Relation.hpp"
+#include "index/PackedElementStore.hpp"
+
+#include <boost/test/unit_test.hpp>
+#include "test_utils/DependencyProvider.hpp"
+#include "test_utils/ElementUtils.hpp"
+
+#include <boost/filesystem/operations.hpp>
+
+using namespace utymap;
+using namespace utymap::entities;
+using namespace utymap::index;
+using namespace utymap::mapcss;
+using namespace utymap::tests;
+
+namespace {
+const std::string TestZoomDirectory = "data/1";
+const std::string stylesheet = "node|z1[any], way|z1[any], area|z1[any], relation|z1[any] { clip: false; }";
+
+struct Index_PackedElementStoreFixture {
+  Index_PackedElementStoreFixture() :
+      dependencyProvider(),
+      elementStore(utymap::utils::make_unique<PackedElementStore>("", *dependencyProvider.getStringTable())) {
+    boost::filesystem::create_directories(TestZoomDirectory);
+  }
+
+  ~Index_PackedElementStoreFixture() {
+    elementStore.reset();
+    boost::filesystem::remove_all(TestZoomDirectory);
+  }
+
+  DependencyProvider dependencyProvider;
+  std::unique_ptr<PackedElementStore> elementStore;
+};
+
+struct ElementCounter : public ElementVisitor {
+  int times = 0;
+  std::uint64_t lastId = 0;
+
+  void visitNode(const Node &node) override { visit(node); }
+  void visitWay(const Way &way) override { visit(way); }
+  void visitArea(const Area &area) override { visit(area); }
+  void visitRelation(const Relation &relation) override { visit(relation); }
+
+ private:
+  void visit(const Element &element) {
+    ++times;
+    lastId = element.id;
+  }
+};
+
+Area createArea(StringTable &stringTable, std::uint64_t id) {
+  return ElementUtils::createElement<Area>(stringTable, id, {{"any", "true"}}, {{1, -1}, {2, -2}, {3, -3}});
+}
+}
+
+BOOST_FIXTURE_TEST_SUITE(Index_PackedElementStore, Index_PackedElementStoreFixture)
+
+BOOST_AUTO_TEST_CASE(GivenWay_WhenStoreAndSearch_ThenItIsStoredAndReadBack) {
+  auto styleProvider = dependencyProvider.getStyleProvider(stylesheet);
+  Way way = ElementUtils::createElement<Way>(*dependencyProvider.getStringTable(), 7,
+                                             {{"any", "true"}}, {{1, -1}, {5, -5}});
+  ElementCounter counter;
+
+  elementStore->store(way, LodRange(1, 1), *styleProvider);
+  elementStore->search(QuadKey(1, 0, 0), counter, CancellationToken());
+
+  BOOST_CHECK_EQUAL(counter.times, 1);
+  BOOST_CHECK_EQUAL(counter.lastId, 7);
+}
+
+BOOST_AUTO_TEST_CASE(GivenAreasStoredInTwoSessions_WhenSearchInNewStore_ThenAllAreReadBackInOrder) {
+  auto styleProvider = dependencyProvider.getStyleProvider(stylesheet);
+  auto &stringTable = *dependencyProvider.getStringTable();
+  ElementCounter counter;
+  for (int session = 0; session < 2; ++session) {
+    elementStore->beginImport();
+    for (int i = 1; i <= 50; ++i)
+      elementStore->store(createArea(stringTable, static_cast<std::uint64_t>(session*50 + i)),
+                          LodRange(1, 1), *styleProvider);
+    elementStore->commitImport();
+  }
+
+  elementStore = utymap::utils::make_unique<PackedElementStore>("", stringTable);
+  elementStore->search(QuadKey(1, 0, 0), counter, CancellationToken());
+
+  BOOST_CHECK_EQUAL(counter.times, 100);
+  BOOST_CHECK_EQUAL(counter.lastId, 100);
+}
+
+BOOST_AUTO_TEST_CASE(GivenAreasStoredWithoutSession_WhenSearchInNewStore_ThenAllAreReadBack) {
+  auto styleProvider = dependencyProvider.getStyleProvider(stylesheet);
+  auto &stringTable = *dependencyProvider.getStringTable();
+  ElementCounter counter;
+  for (int i = 1; i <= 50; ++i)
+    elementStore->store(createArea(stringTable, static_cast<std::uint64_t>(i)), LodRange(1, 1), *styleProvider);
+
+  elementStore = utymap::utils::make_unique<PackedElementStore>("", stringTable);
+  elementStore->search(QuadKey(1, 0, 0), counter, CancellationToken());
+
+  BOOST_CHECK_EQUAL(counter.times, 50);
+  BOOST_CHECK_EQUAL(counter.lastId, 50);
+}
+
+BOOST_AUTO_TEST_CASE(GivenAreasStoredWithoutSession_WhenSearchBeforeStoreIsDestroyed_ThenAllAreOnDisk) {
+  auto styleProvider = dependencyProvider.getStyleProvider(stylesheet);
+  auto &stringTable = *dependencyProvider.getStringTable();
+  ElementCounter counter;
+  elementStore->store(createArea(stringTable, 1), LodRange(1, 1), *styleProvider);
+  elementStore->store(ElementUtils::createElement<Area>(stringTable, 2, {{"any", "true"}},
+                                                        {{1, 1}, {2, 2}, {3, 1}}), LodRange(1, 1), *styleProvider);
+  elementStore->store(createArea(stringTable, 3), LodRange(1, 1), *styleProvider);
+
+  PackedElementStore newStore("", stringTable);
+  newStore.search(QuadKey(1, 0, 0), counter, CancellationToken());
+
+  BOOST_CHECK_EQUAL(counter.times, 2);
+  BOOST_CHECK_EQUAL(counter.lastId, 3);
+  BOOST_CHECK(newStore.hasData(QuadKey(1, 1, 0)));
+}
+
+BOOST_AUTO_TEST_CASE(GivenArea_WhenHasData_ThenReturnsTrueOnlyForAffectedQuadKey) {
+  auto styleProvider = dependencyProvider.getStyleProvider(stylesheet);
+
+  elementStore->store(createArea(*dependencyProvider.getStringTable(), 1), LodRange(1, 1), *styleProvider);
+
+  BOOST_CHECK(elementStore->hasData(QuadKey(1, 0, 0)));
+  BOOST_CHECK(!elementStore->hasData(QuadKey(1, 1, 0)));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -18,16 +18,21 @@ using namespace utymap::tests;
 
 namespace {
 const std::string TestZoomDirectory = "data/1";
+const std::string ManifestFile = "data/occupancy.dat";
+const std::string IdIndexFile = "data/ids.dat";
 const std::string stylesheet = "node|z1[any], way|z1[any], area|z1[any], relation|z1[any] { clip: false; }";
 
 struct Index_PersistentElementStoreFixture {
   Index_PersistentElementStoreFixture() :
-      dependencyProvider(),
-      elementStore("", *dependencyProvider.getStringTable()) {
+      dependencyProvider() {
     boost::filesystem::create_directories(TestZoomDirectory);
+    elementStore = utymap::utils::make_unique<PersistentElementStore>("", *dependencyProvider.getStringTable());
   }
 
   ~Index_PersistentElementStoreFixture() {
+    elementStore.reset();
+    boost::filesystem::remove(ManifestFile);
+    boost::filesystem::remove(IdIndexFile);
     boost::filesystem::path dir(TestZoomDirectory);
     for (boost::filesystem::directory_iterator dirEnd, it(dir); it!=dirEnd; ++it) {
       boost::filesystem::remove_all(it->path());
@@ -36,7 +41,7 @@ struct Index_PersistentElementStoreFixture {
   }
 
   DependencyProvider dependencyProvider;
-  PersistentElementStore elementStore;
+  std::unique_ptr<PersistentElementStore> elementStore;
 };
 
 struct ElementCounter : public ElementVisitor {
@@ -102,8 +107,8 @@ BOOST_AUTO_TEST_CASE(GivenNode_WhenStoreAndSearch_ThenItIsStoredAndReadBack) {
   node.coordinate = {5, -5};
   ElementCounter counter;
 
-  elementStore.store(node, range, *styleProvider);
-  elementStore.search(quadKey, counter, CancellationToken());
+  elementStore->store(node, range, *styleProvider);
+  elementStore->search(quadKey, counter, CancellationToken());
 
   assertNode(node, *std::dynamic_pointer_cast<Node>(counter.element));
 }
@@ -116,8 +121,8 @@ BOOST_AUTO_TEST_CASE(GivenWay_WhenStoreAndSearch_ThenItIsStoredAndReadBack) {
       ElementUtils::createElement<Way>(*dependencyProvider.getStringTable(), 7, {{"any", "true"}}, {{1, -1}, {5, -5}});
   ElementCounter counter;
 
-  elementStore.store(way, range, *styleProvider);
-  elementStore.search(quadKey, counter, CancellationToken());
+  elementStore->store(way, range, *styleProvider);
+  elementStore->search(quadKey, counter, CancellationToken());
 
   assertWayOrArea(way, *std::dynamic_pointer_cast<Way>(counter.element));
 }
@@ -132,8 +137,8 @@ BOOST_AUTO_TEST_CASE(GivenArea_WhenStoreAndSearch_ThenItIsStoredAndReadBack) {
                                                 {{1, -1}, {5, -5}, {10, -10}});
   ElementCounter counter;
 
-  elementStore.store(area, range, *styleProvider);
-  elementStore.search(quadKey, counter, CancellationToken());
+  elementStore->store(area, range, *styleProvider);
+  elementStore->search(quadKey, counter, CancellationToken());
 
   assertWayOrArea(area, *std::dynamic_pointer_cast<Area>(counter.element));
 }
@@ -155,8 +160,8 @@ BOOST_AUTO_TEST_CASE(GivenRelationWithDifferentElements_WhenStoreAndSearch_ThenI
   relation.elements.push_back(std::make_shared<Area>(area));
   ElementCounter counter;
 
-  elementStore.store(relation, range, *styleProvider);
-  elementStore.search(quadKey, counter, CancellationToken());
+  elementStore->store(relation, range, *styleProvider);
+  elementStore->search(quadKey, counter, CancellationToken());
 
   BOOST_CHECK_EQUAL(counter.times, 1);
   Relation result = *std::dynamic_pointer_cast<Relation>(counter.element);
@@ -177,12 +182,337 @@ BOOST_AUTO_TEST_CASE(GivenTwoAreas_WhenStoreAndSearchOnce_ThenTheyStoredTwiceAnd
                                                  {{1, -1}, {2, -2}, {3, -3}});
   ElementCounter counter;
 
-  elementStore.store(area1, range, *styleProvider);
-  elementStore.store(area2, range, *styleProvider);
-  elementStore.search(quadKey, counter, CancellationToken());
+  elementStore->store(area1, range, *styleProvider);
+  elementStore->store(area2, range, *styleProvider);
+  elementStore->search(quadKey, counter, CancellationToken());
 
   BOOST_CHECK_EQUAL(counter.times, 2);
   assertWayOrArea(area2, *std::dynamic_pointer_cast<Area>(counter.element));
 }
 
+BOOST_AUTO_TEST_CASE(GivenAreasStoredInImportSession_WhenSearchAfterCommit_ThenAllAreReadBack) {
+  LodRange range(1, 2);
+  QuadKey quadKey(1, 0, 0);
+  auto styleProvider = dependencyProvider.getStyleProvider(stylesheet);
+  ElementCounter counter;
+
+  elementStore->beginImport();
+  for (int i = 1; i <= 100; ++i) {
+    elementStore->store(ElementUtils::createElement<Area>(*dependencyProvider.getStringTable(),
+                                                         i,
+                                                         {{"any", "true"}},
+                                                         {{1, -1}, {2, -2}, {3, -3}}), range, *styleProvider);
+  }
+  elementStore->commitImport();
+  elementStore->search(quadKey, counter, CancellationToken());
+
+  BOOST_CHECK_EQUAL(counter.times, 100);
+  BOOST_CHECK_EQUAL(counter.element->id, 100);
+}
+
+BOOST_AUTO_TEST_CASE(GivenAreaStoredInImportSession_WhenSearchBeforeCommit_ThenItIsReadBack) {
+  LodRange range(1, 2);
+  QuadKey quadKey(1, 0, 0);
+  auto styleProvider = dependencyProvider.getStyleProvider(stylesheet);
+  Area area = ElementUtils::createElement<Area>(*dependencyProvider.getStringTable(),
+                                                7,
+                                                {{"any", "true"}},
+                                                {{1, -1}, {5, -5}, {10, -10}});
+  ElementCounter counter;
+
+  elementStore->beginImport();
+  elementStore->store(area, range, *styleProvider);
+  elementStore->search(quadKey, counter, CancellationToken());
+  elementStore->commitImport();
+
+  BOOST_CHECK_EQUAL(counter.times, 1);
+  assertWayOrArea(area, *std::dynamic_pointer_cast<Area>(counter.element));
+}
+
+BOOST_AUTO_TEST_CASE(GivenTwoNodes_WhenSearchInBoundingBoxTwice_ThenOnlyIntersectingIsReturned) {
+  LodRange range(1, 1);
+  QuadKey quadKey(1, 0, 0);
+  auto styleProvider = dependencyProvider.getStyleProvider(stylesheet);
+  Node node1 = ElementUtils::createElement<Node>(*dependencyProvider.getStringTable(), 1, {{"any", "true"}});
+  node1.coordinate = {5, -5};
+  Node node2 = ElementUtils::createElement<Node>(*dependencyProvider.getStringTable(), 2, {{"any", "true"}});
+  node2.coordinate = {50, -50};
+  BoundingBox bbox(GeoCoordinate(49, -51), GeoCoordinate(51, -49));
+  ElementCounter counter;
+
+  elementStore->store(node1, range, *styleProvider);
+  elementStore->store(node2, range, *styleProvider);
+  elementStore->search(quadKey, bbox, counter, CancellationToken());
+  elementStore->search(quadKey, bbox, counter, CancellationToken());
+
+  BOOST_CHECK_EQUAL(counter.times, 2);
+  assertNode(node2, *std::dynamic_pointer_cast<Node>(counter.element));
+}
+
+BOOST_AUTO_TEST_CASE(GivenStoredArea_WhenCheckDataInNewStore_ThenManifestIsUsed) {
+  auto styleProvider = dependencyProvider.getStyleProvider(stylesheet);
+  elementStore->store(ElementUtils::createElement<Area>(*dependencyProvider.getStringTable(), 1, {{"any", "true"}},
+                                                        {{1, -1}, {2, -2}, {3, -3}}), LodRange(1, 1), *styleProvider);
+
+  elementStore = utymap::utils::make_unique<PersistentElementStore>("", *dependencyProvider.getStringTable());
+
+  BOOST_CHECK(elementStore->hasData(QuadKey(1, 0, 0)));
+  BOOST_CHECK(!elementStore->hasData(QuadKey(1, 1, 0)));
+  BOOST_CHECK(elementStore->hasAncestorData(QuadKey(3, 1, 1)));
+  BOOST_CHECK(!elementStore->hasAncestorData(QuadKey(3, 7, 1)));
+  BOOST_CHECK(!elementStore->hasDescendantData(QuadKey(1, 0, 0)));
+}
+
+BOOST_AUTO_TEST_CASE(GivenStoreWithoutManifest_WhenCheckDataInNewStore_ThenManifestIsRebuilt) {
+  auto styleProvider = dependencyProvider.getStyleProvider(stylesheet);
+  elementStore->store(ElementUtils::createElement<Area>(*dependencyProvider.getStringTable(), 1, {{"any", "true"}},
+                                                        {{1, -1}, {2, -2}, {3, -3}}), LodRange(1, 1), *styleProvider);
+  elementStore.reset();
+  boost::filesystem::remove(ManifestFile);
+
+  elementStore = utymap::utils::make_unique<PersistentElementStore>("", *dependencyProvider.getStringTable());
+
+  BOOST_CHECK(elementStore->hasData(QuadKey(1, 0, 0)));
+  BOOST_CHECK(!elementStore->hasData(QuadKey(1, 1, 0)));
+  BOOST_CHECK(elementStore->hasDescendantData(QuadKey(0, 0, 0)));
+  BOOST_CHECK(elementStore->hasAncestorData(QuadKey(3, 1, 1)));
+  BOOST_CHECK(boost::filesystem::file_size(ManifestFile) > 1);
+}
+
+BOOST_AUTO_TEST_CASE(GivenAreaStoredTwice_WhenSearch_ThenOnlyLastVersionIsReturned) {
+  QuadKey quadKey(1, 0, 0);
+  auto styleProvider = dependencyProvider.getStyleProvider(stylesheet);
+  Area area1 = ElementUtils::createElement<Area>(*dependencyProvider.getStringTable(), 7, {{"any", "true"}},
+                                                 {{1, -1}, {2, -2}, {3, -3}});
+  Area area2 = ElementUtils::createElement<Area>(*dependencyProvider.getStringTable(), 7, {{"any", "true"}},
+                                                 {{4, -4}, {5, -5}, {6, -6}});
+  Way way = ElementUtils::createElement<Way>(*dependencyProvider.getStringTable(), 7, {{"any", "true"}},
+                                             {{1, -1}, {2, -2}});
+  ElementCounter counter, bboxCounter;
+
+  elementStore->store(area1, LodRange(1, 1), *styleProvider);
+  elementStore->store(way, LodRange(1, 1), *styleProvider);
+  elementStore->store(area2, LodRange(1, 1), *styleProvider);
+  elementStore->search(quadKey, counter, CancellationToken());
+  elementStore->search(quadKey, BoundingBox(GeoCoordinate(3.5, -6.5), GeoCoordinate(6.5, -3.5)), bboxCounter,
+                       CancellationToken());
+
+  BOOST_CHECK_EQUAL(counter.times, 2);
+  assertWayOrArea(area2, *std::dynamic_pointer_cast<Area>(counter.element));
+  BOOST_CHECK_EQUAL(bboxCounter.times, 1);
+  assertWayOrArea(area2, *std::dynamic_pointer_cast<Area>(bboxCounter.element));
+}
+
+BOOST_AUTO_TEST_CASE(GivenWayClippedToPieces_WhenStoreNewVersionAndErase_ThenPiecesAreReplaced) {
+  QuadKey quadKey(1, 0, 0);
+  auto &stringTable = *dependencyProvider.getStringTable();
+  Way way = ElementUtils::createElement<Way>(stringTable, 7, {{"any", "true"}}, {{1, -1}, {2, -2}});
+  Relation pieces = ElementUtils::createElement<Relation>(stringTable, 7, {{"any", "true"}});
+  for (int i = 0; i < 2; ++i) {
+    auto piece = std::make_shared<Way>(ElementUtils::createElement<Way>(stringTable, 7, {}, {{1, -1}, {2, -2}}));
+    pieces.elements.push_back(piece);
+  }
+  ElementCounter beforeErase, afterErase;
+
+  elementStore->store(pieces, quadKey);
+  elementStore->store(way, quadKey);
+  elementStore->search(quadKey, beforeErase, CancellationToken());
+  elementStore->store(pieces, quadKey);
+  elementStore->erase(way, LodRange(1, 1));
+  elementStore->search(quadKey, afterErase, CancellationToken());
+
+  BOOST_CHECK_EQUAL(beforeErase.times, 1);
+  BOOST_CHECK(std::dynamic_pointer_cast<Way>(beforeErase.element)!=nullptr);
+  BOOST_CHECK_EQUAL(afterErase.times, 0);
+}
+
+BOOST_AUTO_TEST_CASE(GivenAreasWithoutId_WhenSearch_ThenAllAreReturnedButNotIndexed) {
+  QuadKey quadKey(1, 0, 0);
+  auto &stringTable = *dependencyProvider.getStringTable();
+  ElementCounter counter;
+  Area area = ElementUtils::createElement<Area>(stringTable, 0, {{"any", "true"}}, {{1, -1}, {2, -2}, {3, -3}});
+
+  for (int i = 0; i < 3; ++i)
+    elementStore->store(area, quadKey);
+  elementStore->search(quadKey, counter, CancellationToken());
+
+  BOOST_CHECK_EQUAL(counter.times, 3);
+  BOOST_CHECK(!elementStore->contains(area));
+}
+
+BOOST_AUTO_TEST_CASE(GivenErasedNode_WhenSearch_ThenItIsSkipped) {
+  QuadKey quadKey(1, 0, 0);
+  auto styleProvider = dependencyProvider.getStyleProvider(stylesheet);
+  Node node1 = ElementUtils::createElement<Node>(*dependencyProvider.getStringTable(), 1, {{"any", "true"}});
+  node1.coordinate = {5, -5};
+  Node node2 = ElementUtils::createElement<Node>(*dependencyProvider.getStringTable(), 2, {{"any", "true"}});
+  node2.coordinate = {50, -50};
+  ElementCounter counter, bboxCounter;
+
+  elementStore->store(node1, LodRange(1, 1), *styleProvider);
+  elementStore->store(node2, LodRange(1, 1), *styleProvider);
+  bool wasErased = elementStore->erase(node1, LodRange(1, 1));
+  elementStore->search(quadKey, counter, CancellationToken());
+  elementStore->search(quadKey, BoundingBox(GeoCoordinate(4, -6), GeoCoordinate(6, -4)), bboxCounter,
+                       CancellationToken());
+
+  BOOST_CHECK(wasErased);
+  BOOST_CHECK_EQUAL(counter.times, 1);
+  assertNode(node2, *std::dynamic_pointer_cast<Node>(counter.element));
+  BOOST_CHECK_EQUAL(bboxCounter.times, 0);
+}
+
+BOOST_AUTO_TEST_CASE(GivenNodeWithOtherLocation_WhenErase_ThenStoredOneIsErasedById) {
+  QuadKey quadKey(1, 0, 0);
+  auto styleProvider = dependencyProvider.getStyleProvider(stylesheet);
+  Node node = ElementUtils::createElement<Node>(*dependencyProvider.getStringTable(), 1, {{"any", "true"}});
+  node.coordinate = {5, -5};
+  elementStore->store(node, LodRange(1, 1), *styleProvider);
+  std::vector<QuadKey> quadKeys;
+  ElementCounter counter;
+
+  node.coordinate = {-50, 50};
+  bool wasErased = elementStore->erase(node, LodRange(1, 1), [&](const QuadKey &affected) {
+    quadKeys.push_back(affected);
+  });
+  elementStore->search(quadKey, counter, CancellationToken());
+
+  BOOST_CHECK(wasErased);
+  BOOST_REQUIRE_EQUAL(quadKeys.size(), 1);
+  BOOST_CHECK_EQUAL(quadKeys[0].tileX, quadKey.tileX);
+  BOOST_CHECK_EQUAL(quadKeys[0].tileY, quadKey.tileY);
+  BOOST_CHECK_EQUAL(counter.times, 0);
+}
+
+BOOST_AUTO_TEST_CASE(GivenFragmentedTile_WhenCompact_ThenOnlyLiveElementsAreKept) {
+  QuadKey quadKey(1, 0, 0);
+  auto styleProvider = dependencyProvider.getStyleProvider(stylesheet);
+  BoundingBox bbox(GeoCoordinate(0, -10), GeoCoordinate(10, 0));
+  auto createArea = [&](std::uint64_t id, double offset) {
+    return ElementUtils::createElement<Area>(*dependencyProvider.getStringTable(), id, {{"any", "true"}},
+                                             {{1 + offset, -1}, {2 + offset, -2}, {3 + offset, -3}});
+  };
+  for (int i = 1; i <= 10; ++i)
+    elementStore->store(createArea(i, 0), LodRange(1, 1), *styleProvider);
+  for (int i = 1; i <= 10; ++i)
+    elementStore->store(createArea(i, 1), LodRange(1, 1), *styleProvider);
+  elementStore->erase(createArea(1, 1), LodRange(1, 1));
+  elementStore->erase(createArea(2, 1), LodRange(1, 1));
+  ElementCounter beforeCounter, afterCounter;
+  elementStore->search(quadKey, bbox, beforeCounter, CancellationToken());
+
+  auto count = elementStore->compact(CompactionOptions(), CancellationToken());
+  elementStore->search(quadKey, bbox, afterCounter, CancellationToken());
+
+  BOOST_CHECK_EQUAL(count, 1);
+  BOOST_CHECK_EQUAL(elementStore->compact(CompactionOptions(), CancellationToken()), 0);
+  BOOST_CHECK_EQUAL(boost::filesystem::file_size(TestZoomDirectory + "/0.idf"), 8*12);
+  BOOST_CHECK_EQUAL(beforeCounter.times, 8);
+  BOOST_CHECK_EQUAL(afterCounter.times, 8);
+  assertWayOrArea(createArea(10, 1), *std::dynamic_pointer_cast<Area>(afterCounter.element));
+}
+
+BOOST_AUTO_TEST_CASE(GivenStoredAndErasedElements_WhenFindInNewStore_ThenOnlyStoredOnesAreFound) {
+  auto styleProvider = dependencyProvider.getStyleProvider(stylesheet);
+  Node node = ElementUtils::createElement<Node>(*dependencyProvider.getStringTable(), 7, {{"any", "true"}});
+  node.coordinate = {5, -5};
+  Way way = ElementUtils::createElement<Way>(*dependencyProvider.getStringTable(), 7, {{"any", "true"}},
+                                             {{1, -1}, {2, -2}});
+  Node erased = ElementUtils::createElement<Node>(*dependencyProvider.getStringTable(), 8, {{"any", "true"}});
+  erased.coordinate = {5, -5};
+  boost::filesystem::create_directories("data/2");
+  elementStore->store(node, LodRange(1, 1), *styleProvider);
+  elementStore->store(node, QuadKey(2, 1, 1));
+  elementStore->store(way, LodRange(1, 1), *styleProvider);
+  elementStore->store(erased, LodRange(1, 1), *styleProvider);
+  elementStore->erase(erased, LodRange(1, 1));
+
+  elementStore = utymap::utils::make_unique<PersistentElementStore>("", *dependencyProvider.getStringTable());
+  ElementCounter counter, erasedCounter, lodCounter;
+  elementStore->find(7, 1, counter, CancellationToken());
+  elementStore->find(8, 1, erasedCounter, CancellationToken());
+  elementStore->find(7, 2, lodCounter, CancellationToken());
+
+  BOOST_CHECK_EQUAL(counter.times, 2);
+  BOOST_CHECK_EQUAL(erasedCounter.times, 0);
+  BOOST_CHECK_EQUAL(lodCounter.times, 1);
+  assertNode(node, *std::dynamic_pointer_cast<Node>(lodCounter.element));
+  BOOST_CHECK(elementStore->contains(node));
+  BOOST_CHECK(!elementStore->contains(erased));
+  boost::filesystem::remove_all("data/2");
+}
+
+BOOST_AUTO_TEST_CASE(GivenCompactedTile_WhenFind_ThenElementIsReadFromNewLocation) {
+  auto styleProvider = dependencyProvider.getStyleProvider(stylesheet);
+  auto createArea = [&](std::uint64_t id, double offset) {
+    return ElementUtils::createElement<Area>(*dependencyProvider.getStringTable(), id, {{"any", "true"}},
+                                             {{1 + offset, -1}, {2 + offset, -2}, {3 + offset, -3}});
+  };
+  for (int i = 1; i <= 4; ++i)
+    elementStore->store(createArea(i, 0), LodRange(1, 1), *styleProvider);
+  elementStore->store(createArea(4, 1), LodRange(1, 1), *styleProvider);
+  elementStore->erase(createArea(1, 0), LodRange(1, 1));
+  ElementCounter counter;
+
+  elementStore->compact(CompactionOptions(), CancellationToken());
+  elementStore->find(4, 1, counter, CancellationToken());
+
+  BOOST_CHECK_EQUAL(counter.times, 1);
+  assertWayOrArea(createArea(4, 1), *std::dynamic_pointer_cast<Area>(counter.element));
+}
+
+BOOST_AUTO_TEST_CASE(GivenTaggedNodes_WhenSearchByTagsBeforeAndAfterStore_ThenOnlyMatchingAreReturned) {
+  QuadKey quadKey(1, 0, 0);
+  auto styleProvider = dependencyProvider.getStyleProvider(stylesheet);
+  auto &stringTable = *dependencyProvider.getStringTable();
+  auto createNode = [&](std::uint64_t id, const char *amenity) {
+    Node node = ElementUtils::createElement<Node>(stringTable, id, {{"any", "true"}, {"amenity", amenity}});
+    node.coordinate = {5, -5};
+    return node;
+  };
+  elementStore->store(createNode(1, "cafe"), LodRange(1, 1), *styleProvider);
+  elementStore->store(createNode(2, "shop"), LodRange(1, 1), *styleProvider);
+  elementStore->store(createNode(3, "cafe"), LodRange(1, 1), *styleProvider);
+  TagFilter filter = TagFilter().hasTag(stringTable.getId("amenity"), stringTable.getId("cafe"));
+  ElementCounter beforeCounter, afterCounter;
+
+  elementStore->search(quadKey, filter, beforeCounter, CancellationToken());
+  elementStore->store(createNode(4, "cafe"), LodRange(1, 1), *styleProvider);
+  elementStore->erase(createNode(1, "cafe"), LodRange(1, 1));
+  elementStore->search(quadKey, filter, afterCounter, CancellationToken());
+
+  BOOST_CHECK_EQUAL(beforeCounter.times, 2);
+  BOOST_CHECK_EQUAL(beforeCounter.element->id, 3);
+  BOOST_CHECK_EQUAL(afterCounter.times, 2);
+  BOOST_CHECK_EQUAL(afterCounter.element->id, 4);
+}
+
+BOOST_AUTO_TEST_CASE(GivenEmptyDirectory_WhenImportElement_ThenItIsContainedAndLocatedInNewStore) {
+  const std::string emptyPath = "persistent_store/";
+  boost::filesystem::remove_all(emptyPath);
+  auto styleProvider = dependencyProvider.getStyleProvider(stylesheet);
+  Node node = ElementUtils::createElement<Node>(*dependencyProvider.getStringTable(), 7, {{"any", "true"}});
+  node.coordinate = {5, -5};
+  bool isContained = false;
+  std::vector<QuadKey> quadKeys;
+  {
+    PersistentElementStore store(emptyPath, *dependencyProvider.getStringTable());
+    store.beginImport();
+    store.store(node, LodRange(1, 1), *styleProvider);
+    store.commitImport();
+  }
+
+  {
+    PersistentElementStore store(emptyPath, *dependencyProvider.getStringTable());
+    isContained = store.contains(node);
+    store.locate(node, 1, quadKeys);
+  }
+  boost::filesystem::remove_all(emptyPath);
+
+  BOOST_CHECK(isContained);
+  BOOST_REQUIRE_EQUAL(quadKeys.size(), 1);
+  BOOST_CHECK_EQUAL(quadKeys[0].tileX, 0);
+  BOOST_CHECK_EQUAL(quadKeys[0].tileY, 0);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,48 @@
+#include "index/QuadKeyOccupancy.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+using namespace utymap;
+using namespace utymap::index;
+
+namespace {
+struct Index_QuadKeyOccupancyFixture {
+  QuadKeyOccupancy occupancy;
+};
+}
+
+BOOST_FIXTURE_TEST_SUITE(Index_QuadKeyOccupancy, Index_QuadKeyOccupancyFixture)
+
+BOOST_AUTO_TEST_CASE(GivenQuadKey_WhenAddTwice_ThenOnlyFirstAddReturnsTrue) {
+  BOOST_CHECK(occupancy.add(QuadKey(16, 35205, 21489)));
+  BOOST_CHECK(!occupancy.add(QuadKey(16, 35205, 21489)));
+}
+
+BOOST_AUTO_TEST_CASE(GivenQuadKey_WhenHasData_ThenOnlyItHasData) {
+  occupancy.add(QuadKey(16, 35205, 21489));
+
+  BOOST_CHECK(occupancy.hasData(QuadKey(16, 35205, 21489)));
+  BOOST_CHECK(!occupancy.hasData(QuadKey(16, 35204, 21489)));
+  BOOST_CHECK(!occupancy.hasData(QuadKey(15, 17602, 10744)));
+}
+
+BOOST_AUTO_TEST_CASE(GivenQuadKey_WhenHasDescendantData_ThenReturnsTrueOnlyForAncestors) {
+  occupancy.add(QuadKey(16, 35205, 21489));
+
+  BOOST_CHECK(occupancy.hasDescendantData(QuadKey(15, 17602, 10744)));
+  BOOST_CHECK(occupancy.hasDescendantData(QuadKey(1, 1, 0)));
+  BOOST_CHECK(!occupancy.hasDescendantData(QuadKey(1, 0, 0)));
+  BOOST_CHECK(!occupancy.hasDescendantData(QuadKey(15, 17603, 10744)));
+  BOOST_CHECK(!occupancy.hasDescendantData(QuadKey(16, 35205, 21489)));
+}
+
+BOOST_AUTO_TEST_CASE(GivenQuadKey_WhenHasAncestorData_ThenReturnsTrueOnlyForDescendants) {
+  occupancy.add(QuadKey(10, 550, 335));
+
+  BOOST_CHECK(occupancy.hasAncestorData(QuadKey(11, 1100, 671)));
+  BOOST_CHECK(occupancy.hasAncestorData(QuadKey(16, 35205, 21489)));
+  BOOST_CHECK(!occupancy.hasAncestorData(QuadKey(10, 550, 335)));
+  BOOST_CHECK(!occupancy.hasAncestorData(QuadKey(11, 1102, 671)));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
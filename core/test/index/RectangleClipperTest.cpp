@@ -0,0 +1,85 @@
+#include "index/RectangleClipper.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+using namespace ClipperLib;
+using namespace utymap::index;
+
+namespace {
+struct Index_RectangleClipperFixture {
+  Index_RectangleClipperFixture() : clipper(0, 0, 100, 100) {}
+
+  static void checkPath(const Path &actual, const Path &expected) {
+    BOOST_REQUIRE_EQUAL(actual.size(), expected.size());
+    for (std::size_t i = 0; i < expected.size(); ++i) {
+      BOOST_CHECK_EQUAL(actual[i].X, expected[i].X);
+      BOOST_CHECK_EQUAL(actual[i].Y, expected[i].Y);
+    }
+  }
+
+  RectangleClipper clipper;
+};
+}
+
+BOOST_FIXTURE_TEST_SUITE(Index_RectangleClipper, Index_RectangleClipperFixture)
+
+BOOST_AUTO_TEST_CASE(GivenPolylineCrossingRectTwice_WhenClip_ThenReturnsPartsInOriginalOrder) {
+  Path polyline = {{-50, 20}, {50, 20}, {150, 20}, {150, 80}, {50, 80}, {-50, 80}};
+  Paths solution;
+
+  bool result = clipper.clipPolyline(polyline, solution);
+
+  BOOST_CHECK(result);
+  BOOST_REQUIRE_EQUAL(solution.size(), 2);
+  checkPath(solution[0], {{0, 20}, {50, 20}, {100, 20}});
+  checkPath(solution[1], {{100, 80}, {50, 80}, {0, 80}});
+}
+
+BOOST_AUTO_TEST_CASE(GivenPolylineTouchingBorder_WhenClip_ThenReturnsFalse) {
+  Path polyline = {{-50, 20}, {0, 50}, {-50, 80}};
+  Paths solution;
+
+  BOOST_CHECK(!clipper.clipPolyline(polyline, solution));
+}
+
+BOOST_AUTO_TEST_CASE(GivenRingCrossingRectOnce_WhenClip_ThenItIsClosedAlongBorder) {
+  Path ring = {{50, 50}, {150, 50}, {150, 150}, {50, 150}};
+  Paths solution;
+
+  bool result = clipper.clipRing(ring, solution);
+
+  BOOST_CHECK(result);
+  BOOST_REQUIRE_EQUAL(solution.size(), 1);
+  BOOST_CHECK_EQUAL(Area(solution[0]), 2500);
+  BOOST_CHECK(Orientation(solution[0]));
+}
+
+BOOST_AUTO_TEST_CASE(GivenClockwiseRingCrossingRectOnce_WhenClip_ThenOrientationIsPositive) {
+  Path ring = {{50, 150}, {150, 150}, {150, 50}, {50, 50}};
+  Paths solution;
+
+  clipper.clipRing(ring, solution);
+
+  BOOST_REQUIRE_EQUAL(solution.size(), 1);
+  BOOST_CHECK_EQUAL(Area(solution[0]), 2500);
+}
+
+BOOST_AUTO_TEST_CASE(GivenRingContainingRect_WhenClip_ThenReturnsRect) {
+  Path ring = {{-10, -10}, {110, -10}, {110, 110}, {-10, 110}};
+  Paths solution;
+
+  bool result = clipper.clipRing(ring, solution);
+
+  BOOST_CHECK(result);
+  BOOST_REQUIRE_EQUAL(solution.size(), 1);
+  BOOST_CHECK_EQUAL(Area(solution[0]), 10000);
+}
+
+BOOST_AUTO_TEST_CASE(GivenRingCrossingRectTwice_WhenClip_ThenReturnsFalse) {
+  Path ring = {{-10, 10}, {110, 10}, {110, 30}, {50, 30}, {50, 70}, {110, 70}, {110, 90}, {-10, 90}};
+  Paths solution;
+
+  BOOST_CHECK(!clipper.clipRing(ring, solution));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
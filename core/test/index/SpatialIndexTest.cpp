@@ -0,0 +1,57 @@
+#include "index/SpatialIndex.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <set>
+#include <sstream>
+
+using namespace utymap;
+using namespace utymap::index;
+
+namespace {
+struct Index_SpatialIndexFixture {
+  /// Creates index of unit boxes placed on grid of given size.
+  static SpatialIndex createGrid(int size) {
+    std::vector<SpatialIndex::Entry> entries;
+    for (int i = 0; i < size; ++i) {
+      for (int j = 0; j < size; ++j) {
+        BoundingBox bbox(GeoCoordinate(i, j), GeoCoordinate(i + 0.5, j + 0.5));
+        entries.push_back(SpatialIndex::Entry{bbox, static_cast<std::uint32_t>(i*size + j)});
+      }
+    }
+    return SpatialIndex(std::move(entries));
+  }
+
+  static std::set<std::uint32_t> query(const SpatialIndex &index, const BoundingBox &bbox) {
+    std::set<std::uint32_t> items;
+    index.query(bbox, [&](std::uint32_t item) { items.insert(item); });
+    return items;
+  }
+};
+}
+
+BOOST_FIXTURE_TEST_SUITE(Index_SpatialIndex, Index_SpatialIndexFixture)
+
+BOOST_AUTO_TEST_CASE(GivenGrid_WhenQuery_ThenReturnsOnlyIntersectingItems) {
+  auto index = createGrid(20);
+
+  auto items = query(index, BoundingBox(GeoCoordinate(2.7, 3.7), GeoCoordinate(4.2, 4.2)));
+
+  BOOST_CHECK_EQUAL(index.size(), 400);
+  BOOST_CHECK(items==(std::set<std::uint32_t>{3*20 + 4, 4*20 + 4}));
+}
+
+BOOST_AUTO_TEST_CASE(GivenGrid_WhenWriteAndRead_ThenQueryReturnsSameItems) {
+  auto index = createGrid(10);
+  BoundingBox bbox(GeoCoordinate(1, 1), GeoCoordinate(3, 3));
+  std::stringstream stream;
+
+  index.write(stream);
+  auto restored = SpatialIndex::read(stream);
+
+  BOOST_CHECK_EQUAL(restored.size(), index.size());
+  BOOST_CHECK(query(restored, bbox)==query(index, bbox));
+  BOOST_CHECK_EQUAL(query(restored, bbox).size(), 9);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -50,4 +50,40 @@ BOOST_AUTO_TEST_CASE(GivenThreeStrings_WhenGetStringOfSecond_ThenReturnValidStri
   BOOST_CHECK_EQUAL(str, "string2");
 }
 
+BOOST_AUTO_TEST_CASE(GivenString_WhenGetStringView_ThenReturnNullTerminatedData) {
+  std::uint32_t id = dependencyProvider.getStringTable()->getId("string1");
+
+  auto view = dependencyProvider.getStringTable()->getStringView(id);
+
+  BOOST_CHECK_EQUAL(view.size, 7);
+  BOOST_CHECK_EQUAL(std::string(view.data), "string1");
+}
+
+BOOST_AUTO_TEST_CASE(GivenStoredStrings_WhenReopenTable_ThenIdsAndStringsArePreserved) {
+  {
+    StringTable stringTable("");
+    stringTable.getId("string1");
+    stringTable.getId("string2");
+  }
+
+  auto stringTable = dependencyProvider.getStringTable();
+
+  BOOST_CHECK_EQUAL(stringTable->getId("string2"), 1);
+  BOOST_CHECK_EQUAL(stringTable->getString(0), "string1");
+  BOOST_CHECK_EQUAL(stringTable->getId("string3"), 2);
+  BOOST_CHECK_EQUAL(stringTable->getString(2), "string3");
+}
+
+BOOST_AUTO_TEST_CASE(GivenFlushedStrings_WhenOpenAnotherTable_ThenTheyAreRead) {
+  StringTable stringTable("");
+  stringTable.getId("string1");
+  stringTable.getId("string2");
+  stringTable.flush();
+
+  StringTable newTable("");
+
+  BOOST_CHECK_EQUAL(newTable.getId("string2"), 1);
+  BOOST_CHECK_EQUAL(newTable.getString(0), "string1");
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,78 @@
+#include "index/TagIndex.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <sstream>
+
+using namespace utymap;
+using namespace utymap::entities;
+using namespace utymap::index;
+
+namespace {
+const std::uint32_t AmenityKey = 1;
+const std::uint32_t NameKey = 2;
+const std::uint32_t BuildingKey = 3;
+const std::uint32_t CafeValue = 10;
+const std::uint32_t ShopValue = 11;
+const std::uint32_t YesValue = 12;
+
+struct Index_TagIndexFixture {
+  /// Creates index where every item has unique name, every third item is cafe,
+  /// every fifth is shop and every even one is building.
+  static TagIndex createIndex(std::uint32_t size) {
+    std::vector<TagIndex::Entry> entries;
+    for (std::uint32_t i = 0; i < size; ++i) {
+      std::vector<Tag> tags = {Tag(NameKey, 1000 + i)};
+      if (i%3==0) tags.push_back(Tag(AmenityKey, CafeValue));
+      else if (i%5==0) tags.push_back(Tag(AmenityKey, ShopValue));
+      if (i%2==0) tags.push_back(Tag(BuildingKey, YesValue));
+      entries.push_back(TagIndex::Entry{tags, i});
+    }
+    return TagIndex(entries);
+  }
+};
+}
+
+BOOST_FIXTURE_TEST_SUITE(Index_TagIndex, Index_TagIndexFixture)
+
+BOOST_AUTO_TEST_CASE(GivenIndex_WhenQueryByKeyAndValue_ThenReturnsOnlyMatchingItems) {
+  auto index = createIndex(100);
+
+  auto items = index.query(TagFilter().hasTag(AmenityKey, CafeValue).hasKey(BuildingKey));
+
+  BOOST_CHECK_EQUAL(index.size(), 100);
+  BOOST_REQUIRE_EQUAL(items.size(), 17);
+  for (std::size_t i = 0; i < items.size(); ++i)
+    BOOST_CHECK_EQUAL(items[i], i*6);
+}
+
+BOOST_AUTO_TEST_CASE(GivenKeyWithManyValues_WhenQueryByValue_ThenReturnsAllItemsWithKey) {
+  auto index = createIndex(100);
+
+  auto items = index.query(TagFilter().hasTag(NameKey, 1005));
+
+  BOOST_CHECK_EQUAL(items.size(), 100);
+}
+
+BOOST_AUTO_TEST_CASE(GivenIndex_WhenQueryByMissingTag_ThenReturnsNothing) {
+  auto index = createIndex(100);
+
+  BOOST_CHECK(index.query(TagFilter().hasTag(AmenityKey, YesValue)).empty());
+  BOOST_CHECK(index.query(TagFilter().hasKey(42)).empty());
+  BOOST_CHECK_EQUAL(index.query(TagFilter()).size(), 100);
+}
+
+BOOST_AUTO_TEST_CASE(GivenIndex_WhenWriteAndRead_ThenQueryReturnsSameItems) {
+  auto index = createIndex(100);
+  TagFilter filter = TagFilter().hasTag(AmenityKey, ShopValue);
+  std::stringstream stream;
+
+  index.write(stream);
+  auto result = TagIndex::read(stream);
+
+  BOOST_CHECK_EQUAL(result.size(), index.size());
+  BOOST_CHECK(result.query(filter)==index.query(filter));
+  BOOST_CHECK_EQUAL(result.query(TagFilter().hasTag(NameKey, 1)).size(), 100);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,100 @@
+#include "entities/Node.hpp"
+#include "entities/Way.hpp"
+#include "entities/Area.hpp"
+#include "index/BoundingBoxVisitor.hpp"
+#include "index/TileCoverage.hpp"
+#include "utils/GeoUtils.hpp"
+
+#include <boost/test/unit_test.hpp>
+#include "test_utils/DependencyProvider.hpp"
+#include "test_utils/ElementUtils.hpp"
+
+#include <set>
+
+using namespace utymap;
+using namespace utymap::entities;
+using namespace utymap::index;
+using namespace utymap::tests;
+using namespace utymap::utils;
+
+namespace {
+const int LevelOfDetail = 10;
+
+struct Index_TileCoverageFixture {
+  template<typename T>
+  T createElement(std::initializer_list<std::pair<double, double>> geometry) {
+    return ElementUtils::createElement<T>(*dependencyProvider.getStringTable(), 1, {}, geometry);
+  }
+
+  static std::set<std::string> getCoverage(const Element &element) {
+    std::set<std::string> quadKeys;
+    TileCoverage::visit(element, LevelOfDetail, [&](const QuadKey &quadKey, const BoundingBox &) {
+      quadKeys.insert(GeoUtils::quadKeyToString(quadKey));
+    });
+    return quadKeys;
+  }
+
+  static std::size_t getTileRangeSize(const Element &element) {
+    std::size_t count = 0;
+    GeoUtils::visitTileRange(BoundingBoxVisitor::create(element), LevelOfDetail,
+                             [&](const QuadKey &, const BoundingBox &) { ++count; });
+    return count;
+  }
+
+  static std::string getQuadKey(double latitude, double longitude) {
+    return GeoUtils::quadKeyToString(GeoUtils::GeoCoordinateToQuadKey(GeoCoordinate(latitude, longitude),
+                                                                      LevelOfDetail));
+  }
+
+  DependencyProvider dependencyProvider;
+};
+}
+
+BOOST_FIXTURE_TEST_SUITE(Index_TileCoverage, Index_TileCoverageFixture)
+
+BOOST_AUTO_TEST_CASE(GivenNode_WhenVisit_ThenOnlyItsTileIsCovered) {
+  Node node;
+  node.coordinate = GeoCoordinate(52.5312, 13.3871);
+
+  auto coverage = getCoverage(node);
+
+  BOOST_CHECK_EQUAL(coverage.size(), 1);
+  BOOST_CHECK(coverage.count(getQuadKey(52.5312, 13.3871))==1);
+}
+
+BOOST_AUTO_TEST_CASE(GivenDiagonalWay_WhenVisit_ThenCoverageIsSmallerThanTileRange) {
+  auto way = createElement<Way>({{52.1, 13.1}, {53.9, 14.9}});
+
+  auto coverage = getCoverage(way);
+
+  BOOST_CHECK_LT(coverage.size()*3, getTileRangeSize(way));
+  BOOST_CHECK(coverage.count(getQuadKey(52.1, 13.1))==1);
+  BOOST_CHECK(coverage.count(getQuadKey(53, 14))==1);
+  BOOST_CHECK(coverage.count(getQuadKey(53.9, 14.9))==1);
+  BOOST_CHECK(coverage.count(getQuadKey(53.9, 13.1))==0);
+}
+
+BOOST_AUTO_TEST_CASE(GivenConcaveArea_WhenVisit_ThenInteriorIsCoveredAndNotchIsSkipped) {
+  auto area = createElement<Area>({{52, 13}, {52, 15}, {52.5, 15}, {52.5, 13.5}, {54, 13.5}, {54, 13}});
+
+  auto coverage = getCoverage(area);
+
+  BOOST_CHECK(coverage.count(getQuadKey(53, 13.25))==1);
+  BOOST_CHECK(coverage.count(getQuadKey(52.25, 14.5))==1);
+  BOOST_CHECK(coverage.count(getQuadKey(53.5, 14.5))==0);
+  BOOST_CHECK_LT(coverage.size(), getTileRangeSize(area));
+}
+
+BOOST_AUTO_TEST_CASE(GivenWayAlongTileBorder_WhenVisit_ThenTilesOnBothSidesAreCovered) {
+  auto bbox = GeoUtils::quadKeyToBoundingBox(QuadKey(LevelOfDetail, 550, 335));
+  double longitude = bbox.minPoint.longitude;
+  auto way = createElement<Way>({{bbox.minPoint.latitude + 0.01, longitude}, {bbox.maxPoint.latitude - 0.01, longitude}});
+
+  auto coverage = getCoverage(way);
+
+  BOOST_CHECK_EQUAL(coverage.size(), 2);
+  BOOST_CHECK(coverage.count(GeoUtils::quadKeyToString(QuadKey(LevelOfDetail, 550, 335)))==1);
+  BOOST_CHECK(coverage.count(GeoUtils::quadKeyToString(QuadKey(LevelOfDetail, 549, 335)))==1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -4,10 +4,14 @@
 #include "entities/Relation.hpp"
 #include "mapcss/StyleProvider.hpp"
 #include "test_utils/ElementUtils.hpp"
+#include "utils/CoreUtils.hpp"
 
 #include <boost/test/unit_test.hpp>
 #include "test_utils/DependencyProvider.hpp"
 
+#include <sstream>
+#include <thread>
+
 using namespace utymap::entities;
 using namespace utymap::mapcss;
 using namespace utymap::tests;
@@ -183,4 +187,112 @@ BOOST_AUTO_TEST_CASE(GivenTwoEqualStyles_WhenConstructed_ThenTheyHaveTheSameTag)
   BOOST_CHECK_EQUAL(tag1, tag2);
 }
 
+BOOST_AUTO_TEST_CASE(GivenRulesWithClipAndSkip_WhenForLodRange_ThenDecisionsMatchStylePerLod) {
+  auto stringTable = dependencyProvider.getStringTable();
+  setSingleSelector(1, 10, {"way"}, {{"highway", "", ""}}, {{"clip", "true"}});
+  setSingleSelector(5, 8, {"way"}, {{"highway", "=", "primary"}}, {{"clip", "false"}});
+  setSingleSelector(7, 12, {"way"}, {{"highway", "", ""}}, {{"skip", "true"}});
+  setSingleSelector(12, 16, {"way"}, {{"highway", "", ""}}, {{"skip", "false"}});
+  Way way = ElementUtils::createElement<Way>(*stringTable, 0, {std::make_pair("highway", "primary")});
+  auto clipKey = stringTable->getId("clip"), skipKey = stringTable->getId("skip");
+
+  StyleSpan span = styleProvider->forLodRange(way, utymap::LodRange(1, 16));
+
+  for (int lod = 1; lod <= 16; ++lod) {
+    Style style = styleProvider->forElement(way, lod);
+    BOOST_CHECK_EQUAL(span.isStored(lod), !style.empty() && !style.has(skipKey, "true"));
+    if (span.isStored(lod))
+      BOOST_CHECK_EQUAL(span.isClipped(lod), style.has(clipKey, "true"));
+  }
+  BOOST_CHECK(span.isClipped(1) && !span.isClipped(5) && !span.isStored(7) && span.isStored(12));
+}
+
+BOOST_AUTO_TEST_CASE(GivenWrittenMatches_WhenReadBySameStylesheet_ThenStyleIsBuiltFromThem) {
+  auto stringTable = dependencyProvider.getStringTable();
+  setSingleSelector(1, 1, {"way"}, {{"highway", "", ""}}, {{"width", "1"}, {"color", "red"}});
+  setSingleSelector(1, 1, {"way"}, {{"highway", "=", "primary"}}, {{"width", "2"}});
+  Way way = ElementUtils::createElement<Way>(*stringTable, 0, {std::make_pair("highway", "primary")});
+  styleProvider->forElement(way, 1);
+  std::stringstream stream;
+  styleProvider->writeMatches(stream);
+
+  StyleProvider newStyleProvider(*stylesheet, *stringTable);
+  bool wasRead = newStyleProvider.readMatches(stream);
+  Style style = newStyleProvider.forElement(way, 1);
+
+  BOOST_CHECK(wasRead);
+  BOOST_CHECK_EQUAL(style.getString("width"), "2");
+  BOOST_CHECK_EQUAL(style.getString("color"), "red");
+}
+
+BOOST_AUTO_TEST_CASE(GivenMatchesOfDifferentStylesheet_WhenRead_ThenTheyAreRejected) {
+  auto stringTable = dependencyProvider.getStringTable();
+  setSingleSelector(1, 1, {"way"}, {{"highway", "", ""}}, {{"width", "1"}});
+  Way way = ElementUtils::createElement<Way>(*stringTable, 0, {std::make_pair("highway", "primary")});
+  styleProvider->forElement(way, 1);
+  std::stringstream stream;
+  styleProvider->writeMatches(stream);
+
+  setSingleSelector(1, 1, {"way"}, {{"highway", "=", "primary"}}, {{"width", "2"}});
+
+  BOOST_CHECK(!styleProvider->readMatches(stream));
+  BOOST_CHECK_EQUAL(styleProvider->forElement(way, 1).getString("width"), "2");
+}
+
+BOOST_AUTO_TEST_CASE(GivenWaysWithDifferentTags_WhenForElementConcurrently_ThenStylesAreBuiltFromTheirMatches) {
+  auto stringTable = dependencyProvider.getStringTable();
+  setSingleSelector(1, 1, {"way"}, {{"highway", "", ""}}, {{"width", "1"}});
+  setSingleSelector(1, 1, {"way"}, {{"highway", "=", "primary"}}, {{"width", "2"}});
+  setSingleSelector(1, 1, {"way"}, {{"layer", "", ""}}, {{"color", "red"}});
+  std::vector<Way> ways;
+  for (int i = 0; i < 64; ++i) {
+    auto layer = utymap::utils::toString(i);
+    ways.push_back(ElementUtils::createElement<Way>(*stringTable, 0, {
+        std::make_pair("highway", i%2==0 ? "primary" : "residential"),
+        std::make_pair("layer", layer.c_str())}));
+  }
+  std::vector<std::string> widths(ways.size()*4);
+  std::vector<std::thread> threads;
+
+  for (std::size_t t = 0; t < 4; ++t) {
+    threads.emplace_back([&, t]() {
+      for (std::size_t i = 0; i < ways.size(); ++i)
+        widths[t*ways.size() + i] = styleProvider->forElement(ways[i], 1).getString("width");
+    });
+  }
+  for (auto &thread : threads)
+    thread.join();
+
+  for (std::size_t i = 0; i < widths.size(); ++i)
+    BOOST_CHECK_EQUAL(widths[i], (i%ways.size())%2==0 ? "2" : "1");
+}
+
+BOOST_AUTO_TEST_CASE(GivenWaysWithDifferentNames_WhenForElement_ThenOnlyConditionTagsAffectStyle) {
+  auto stringTable = dependencyProvider.getStringTable();
+  setSingleSelector(1, 1, {"way"}, {{"highway", "", ""}}, {{"width", "1"}});
+  setSingleSelector(1, 1, {"way"}, {{"highway", "=", "primary"}}, {{"width", "2"}});
+  Way primary1 = ElementUtils::createElement<Way>(*stringTable, 0, {std::make_pair("highway", "primary"),
+                                                                    std::make_pair("name", "first")});
+  Way primary2 = ElementUtils::createElement<Way>(*stringTable, 0, {std::make_pair("highway", "primary"),
+                                                                    std::make_pair("name", "second")});
+  Way residential = ElementUtils::createElement<Way>(*stringTable, 0, {std::make_pair("highway", "residential"),
+                                                                       std::make_pair("name", "first")});
+
+  BOOST_CHECK_EQUAL(styleProvider->forElement(primary1, 1).getString("width"), "2");
+  BOOST_CHECK_EQUAL(styleProvider->forElement(primary2, 1).getString("width"), "2");
+  BOOST_CHECK_EQUAL(styleProvider->forElement(residential, 1).getString("width"), "1");
+}
+
+BOOST_AUTO_TEST_CASE(GivenConditionsAndEvalDeclarations_WhenGetTagKeys_ThenReturnsReferencedKeys) {
+  setSingleSelector(1, 1, {"way"}, {{"highway", "", ""}}, {{"width", "eval(\"tag('lanes') * 2\")"}});
+  setSingleSelector(1, 1, {"area"}, {{"building", "=", "yes"}, {"amenity", "!=", "cafe"}},
+                    {{"height", "eval(\"tag('height') - tag('min_height')\")"}, {"color", "red"}});
+
+  auto keys = styleProvider->getTagKeys();
+
+  BOOST_CHECK_EQUAL(keys.size(), 6);
+  for (const auto &key : {"highway", "lanes", "building", "amenity", "height", "min_height"})
+    BOOST_CHECK(keys.find(key)!=keys.end());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
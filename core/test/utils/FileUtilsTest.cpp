@@ -0,0 +1,40 @@
+#include "utils/FileUtils.hpp"
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <fstream>
+
+using namespace utymap::utils;
+
+namespace {
+const std::string TestDirectory = "file_utils/";
+}
+
+BOOST_AUTO_TEST_SUITE(Utils_FileUtils)
+
+BOOST_AUTO_TEST_CASE(GivenMissingNestedDirectory_WhenCreate_ThenItExists) {
+  BOOST_CHECK(FileUtils::createDirectories(TestDirectory + "data/1/"));
+  BOOST_CHECK(FileUtils::createDirectories(TestDirectory + "data/1"));
+
+  BOOST_CHECK(boost::filesystem::is_directory(TestDirectory + "data/1"));
+  boost::filesystem::remove_all(TestDirectory);
+}
+
+BOOST_AUTO_TEST_CASE(GivenDirectoryWithFilesAndSubdirectories_WhenRemove_ThenItIsRemoved) {
+  boost::filesystem::create_directories(TestDirectory + "data/1");
+  std::ofstream(TestDirectory + "data/ids.dat") << "ids";
+  std::ofstream(TestDirectory + "data/1/0.dat") << "data";
+
+  FileUtils::removeDirectory(TestDirectory);
+
+  BOOST_CHECK(!boost::filesystem::exists(TestDirectory));
+}
+
+BOOST_AUTO_TEST_CASE(GivenMissingDirectory_WhenRemove_ThenNothingHappens) {
+  FileUtils::removeDirectory(TestDirectory + "missing");
+
+  BOOST_CHECK(!boost::filesystem::exists(TestDirectory + "missing"));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
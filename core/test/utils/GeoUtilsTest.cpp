@@ -58,6 +58,35 @@ BOOST_AUTO_TEST_CASE(GivenQuadKeyAtNineteenLod_WhenToString_ThenReturnValidCode)
   BOOST_CHECK_EQUAL("1202102332220103020", code);
 }
 
+BOOST_AUTO_TEST_CASE(GivenQuadKeyString_WhenParse_ThenReturnValidQuadKey) {
+  QuadKey quadKey;
+
+  BOOST_REQUIRE(GeoUtils::stringToQuadKey("1202102332220103020", quadKey));
+
+  BOOST_CHECK_EQUAL(quadKey.levelOfDetail, 19);
+  BOOST_CHECK_EQUAL(quadKey.tileX, 281640);
+  BOOST_CHECK_EQUAL(quadKey.tileY, 171914);
+  BOOST_CHECK(!GeoUtils::stringToQuadKey("ids", quadKey));
+  BOOST_CHECK(!GeoUtils::stringToQuadKey("", quadKey));
+}
+
+BOOST_AUTO_TEST_CASE(GivenQuadKeyAtNineteenLod_WhenToCodeAndBack_ThenReturnSameQuadKey) {
+  QuadKey quadKey(19, 281640, 171914);
+
+  QuadKey result = GeoUtils::codeToQuadKey(GeoUtils::quadKeyToCode(quadKey));
+
+  BOOST_CHECK_EQUAL(result.levelOfDetail, 19);
+  BOOST_CHECK_EQUAL(result.tileX, 281640);
+  BOOST_CHECK_EQUAL(result.tileY, 171914);
+}
+
+BOOST_AUTO_TEST_CASE(GivenQuadKeysAtSameLod_WhenToCode_ThenCodesHaveStringOrder) {
+  QuadKey first(2, 1, 0), second(2, 0, 1);
+
+  BOOST_CHECK(GeoUtils::quadKeyToString(first) < GeoUtils::quadKeyToString(second));
+  BOOST_CHECK(GeoUtils::quadKeyToCode(first) < GeoUtils::quadKeyToCode(second));
+}
+
 BOOST_AUTO_TEST_CASE(GivenBboxAtLodOne_WhenVisitTileRange_VisitsOneTile) {
   BoundingBox bbox(GeoCoordinate(1, 1), GeoCoordinate(2, 2));
   int count = 0;
@@ -0,0 +1,220 @@
+#include "Application.hpp"
+#include "utils/CoreUtils.hpp"
+#include "utils/GeoUtils.hpp"
+
+#include <boost/filesystem/operations.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+using namespace utymap;
+using namespace utymap::utils;
+
+namespace {
+const char *StoreKey = "seed";
+const char *JournalFileName = "seed.journal";
+
+/// Keeps settings passed via command line.
+struct Settings final {
+  std::string dataPath;
+  std::string stylePath;
+  std::string journalPath;
+  BoundingBox bbox;
+  int startLod = 0;
+  int endLod = 0;
+  Application::PersistentStoreType storeType = Application::PersistentStoreType::Files;
+  Application::ElevationDataType eleDataType = Application::ElevationDataType::Flat;
+  std::size_t threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+};
+
+void printUsage() {
+  std::cout << "Usage: utymap-seed --data <path> --style <mapcss> --bbox <minLat,minLon,maxLat,maxLon>" << std::endl
+            << "                   --lod <start,end> [--store files|packed] [--elevation flat|srtm|grid]" << std::endl
+            << "                   [--threads <count>] [--journal <path>]" << std::endl
+            << "Builds all quadkeys with data inside bounding box and level of details range, so their" << std::endl
+            << "meshes are written to mesh cache. Interrupted run continues from its journal." << std::endl;
+}
+
+/// Parses settings from command line arguments.
+Settings parseSettings(int argc, char *argv[]) {
+  Settings settings;
+  for (int i = 1; i < argc; i += 2) {
+    std::string name = argv[i];
+    if (i + 1 >= argc)
+      throw std::invalid_argument("Missing value of " + name);
+    std::string value = argv[i + 1];
+
+    if (name=="--data")
+      settings.dataPath = value.back()=='/' || value.back()=='\\' ? value : value + '/';
+    else if (name=="--style")
+      settings.stylePath = value;
+    else if (name=="--journal")
+      settings.journalPath = value;
+    else if (name=="--bbox") {
+      auto parts = splitBy(',', value);
+      if (parts.size()!=4)
+        throw std::invalid_argument("Bounding box should have four values.");
+      settings.bbox = BoundingBox(GeoCoordinate(lexicalCast<double>(parts[0]), lexicalCast<double>(parts[1])),
+                                  GeoCoordinate(lexicalCast<double>(parts[2]), lexicalCast<double>(parts[3])));
+    } else if (name=="--lod") {
+      auto parts = splitBy(',', value);
+      settings.startLod = lexicalCast<int>(parts.front());
+      settings.endLod = lexicalCast<int>(parts.back());
+    } else if (name=="--store")
+      settings.storeType = value=="packed"
+                           ? Application::PersistentStoreType::Packed
+                           : Application::PersistentStoreType::Files;
+    else if (name=="--elevation")
+      settings.eleDataType = value=="srtm" ? Application::ElevationDataType::Srtm :
+                             (value=="grid" ? Application::ElevationDataType::Grid
+                                            : Application::ElevationDataType::Flat);
+    else if (name=="--threads")
+      settings.threadCount = std::max(lexicalCast<std::size_t>(value), std::size_t(1));
+    else
+      throw std::invalid_argument("Unknown option " + name);
+  }
+
+  if (settings.dataPath.empty() || settings.stylePath.empty() || !settings.bbox.isValid())
+    throw std::invalid_argument("Data path, stylesheet and bounding box are required.");
+  if (settings.journalPath.empty())
+    settings.journalPath = settings.dataPath + JournalFileName;
+
+  // NOTE validates level of details.
+  LodRange(settings.startLod, settings.endLod);
+  return settings;
+}
+
+/// Keeps quadkeys which are already built by previous runs.
+/// NOTE journal is removed when all quadkeys are built, so cache invalidated later is seeded again.
+class Journal final {
+ public:
+  explicit Journal(const std::string &path) : path_(path) {
+    std::ifstream file(path);
+    std::string quadKey;
+    while (file >> quadKey)
+      quadKeys_.insert(quadKey);
+    file_.open(path, std::ios::out | std::ios::app);
+  }
+
+  bool contains(const QuadKey &quadKey) const {
+    return quadKeys_.find(GeoUtils::quadKeyToString(quadKey))!=quadKeys_.end();
+  }
+
+  std::size_t size() const {
+    return quadKeys_.size();
+  }
+
+  void add(const QuadKey &quadKey) {
+    file_ << GeoUtils::quadKeyToString(quadKey) << std::endl;
+  }
+
+  void remove() {
+    file_.close();
+    std::remove(path_.c_str());
+  }
+
+ private:
+  const std::string path_;
+  std::unordered_set<std::string> quadKeys_;
+  std::ofstream file_;
+};
+
+/// Set when quadkey built by current thread has failed.
+thread_local bool hasError = false;
+
+void createDirectory(const char *path) {
+  boost::filesystem::create_directories(path);
+}
+
+void reportError(const char *message) {
+  hasError = true;
+  std::cerr << "Error: " << message << std::endl;
+}
+
+long long getMilliseconds(const std::chrono::steady_clock::time_point &start) {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+}
+}
+
+int main(int argc, char *argv[]) {
+  Settings settings;
+  try {
+    settings = parseSettings(argc, argv);
+  } catch (std::exception &ex) {
+    std::cerr << ex.what() << std::endl;
+    printUsage();
+    return 1;
+  }
+
+  Application application(settings.dataPath.c_str());
+  try {
+    application.registerStylesheet(settings.stylePath.c_str(), createDirectory);
+    application.registerPersistentStore(StoreKey, settings.dataPath.c_str(), settings.storeType, createDirectory);
+  } catch (std::exception &ex) {
+    std::cerr << ex.what() << std::endl;
+    return 1;
+  }
+
+  Journal journal(settings.journalPath);
+  std::vector<QuadKey> quadKeys;
+  for (int lod = settings.startLod; lod <= settings.endLod; ++lod) {
+    GeoUtils::visitTileRange(settings.bbox, lod, [&](const QuadKey &quadKey, const BoundingBox &) {
+      if (application.hasData(quadKey) && !journal.contains(quadKey))
+        quadKeys.push_back(quadKey);
+    });
+  }
+  std::cout << "Seeding " << quadKeys.size() << " quadkeys using " << settings.threadCount << " threads, "
+            << journal.size() << " are already built." << std::endl;
+
+  std::atomic<std::size_t> next(0);
+  std::size_t built = 0, failed = 0;
+  std::mutex lock;
+  CancellationToken cancelToken;
+  auto start = std::chrono::steady_clock::now();
+
+  auto worker = [&]() {
+    for (std::size_t i = next++; i < quadKeys.size(); i = next++) {
+      const QuadKey &quadKey = quadKeys[i];
+      auto tileStart = std::chrono::steady_clock::now();
+      hasError = false;
+      application.buildQuadKey(settings.stylePath.c_str(), quadKey, settings.eleDataType, reportError, cancelToken);
+      auto milliseconds = getMilliseconds(tileStart);
+
+      std::lock_guard<std::mutex> guard(lock);
+      if (hasError)
+        ++failed;
+      else {
+        ++built;
+        journal.add(quadKey);
+      }
+      std::cout << "[" << built + failed << "/" << quadKeys.size() << "] "
+                << quadKey.levelOfDetail << "/" << quadKey.tileX << "/" << quadKey.tileY << " "
+                << (hasError ? "failed" : "built") << " in " << milliseconds << " ms" << std::endl;
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (std::size_t i = 0; i < settings.threadCount; ++i)
+    threads.emplace_back(worker);
+  for (auto &thread : threads)
+    thread.join();
+
+  auto milliseconds = getMilliseconds(start);
+  std::cout << "Built " << built << " quadkeys, failed " << failed << ", total " << milliseconds << " ms";
+  if (built > 0)
+    std::cout << ", " << milliseconds*settings.threadCount/built << " ms per quadkey and thread";
+  std::cout << "." << std::endl;
+
+  if (failed > 0)
+    return 1;
+
+  journal.remove();
+  return 0;
+}
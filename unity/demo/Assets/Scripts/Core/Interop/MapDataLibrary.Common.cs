@@ -51,7 +51,7 @@ namespace Assets.Scripts.Core.Interop
                 // NOTE actually, it is possible to have multiple in-memory and persistent 
                 // storages at the same time.
                 registerInMemoryStore(InMemoryStoreKey);
-                registerPersistentStore(PersistentStoreKey, indexPath, OnCreateDirectory);
+                registerPersistentStore(PersistentStoreKey, indexPath, 0, OnCreateDirectory);
                 // NOTE Enable mesh caching mechanism for speed up tile loading.
                 enableMeshCache(1);
                 
@@ -198,7 +198,7 @@ namespace Assets.Scripts.Core.Interop
         private static extern void registerInMemoryStore(string key);
 
         [DllImport("UtyMap.Shared")]
-        private static extern void registerPersistentStore(string key, string path, OnNewDirectory directoryHandler);
+        private static extern void registerPersistentStore(string key, string path, int storeType, OnNewDirectory directoryHandler);
 
         [DllImport("UtyMap.Shared")]
         private static extern void addToStoreInRange(string key, string stylePath, string path, int startLod, int endLod, OnError errorHandler);
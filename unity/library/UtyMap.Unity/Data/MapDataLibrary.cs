@@ -129,7 +129,7 @@ namespace UtyMap.Unity.Data
                 // NOTE actually, it is possible to have multiple in-memory and persistent 
                 // storages at the same time.
                 registerInMemoryStore(InMemoryStoreKey);
-                registerPersistentStore(PersistentStoreKey, indexPath, CreateDirectory);
+                registerPersistentStore(PersistentStoreKey, indexPath, 0, CreateDirectory);
                 
                 _isConfigured = true;
             }
@@ -375,7 +375,7 @@ namespace UtyMap.Unity.Data
         private static extern void registerInMemoryStore(string key);
 
         [DllImport("UtyMap.Shared")]
-        private static extern void registerPersistentStore(string key, string path, OnNewDirectory directoryHandler);
+        private static extern void registerPersistentStore(string key, string path, int storeType, OnNewDirectory directoryHandler);
 
         [DllImport("UtyMap.Shared")]
         private static extern void addToStoreInRange(string key, string stylePath, string path, int startLod, int endLod, OnError errorHandler);